@@ -116,6 +116,13 @@ LCUI_API size_t LCUIDisplay_Render(void);
 /** 呈现渲染后的内容 */
 LCUI_API void LCUIDisplay_Present(void);
 
+/**
+ * Wait for the previous frame to be presented
+ * It only blocks in pipelined present mode, where the rendered surfaces are
+ * presented on a separate thread.
+ */
+LCUI_API void LCUIDisplay_WaitPresent(void);
+
 LCUI_API void LCUIDisplay_EnablePaintFlashing(LCUI_BOOL enable);
 
 /** 设置显示区域的尺寸，仅在窗口化、全屏模式下有效 */
@@ -67,6 +67,12 @@ typedef struct LCUI_FontBitmap_ {
 	LCUI_Pos advance;	/**< XY轴的跨距 */
 } LCUI_FontBitmap;
 
+/** 字形串中的字形 */
+typedef struct LCUI_GlyphRec_ {
+	const LCUI_FontBitmap *bitmap; /**< 字体位图 */
+	LCUI_Pos pos;                  /**< 字体位图在目标图像中的坐标 */
+} LCUI_GlyphRec, *LCUI_Glyph;
+
 typedef struct LCUI_FontEngine LCUI_FontEngine;
 
 typedef struct LCUI_FontRec_ {
@@ -77,11 +83,14 @@ typedef struct LCUI_FontRec_ {
 	LCUI_FontStyle style;		/**< 风格 */
 	LCUI_FontWeight weight;		/**< 粗细程度 */
 	LCUI_FontEngine *engine;	/**< 所属的字体引擎 */
+	char *path;			/**< 字体文件路径，用于延迟载入字体 */
+	int face_index;			/**< 字体在字体文件中的索引 */
 } LCUI_FontRec, *LCUI_Font;
 
 struct LCUI_FontEngine {
 	char name[64];
 	int(*open)(const char*, LCUI_Font**);
+	int(*open_face)(const char*, int, void**);
 	int(*render)(LCUI_FontBitmap*, wchar_t, int, LCUI_Font);
 	void(*close)(void*);
 };
@@ -138,6 +147,15 @@ LCUI_API int FontBitmap_Print(LCUI_FontBitmap *fontbmp);
 LCUI_API int FontBitmap_Mix(LCUI_Graph *graph, LCUI_Pos pos,
 			    const LCUI_FontBitmap *bmp, LCUI_Color color);
 
+/**
+ * 将一串同色的字体位图绘制到目标图像上
+ * @param[in] clip 裁剪区域，坐标相对于 graph，为 NULL 时只按 graph 的范围裁剪
+ * @param[in] glyphs 字形列表，位图为 NULL 的字形会被跳过
+ */
+LCUI_API int FontBitmap_MixGlyphs(LCUI_Graph *graph, const LCUI_Rect *clip,
+				  const LCUI_GlyphRec *glyphs, size_t count,
+				  LCUI_Color color);
+
 /** 载入字体位图 */
 LCUI_API int LCUIFont_RenderBitmap(LCUI_FontBitmap *buff, wchar_t ch,
 				   int font_id, int pixel_size);
@@ -215,12 +233,26 @@ LCUI_API LCUI_FontBitmap* LCUIFont_AddBitmap(wchar_t ch, int font_id,
  * @param[in] font_id 使用的字体ID
  * @param[in] size 字体大小（单位为像素）
  * @param[out] bmp 输出的字体位图的引用
+ * @returns 获取成功返回 0，字体位图正在预渲染时返回 1，此时 bmp 为只有跨距
+ * 的占位位图，预渲染完成后会触发 LCUI_FONT_BITMAPS_READY 事件
  * @warning 请勿释放 bmp，bmp 仅仅是引用缓存中的字体位图，并未建分配新
  * 空间存储字体位图的拷贝。
  */
 LCUI_API int LCUIFont_GetBitmap(wchar_t ch, int font_id, int size,
 				const LCUI_FontBitmap **bmp);
 
+/**
+ * 预渲染字体位图
+ * 在工作线程中渲染文本中尚未缓存的字符，渲染完成后在主线程中加入缓存，
+ * 可用于预先准备新文本或某个语言的常用字符的字体位图，避免在排版时同步渲染
+ * @param[in] text 文本
+ * @param[in] font_ids 字体ID列表，以 0 结尾，为 NULL 时只使用默认字体
+ * @param[in] size 字体大小（单位为像素）
+ * @returns 需要渲染的字符数量
+ */
+LCUI_API int LCUIFont_PrepareBitmaps(const wchar_t *text, const int *font_ids,
+				     int size);
+
 /** 载入字体至数据库中 */
 LCUI_API int LCUIFont_LoadFile(const char *filepath);
 
@@ -33,12 +33,6 @@
 
 LCUI_BEGIN_HEADER
 
-typedef struct LCUI_TextCharRec_ {
-	wchar_t code;                  /**< 字符码 */
-	LCUI_TextStyle style;          /**< 该字符使用的样式数据 */
-	const LCUI_FontBitmap *bitmap; /**< 字体位图数据(只读) */
-} LCUI_TextCharRec, *LCUI_TextChar;
-
 /** End Of Line character */
 typedef enum LCUI_EOLChar {
 	LCUI_EOL_NONE, /**< 无换行 */
@@ -47,14 +41,30 @@ typedef enum LCUI_EOLChar {
 	LCUI_EOL_CR_LF /**< Windows 格式换行： \r\n */
 } LCUI_EOLChar;
 
-/* 文本行 */
+/**
+ * 文本行
+ * 各个字符的数据按字段存放在连续的数组中，排版和绘制时只需顺序读取需要的字段
+ */
 typedef struct TextRowRec_ {
-	int width;             /**< 宽度 */
-	int height;            /**< 高度 */
-	int text_height;       /**< 当前行中最大字体的高度 */
-	int length;            /**< 该行文本长度 */
-	LCUI_TextChar *string; /**< 该行文本的数据 */
-	LCUI_EOLChar eol;      /**< 行尾结束类型 */
+	int width;       /**< 宽度 */
+	int height;      /**< 高度 */
+	int text_height; /**< 当前行中最大字体的高度 */
+	int length;      /**< 该行文本长度 */
+	int capacity;    /**< 各个字段数组的容量 */
+
+	/** 字符码 */
+	wchar_t *codes;
+
+	/** 字体位图数据(只读)，由字体库缓存，没有可用字体时为 NULL */
+	const LCUI_FontBitmap **bitmaps;
+
+	/** 字符的水平步进宽度，没有字体位图的字符为 0 */
+	int *advances;
+
+	/** 字符使用的样式在图层样式表中的序号，0 表示只使用全局样式 */
+	unsigned *styles;
+
+	LCUI_EOLChar eol; /**< 行尾结束类型 */
 } LCUI_TextRowRec, *LCUI_TextRow;
 
 /* 文本行列表 */
@@ -102,8 +112,13 @@ typedef struct LCUI_TextLayerRec_ {
 	LCUI_BOOL enable_mulitiline;   /**< 是否启用多行文本模式 */
 	LCUI_BOOL enable_autowrap;     /**< 是否启用自动换行模式 */
 	LCUI_BOOL enable_style_tag;    /**< 是否使用文本样式标签 */
+	LCUI_BOOL has_placeholder;     /**< 是否有文字在使用占位的字体位图 */
 	LinkedList dirty_rects;               /**< 脏矩形记录 */
-	LinkedList text_styles;               /**< 样式缓存 */
+	struct {
+		LCUI_TextStyle *items; /**< 样式表，样式编号为下标加 1 */
+		unsigned length;
+		unsigned capacity;
+	} text_styles;                        /**< 样式标签产生的样式 */
 	LCUI_TextStyleRec text_default_style; /**< 文本全局样式 */
 	LCUI_TextRowListRec text_rows;        /**< 文本行列表 */
 	struct {
@@ -230,6 +245,17 @@ LCUI_API void TextLayer_EnableStyleTag(LCUI_TextLayer layer, LCUI_BOOL enabled);
 /** 重新载入各个文字的字体位图 */
 LCUI_API void TextLayer_ReloadCharBitmap(LCUI_TextLayer layer);
 
+/** 在工作线程中预渲染文本所需的字体位图 */
+LCUI_API int TextLayer_PrepareBitmaps(LCUI_TextLayer layer,
+				      const wchar_t *wstr);
+
+/**
+ * 如果有文字在使用占位的字体位图，则添加重新载入字体位图和排版的任务
+ * 应该在 LCUI_FONT_BITMAPS_READY 事件触发时调用
+ * @returns 是否添加了任务
+ */
+LCUI_API LCUI_BOOL TextLayer_UpdatePlaceholders(LCUI_TextLayer layer);
+
 /** 更新数据 */
 LCUI_API void TextLayer_Update(LCUI_TextLayer layer, LinkedList *rects);
 
@@ -33,6 +33,8 @@
 
 LCUI_BEGIN_HEADER
 
+typedef struct LCUI_UITemplateRec_ LCUI_UITemplateRec, *LCUI_UITemplate;
+
 /**
  * 从字符串中载入界面配置代码，解析并生成相应的图形界面(元素)
  * @param[in] str 包含界面配置代码的字符串
@@ -47,6 +49,31 @@ LCUI_API LCUI_Widget LCUIBuilder_LoadString(const char *str, int size);
  */
 LCUI_API LCUI_Widget LCUIBuilder_LoadFile(const char *filepath);
 
+/**
+ * 从字符串中编译界面模板
+ * 界面配置代码只解析一次，生成的模板可以多次实例化，适用于需要重复创建的界面，
+ * 例如对话框和列表项。模板中引用的样式和字体等资源会在编译时载入。
+ * @param[in] str 包含界面配置代码的字符串
+ * @return 正常解析会返回一个模板，出现错误则返回 NULL
+ */
+LCUI_API LCUI_UITemplate LCUIBuilder_CompileString(const char *str, int size);
+
+/**
+ * 从文件中编译界面模板
+ * @param[in] filepath 文件路径
+ * @return 正常解析会返回一个模板，出现错误则返回 NULL
+ */
+LCUI_API LCUI_UITemplate LCUIBuilder_CompileFile(const char *filepath);
+
+/**
+ * 根据界面模板创建部件
+ * @return 模板中的根级部件，若模板中没有根级部件则返回 NULL
+ */
+LCUI_API LCUI_Widget LCUIBuilder_Instantiate(LCUI_UITemplate tpl);
+
+/** 释放界面模板 */
+LCUI_API void LCUIBuilder_FreeTemplate(LCUI_UITemplate tpl);
+
 LCUI_END_HEADER
 
 #endif
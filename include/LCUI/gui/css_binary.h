@@ -0,0 +1,69 @@
+/*
+ * css_binary.h -- Compiled stylesheet
+ *
+ * Copyright (c) 2020, Liu chao <lc-soft@live.cn> All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of LCUI nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LCUI_CSS_BINARY_H
+#define LCUI_CSS_BINARY_H
+
+LCUI_BEGIN_HEADER
+
+/**
+ * Compiled stylesheet
+ * The rules in the style library can be written into a binary image and
+ * loaded back without tokenizing and parsing the CSS code again. Selectors
+ * are stored as their nodes, and property and value names are stored in a
+ * string table, so the image does not depend on the order in which the
+ * style keys are registered.
+ *
+ * The image uses the byte order of the host that compiled it, images with
+ * a different byte order or version are rejected.
+ */
+
+/**
+ * Write the rules in the style library into a compiled stylesheet
+ * It should not be called while other threads are modifying the library.
+ * @param[in] space only write the rules in this space, write all rules if
+ *  it is NULL. The space of the rules loaded by LCUI_LoadCSSFile() is the
+ *  path of the file.
+ * @returns the number of rules written, or a negative error code
+ */
+LCUI_API int LCUI_WriteCompiledCSSFile(const char *space, const char *filepath);
+
+/**
+ * Load the rules from the compiled stylesheet in memory
+ * @returns the number of rules loaded, or a negative error code
+ */
+LCUI_API int LCUI_LoadCompiledCSS(const void *data, size_t size);
+
+/** Map the compiled stylesheet file into memory and load it */
+LCUI_API int LCUI_LoadCompiledCSSFile(const char *filepath);
+
+LCUI_END_HEADER
+
+#endif
@@ -189,6 +189,17 @@ typedef struct LCUI_SelectorRec_ {
 	LCUI_SelectorNode *nodes;	/**< 选择器结点列表 */
 } LCUI_SelectorRec, *LCUI_Selector;
 
+/** 样式规则，在遍历样式库时使用 */
+typedef struct LCUI_StyleRuleRec_ {
+	const char *selector;		/**< 完整的选择器文本 */
+	const char *space;		/**< 所属的空间 */
+	int rank;			/**< 权值 */
+	int batch_num;			/**< 批次号 */
+	LCUI_StyleList list;		/**< 样式表 */
+} LCUI_StyleRuleRec, *LCUI_StyleRule;
+
+typedef void(*LCUI_StyleRuleHandler)(LCUI_StyleRule, void*);
+
 /* clang-format on */
 
 #define CheckStyleType(S, K, T) \
@@ -298,6 +309,12 @@ LCUI_API void LCUI_PrintSelector(LCUI_Selector selector);
 
 LCUI_API void LCUI_PrintCSSLibrary(void);
 
+/**
+ * 遍历样式库中的样式规则
+ * 遍历时会锁定样式库，因此不能在回调函数中修改样式库。
+ */
+LCUI_API void LCUI_EachStyleRule(LCUI_StyleRuleHandler handler, void *data);
+
 LCUI_API void LCUI_InitCSSLibrary(void);
 
 LCUI_API void LCUI_FreeCSSLibrary(void);
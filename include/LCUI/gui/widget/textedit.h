@@ -52,6 +52,18 @@ LCUI_API size_t TextEdit_GetTextW(LCUI_Widget w, size_t start,
 /** 获取文本长度 */
 LCUI_API size_t TextEdit_GetTextLength(LCUI_Widget w);
 
+/**
+ * Undo the last edit
+ * @returns 0 on success, -1 if there is nothing to undo
+ */
+LCUI_API int TextEdit_Undo(LCUI_Widget w);
+
+/**
+ * Redo the last undone edit
+ * @returns 0 on success, -1 if there is nothing to redo
+ */
+LCUI_API int TextEdit_Redo(LCUI_Widget w);
+
 /** 设置文本编辑框内的光标，指定是否闪烁、闪烁时间间隔 */
 LCUI_API void TextEdit_SetCaretBlink(LCUI_Widget w, LCUI_BOOL visible, int time);
 
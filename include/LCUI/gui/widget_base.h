@@ -109,6 +109,25 @@ typedef struct LCUI_WidgetBoxModelRec_ {
 	LCUI_RectF outer;
 } LCUI_WidgetBoxModelRec, *LCUI_WidgetBoxModel;
 
+/**
+ * The result of the last layout
+ * It is keyed by the layout rule, the content box size of the parent, which
+ * is the space available to the widget, and the content box size of the
+ * widget on entry, which can be changed by the parent layout without a
+ * change of the available space. It is invalidated when the widget or one
+ * of its descendants adds a layout related task.
+ */
+typedef struct LCUI_WidgetLayoutCacheRec_ {
+	LCUI_BOOL is_valid;
+	LCUI_LayoutRule rule;
+	float available_width;
+	float available_height;
+	float content_width;
+	float content_height;
+	float width, height;
+	float max_content_width, max_content_height;
+} LCUI_WidgetLayoutCacheRec;
+
 typedef struct LCUI_WidgetTaskRec_ {
 	/** Should update for self? */
 	LCUI_BOOL for_self;
@@ -284,6 +303,7 @@ typedef struct LCUI_WidgetRec_ {
 	LCUI_Rect2F padding;
 	LCUI_Rect2F margin;
 	LCUI_WidgetBoxModelRec box;
+	LCUI_WidgetLayoutCacheRec layout_cache;
 
 	LCUI_StyleSheet style;
 	LCUI_StyleList custom_style;
@@ -305,6 +325,9 @@ typedef struct LCUI_WidgetRec_ {
 	LCUI_WidgetRules rules;
 	LCUI_EventTrigger trigger;
 
+	/** Events posted to this widget and waiting to be dispatched */
+	LinkedList pending_events;
+
 	/** Invalid area (Dirty Rectangle) */
 	LCUI_RectF invalid_area;
 	LCUI_InvalidAreaType invalid_area_type;
@@ -318,16 +341,31 @@ typedef struct LCUI_WidgetRec_ {
 
 	/** List of child widgets in descending order by z-index */
 	LinkedList children_show;
+
+	/**
+	 * Array of child widgets in the same order as the children list
+	 * It is updated lazily, only items[0, valid) and their index are up to
+	 * date, so that adding or removing a child does not renumber all the
+	 * siblings behind it.
+	 */
+	struct {
+		LCUI_Widget *items;
+		size_t capacity;
+		size_t valid;
+	} child_index;
 	
 	/**
-	 * Position in the parent->children
-	 * this == LinkedList_Get(&this->parent->children, this.index)
+	 * Cached position in the parent->children, for internal use only
+	 * It is out of date after the siblings have been changed until the
+	 * index of the parent is updated, use Widget_GetIndex() to get the
+	 * current position.
 	 */
-	size_t index;
+	size_t cached_index;
 
 	/**
 	 * Node in the parent->children
-	 * &this->node == LinkedList_GetNode(&this->parent->children, this.index)
+	 * &this->node == LinkedList_GetNode(&this->parent->children,
+	 *                                   Widget_GetIndex(this))
 	 */
 	LinkedListNode node;
 	
@@ -103,6 +103,13 @@ typedef void(*LCUI_WidgetEventFunc)(LCUI_Widget, LCUI_WidgetEvent, void*);
 LCUI_API LCUI_BOOL Widget_PostEvent(LCUI_Widget widget, LCUI_WidgetEvent ev,
 				    void *data, void(*destroy_data)(void*));
 
+/**
+ * 分发已投递的部件事件
+ * 该函数由主循环调用，在分发期间投递的事件也会在本次调用中分发
+ * @returns 已分发的事件数量
+ */
+LCUI_API size_t LCUIWidget_ProcessEvents(void);
+
 /** 触发事件，直接调用事件处理器 */
 LCUI_API int Widget_TriggerEvent(LCUI_Widget widget,
 				 LCUI_WidgetEvent e, void *data);
@@ -35,4 +35,10 @@ LCUI_API void Widget_Reflow(LCUI_Widget w, LCUI_LayoutRule rule);
 
 LCUI_API LCUI_BOOL Widget_AutoReflow(LCUI_Widget w, LCUI_LayoutRule rule);
 
+/**
+ * Invalidate the cached layout result of the widget and its ancestors
+ * It should be called when the widget has changes that affect the layout.
+ */
+LCUI_API void Widget_InvalidateLayoutCache(LCUI_Widget w);
+
 #endif
@@ -59,6 +59,9 @@ LCUI_API size_t LCUIWidget_Update(void);
 
 LCUI_API void LCUIWidget_UpdateWithProfile(LCUI_WidgetTasksProfile profile);
 
+/** 检查是否有等待下一帧处理的部件任务或无效区域 */
+LCUI_API LCUI_BOOL LCUIWidget_HasPendingUpdates(void);
+
 /** 刷新所有部件的样式 */
 LCUI_API void LCUIWidget_RefreshStyle(void);
 
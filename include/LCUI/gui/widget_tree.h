@@ -57,6 +57,41 @@ LCUI_API LCUI_Widget Widget_GetNext(LCUI_Widget w);
 /** 获取一个子部件 */
 LCUI_API LCUI_Widget Widget_GetChild(LCUI_Widget w, size_t index);
 
+/** 获取部件在父部件的子部件列表中的位置 */
+LCUI_API size_t Widget_GetIndex(LCUI_Widget w);
+
+/**
+ * 更新子部件索引
+ * 子部件索引是按需更新的，在通过下标访问子部件前需要调用该函数
+ * @returns 更新成功返回 0，内存不足时返回 -ENOMEM
+ */
+LCUI_API int Widget_UpdateChildIndex(LCUI_Widget w);
+
+/**
+ * 获取遍历中的第 i 个子部件
+ * 如果子部件索引因内存不足而不完整，则从上一个子部件开始沿着链表查找
+ */
+INLINE LCUI_Widget Widget_GetEachChild(LCUI_Widget w, size_t i,
+				       LCUI_Widget prev)
+{
+	LinkedListNode *node;
+
+	if (i < w->child_index.valid) {
+		return w->child_index.items[i];
+	}
+	node = prev ? prev->node.next : w->children.head.next;
+	return node ? node->data : NULL;
+}
+
+/**
+ * 按顺序遍历子部件，用法：for (Widget_EachChild(i, child, w)) { ... }
+ * 遍历时访问的是连续的子部件数组，在遍历过程中不能增删子部件
+ */
+#define Widget_EachChild(I, CHILD, W)                                       \
+	I = (Widget_UpdateChildIndex(W), 0);                                \
+	((CHILD) = Widget_GetEachChild(W, I, I > 0 ? (CHILD) : NULL)) != NULL; \
+	++I
+
 /** Traverse the child widget tree */
 LCUI_API size_t Widget_Each(LCUI_Widget w,
 			    void (*callback)(LCUI_Widget, void *), void *arg);
@@ -37,6 +37,7 @@
 LCUI_BEGIN_HEADER
 
 typedef void(*LCUI_ImageProgressFunc)(void*, float);
+typedef void(*LCUI_ImageRowsFunc)(void*, unsigned, unsigned);
 typedef size_t(*LCUI_ImageReadFunc)(void*, void*, size_t);
 typedef void(*LCUI_ImageSkipFunc)(void*, long);
 typedef void(*LCUI_ImageFunc)(void*);
@@ -63,6 +64,13 @@ typedef struct LCUI_ImageHeaderRec_ {
 	unsigned int width, height;
 } LCUI_ImageHeaderRec, *LCUI_ImageHeader;
 
+/** 内存数据流 */
+typedef struct LCUI_ImageMemoryStreamRec_ {
+	const unsigned char *data;		/**< 数据 */
+	size_t size;				/**< 数据的大小 */
+	size_t pos;				/**< 当前读取位置 */
+} LCUI_ImageMemoryStreamRec, *LCUI_ImageMemoryStream;
+
 /** 图像读取器 */
 typedef struct LCUI_ImageReaderRec_ {
 	void *stream_data;			/**< 自定义的输入流数据 */
@@ -81,6 +89,11 @@ typedef struct LCUI_ImageReaderRec_ {
 	void(*destructor)(void*);		/**< 私有数据的析构函数 */
 	jmp_buf *env;				/**< 堆栈环境缓存的指针，用于 setjump() */
 	jmp_buf env_src;			/**< 默认堆栈环境缓存 */
+	LCUI_ImageRowsFunc fn_rows;		/**< 用于接收已解码的图像行的函数，参数为起始行和行数 */
+	void *rows_arg;				/**< 接收已解码的图像行时的附加参数 */
+	unsigned int target_width;		/**< 期望的最小输出宽度，为 0 时不限制 */
+	unsigned int target_height;		/**< 期望的最小输出高度，为 0 时不限制 */
+	LCUI_ImageMemoryStreamRec memory;	/**< 内存数据流，用于直接读取内存中的图像数据 */
 } LCUI_ImageReaderRec, *LCUI_ImageReader;
 
 /** 初始化适用于 PNG 图像的读取器 */
@@ -94,6 +107,13 @@ LCUI_API int LCUI_InitBMPReader(LCUI_ImageReader reader);
 
 LCUI_API void LCUI_SetImageReaderForFile(LCUI_ImageReader reader, FILE *fp);
 
+/**
+ * 设置图像读取器从内存中读取数据
+ * 数据不会被复制，在读取结束前需要保证它有效。
+ */
+LCUI_API void LCUI_SetImageReaderForMemory(LCUI_ImageReader reader,
+					   const void *data, size_t size);
+
 /** 创建图像读取器 */
 LCUI_API int LCUI_InitImageReader(LCUI_ImageReader reader);
 
@@ -122,6 +142,14 @@ LCUI_API int LCUI_WritePNGFile(const char *file_name, const LCUI_Graph *graph);
 /** 载入指定图片文件的图像数据 */
 LCUI_API int LCUI_ReadImageFile(const char *filepath, LCUI_Graph *out);
 
+/**
+ * 使用指定的读取器载入图片文件的图像数据
+ * 读取器中的 target_width、target_height、fn_prog 和 fn_rows 等选项会被保留，
+ * 可用于在解码时缩小图像，以及渐进式地显示已解码的图像行。
+ */
+LCUI_API int LCUI_ReadImageFileEx(LCUI_ImageReader reader,
+				  const char *filepath, LCUI_Graph *out);
+
 /** 从文件中获取图像尺寸 */
 LCUI_API int LCUI_GetImageSize(const char *filepath, int *width, int *height);
 
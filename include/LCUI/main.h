@@ -54,6 +54,7 @@ enum LCUI_SysEventType {
 	LCUI_WIDGET,
 	LCUI_QUIT, /**< 在 LCUI 退出前触发的事件 */
 	LCUI_SETTINGS_CHANGE,
+	LCUI_FONT_BITMAPS_READY, /**< 预渲染的字体位图已加入缓存 */
 	LCUI_USER = 100 /**< 用户事件，可以把这个当成系统事件与用户事件的分界 */
 };
 
@@ -118,6 +119,9 @@ typedef struct LCUI_SysEventRec_ {
 		LCUI_TouchEvent touch;
 		LCUI_PaintEvent paint;
 	};
+
+	/** the time at which the event was generated, see LCUI_GetTime() */
+	int64_t timestamp;
 } LCUI_SysEventRec, *LCUI_SysEvent;
 
 typedef void (*LCUI_SysEventFunc)(LCUI_SysEvent, void *);
@@ -138,6 +142,15 @@ typedef struct LCUI_AppDriverRec_ {
 	int (*UnbindSysEvent)(int, LCUI_EventFunc);
 	int (*UnbindSysEvent2)(int);
 	void *(*GetData)(void);
+
+	/**
+	 * Block until new events arrive or the timeout expires, optional
+	 * A negative timeout means waiting forever.
+	 */
+	void (*WaitEvent)(int);
+
+	/** Wake up the thread which is blocked in WaitEvent(), optional */
+	void (*WakeUp)(void);
 } LCUI_AppDriverRec, *LCUI_AppDriver;
 
 #ifndef LCUI_MAIN_C
@@ -153,6 +166,32 @@ LCUI_API int LCUI_UnbindEvent(int handler_id);
 
 LCUI_API int LCUI_TriggerEvent(LCUI_SysEvent e, void *arg);
 
+/**
+ * Add an input event to the input queue
+ * This function can be called from any thread. The queued events are
+ * dispatched at the beginning of the next frame, consecutive mouse motion
+ * events are coalesced into one. The resources of the event are taken over by
+ * the queue even if posting fails, so do not call LCUI_DestroyEvent() on it.
+ * If the timestamp of the event is zero, it is set to the current time.
+ */
+LCUI_API int LCUI_PostEvent(LCUI_SysEvent e);
+
+/**
+ * Get the events coalesced into the event currently being dispatched
+ * Apps that need every motion sample, such as drawing apps, can call this
+ * function in the LCUI_MOUSEMOVE event handler.
+ * @param[out] events the original events in order, the last one is the newest
+ * @returns the number of the events, zero if no input event is dispatching
+ */
+LCUI_API size_t LCUI_GetCoalescedEvents(const LCUI_SysEventRec **events);
+
+/**
+ * Get the input latency of the last frame which handled input events
+ * @returns the milliseconds from the oldest input event of that frame to the
+ * end of presenting, -1 if no input event has been handled yet
+ */
+LCUI_API long LCUI_GetInputLatency(void);
+
 LCUI_API int LCUI_CreateTouchEvent(LCUI_SysEvent e, LCUI_TouchPoint points,
 				   int n_points);
 
@@ -170,6 +209,13 @@ LCUI_AppDriverId LCUI_GetAppId(void);
 /** 处理当前所有事件 */
 LCUI_API size_t LCUI_ProcessEvents(void);
 
+/**
+ * Wake up the main loop
+ * The main loop sleeps when there is nothing to do, call this function after
+ * changing the state of the UI from another thread.
+ */
+LCUI_API void LCUI_WakeUp(void);
+
 /**
  * 添加任务
  * 该任务将会添加至主线程中执行
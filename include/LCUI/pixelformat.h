@@ -0,0 +1,75 @@
+/*
+ * pixelformat.h -- Pixel format conversion
+ *
+ * Copyright (c) 2020, Liu chao <lc-soft@live.cn> All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of LCUI nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LCUI_PIXELFORMAT_H
+#define LCUI_PIXELFORMAT_H
+
+LCUI_BEGIN_HEADER
+
+/**
+ * Convert a row of ARGB8888 pixels to RGB888
+ * @param[out] out a buffer of at least count * 3 bytes
+ */
+LCUI_API void PixelFormat_ARGBToRGB888(uchar_t *out, const LCUI_ARGB *in,
+				       size_t count);
+
+/**
+ * Convert a row of RGB888 pixels to ARGB8888, the alpha channel is set to 255
+ */
+LCUI_API void PixelFormat_RGB888ToARGB(LCUI_ARGB *out, const uchar_t *in,
+				       size_t count);
+
+/**
+ * Convert a row of ARGB8888 pixels to RGB565
+ * The coordinates of the first pixel are used to align the ordered dither
+ * pattern, so the dithering of a region is the same no matter how it is split.
+ * @param[out] out a buffer of at least count * 2 bytes, aligned to 2 bytes
+ * @param[in] x the horizontal position of the first pixel in the destination
+ * @param[in] y the vertical position of the row in the destination
+ * @param[in] dither whether to apply the ordered dithering
+ */
+LCUI_API void PixelFormat_ARGBToRGB565(uchar_t *out, const LCUI_ARGB *in,
+				       size_t count, int x, int y,
+				       LCUI_BOOL dither);
+
+/**
+ * Convert a row of ARGB8888 pixels to the indices of the fixed 8-bit palette
+ * The palette uses 3 bits for red, 3 bits for green and 2 bits for blue.
+ */
+LCUI_API void PixelFormat_ARGBToIndex8(uchar_t *out, const LCUI_ARGB *in,
+				       size_t count, int x, int y,
+				       LCUI_BOOL dither);
+
+/** Get the colors of the fixed 8-bit palette */
+LCUI_API void PixelFormat_GetIndex8Palette(LCUI_ARGB palette[256]);
+
+LCUI_END_HEADER
+
+#endif
@@ -0,0 +1,53 @@
+/*
+ * linux_evdev.h -- evdev input support for linux.
+ *
+ * Copyright (c) 2020, Liu chao <lc-soft@live.cn> All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of LCUI nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LCUI_LINUX_EVDEV_H
+#define LCUI_LINUX_EVDEV_H
+
+#define LCUI_EVDEV_POINTER 1
+#define LCUI_EVDEV_KEYBOARD (1 << 1)
+#define LCUI_EVDEV_TOUCH (1 << 2)
+
+/**
+ * Open the evdev input devices and start reading them
+ * The device paths are read from the LCUI_INPUT_DEVICES environment variable,
+ * separated by colons, or /dev/input/event* are scanned by default. A regular
+ * file or a pipe filled with recorded input_event records can be used as a
+ * device, which is useful for testing.
+ * @returns the capabilities of the opened devices, 0 if no device is usable
+ */
+int LCUI_InitLinuxEvdev(void);
+
+/** Get the capabilities of the opened devices */
+int LCUI_GetLinuxEvdevCaps(void);
+
+void LCUI_FreeLinuxEvdev(void);
+
+#endif
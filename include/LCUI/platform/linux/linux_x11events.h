@@ -44,6 +44,8 @@ typedef struct LCUI_X11AppDriverRec_ {
 	Atom wm_delete;
 	Colormap cmap;
 	LCUI_EventTrigger trigger;
+	/** the pipe used to wake up the main loop blocked in select() */
+	int wakeup_pipe[2];
 } LCUI_X11AppDriverRec, *LCUI_X11AppDriver;
 
 void LCUI_SetLinuxX11MainWindow( Window win );
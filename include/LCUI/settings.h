@@ -33,12 +33,18 @@
 
 LCUI_BEGIN_HEADER
 
+/** The default maximum bytes of the cached images */
+#define LCUI_DEFAULT_IMAGE_CACHE_SIZE (32 * 1024 * 1024)
+
 typedef struct LCUI_SettingsRec_ {
 	int frame_rate_cap;
 	int parallel_rendering_threads;
 	LCUI_BOOL record_profile;
 	LCUI_BOOL fps_meter;
 	LCUI_BOOL paint_flashing;
+	LCUI_BOOL progressive_image_loading;
+	size_t image_cache_size;
+	LCUI_BOOL pipelined_present;
 } LCUI_SettingsRec, *LCUI_Settings;
 
 /* Initialize settings with the current global settings. */
@@ -103,6 +103,12 @@ LCUI_API int LCUITimer_Reset(int timer_id, long int n_ms);
 /* Process all active timers */
 LCUI_API size_t LCUI_ProcessTimers(void);
 
+/**
+ * Get the time until the next running timer expires
+ * @return the delay in milliseconds, -1 if there are no running timers
+ */
+LCUI_API long LCUI_GetNextTimerDelay(void);
+
 /* Init the timer module */
 LCUI_API void LCUI_InitTimer(void);
 
@@ -460,6 +460,9 @@ typedef struct LCUI_FrameProfileRec_ {
 	clock_t render_time;
 	clock_t present_time;
 
+	/** the input latency of the frame in milliseconds, -1 if no input */
+	long input_latency;
+
 	LCUI_WidgetTasksProfileRec widget_tasks;
 } LCUI_FrameProfileRec, *LCUI_FrameProfile;
 
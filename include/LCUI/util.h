@@ -48,4 +48,6 @@
 #include <LCUI/util/task.h>
 #include <LCUI/util/uri.h>
 #include <LCUI/util/charset.h>
+#include <LCUI/util/mmap.h>
+#include <LCUI/util/textbuffer.h>
 #endif
@@ -46,6 +46,29 @@ LCUI_API size_t LCUI_DecodeString(wchar_t *wstr, const char *str,
 
 LCUI_API size_t LCUI_EncodeString(char *str, const wchar_t *wstr,
 				  size_t max_len, int encoding);
+
+/**
+ * Decode a UTF-8 string of the specified length
+ * Invalid sequences are replaced with U+FFFD. If wchar_t is 16 bits, the
+ * characters beyond the BMP are decoded into surrogate pairs.
+ * @param[out] wstr output buffer, NULL to only compute the length
+ * @param[in] max_len the maximum number of characters written to wstr
+ * @param[out] errors the number of invalid sequences, can be NULL
+ * @returns the number of characters, excluding the terminating null
+ */
+LCUI_API size_t LCUI_DecodeUTF8(wchar_t *wstr, const char *str, size_t len,
+				size_t max_len, size_t *errors);
+
+/**
+ * Encode a wide string of the specified length to UTF-8
+ * Unpaired surrogates and invalid code points are encoded as U+FFFD.
+ * @param[out] str output buffer, NULL to only compute the length
+ * @param[in] max_len the maximum number of bytes written to str
+ * @param[out] errors the number of invalid characters, can be NULL
+ * @returns the number of bytes, excluding the terminating null
+ */
+LCUI_API size_t LCUI_EncodeUTF8(char *str, const wchar_t *wstr, size_t len,
+				size_t max_len, size_t *errors);
 LCUI_END_HEADER
 
 #endif
@@ -48,7 +48,6 @@ typedef struct DictEntry {
 		uint64_t u64;
 		int64_t s64;
 	} v;
-	struct DictEntry *next; /**< 指向下一个哈希节点(形成链表) */
 } DictEntry;
 
 /** 字典内数据的类型 */
@@ -61,34 +60,33 @@ typedef struct DictType {
 	void(*valDestructor)(void *privdata, void *obj);
 } DictType;
 
-/** 哈希表结构 */
-typedef struct DictHashTable {
-	DictEntry **table;	/**< 节点指针数组 */
-	unsigned long size;	/**< 桶的数量 */
-	unsigned long sizemask;	/**< mask 码，用于地址索引计算 */
-	unsigned long used;	/**< 已有节点数量 */
-} DictHashTable;
-
-/** 字典结构 */
+/**
+ * 字典结构
+ * 字典使用开放寻址的哈希表，节点直接存放在槽数组中，每个槽还有一个控制
+ * 字节，查找时一次比较一组控制字节。
+ * 添加元素可能会让哈希表扩容并移动节点，之前获取的节点指针随之失效。
+ */
 typedef struct Dict {
 	DictType *type;		/**< 为哈希表中不同类型的值所使用的一族函数 */
 	void *privdata;
-	DictHashTable ht[2];	/**< 每个字典使用两个哈希表 */
-	int rehashidx;		/**< rehash 进行到的索引位置，如果没有在 rehash ，就为 -1 */
-	int iterators;		/**< 当前正在使用的 iterator 的数量 */
+	unsigned char *ctrl;	/**< 控制字节数组，末尾附有开头一组控制字节的副本 */
+	DictEntry *entries;	/**< 槽数组 */
+	unsigned long size;	/**< 槽的数量 */
+	unsigned long sizemask;	/**< mask 码，用于地址索引计算 */
+	unsigned long used;	/**< 已有节点数量 */
+	unsigned long deleted;	/**< 已删除的槽的数量 */
+	int iterators;		/**< 当前正在使用的安全迭代器的数量 */
 } Dict;
 
 /** 用于遍历字典的迭代器 */
 typedef struct DictIterator {
 	Dict *d;		/**< 迭代器所指向的字典 */
-	int table;		/**< 使用的哈希表号码 */
-	int index;		/**< 迭代进行的索引 */
+	long index;		/**< 迭代进行的索引 */
 	int safe;		/**< 是否安全 */
 	DictEntry *entry;	/**< 指向哈希表的当前节点 */
-	DictEntry *next_entry;	/**< 指向哈希表的下个节点 */
 } DictIterator;
 
-#define DICT_HT_INITIAL_SIZE 4
+#define DICT_HT_INITIAL_SIZE 16
 
 #define Dict_FreeVal(d, entry) \
     if ((d)->type->valDestructor) \
@@ -128,9 +126,8 @@ typedef struct DictIterator {
 #define DictEntry_GetVal(he) ((he)->v.val)
 #define DictEntry_GetSignedIntegerVal(he) ((he)->v.s64)
 #define DictEntry_GetUnsignedIntegerVal(he) ((he)->v.u64)
-#define Dict_Slots(d) ((d)->ht[0].size+(d)->ht[1].size)
-#define Dict_Size(d) ((d)->ht[0].used+(d)->ht[1].used)
-#define Dict_IsRehashing(ht) ((ht)->rehashidx != -1)
+#define Dict_Slots(d) ((d)->size)
+#define Dict_Size(d) ((d)->used)
 
 /** 创建一个新字典 */
 LCUI_API Dict *Dict_Create(DictType *type, void *privdata);
@@ -172,8 +169,8 @@ LCUI_API void Dict_Release(Dict *d);
 
 /**
  * 在字典中按指定的 key 查找
- * 查找过程是典型的 separate chaining find 操作
- * 具体参见：http://en.wikipedia.org/wiki/Hash_table#Separate_chaining
+ * 查找过程是开放寻址的探测操作，按三角数序列逐组探测槽
+ * 具体参见：https://en.wikipedia.org/wiki/Open_addressing
  */
 LCUI_API DictEntry * Dict_Find(Dict *d, const void *key);
 
@@ -189,8 +186,8 @@ LCUI_API int Dict_Resize(Dict *d);
  * safe 属性指示迭代器是否安全，如果迭代器是安全的，那么它可以在遍历的过程中
  * 进行增删操作，反之，如果迭代器是不安全的，那么它只能执行 Dict_Next 操作。
  *
- * 因为迭代进行的时候可以对列表的当前节点进行修改，为了避免修改造成指针丢失，
- * 所以不仅要有指向当前节点的 entry 属性，还需要指向下一节点的 next_entry 属性
+ * 删除节点只会标记它所在的槽，不会移动其它节点。在安全迭代器存在期间，
+ * 哈希表会尽量推迟扩容，但如果槽已经用完，扩容后的遍历结果是不确定的。
  */
 LCUI_API DictIterator *Dict_GetIterator(Dict *d);
 
@@ -220,21 +217,6 @@ LCUI_API unsigned int Dict_IdentityHashFunction(unsigned int key);
 LCUI_API void Dict_Empty(Dict *d);
 LCUI_API void Dict_EnableResize(void);
 LCUI_API void Dict_DisableResize(void);
-
-/**
- * 字典的 rehash 函数
- * @param[in] n 要执行 rehash 的元素数量
- * @return 0 所有元素 rehash 完毕
- * @return 1 还有元素没有 rehash
-*/
-LCUI_API int Dict_Rehash(Dict *d, int n);
-
-/*
- * 在指定的时间内完成 rehash 操作
- * @param[in] ms 进行 rehash 的时间，以毫秒为单位
- * @returns rehashes 完成 rehash 的元素的数量
- */
-LCUI_API int Dict_RehashMilliseconds(Dict *d, int ms);
 LCUI_API void Dict_SetHashFunctionSeed(unsigned int initval);
 LCUI_API unsigned int Dict_GetHashFunctionSeed(void);
 
@@ -52,6 +52,23 @@ LCUI_API void Logger_SetHandler(void (*handler)(const char*));
 
 LCUI_API void Logger_SetHandlerW(void (*handler)(const wchar_t*));
 
+/**
+ * Enable or disable the asynchronous mode
+ * In asynchronous mode, messages are formatted into a ring buffer of the
+ * calling thread without taking any lock, and a background thread writes
+ * them to the handler in batches. Messages from different threads may be
+ * written out of order, and a message is dropped instead of blocking the
+ * caller when the buffer of its thread is full.
+ * Disabling it stops the background thread and writes the pending messages.
+ */
+LCUI_API int Logger_SetAsync(LCUI_BOOL enable);
+
+/** Write the pending messages of the asynchronous mode */
+LCUI_API void Logger_Flush(void);
+
+/** Get the number of messages dropped in asynchronous mode */
+LCUI_API size_t Logger_GetDroppedCount(void);
+
 #define Logger_Info(fmt, ...) Logger_Log(LOGGER_LEVEL_INFO, fmt, ##__VA_ARGS__)
 #define Logger_Debug(fmt, ...) \
 	Logger_Log(LOGGER_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
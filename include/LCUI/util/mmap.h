@@ -0,0 +1,79 @@
+/*
+ * mmap.h -- Read-only file mapping
+ *
+ * Copyright (c) 2020, Liu chao <lc-soft@live.cn> All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of LCUI nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LCUI_UTIL_MMAP_H
+#define LCUI_UTIL_MMAP_H
+
+LCUI_BEGIN_HEADER
+
+/**
+ * Read-only file mapping
+ * The same file is mapped only once per process. The mapped pages are
+ * backed by the system file cache, so they are shared with other processes
+ * that load the same file.
+ */
+typedef struct LCUI_MappedFileRec_ {
+	char *path;
+	const unsigned char *data;
+	size_t size;
+	unsigned refs;
+
+	/** whether the data is read into the heap instead of mapped */
+	LCUI_BOOL is_copy;
+#ifdef _WIN32
+	void *file_handle;
+	void *mapping_handle;
+#endif
+} LCUI_MappedFileRec, *LCUI_MappedFile;
+
+/**
+ * Map a file into memory, or add a reference to the existing mapping
+ * @returns NULL if the file cannot be opened
+ */
+LCUI_API LCUI_MappedFile LCUI_MapFile(const char *path);
+
+/** Release a reference, the mapping is closed when it has no references */
+LCUI_API void LCUI_UnmapFile(LCUI_MappedFile file);
+
+/**
+ * Initialize the table of the shared mappings
+ * It is called by LCUI_InitBase(), files mapped before that are not shared.
+ */
+LCUI_API void LCUI_InitMappedFiles(void);
+
+/**
+ * Free the table of the shared mappings
+ * The mappings still referenced are kept and closed by LCUI_UnmapFile().
+ */
+LCUI_API void LCUI_FreeMappedFiles(void);
+
+LCUI_END_HEADER
+
+#endif
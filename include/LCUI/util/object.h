@@ -63,6 +63,12 @@ typedef struct LCUI_ObjectRec_ {
 	} value;
 	size_t size;
 	LinkedList *watchers;
+
+	/** Whether the watchers are notified once per frame */
+	LCUI_BOOL deferred_notify;
+
+	/** Node in the queue of objects waiting to notify their watchers */
+	LinkedListNode notify_node;
 } LCUI_ObjectRec;
 
 LCUI_API LCUI_ObjectType ObjectType_New(const char *name);
@@ -92,6 +98,21 @@ LCUI_API LCUI_ObjectWatcher Object_Watch(LCUI_Object object,
 
 LCUI_API size_t Object_Notify(LCUI_Object object);
 
+/**
+ * Set whether the watchers of the object are notified once per frame
+ * In deferred mode, Object_Notify() only puts the object into a queue, the
+ * watchers will be called once with the final value when the main loop
+ * calls Object_FlushNotifications().
+ */
+LCUI_API void Object_SetDeferredNotify(LCUI_Object object, LCUI_BOOL deferred);
+
+/**
+ * Notify the watchers of the objects queued in deferred mode
+ * Objects changed by the watchers will be notified in the next call.
+ * @returns the number of watchers called
+ */
+LCUI_API size_t Object_FlushNotifications(void);
+
 LCUI_API void ObjectWatcher_Delete(LCUI_ObjectWatcher watcher);
 
 LCUI_API void WString_SetValue(LCUI_Object str, const wchar_t *value);
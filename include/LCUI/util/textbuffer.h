@@ -0,0 +1,152 @@
+/*
+ * textbuffer.h -- Piece table text buffer
+ *
+ * Copyright (c) 2020, Liu chao <lc-soft@live.cn> All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of LCUI nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LCUI_UTIL_TEXTBUFFER_H
+#define LCUI_UTIL_TEXTBUFFER_H
+
+LCUI_BEGIN_HEADER
+
+/**
+ * Piece table text buffer
+ * The text is a sequence of pieces which reference read-only chunks of
+ * characters. The pieces are kept in a persistent balanced tree, so insert,
+ * delete and position lookup are O(log n), and every edit produces a new
+ * version that shares most of its nodes with the previous one. Undo and redo
+ * simply switch between these versions.
+ */
+typedef struct LCUI_TextBufferRec_ *LCUI_TextBuffer;
+
+/** A version of the text, it stays valid until it is released */
+typedef struct LCUI_TextSnapshotRec_ *LCUI_TextSnapshot;
+
+/**
+ * The change of the text made by undo or redo
+ * The deleted characters at start are replaced with the inserted ones, and
+ * the caret is expected to be placed at start + inserted.
+ */
+typedef struct LCUI_TextChangeRec_ {
+	size_t start;
+	size_t deleted;
+	size_t inserted;
+} LCUI_TextChangeRec, *LCUI_TextChange;
+
+LCUI_API LCUI_TextBuffer TextBuffer_New(void);
+
+LCUI_API void TextBuffer_Destroy(LCUI_TextBuffer buf);
+
+/** Get the number of characters */
+LCUI_API size_t TextBuffer_GetLength(LCUI_TextBuffer buf);
+
+/** Get the number of lines, it is the number of '\n' plus one */
+LCUI_API size_t TextBuffer_GetLineCount(LCUI_TextBuffer buf);
+
+/** Get the position of the first character of a line */
+LCUI_API size_t TextBuffer_GetLineStart(LCUI_TextBuffer buf, size_t line);
+
+/** Get the line number of a position */
+LCUI_API size_t TextBuffer_GetLineIndex(LCUI_TextBuffer buf, size_t pos);
+
+/**
+ * Insert a copy of the text
+ * @returns 0 on success, -ENOMEM if there is not enough memory, the buffer
+ * is not changed in this case
+ */
+LCUI_API int TextBuffer_Insert(LCUI_TextBuffer buf, size_t pos,
+			       const wchar_t *text, size_t len);
+
+/**
+ * Insert the text without copying it
+ * The buffer keeps referencing the text until no version uses it, and then
+ * calls destroy(arg). It is useful for loading large files.
+ * @returns 0 on success, -ENOMEM if there is not enough memory, the text
+ * is not referenced and destroy is not called in this case
+ */
+LCUI_API int TextBuffer_InsertExternal(LCUI_TextBuffer buf, size_t pos,
+				       const wchar_t *text, size_t len,
+				       void (*destroy)(void *), void *arg);
+
+/**
+ * Delete the text in [pos, pos + len)
+ * @returns 0 on success, -ENOMEM if there is not enough memory, the buffer
+ * is not changed in this case
+ */
+LCUI_API int TextBuffer_Delete(LCUI_TextBuffer buf, size_t pos, size_t len);
+
+LCUI_API void TextBuffer_Clear(LCUI_TextBuffer buf);
+
+/**
+ * Copy text to the output buffer
+ * The output is always null-terminated, so it must be able to hold
+ * max_len + 1 characters.
+ * @returns the number of characters copied
+ */
+LCUI_API size_t TextBuffer_GetText(LCUI_TextBuffer buf, size_t pos,
+				   size_t max_len, wchar_t *out);
+
+/**
+ * Get the contiguous text which starts at the specified position
+ * The text is not null-terminated, and it stays valid until the buffer is
+ * modified.
+ * @returns the number of characters of the text
+ */
+LCUI_API size_t TextBuffer_GetChunk(LCUI_TextBuffer buf, size_t pos,
+				    const wchar_t **text);
+
+/**
+ * Undo the last edit
+ * Only the last 256 versions are kept, the oldest edits are dropped when an
+ * edit is made beyond that and they can no longer be undone.
+ * @param[out] change the change of the text, can be NULL
+ * @returns 0 on success, -1 if there is nothing to undo
+ */
+LCUI_API int TextBuffer_Undo(LCUI_TextBuffer buf, LCUI_TextChange change);
+
+/**
+ * Redo the last undone edit
+ * @param[out] change the change of the text, can be NULL
+ * @returns 0 on success, -1 if there is nothing to redo
+ */
+LCUI_API int TextBuffer_Redo(LCUI_TextBuffer buf, LCUI_TextChange change);
+
+/** Drop the undo and redo history */
+LCUI_API void TextBuffer_ClearHistory(LCUI_TextBuffer buf);
+
+/** Take a snapshot of the current text, it costs O(1) */
+LCUI_API LCUI_TextSnapshot TextBuffer_GetSnapshot(LCUI_TextBuffer buf);
+
+/** Restore the text from a snapshot, as an edit which can be undone */
+LCUI_API void TextBuffer_SetSnapshot(LCUI_TextBuffer buf,
+				     LCUI_TextSnapshot snapshot);
+
+LCUI_API void TextSnapshot_Release(LCUI_TextSnapshot snapshot);
+
+LCUI_END_HEADER
+
+#endif
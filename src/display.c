@@ -83,6 +83,26 @@ static struct LCUI_DisplayModule {
 	LCUI_DisplayDriver driver;
 	LCUI_SettingsRec settings;
 	int settings_change_handler_id;
+
+	/**
+	 * The present thread, it is only running in pipelined present mode
+	 * The main thread hands over the rendered surfaces and goes on to
+	 * process the events and update widgets of the next frame, it only
+	 * waits for the previous frame to be presented before rendering.
+	 */
+	struct LCUI_DisplayPresenter {
+		LCUI_BOOL active;
+
+		/** whether a frame is being presented, used as the fence */
+		LCUI_BOOL busy;
+
+		/** surfaces of the frame to be presented */
+		LinkedList surfaces;
+
+		LCUI_Thread thread;
+		LCUI_Mutex mutex;
+		LCUI_Cond cond;
+	} presenter;
 } display;
 
 /* clang-format on */
@@ -100,15 +120,103 @@ static void OnDestroySurfaceRecord(void *data)
 {
 	SurfaceRecord record = data;
 
+	LCUIDisplay_WaitPresent();
 	Surface_Close(record->surface);
 	LinkedList_Clear(&record->rects, free);
 	LinkedList_Clear(&record->flash_rects, free);
 	free(record);
 }
 
+static void LCUIDisplay_PresentThread(void *arg)
+{
+	LinkedListNode *node;
+	struct LCUI_DisplayPresenter *presenter = &display.presenter;
+
+	LCUIMutex_Lock(&presenter->mutex);
+	while (presenter->active) {
+		if (!presenter->busy) {
+			LCUICond_Wait(&presenter->cond, &presenter->mutex);
+			continue;
+		}
+		LCUIMutex_Unlock(&presenter->mutex);
+		for (LinkedList_Each(node, &presenter->surfaces)) {
+			Surface_Present(node->data);
+		}
+		LCUIMutex_Lock(&presenter->mutex);
+		LinkedList_Clear(&presenter->surfaces, NULL);
+		presenter->busy = FALSE;
+		LCUICond_Broadcast(&presenter->cond);
+	}
+	LCUIMutex_Unlock(&presenter->mutex);
+	LCUIThread_Exit(NULL);
+}
+
+static void LCUIDisplay_StartPresenter(void)
+{
+	struct LCUI_DisplayPresenter *presenter = &display.presenter;
+
+	if (presenter->active) {
+		return;
+	}
+	presenter->busy = FALSE;
+	presenter->active = TRUE;
+	LinkedList_Init(&presenter->surfaces);
+	LCUIMutex_Init(&presenter->mutex);
+	LCUICond_Init(&presenter->cond);
+	if (LCUIThread_Create(&presenter->thread, LCUIDisplay_PresentThread,
+			      NULL) != 0) {
+		Logger_Error("[display] cannot create the present thread\n");
+		presenter->active = FALSE;
+		LCUICond_Destroy(&presenter->cond);
+		LCUIMutex_Destroy(&presenter->mutex);
+		return;
+	}
+	Logger_Debug("[display] pipelined present is enabled\n");
+}
+
+static void LCUIDisplay_StopPresenter(void)
+{
+	struct LCUI_DisplayPresenter *presenter = &display.presenter;
+
+	if (!presenter->active) {
+		return;
+	}
+	LCUIDisplay_WaitPresent();
+	LCUIMutex_Lock(&presenter->mutex);
+	presenter->active = FALSE;
+	LCUICond_Broadcast(&presenter->cond);
+	LCUIMutex_Unlock(&presenter->mutex);
+	LCUIThread_Join(presenter->thread, NULL);
+	LCUICond_Destroy(&presenter->cond);
+	LCUIMutex_Destroy(&presenter->mutex);
+	Logger_Debug("[display] pipelined present is disabled\n");
+}
+
+void LCUIDisplay_WaitPresent(void)
+{
+	struct LCUI_DisplayPresenter *presenter = &display.presenter;
+
+	if (!presenter->active) {
+		return;
+	}
+	LCUIMutex_Lock(&presenter->mutex);
+	while (presenter->busy) {
+		LCUICond_Wait(&presenter->cond, &presenter->mutex);
+	}
+	LCUIMutex_Unlock(&presenter->mutex);
+}
+
 static void OnSettingsChangeEvent(LCUI_SysEvent e, void *arg)
 {
 	Settings_Init(&display.settings);
+	if (!display.driver) {
+		return;
+	}
+	if (display.settings.pipelined_present) {
+		LCUIDisplay_StartPresenter();
+	} else {
+		LCUIDisplay_StopPresenter();
+	}
 }
 
 static size_t LCUIDisplay_RenderFlashRect(SurfaceRecord record,
@@ -364,6 +472,9 @@ void LCUIDisplay_Update(void)
 	if (!display.active) {
 		return;
 	}
+	/* The surfaces will be updated and painted, so the previous frame
+	 * must have been presented */
+	LCUIDisplay_WaitPresent();
 	for (LinkedList_Each(node, &display.surfaces)) {
 		record = node->data;
 		surface = record->surface;
@@ -396,20 +507,37 @@ size_t LCUIDisplay_Render(void)
 void LCUIDisplay_Present(void)
 {
 	LinkedListNode *sn;
+	struct LCUI_DisplayPresenter *presenter = &display.presenter;
 
 	if (!display.active) {
 		return;
 	}
+	if (presenter->active) {
+		LCUIMutex_Lock(&presenter->mutex);
+		while (presenter->busy) {
+			LCUICond_Wait(&presenter->cond, &presenter->mutex);
+		}
+	}
 	for (LinkedList_Each(sn, &display.surfaces)) {
 		SurfaceRecord record = sn->data;
 		LCUI_Surface surface = record->surface;
 		if (!surface || !Surface_IsReady(surface)) {
 			continue;
 		}
-		if (record->rendered) {
+		if (!record->rendered) {
+			continue;
+		}
+		if (presenter->active) {
+			LinkedList_Append(&presenter->surfaces, surface);
+		} else {
 			Surface_Present(surface);
 		}
 	}
+	if (presenter->active) {
+		presenter->busy = presenter->surfaces.length > 0;
+		LCUICond_Broadcast(&presenter->cond);
+		LCUIMutex_Unlock(&presenter->mutex);
+	}
 }
 
 void LCUIDisplay_InvalidateArea(LCUI_Rect *rect)
@@ -688,6 +816,7 @@ void Surface_Destroy(LCUI_Surface surface)
 	if (!display.active) {
 		return;
 	}
+	LCUIDisplay_WaitPresent();
 	for (LinkedList_Each(node, &display.surfaces)) {
 		SurfaceRecord record = node->data;
 		if (record && record->surface == surface) {
@@ -977,6 +1106,9 @@ int LCUI_InitDisplay(LCUI_DisplayDriver driver)
 	Widget_BindEvent(root, "surface", OnSurfaceEvent, NULL, NULL);
 	LCUIDisplay_SetMode(LCUI_DMODE_DEFAULT);
 	LCUIDisplay_Update();
+	if (display.settings.pipelined_present) {
+		LCUIDisplay_StartPresenter();
+	}
 	Logger_Debug("[display] init ok, driver name: %s\n",
 		     display.driver->name);
 	return 0;
@@ -988,6 +1120,7 @@ int LCUI_FreeDisplay(void)
 	if (!display.active) {
 		return -1;
 	}
+	LCUIDisplay_StopPresenter();
 	display.active = FALSE;
 	RectList_Clear(&display.rects);
 	LCUIDisplay_CleanSurfaces();
@@ -0,0 +1,474 @@
+/*
+ * fontindex.c -- Persistent font index
+ *
+ * Copyright (c) 2020, Liu chao <lc-soft@live.cn> All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of LCUI nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <LCUI_Build.h>
+#include <LCUI/types.h>
+#include <LCUI/util.h>
+#include <LCUI/font.h>
+#include "fontindex.h"
+
+#ifdef LCUI_BUILD_IN_WIN32
+#include <direct.h>
+#define mkdir(PATH, MODE) _mkdir(PATH)
+#endif
+
+#define FONT_INDEX_HEADER "LCUI font index 2"
+#define FONT_INDEX_FILE_NAME "lcui-fonts.idx"
+#define FONT_INDEX_LINE_SIZE 4096
+#define FONT_INDEX_MAX_FIELDS 6
+
+typedef struct LCUI_FontIndexFileRec_ {
+	char *path;
+	int64_t mtime;
+	int n_faces;
+	LCUI_FontIndexFaceRec *faces;
+} LCUI_FontIndexFileRec, *LCUI_FontIndexFile;
+
+static struct LCUI_FontIndexModule {
+	LCUI_BOOL active;
+	LCUI_BOOL changed;
+	char *filepath;
+	DictType files_type;
+	DictType matches_type;
+
+	/** the indexed font files, keyed by path */
+	Dict *files;
+
+	/** the paths of font files matched by font names */
+	Dict *matches;
+} self;
+
+static int GetFileModifiedTime(const char *path, int64_t *mtime)
+{
+	struct stat st;
+
+	if (stat(path, &st) != 0) {
+		return -1;
+	}
+	*mtime = (int64_t)st.st_mtime;
+	return 0;
+}
+
+static char *GetIndexFilePath(void)
+{
+	size_t len;
+	char *path;
+	const char *dir;
+	const char *sep = "/";
+
+#ifdef LCUI_BUILD_IN_WIN32
+	dir = getenv("LOCALAPPDATA");
+	sep = "\\";
+#else
+	dir = getenv("XDG_CACHE_HOME");
+	if (!dir || !*dir) {
+		dir = getenv("HOME");
+		sep = "/.cache/";
+	}
+#endif
+	if (!dir || !*dir) {
+		return NULL;
+	}
+	len = strlen(dir) + strlen(sep) + strlen(FONT_INDEX_FILE_NAME) + 1;
+	path = malloc(len * sizeof(char));
+	if (path) {
+		snprintf(path, len, "%s%s%s", dir, sep, FONT_INDEX_FILE_NAME);
+	}
+	return path;
+}
+
+/** Create the directories of the file path which do not exist */
+static void CreateParentDirs(const char *path)
+{
+	char c, *p, *dir;
+
+	dir = strdup2(path);
+	if (!dir) {
+		return;
+	}
+	for (p = dir + 1; *p; ++p) {
+		if (*p != '/' && *p != '\\') {
+			continue;
+		}
+		c = *p;
+		*p = 0;
+		/* The error is ignored, the file cannot be opened if the
+		 * directory does not exist */
+		mkdir(dir, 0755);
+		*p = c;
+	}
+	free(dir);
+}
+
+static void DestroyFontIndexFile(void *privdata, void *data)
+{
+	int i;
+	LCUI_FontIndexFile file = data;
+
+	for (i = 0; i < file->n_faces; ++i) {
+		free(file->faces[i].family_name);
+		free(file->faces[i].style_name);
+	}
+	free(file->faces);
+	free(file->path);
+	free(file);
+}
+
+static void DestroyMatchPath(void *privdata, void *data)
+{
+	free(data);
+}
+
+static LCUI_FontIndexFile CreateFontIndexFile(const char *path, int64_t mtime)
+{
+	LCUI_FontIndexFile file;
+
+	file = NEW(LCUI_FontIndexFileRec, 1);
+	if (!file) {
+		return NULL;
+	}
+	file->path = strdup2(path);
+	file->mtime = mtime;
+	Dict_Delete(self.files, path);
+	Dict_Add(self.files, file->path, file);
+	return file;
+}
+
+static int FontIndexFile_AddFace(LCUI_FontIndexFile file, int index,
+				 LCUI_FontStyle style, LCUI_FontWeight weight,
+				 const char *family_name,
+				 const char *style_name)
+{
+	LCUI_FontIndexFace face;
+	LCUI_FontIndexFaceRec *faces;
+
+	faces = realloc(file->faces,
+			sizeof(LCUI_FontIndexFaceRec) * (file->n_faces + 1));
+	if (!faces) {
+		return -ENOMEM;
+	}
+	file->faces = faces;
+	face = &faces[file->n_faces++];
+	face->index = index;
+	face->style = style;
+	face->weight = weight;
+	face->family_name = strdup2(family_name);
+	face->style_name = strdup2(style_name);
+	return 0;
+}
+
+/** Write a field, escaping the characters which separate fields and lines */
+static void WriteField(FILE *fp, const char *str)
+{
+	fputc('\t', fp);
+	for (; *str; ++str) {
+		switch (*str) {
+		case '\\':
+			fputs("\\\\", fp);
+			break;
+		case '\t':
+			fputs("\\t", fp);
+			break;
+		case '\n':
+			fputs("\\n", fp);
+			break;
+		case '\r':
+			fputs("\\r", fp);
+			break;
+		default:
+			fputc(*str, fp);
+			break;
+		}
+	}
+}
+
+/** Restore the characters escaped by WriteField() */
+static void UnescapeField(char *str)
+{
+	char *dst = str;
+
+	for (; *str; ++str, ++dst) {
+		if (*str != '\\' || !str[1]) {
+			*dst = *str;
+			continue;
+		}
+		switch (*++str) {
+		case 't':
+			*dst = '\t';
+			break;
+		case 'n':
+			*dst = '\n';
+			break;
+		case 'r':
+			*dst = '\r';
+			break;
+		default:
+			*dst = *str;
+			break;
+		}
+	}
+	*dst = 0;
+}
+
+/** Split a line into fields separated by tabs */
+static int SplitFields(char *line, char **fields)
+{
+	int i, n = 0;
+	char *p = line;
+
+	fields[n++] = p;
+	for (; *p && n < FONT_INDEX_MAX_FIELDS; ++p) {
+		if (*p == '\t') {
+			*p = 0;
+			fields[n++] = p + 1;
+		} else if (*p == '\r' || *p == '\n') {
+			*p = 0;
+			break;
+		}
+	}
+	for (; *p; ++p) {
+		if (*p == '\r' || *p == '\n') {
+			*p = 0;
+			break;
+		}
+	}
+	for (i = 0; i < n; ++i) {
+		UnescapeField(fields[i]);
+	}
+	return n;
+}
+
+static void LoadIndexFile(FILE *fp)
+{
+	int n;
+	char *fields[FONT_INDEX_MAX_FIELDS];
+	char line[FONT_INDEX_LINE_SIZE];
+	LCUI_FontIndexFile file = NULL;
+
+	if (!fgets(line, FONT_INDEX_LINE_SIZE, fp) ||
+	    strncmp(line, FONT_INDEX_HEADER, strlen(FONT_INDEX_HEADER)) != 0) {
+		return;
+	}
+	while (fgets(line, FONT_INDEX_LINE_SIZE, fp)) {
+		n = SplitFields(line, fields);
+		if (n == 3 && strcmp(fields[0], "file") == 0) {
+			file = CreateFontIndexFile(fields[2],
+						   strtoll(fields[1], NULL, 10));
+		} else if (n == 6 && strcmp(fields[0], "face") == 0 && file) {
+			FontIndexFile_AddFace(
+			    file, atoi(fields[1]), atoi(fields[2]),
+			    atoi(fields[3]), fields[4], fields[5]);
+		} else if (n == 3 && strcmp(fields[0], "match") == 0) {
+			Dict_Delete(self.matches, fields[1]);
+			Dict_Add(self.matches, fields[1], strdup2(fields[2]));
+		}
+	}
+}
+
+void LCUIFontIndex_Init(void)
+{
+	FILE *fp;
+
+	Dict_InitStringKeyType(&self.files_type);
+	Dict_InitStringCopyKeyType(&self.matches_type);
+	self.files_type.valDestructor = DestroyFontIndexFile;
+	self.matches_type.valDestructor = DestroyMatchPath;
+	self.files = Dict_Create(&self.files_type, NULL);
+	self.matches = Dict_Create(&self.matches_type, NULL);
+	self.filepath = GetIndexFilePath();
+	self.changed = FALSE;
+	self.active = TRUE;
+	if (!self.filepath) {
+		return;
+	}
+	fp = fopen(self.filepath, "r");
+	if (fp) {
+		LoadIndexFile(fp);
+		fclose(fp);
+	}
+}
+
+void LCUIFontIndex_Save(void)
+{
+	int i;
+	FILE *fp;
+	char *tmp_path;
+	size_t len;
+	DictEntry *entry;
+	DictIterator *iter;
+	LCUI_FontIndexFile file;
+	LCUI_FontIndexFace face;
+
+	if (!self.active || !self.changed || !self.filepath) {
+		return;
+	}
+	len = strlen(self.filepath) + 5;
+	tmp_path = malloc(len * sizeof(char));
+	if (!tmp_path) {
+		return;
+	}
+	snprintf(tmp_path, len, "%s.tmp", self.filepath);
+	CreateParentDirs(tmp_path);
+	fp = fopen(tmp_path, "w");
+	if (!fp) {
+		Logger_Debug("[font] cannot write the font index: %s\n",
+			     tmp_path);
+		free(tmp_path);
+		return;
+	}
+	fprintf(fp, "%s\n", FONT_INDEX_HEADER);
+	iter = Dict_GetIterator(self.files);
+	while ((entry = Dict_Next(iter))) {
+		file = DictEntry_GetVal(entry);
+		fprintf(fp, "file\t%lld", (long long)file->mtime);
+		WriteField(fp, file->path);
+		fputc('\n', fp);
+		for (i = 0; i < file->n_faces; ++i) {
+			face = &file->faces[i];
+			fprintf(fp, "face\t%d\t%d\t%d", face->index,
+				face->style, face->weight);
+			WriteField(fp, face->family_name);
+			WriteField(fp, face->style_name);
+			fputc('\n', fp);
+		}
+	}
+	Dict_ReleaseIterator(iter);
+	iter = Dict_GetIterator(self.matches);
+	while ((entry = Dict_Next(iter))) {
+		fputs("match", fp);
+		WriteField(fp, DictEntry_GetKey(entry));
+		WriteField(fp, DictEntry_GetVal(entry));
+		fputc('\n', fp);
+	}
+	Dict_ReleaseIterator(iter);
+	fclose(fp);
+	/* Replace the index file at once, so that other processes never read
+	 * an incomplete index */
+	remove(self.filepath);
+	if (rename(tmp_path, self.filepath) == 0) {
+		self.changed = FALSE;
+	}
+	free(tmp_path);
+}
+
+void LCUIFontIndex_Free(void)
+{
+	if (!self.active) {
+		return;
+	}
+	LCUIFontIndex_Save();
+	Dict_Release(self.files);
+	Dict_Release(self.matches);
+	free(self.filepath);
+	self.files = NULL;
+	self.matches = NULL;
+	self.filepath = NULL;
+	self.active = FALSE;
+}
+
+int LCUIFontIndex_GetFaces(const char *path, LCUI_FontIndexFace *faces)
+{
+	int64_t mtime;
+	LCUI_FontIndexFile file;
+
+	if (!self.active) {
+		return -1;
+	}
+	file = Dict_FetchValue(self.files, path);
+	if (!file || GetFileModifiedTime(path, &mtime) != 0 ||
+	    mtime != file->mtime) {
+		return -1;
+	}
+	*faces = file->faces;
+	return file->n_faces;
+}
+
+void LCUIFontIndex_AddFile(const char *path, LCUI_Font *fonts, int n_fonts)
+{
+	int i;
+	int64_t mtime;
+	LCUI_FontIndexFile file;
+
+	if (!self.active || GetFileModifiedTime(path, &mtime) != 0) {
+		return;
+	}
+	file = CreateFontIndexFile(path, mtime);
+	if (!file) {
+		return;
+	}
+	for (i = 0; i < n_fonts; ++i) {
+		if (!fonts[i] || !fonts[i]->family_name ||
+		    !fonts[i]->style_name) {
+			continue;
+		}
+		FontIndexFile_AddFace(file, fonts[i]->face_index,
+				      fonts[i]->style, fonts[i]->weight,
+				      fonts[i]->family_name,
+				      fonts[i]->style_name);
+	}
+	self.changed = TRUE;
+}
+
+const char *LCUIFontIndex_GetMatch(const char *name)
+{
+	int64_t mtime;
+	const char *path;
+
+	if (!self.active) {
+		return NULL;
+	}
+	path = Dict_FetchValue(self.matches, name);
+	if (!path || GetFileModifiedTime(path, &mtime) != 0) {
+		return NULL;
+	}
+	return path;
+}
+
+void LCUIFontIndex_SetMatch(const char *name, const char *path)
+{
+	const char *old_path;
+
+	if (!self.active || !path) {
+		return;
+	}
+	old_path = Dict_FetchValue(self.matches, name);
+	if (old_path && strcmp(old_path, path) == 0) {
+		return;
+	}
+	Dict_Delete(self.matches, name);
+	Dict_Add(self.matches, (void *)name, strdup2(path));
+	self.changed = TRUE;
+}
@@ -0,0 +1,68 @@
+/*
+ * fontindex.h -- Persistent font index
+ *
+ * Copyright (c) 2020, Liu chao <lc-soft@live.cn> All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of LCUI nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LCUI_FONT_INDEX_H
+#define LCUI_FONT_INDEX_H
+
+/** The face information recorded in the font index */
+typedef struct LCUI_FontIndexFaceRec_ {
+	int index;
+	LCUI_FontStyle style;
+	LCUI_FontWeight weight;
+	char *family_name;
+	char *style_name;
+} LCUI_FontIndexFaceRec, *LCUI_FontIndexFace;
+
+/** Load the font index from the cache file */
+void LCUIFontIndex_Init(void);
+
+/** Write the font index to the cache file if it has been changed */
+void LCUIFontIndex_Save(void);
+
+/** Save and free the font index */
+void LCUIFontIndex_Free(void);
+
+/**
+ * Get the faces recorded for a font file
+ * @returns the number of faces, or -1 if the file is not recorded or it has
+ * been modified since it was recorded
+ */
+int LCUIFontIndex_GetFaces(const char *path, LCUI_FontIndexFace *faces);
+
+/** Record the faces of a font file */
+void LCUIFontIndex_AddFile(const char *path, LCUI_Font *fonts, int n_fonts);
+
+/** Get the recorded path of the font file matched by a font name */
+const char *LCUIFontIndex_GetMatch(const char *name);
+
+/** Record the path of the font file matched by a font name */
+void LCUIFontIndex_SetMatch(const char *name, const char *path);
+
+#endif
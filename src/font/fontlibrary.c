@@ -36,13 +36,25 @@
 #include <LCUI_Build.h>
 #include <LCUI/types.h>
 #include <LCUI/util.h>
+#include <LCUI/thread.h>
 #include <LCUI/graph.h>
 #include <LCUI/font.h>
+#include <LCUI/main.h>
+#include "fontindex.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define USE_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define USE_NEON
+#endif
 
 /* clang-format off */
 
 #define FONT_CACHE_SIZE		32
 #define FONT_CACHE_MAX_SIZE	1024
+#define FONT_PREPARE_BATCH_SIZE	64
 
 /**
  * 库中缓存的字体位图是分组存放的，共有三级分组，分别为：
@@ -63,6 +75,26 @@ typedef struct LCUI_FontCacheRec {
 	LCUI_Font fonts[FONT_CACHE_SIZE];
 } LCUI_FontCacheRec, *LCUI_FontCache;
 
+/** 字体位图的标识 */
+typedef struct LCUI_FontBitmapKeyRec_ {
+	wchar_t ch;
+	int font_id;
+	int size;
+} LCUI_FontBitmapKeyRec, *LCUI_FontBitmapKey;
+
+/**
+ * 字体位图预渲染任务
+ * 在工作线程中按字体列表的顺序渲染各个字符，结果交给主线程加入缓存
+ */
+typedef struct LCUI_FontPrepareTaskRec_ {
+	int size;			/**< 字体大小 */
+	int *font_ids;			/**< 字体ID列表，以 0 结尾 */
+	size_t length;			/**< 字符数量 */
+	wchar_t chars[FONT_PREPARE_BATCH_SIZE];
+	int bitmap_font_ids[FONT_PREPARE_BATCH_SIZE];	/**< 位图所属的字体，0 表示渲染失败 */
+	LCUI_FontBitmap bitmaps[FONT_PREPARE_BATCH_SIZE];
+} LCUI_FontPrepareTaskRec, *LCUI_FontPrepareTask;
+
 /** 字体字族索引结点 */
 typedef struct LCUI_FontFamilyNodeRec_ {
 	char *family_name;		/**< 字体的字族名称  */
@@ -76,6 +108,9 @@ static struct LCUI_FontLibraryModule {
 	Dict *font_families;		/**< 字族信息库，以字族名称索引字体信息 */
 	DictType font_families_type;	/**< 字族信息库的字典类型数据 */
 	RBTree bitmap_cache;		/**< 字体位图缓存区 */
+	RBTree pending_bitmaps;		/**< 正在预渲染的字体位图 */
+	RBTree placeholders;		/**< 占位用的字体位图，按大小和宽度索引 */
+	LCUI_Mutex mutex;		/**< 字体引擎的互斥锁，字体引擎不能在多个线程中同时使用 */
 	LCUI_FontCache *font_cache;	/**< 字体信息缓存区 */
 	LCUI_Font default_font;		/**< 默认字体的信息 */
 	LCUI_Font incore_font;		/**< 内置字体的信息 */
@@ -215,6 +250,8 @@ LCUI_Font Font(const char *family_name, const char *style_name)
 	font->id = 0;
 	font->data = NULL;
 	font->engine = NULL;
+	font->path = NULL;
+	font->face_index = 0;
 	font->family_name = strdup2(family_name);
 	font->style_name = strdup2(style_name);
 	font->weight = LCUIFont_DetectWeight(style_name);
@@ -226,7 +263,10 @@ void DeleteFont(LCUI_Font font)
 {
 	free(font->family_name);
 	free(font->style_name);
-	font->engine->close(font->data);
+	free(font->path);
+	if (font->data) {
+		font->engine->close(font->data);
+	}
 	font->data = NULL;
 	font->engine = NULL;
 	free(font);
@@ -260,6 +300,9 @@ int LCUIFont_Add(LCUI_Font font)
 	LCUI_Font exists_font;
 	LCUI_FontFamilyNode node;
 	LCUI_FontStyleNode snode;
+
+	/* 工作线程可能正在使用将被替换的字体 */
+	LCUIMutex_Lock(&fontlib.mutex);
 	node = SelectFontFamliy(font->family_name);
 	if (!node) {
 		node = NEW(LCUI_FontFamilyNodeRec, 1);
@@ -282,6 +325,7 @@ int LCUIFont_Add(LCUI_Font font)
 	}
 	SetFontWeight(snode, font);
 	SetFontCache(font);
+	LCUIMutex_Unlock(&fontlib.mutex);
 	return font->id;
 }
 
@@ -565,11 +609,89 @@ LCUI_FontBitmap *LCUIFont_AddBitmap(wchar_t ch, int font_id, int size,
 	return bmp_cache;
 }
 
+static int CompareFontBitmapKey(void *data, const void *keydata)
+{
+	const LCUI_FontBitmapKeyRec *a = data;
+	const LCUI_FontBitmapKeyRec *b = keydata;
+
+	if (a->ch != b->ch) {
+		return a->ch > b->ch ? 1 : -1;
+	}
+	if (a->font_id != b->font_id) {
+		return a->font_id > b->font_id ? 1 : -1;
+	}
+	if (a->size != b->size) {
+		return a->size > b->size ? 1 : -1;
+	}
+	return 0;
+}
+
+static LCUI_BOOL LCUIFont_IsPending(wchar_t ch, int font_id, int size)
+{
+	LCUI_FontBitmapKeyRec key;
+
+	key.ch = ch;
+	key.font_id = font_id;
+	key.size = size;
+	return RBTree_CustomGetData(&fontlib.pending_bitmaps, &key) != NULL;
+}
+
+/** 判断字符是否为全角字符，例如中日韩文字 */
+static LCUI_BOOL IsWideChar(wchar_t ch)
+{
+	return (ch >= 0x1100 && ch <= 0x115f) ||
+	       (ch >= 0x2e80 && ch <= 0xa4cf) ||
+	       (ch >= 0xac00 && ch <= 0xd7a3) ||
+	       (ch >= 0xf900 && ch <= 0xfaff) ||
+	       (ch >= 0xfe30 && ch <= 0xfe4f) ||
+	       (ch >= 0xff00 && ch <= 0xff60) ||
+	       (ch >= 0xffe0 && ch <= 0xffe6) ||
+	       ((unsigned)ch >= 0x20000 && (unsigned)ch <= 0x3fffd);
+}
+
+/**
+ * 获取占位用的字体位图
+ * 占位位图没有像素数据，只有按字符宽度估算的跨距，全角字符的宽度与字体大小
+ * 相同，其它字符为一半
+ */
+static const LCUI_FontBitmap *LCUIFont_GetPlaceholder(wchar_t ch, int size)
+{
+	int key = size * 2 + (IsWideChar(ch) ? 1 : 0);
+	LCUI_FontBitmap *bmp;
+
+	bmp = RBTree_GetData(&fontlib.placeholders, key);
+	if (bmp) {
+		return bmp;
+	}
+	bmp = NEW(LCUI_FontBitmap, 1);
+	if (!bmp) {
+		return NULL;
+	}
+	FontBitmap_Init(bmp);
+	bmp->advance.x = key & 1 ? size : size / 2;
+	bmp->advance.y = size;
+	RBTree_Insert(&fontlib.placeholders, key, bmp);
+	return bmp;
+}
+
+/** 在缓存中查找字体位图 */
+static LCUI_FontBitmap *LCUIFont_FindBitmap(wchar_t ch, int font_id, int size)
+{
+	RBTree *ctx;
+
+	if (!(ctx = SelectChar(ch))) {
+		return NULL;
+	}
+	if (!(ctx = SelectFont(ctx, font_id))) {
+		return NULL;
+	}
+	return SelectBitmap(ctx, size);
+}
+
 int LCUIFont_GetBitmap(wchar_t ch, int font_id, int size,
 		       const LCUI_FontBitmap **bmp)
 {
 	int ret;
-	RBTree *ctx;
 	LCUI_FontBitmap bmp_cache;
 
 	*bmp = NULL;
@@ -583,23 +705,18 @@ int LCUIFont_GetBitmap(wchar_t ch, int font_id, int size,
 			font_id = fontlib.incore_font->id;
 		}
 	}
-	do {
-		if (!(ctx = SelectChar(ch))) {
-			break;
-		}
-		ctx = SelectFont(ctx, font_id);
-		if (!ctx) {
-			break;
-		}
-		*bmp = SelectBitmap(ctx, size);
-		if (*bmp) {
-			return 0;
-		}
-		break;
-	} while (0);
+	*bmp = LCUIFont_FindBitmap(ch, font_id, size);
+	if (*bmp) {
+		return 0;
+	}
 	if (ch == 0) {
 		return -1;
 	}
+	/* 字体位图正在工作线程中渲染，先用占位的字体位图排版 */
+	if (LCUIFont_IsPending(ch, font_id, size)) {
+		*bmp = LCUIFont_GetPlaceholder(ch, size);
+		return *bmp ? 1 : -1;
+	}
 	FontBitmap_Init(&bmp_cache);
 	ret = LCUIFont_RenderBitmap(&bmp_cache, ch, font_id, size);
 	if (ret == 0) {
@@ -613,6 +730,276 @@ int LCUIFont_GetBitmap(wchar_t ch, int font_id, int size,
 	return -1;
 }
 
+static void LCUIFont_DestroyPrepareTask(void *arg)
+{
+	size_t i;
+	LCUI_FontPrepareTask task = arg;
+
+	for (i = 0; i < task->length; ++i) {
+		FontBitmap_Free(&task->bitmaps[i]);
+	}
+	free(task->font_ids);
+	free(task);
+}
+
+/** 将预渲染的字体位图加入缓存，然后通知文本图层重新载入字体位图 */
+static void LCUIFont_OnBitmapsPrepared(void *arg1, void *arg2)
+{
+	size_t i;
+	int *id;
+	LCUI_FontBitmapKeyRec key;
+	LCUI_FontPrepareTask task = arg1;
+	LCUI_SysEventRec e = { 0 };
+
+	if (!fontlib.active) {
+		return;
+	}
+	key.size = task->size;
+	for (i = 0; i < task->length; ++i) {
+		key.ch = task->chars[i];
+		for (id = task->font_ids; *id > 0; ++id) {
+			key.font_id = *id;
+			RBTree_CustomErase(&fontlib.pending_bitmaps, &key);
+		}
+		id = &task->bitmap_font_ids[i];
+		if (*id < 1 || LCUIFont_FindBitmap(key.ch, *id, key.size)) {
+			continue;
+		}
+		if (LCUIFont_AddBitmap(key.ch, *id, key.size,
+				       &task->bitmaps[i])) {
+			FontBitmap_Init(&task->bitmaps[i]);
+		}
+	}
+	e.type = LCUI_FONT_BITMAPS_READY;
+	LCUI_TriggerEvent(&e, NULL);
+}
+
+/**
+ * 在工作线程中渲染字体位图
+ * arg1 指向任务的所有者，任务交给主线程后所有者会被置空，否则由工作线程
+ * 任务的销毁函数释放它
+ */
+static void LCUIFont_ExecPrepareBitmaps(void *arg1, void *arg2)
+{
+	size_t i;
+	int *id;
+	LCUI_FontPrepareTask *owner = arg1;
+	LCUI_FontPrepareTask task = *owner;
+	LCUI_TaskRec ui_task = { 0 };
+
+	for (i = 0; i < task->length; ++i) {
+		for (id = task->font_ids; *id > 0; ++id) {
+			if (LCUIFont_RenderBitmap(&task->bitmaps[i],
+						  task->chars[i], *id,
+						  task->size) == 0) {
+				task->bitmap_font_ids[i] = *id;
+				break;
+			}
+			FontBitmap_Free(&task->bitmaps[i]);
+		}
+	}
+	ui_task.func = LCUIFont_OnBitmapsPrepared;
+	ui_task.arg[0] = task;
+	ui_task.destroy_arg[0] = LCUIFont_DestroyPrepareTask;
+	/* 主线程已退出时不能再访问字体库，直接丢弃渲染结果 */
+	if (LCUI_PostTask(&ui_task)) {
+		*owner = NULL;
+	}
+}
+
+static void LCUIFont_DestroyAsyncPrepareTask(void *arg)
+{
+	LCUI_FontPrepareTask *owner = arg;
+
+	if (*owner) {
+		LCUIFont_DestroyPrepareTask(*owner);
+	}
+	free(owner);
+}
+
+static LCUI_FontPrepareTask LCUIFont_CreatePrepareTask(const int *font_ids,
+						       size_t n_ids, int size)
+{
+	size_t i;
+	LCUI_FontPrepareTask task;
+
+	task = NEW(LCUI_FontPrepareTaskRec, 1);
+	if (!task) {
+		return NULL;
+	}
+	task->font_ids = malloc(sizeof(int) * (n_ids + 1));
+	if (!task->font_ids) {
+		free(task);
+		return NULL;
+	}
+	memcpy(task->font_ids, font_ids, sizeof(int) * (n_ids + 1));
+	for (i = 0; i < FONT_PREPARE_BATCH_SIZE; ++i) {
+		FontBitmap_Init(&task->bitmaps[i]);
+	}
+	task->size = size;
+	return task;
+}
+
+static void LCUIFont_PostPrepareTask(LCUI_FontPrepareTask task)
+{
+	LCUI_FontPrepareTask *owner;
+	LCUI_TaskRec async_task = { 0 };
+
+	owner = malloc(sizeof(LCUI_FontPrepareTask));
+	if (!owner) {
+		/* 任务中没有渲染好的位图，这里只是清除字符的预渲染标记 */
+		LCUIFont_OnBitmapsPrepared(task, NULL);
+		LCUIFont_DestroyPrepareTask(task);
+		return;
+	}
+	*owner = task;
+	async_task.func = LCUIFont_ExecPrepareBitmaps;
+	async_task.arg[0] = owner;
+	async_task.destroy_arg[0] = LCUIFont_DestroyAsyncPrepareTask;
+	LCUI_PostAsyncTask(&async_task);
+}
+
+/**
+ * 将字符标记为正在预渲染
+ * 如果字符在字体列表中的任意一个字体里已有缓存或正在预渲染，则不需要再渲染
+ */
+static LCUI_BOOL LCUIFont_SetPending(wchar_t ch, const int *font_ids,
+				     int size)
+{
+	const int *id;
+	LCUI_FontBitmapKey key;
+
+	for (id = font_ids; *id > 0; ++id) {
+		if (LCUIFont_FindBitmap(ch, *id, size) ||
+		    LCUIFont_IsPending(ch, *id, size)) {
+			return FALSE;
+		}
+	}
+	for (id = font_ids; *id > 0; ++id) {
+		key = NEW(LCUI_FontBitmapKeyRec, 1);
+		if (!key) {
+			break;
+		}
+		key->ch = ch;
+		key->font_id = *id;
+		key->size = size;
+		/* 字体列表中可能有重复的字体 */
+		if (!RBTree_CustomInsert(&fontlib.pending_bitmaps, key, key)) {
+			free(key);
+		}
+	}
+	return TRUE;
+}
+
+int LCUIFont_PrepareBitmaps(const wchar_t *text, const int *font_ids,
+			    int size)
+{
+	int count = 0;
+	size_t n_ids = 0;
+	int *ids;
+	const wchar_t *p;
+	LCUI_FontPrepareTask task = NULL;
+
+	if (!fontlib.active || !text || size < 1) {
+		return 0;
+	}
+	while (font_ids && font_ids[n_ids] > 0) {
+		++n_ids;
+	}
+	/* 字体列表末尾加上默认字体，与 LCUIFont_GetBitmap() 的回退方式一致 */
+	ids = malloc(sizeof(int) * (n_ids + 2));
+	if (!ids) {
+		return -ENOMEM;
+	}
+	if (n_ids > 0) {
+		memcpy(ids, font_ids, sizeof(int) * n_ids);
+	}
+	if (fontlib.default_font) {
+		ids[n_ids++] = fontlib.default_font->id;
+	} else {
+		ids[n_ids++] = fontlib.incore_font->id;
+	}
+	ids[n_ids] = 0;
+	for (p = text; *p; ++p) {
+		if (!task) {
+			task = LCUIFont_CreatePrepareTask(ids, n_ids, size);
+			if (!task) {
+				break;
+			}
+		}
+		if (!LCUIFont_SetPending(*p, ids, size)) {
+			continue;
+		}
+		task->chars[task->length++] = *p;
+		++count;
+		if (task->length >= FONT_PREPARE_BATCH_SIZE) {
+			LCUIFont_PostPrepareTask(task);
+			task = NULL;
+		}
+	}
+	if (task && task->length > 0) {
+		LCUIFont_PostPrepareTask(task);
+	} else if (task) {
+		LCUIFont_DestroyPrepareTask(task);
+	}
+	free(ids);
+	return count;
+}
+
+/** Open the face of the font registered from the font index */
+static int LCUIFont_LoadFace(LCUI_Font font)
+{
+	if (font->data) {
+		return 0;
+	}
+	if (!font->path || !font->engine->open_face) {
+		return -1;
+	}
+	Logger_Debug("[font] load face: %s, index: %d\n", font->path,
+		     font->face_index);
+	if (font->engine->open_face(font->path, font->face_index,
+				    &font->data) != 0) {
+		Logger_Debug("[font] failed to load face: %s\n", font->path);
+		free(font->path);
+		font->path = NULL;
+		return -2;
+	}
+	return 0;
+}
+
+/**
+ * Register the fonts of a file from the font index without opening it
+ * The faces will be opened when their glyphs are rendered for the first time.
+ */
+static int LCUIFont_LoadFileFromIndex(LCUI_FontEngine *engine,
+				      const char *file)
+{
+	int i, id, num_faces;
+	LCUI_Font font;
+	LCUI_FontIndexFace faces;
+
+	if (!engine || !engine->open_face) {
+		return -1;
+	}
+	num_faces = LCUIFontIndex_GetFaces(file, &faces);
+	if (num_faces < 1) {
+		return -1;
+	}
+	Logger_Debug("[font] load file from index: %s\n", file);
+	for (i = 0; i < num_faces; ++i) {
+		font = Font(faces[i].family_name, faces[i].style_name);
+		font->style = faces[i].style;
+		font->weight = faces[i].weight;
+		font->path = strdup2(file);
+		font->face_index = faces[i].index;
+		font->engine = engine;
+		id = LCUIFont_Add(font);
+		Logger_Debug("[font] add family: %s, style name: %s, id: %d\n",
+			     font->family_name, font->style_name, id);
+	}
+	return 0;
+}
+
 static int LCUIFont_LoadFileEx(LCUI_FontEngine *engine, const char *file)
 {
 	LCUI_Font *fonts;
@@ -622,13 +1009,24 @@ static int LCUIFont_LoadFileEx(LCUI_FontEngine *engine, const char *file)
 	if (!engine) {
 		return -1;
 	}
+	LCUIMutex_Lock(&fontlib.mutex);
 	num_fonts = engine->open(file, &fonts);
+	LCUIMutex_Unlock(&fontlib.mutex);
 	if (num_fonts < 1) {
 		Logger_Debug("[font] failed to load file: %s\n", file);
 		return -2;
 	}
+	if (engine->open_face) {
+		LCUIFontIndex_AddFile(file, fonts, num_fonts);
+	}
 	for (i = 0; i < num_fonts; ++i) {
+		if (!fonts[i]) {
+			continue;
+		}
 		fonts[i]->engine = engine;
+		if (engine->open_face) {
+			fonts[i]->path = strdup2(file);
+		}
 		id = LCUIFont_Add(fonts[i]);
 		Logger_Debug("[font] add family: %s, style name: %s, id: %d\n",
 			    fonts[i]->family_name, fonts[i]->style_name, id);
@@ -639,6 +1037,9 @@ static int LCUIFont_LoadFileEx(LCUI_FontEngine *engine, const char *file)
 
 int LCUIFont_LoadFile(const char *filepath)
 {
+	if (LCUIFont_LoadFileFromIndex(fontlib.engine, filepath) == 0) {
+		return 0;
+	}
 	return LCUIFont_LoadFileEx(fontlib.engine, filepath);
 }
 
@@ -714,94 +1115,281 @@ int FontBitmap_Print(LCUI_FontBitmap *fontbmp)
 	return 0;
 }
 
-static void FontBitmap_MixARGB(LCUI_Graph *graph, LCUI_Rect *write_rect,
-			       const LCUI_FontBitmap *bmp, LCUI_Color color,
-			       LCUI_Rect *read_rect)
+/*------------------------------ Glyph blitting -----------------------------*/
+
+/** 除以 255 并四舍五入，x 不能超过 65025 */
+INLINE unsigned Div255(unsigned x)
+{
+	x += 128;
+	return (x + (x >> 8)) >> 8;
+}
+
+/**
+ * 将一个覆盖率值与前景色混合到 ARGB 像素上
+ * 不透明像素使用四舍五入到 8 位的透明度做线性插值，与精确的 over 运算结果
+ * 相差不超过 1；半透明像素不对透明度取整，结果是精确值四舍五入后的值。
+ */
+INLINE void FontBitmap_MixPixelARGB(LCUI_ARGB *px, uchar_t coverage,
+				    LCUI_Color color)
+{
+	unsigned a, da, out_a;
+
+	a = coverage * color.a;
+	if (a == 0) {
+		return;
+	}
+	if (px->a == 255) {
+		a = Div255(a);
+		da = 255 - a;
+		px->r = (uchar_t)Div255(color.r * a + px->r * da);
+		px->g = (uchar_t)Div255(color.g * a + px->g * da);
+		px->b = (uchar_t)Div255(color.b * a + px->b * da);
+		return;
+	}
+	/*
+	 * 目标像素是半透明的，按 LCUI_OverPixel() 的公式计算，透明度的单位是
+	 * 1/(255*255*255)，颜色值与透明度的乘积最大约为 4.24e9，不会超出 32 位
+	 */
+	da = px->a * (65025 - a);
+	a *= 255;
+	out_a = a + da;
+	px->r = (uchar_t)((color.r * a + px->r * da + out_a / 2) / out_a);
+	px->g = (uchar_t)((color.g * a + px->g * da + out_a / 2) / out_a);
+	px->b = (uchar_t)((color.b * a + px->b * da + out_a / 2) / out_a);
+	px->a = (uchar_t)((out_a + 32512) / 65025);
+}
+
+#ifdef USE_SSE2
+
+INLINE __m128i Div255_SSE2(__m128i x)
+{
+	x = _mm_add_epi16(x, _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+/**
+ * 每次混合 4 个像素
+ * 前景色的透明通道值设为 255，这样不透明像素混合后的透明度仍然是 255
+ */
+static int FontBitmap_MixRowARGB_SSE2(LCUI_ARGB *px, const uchar_t *coverage,
+				      int n, LCUI_Color color)
+{
+	int i, j;
+	uint32_t c4;
+	__m128i d, a, lo, hi, alo, ahi;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i opaque = _mm_set1_epi32((int)0xff000000);
+	const __m128i c255 = _mm_set1_epi16(255);
+	const __m128i ca = _mm_set1_epi16(color.a);
+	const __m128i fore = _mm_setr_epi16(color.b, color.g, color.r, 255,
+					    color.b, color.g, color.r, 255);
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		memcpy(&c4, coverage + i, sizeof(c4));
+		if (c4 == 0) {
+			continue;
+		}
+		d = _mm_loadu_si128((const __m128i *)(px + i));
+		/* 有半透明像素时交给标量版本处理 */
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(
+			_mm_and_si128(d, opaque), opaque)) != 0xffff) {
+			for (j = i; j < i + 4; ++j) {
+				FontBitmap_MixPixelARGB(px + j, coverage[j],
+							color);
+			}
+			continue;
+		}
+		/* 将 4 个透明度值分别扩展到每个像素的 4 个通道 */
+		a = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)c4), zero);
+		a = Div255_SSE2(_mm_mullo_epi16(a, ca));
+		a = _mm_unpacklo_epi16(a, a);
+		alo = _mm_unpacklo_epi32(a, a);
+		ahi = _mm_unpackhi_epi32(a, a);
+		lo = _mm_unpacklo_epi8(d, zero);
+		hi = _mm_unpackhi_epi8(d, zero);
+		lo = _mm_add_epi16(_mm_mullo_epi16(fore, alo),
+				   _mm_mullo_epi16(lo, _mm_sub_epi16(c255, alo)));
+		hi = _mm_add_epi16(_mm_mullo_epi16(fore, ahi),
+				   _mm_mullo_epi16(hi, _mm_sub_epi16(c255, ahi)));
+		d = _mm_packus_epi16(Div255_SSE2(lo), Div255_SSE2(hi));
+		_mm_storeu_si128((__m128i *)(px + i), d);
+	}
+	return i;
+}
+
+#endif
+
+#ifdef USE_NEON
+
+INLINE uint8x8_t Div255_NEON(uint16x8_t x)
 {
-	int x, y;
-	LCUI_Color c;
-	LCUI_ARGB *px, *px_row_des;
-	uchar_t *byte_ptr, *byte_row_ptr;
+	x = vaddq_u16(x, vdupq_n_u16(128));
+	return vshrn_n_u16(vsraq_n_u16(x, x, 8), 8);
+}
 
-	byte_row_ptr = bmp->buffer + read_rect->y * bmp->width;
-	px_row_des = graph->argb + write_rect->y * graph->width;
-	byte_row_ptr += read_rect->x;
-	px_row_des += write_rect->x;
-	for (y = 0; y < read_rect->height; ++y) {
-		px = px_row_des;
-		byte_ptr = byte_row_ptr;
-		for (x = 0; x < read_rect->width; ++x, ++byte_ptr, ++px) {
-			c = color;
-			c.alpha = (uchar_t)(*byte_ptr * color.alpha / 255.0);
-			LCUI_OverPixel(px, &c);
+/** 每次混合 8 个像素，像素数据按通道拆分后再计算 */
+static int FontBitmap_MixRowARGB_NEON(LCUI_ARGB *px, const uchar_t *coverage,
+				      int n, LCUI_Color color)
+{
+	int i, j;
+	uint8x8_t c, a, da;
+	uint8x8x4_t d;
+	const uint8x8_t ca = vdup_n_u8(color.a);
+	const uint8x8_t cr = vdup_n_u8(color.r);
+	const uint8x8_t cg = vdup_n_u8(color.g);
+	const uint8x8_t cb = vdup_n_u8(color.b);
+	const uint8x8_t c255 = vdup_n_u8(255);
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		c = vld1_u8(coverage + i);
+		if (vget_lane_u64(vreinterpret_u64_u8(c), 0) == 0) {
+			continue;
 		}
-		px_row_des += graph->width;
-		byte_row_ptr += bmp->width;
+		d = vld4_u8((const uint8_t *)(px + i));
+		/* 有半透明像素时交给标量版本处理 */
+		if (vget_lane_u64(vreinterpret_u64_u8(d.val[3]), 0) !=
+		    ~(uint64_t)0) {
+			for (j = i; j < i + 8; ++j) {
+				FontBitmap_MixPixelARGB(px + j, coverage[j],
+							color);
+			}
+			continue;
+		}
+		a = Div255_NEON(vmull_u8(c, ca));
+		da = vsub_u8(c255, a);
+		d.val[0] = Div255_NEON(vmlal_u8(vmull_u8(cb, a), d.val[0], da));
+		d.val[1] = Div255_NEON(vmlal_u8(vmull_u8(cg, a), d.val[1], da));
+		d.val[2] = Div255_NEON(vmlal_u8(vmull_u8(cr, a), d.val[2], da));
+		vst4_u8((uint8_t *)(px + i), d);
+	}
+	return i;
+}
+
+#endif
+
+static void FontBitmap_MixRowARGB(LCUI_ARGB *px, const uchar_t *coverage,
+				  int n, LCUI_Color color)
+{
+	int i = 0;
+
+#if defined(USE_SSE2)
+	i = FontBitmap_MixRowARGB_SSE2(px, coverage, n, color);
+#elif defined(USE_NEON)
+	i = FontBitmap_MixRowARGB_NEON(px, coverage, n, color);
+#endif
+	for (; i < n; ++i) {
+		FontBitmap_MixPixelARGB(px + i, coverage[i], color);
 	}
 }
 
-static void FontBitmap_MixRGB(LCUI_Graph *graph, LCUI_Rect *write_rect,
-			      const LCUI_FontBitmap *bmp, LCUI_Color color,
-			      LCUI_Rect *read_rect)
+static void FontBitmap_MixRowRGB(uchar_t *bytes, const uchar_t *coverage,
+				 int n, LCUI_Color color)
 {
-	int x, y;
-	uchar_t *byte_src, *byte_row_src, *byte_row_des, *byte_des, alpha;
-	byte_row_src = bmp->buffer + read_rect->y * bmp->width + read_rect->x;
-	byte_row_des = graph->bytes + write_rect->y * graph->bytes_per_row;
-	byte_row_des += write_rect->x * graph->bytes_per_pixel;
-	for (y = 0; y < read_rect->height; ++y) {
-		byte_src = byte_row_src;
-		byte_des = byte_row_des;
-		for (x = 0; x < read_rect->width; ++x) {
-			alpha = (uchar_t)(*byte_src * color.alpha / 255);
-			ALPHA_BLEND(*byte_des, color.b, alpha);
-			++byte_des;
-			ALPHA_BLEND(*byte_des, color.g, alpha);
-			++byte_des;
-			ALPHA_BLEND(*byte_des, color.r, alpha);
-			++byte_des;
-			++byte_src;
+	int i;
+	unsigned a, da;
+
+	for (i = 0; i < n; ++i, bytes += 3) {
+		a = Div255(coverage[i] * color.a);
+		if (a == 0) {
+			continue;
+		}
+		da = 255 - a;
+		bytes[0] = (uchar_t)Div255(color.b * a + bytes[0] * da);
+		bytes[1] = (uchar_t)Div255(color.g * a + bytes[1] * da);
+		bytes[2] = (uchar_t)Div255(color.r * a + bytes[2] * da);
+	}
+}
+
+int FontBitmap_MixGlyphs(LCUI_Graph *graph, const LCUI_Rect *clip,
+			 const LCUI_GlyphRec *glyphs, size_t count,
+			 LCUI_Color color)
+{
+	size_t i;
+	int y, left, top;
+	uchar_t *bytes;
+	const uchar_t *coverage;
+	const LCUI_FontBitmap *bmp;
+	LCUI_Rect box, rect;
+
+	if (color.alpha == 0 || !Graph_IsWritable(graph)) {
+		return -1;
+	}
+	/* 字形坐标是相对于 graph 的，而像素要写入到它引用的源图像中 */
+	Graph_GetValidRect(graph, &box);
+	left = box.x;
+	top = box.y;
+	if (clip) {
+		rect = *clip;
+		rect.x += left;
+		rect.y += top;
+		if (!LCUIRect_GetOverlayRect(&box, &rect, &box)) {
+			return 0;
+		}
+	}
+	graph = Graph_GetQuote(graph);
+	for (i = 0; i < count; ++i) {
+		bmp = glyphs[i].bitmap;
+		if (!bmp || !bmp->buffer) {
+			continue;
+		}
+		rect.x = glyphs[i].pos.x + left;
+		rect.y = glyphs[i].pos.y + top;
+		rect.width = bmp->width;
+		rect.height = bmp->rows;
+		coverage = bmp->buffer;
+		if (!LCUIRect_GetOverlayRect(&box, &rect, &rect)) {
+			continue;
+		}
+		coverage += (rect.y - glyphs[i].pos.y - top) * bmp->width;
+		coverage += rect.x - glyphs[i].pos.x - left;
+		if (graph->color_type == LCUI_COLOR_TYPE_ARGB) {
+			LCUI_ARGB *px = graph->argb + rect.y * graph->width;
+
+			px += rect.x;
+			for (y = 0; y < rect.height; ++y) {
+				FontBitmap_MixRowARGB(px, coverage, rect.width,
+						      color);
+				px += graph->width;
+				coverage += bmp->width;
+			}
+			continue;
+		}
+		bytes = graph->bytes + rect.y * graph->bytes_per_row;
+		bytes += rect.x * graph->bytes_per_pixel;
+		for (y = 0; y < rect.height; ++y) {
+			FontBitmap_MixRowRGB(bytes, coverage, rect.width,
+					     color);
+			bytes += graph->bytes_per_row;
+			coverage += bmp->width;
 		}
-		byte_row_des += graph->bytes_per_row;
-		byte_row_src += bmp->width;
 	}
+	return 0;
 }
 
 int FontBitmap_Mix(LCUI_Graph *graph, LCUI_Pos pos, const LCUI_FontBitmap *bmp,
 		   LCUI_Color color)
 {
-	LCUI_Graph write_slot;
-	LCUI_Rect r_rect, w_rect;
+	LCUI_GlyphRec glyph;
+
 	if (pos.x > (int)graph->width || pos.y > (int)graph->height) {
 		return -2;
 	}
-	/* 获取写入区域 */
-	w_rect.x = pos.x;
-	w_rect.y = pos.y;
-	w_rect.width = bmp->width;
-	w_rect.height = bmp->rows;
-	/* 获取需要裁剪的区域 */
-	LCUIRect_GetCutArea(graph->width, graph->height, w_rect, &r_rect);
-	w_rect.x += r_rect.x;
-	w_rect.y += r_rect.y;
-	w_rect.width = r_rect.width;
-	w_rect.height = r_rect.height;
-	Graph_Quote(&write_slot, graph, &w_rect);
-	Graph_GetValidRect(&write_slot, &w_rect);
-	/* 获取背景图引用的源图形 */
-	graph = Graph_GetQuote(graph);
-	if (graph->color_type == LCUI_COLOR_TYPE_ARGB) {
-		FontBitmap_MixARGB(graph, &w_rect, bmp, color, &r_rect);
-	} else {
-		FontBitmap_MixRGB(graph, &w_rect, bmp, color, &r_rect);
-	}
-	return 0;
+	glyph.bitmap = bmp;
+	glyph.pos = pos;
+	return FontBitmap_MixGlyphs(graph, NULL, &glyph, 1, color);
 }
 
 int LCUIFont_RenderBitmap(LCUI_FontBitmap *buff, wchar_t ch, int font_id,
 			  int pixel_size)
 {
-	LCUI_Font font = fontlib.default_font;
+	int ret;
+	LCUI_Font font;
+
+	if (!fontlib.active) {
+		return -1;
+	}
+	LCUIMutex_Lock(&fontlib.mutex);
+	font = fontlib.default_font;
 	do {
 		if (font_id < 0 || !fontlib.engine) {
 			break;
@@ -817,10 +1405,24 @@ int LCUIFont_RenderBitmap(LCUI_FontBitmap *buff, wchar_t ch, int font_id,
 		}
 		break;
 	} while (0);
-	if (!font) {
+	/*
+	 * The face of a font from the index is opened on the first use, if it
+	 * cannot be opened, fall back to the default font as if the font had
+	 * failed to load from the file.
+	 */
+	if (font && LCUIFont_LoadFace(font) != 0) {
+		font = fontlib.default_font;
+		if (font && LCUIFont_LoadFace(font) != 0) {
+			font = fontlib.incore_font;
+		}
+	}
+	if (!font || LCUIFont_LoadFace(font) != 0) {
+		LCUIMutex_Unlock(&fontlib.mutex);
 		return -1;
 	}
-	return font->engine->render(buff, ch, pixel_size, font);
+	ret = font->engine->render(buff, ch, pixel_size, font);
+	LCUIMutex_Unlock(&fontlib.mutex);
+	return ret;
 }
 
 static void LCUIFont_InitBase(void)
@@ -830,6 +1432,12 @@ static void LCUIFont_InitBase(void)
 	fontlib.font_cache = NEW(LCUI_FontCache, 1);
 	fontlib.font_cache[0] = FontCache();
 	RBTree_Init(&fontlib.bitmap_cache);
+	RBTree_Init(&fontlib.pending_bitmaps);
+	RBTree_Init(&fontlib.placeholders);
+	RBTree_OnCompare(&fontlib.pending_bitmaps, CompareFontBitmapKey);
+	RBTree_OnDestroy(&fontlib.pending_bitmaps, free);
+	RBTree_OnDestroy(&fontlib.placeholders, free);
+	LCUIMutex_Init(&fontlib.mutex);
 	Dict_InitStringKeyType(&fontlib.font_families_type);
 	fontlib.font_families_type.valDestructor = DestroyFontFamilyNode;
 	fontlib.font_families = Dict_Create(&fontlib.font_families_type, NULL);
@@ -873,6 +1481,9 @@ static void LCUIFont_FreeBase(void)
 	}
 	Dict_Release(fontlib.font_families);
 	RBTree_Destroy(&fontlib.bitmap_cache);
+	RBTree_Destroy(&fontlib.pending_bitmaps);
+	RBTree_Destroy(&fontlib.placeholders);
+	LCUIMutex_Destroy(&fontlib.mutex);
 	free(fontlib.font_cache);
 	fontlib.font_cache = NULL;
 }
@@ -915,13 +1526,22 @@ static void LCUIFont_LoadFontsByFontConfig(void)
 {
 	size_t i;
 	char *path;
+	const char *match;
 	int *ids = NULL;
 	const char *names = "Noto Sans CJK, Ubuntu, WenQuanYi Micro Hei";
 	const char *fonts[] = { "Ubuntu", "Noto Sans CJK SC",
 				"WenQuanYi Micro Hei" };
 
 	for (i = 0; i < sizeof(fonts) / sizeof(char *); ++i) {
-		path = Fontconfig_GetPath(fonts[i]);
+		/* Querying fontconfig is slow, so the matched path is reused
+		 * while the font file still exists */
+		match = LCUIFontIndex_GetMatch(fonts[i]);
+		if (match) {
+			path = strdup2(match);
+		} else {
+			path = Fontconfig_GetPath(fonts[i]);
+			LCUIFontIndex_SetMatch(fonts[i], path);
+		}
 		LCUIFont_LoadFile(path);
 		free(path);
 	}
@@ -983,12 +1603,15 @@ static void LCUIFont_LoadDefaultFonts(void)
 void LCUI_InitFontLibrary(void)
 {
 	LCUIFont_InitBase();
+	LCUIFontIndex_Init();
 	LCUIFont_InitEngine();
 	LCUIFont_LoadDefaultFonts();
+	LCUIFontIndex_Save();
 }
 
 void LCUI_FreeFontLibrary(void)
 {
 	LCUIFont_FreeBase();
 	LCUIFont_FreeEngine();
+	LCUIFontIndex_Free();
 }
@@ -33,6 +33,7 @@
 #ifdef LCUI_FONT_ENGINE_FREETYPE
 #include <LCUI/types.h>
 #include <LCUI/util/linkedlist.h>
+#include <LCUI/util/mmap.h>
 #include <LCUI/font.h>
 #include <stdlib.h>
 #include <errno.h>
@@ -50,41 +51,91 @@ static struct {
 	FT_Library library;
 } freetype;
 
+/** Release the file mapping when the face is destroyed */
+static void FreeType_OnDoneFace(void *object)
+{
+	FT_Face face = object;
+	LCUI_UnmapFile(face->generic.data);
+}
+
+static int FreeType_OpenMemoryFace(LCUI_MappedFile file, int index,
+				   FT_Face *face)
+{
+	return FT_New_Memory_Face(freetype.library, file->data,
+				  (FT_Long)file->size, index, face);
+}
+
 static int FreeType_Open(const char *filepath, LCUI_Font **outfonts)
 {
 	FT_Face face;
 	LCUI_Font font, *fonts;
+	LCUI_MappedFile file;
 	int i, err, num_faces;
 
-	err = FT_New_Face(freetype.library, filepath, -1, &face);
+	/* The faces read the font data directly from the file mapping, which
+	 * is shared by all faces of the file */
+	file = LCUI_MapFile(filepath);
+	if (!file) {
+		*outfonts = NULL;
+		return -1;
+	}
+	err = FreeType_OpenMemoryFace(file, -1, &face);
 	if (err) {
+		LCUI_UnmapFile(file);
 		*outfonts = NULL;
 		return -1;
 	}
 	num_faces = face->num_faces;
 	FT_Done_Face(face);
 	if (num_faces < 1) {
+		LCUI_UnmapFile(file);
 		return 0;
 	}
 	fonts = malloc(sizeof(LCUI_FontRec*) * num_faces);
 	if (!fonts) {
+		LCUI_UnmapFile(file);
 		return -ENOMEM;
 	}
 	for (i = 0; i < num_faces; ++i) {
-		err = FT_New_Face(freetype.library, filepath, i, &face);
+		err = FreeType_OpenMemoryFace(file, i, &face);
 		if (err) {
 			fonts[i] = NULL;
 			continue;
 		}
+		LCUI_MapFile(filepath);
+		face->generic.data = file;
+		face->generic.finalizer = FreeType_OnDoneFace;
 		FT_Select_Charmap(face, FT_ENCODING_UNICODE);
 		font = Font(face->family_name, face->style_name);
 		font->data = face;
+		font->face_index = i;
 		fonts[i] = font;
 	}
+	LCUI_UnmapFile(file);
 	*outfonts = fonts;
 	return num_faces;
 }
 
+static int FreeType_OpenFace(const char *filepath, int index, void **data)
+{
+	FT_Face face;
+	LCUI_MappedFile file;
+
+	file = LCUI_MapFile(filepath);
+	if (!file) {
+		return -1;
+	}
+	if (FreeType_OpenMemoryFace(file, index, &face)) {
+		LCUI_UnmapFile(file);
+		return -1;
+	}
+	face->generic.data = file;
+	face->generic.finalizer = FreeType_OnDoneFace;
+	FT_Select_Charmap(face, FT_ENCODING_UNICODE);
+	*data = face;
+	return 0;
+}
+
 static void FreeType_Close(void *face)
 {
 	FT_Done_Face(face);
@@ -205,6 +256,7 @@ int LCUIFont_InitFreeType(LCUI_FontEngine *engine)
 	strcpy(engine->name, "FreeType");
 	engine->render = FreeType_Render;
 	engine->open = FreeType_Open;
+	engine->open_face = FreeType_OpenFace;
 	engine->close = FreeType_Close;
 	return 0;
 }
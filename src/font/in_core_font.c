@@ -79,6 +79,7 @@ int LCUIFont_InitInCoreFont(LCUI_FontEngine *engine)
 	engine->render = InCoreFont_Render;
 	engine->close = InCoreFont_Close;
 	engine->open = InCoreFont_Open;
+	engine->open_face = NULL;
 	strcpy(engine->name, "in-core");
 	return 0;
 }
@@ -28,7 +28,9 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <errno.h>
 #include <stdlib.h>
+#include <string.h>
 #include <wctype.h>
 #include <LCUI_Build.h>
 #include <LCUI/types.h>
@@ -45,7 +47,10 @@ typedef enum { TEXT_ACTION_INSERT, TEXT_ACTION_APPEND } TextAction;
 #define TextLayer_GetRow(layer, n) \
 	(n >= layer->text_rows.length) ? NULL : layer->text_rows.rows[n]
 #define GetDefaultLineHeight(H) iround(H * 1.42857143)
+#define TEXT_GLYPH_RUN_SIZE 64
 #define ISALPHA(CH) (CH >= 'a' && CH <= 'z') || (CH >= 'A' && CH <= 'Z')
+#define TextLayer_GetStyle(layer, id) \
+	((id) > 0 ? (layer)->text_styles.items[(id) - 1] : NULL)
 
 /* 根据对齐方式，计算文本行的起始X轴位置 */
 static int TextLayer_GetRowStartX(LCUI_TextLayer layer, LCUI_TextRow txtrow)
@@ -106,27 +111,30 @@ static void TextRow_Init(LCUI_TextRow txtrow)
 	txtrow->width = 0;
 	txtrow->height = 0;
 	txtrow->length = 0;
-	txtrow->string = NULL;
+	txtrow->capacity = 0;
+	txtrow->codes = NULL;
+	txtrow->bitmaps = NULL;
+	txtrow->advances = NULL;
+	txtrow->styles = NULL;
 	txtrow->eol = LCUI_EOL_NONE;
 	txtrow->text_height = 0;
 }
 
 static void TextRow_Destroy(LCUI_TextRow txtrow)
 {
-	int i;
-	for (i = 0; i < txtrow->length; ++i) {
-		if (txtrow->string[i]) {
-			free(txtrow->string[i]);
-		}
-	}
 	txtrow->width = 0;
 	txtrow->height = 0;
 	txtrow->length = 0;
+	txtrow->capacity = 0;
 	txtrow->text_height = 0;
-	if (txtrow->string) {
-		free(txtrow->string);
-	}
-	txtrow->string = NULL;
+	free(txtrow->codes);
+	free(txtrow->bitmaps);
+	free(txtrow->advances);
+	free(txtrow->styles);
+	txtrow->codes = NULL;
+	txtrow->bitmaps = NULL;
+	txtrow->advances = NULL;
+	txtrow->styles = NULL;
 }
 
 /** 向文本行列表中插入新的文本行 */
@@ -180,17 +188,17 @@ static int TextRowList_RemoveRow(LCUI_TextRowList rowlist, int i_row)
 static void TextLayer_UpdateRowSize(LCUI_TextLayer layer, LCUI_TextRow txtrow)
 {
 	int i;
-	LCUI_TextChar txtchar;
+	const LCUI_FontBitmap *bitmap;
+
 	txtrow->width = 0;
 	txtrow->text_height = layer->text_default_style.pixel_size;
 	for (i = 0; i < txtrow->length; ++i) {
-		txtchar = txtrow->string[i];
-		if (!txtchar->bitmap) {
-			continue;
-		}
-		txtrow->width += txtchar->bitmap->advance.x;
-		if (txtrow->text_height < txtchar->bitmap->advance.y) {
-			txtrow->text_height = txtchar->bitmap->advance.y;
+		txtrow->width += txtrow->advances[i];
+	}
+	for (i = 0; i < txtrow->length; ++i) {
+		bitmap = txtrow->bitmaps[i];
+		if (bitmap && txtrow->text_height < bitmap->advance.y) {
+			txtrow->text_height = bitmap->advance.y;
 		}
 	}
 	if (layer->line_height > -1) {
@@ -200,77 +208,151 @@ static void TextLayer_UpdateRowSize(LCUI_TextLayer layer, LCUI_TextRow txtrow)
 	}
 }
 
-/** 设置文本行的字符串长度 */
+/**
+ * 设置文本行的字符串长度
+ * 新增的字符数据未初始化，容量不足时按倍数扩充，以减少逐字插入时的内存分配
+ */
 static int TextRow_SetLength(LCUI_TextRow txtrow, int len)
 {
-	LCUI_TextChar *txtstr;
+	int capacity;
+	void *p;
+
 	if (len < 0) {
 		len = 0;
 	}
-	txtstr = realloc(txtrow->string, sizeof(LCUI_TextChar) * (len + 1));
-	if (!txtstr) {
-		return -1;
+	if (len > txtrow->capacity) {
+		capacity = max(len, max(txtrow->capacity * 2, 8));
+		p = realloc(txtrow->codes, sizeof(wchar_t) * capacity);
+		if (!p) {
+			return -ENOMEM;
+		}
+		txtrow->codes = p;
+		p = realloc(txtrow->bitmaps,
+			    sizeof(const LCUI_FontBitmap *) * capacity);
+		if (!p) {
+			return -ENOMEM;
+		}
+		txtrow->bitmaps = p;
+		p = realloc(txtrow->advances, sizeof(int) * capacity);
+		if (!p) {
+			return -ENOMEM;
+		}
+		txtrow->advances = p;
+		p = realloc(txtrow->styles, sizeof(unsigned) * capacity);
+		if (!p) {
+			return -ENOMEM;
+		}
+		txtrow->styles = p;
+		txtrow->capacity = capacity;
 	}
-	txtstr[len] = NULL;
-	txtrow->string = txtstr;
 	txtrow->length = len;
 	return 0;
 }
 
-/** 将字符数据直接插入至文本行 */
-static int TextRow_Insert(LCUI_TextRow txtrow, int ins_pos,
-			  LCUI_TextChar txtchar)
+/** 复制文本行中的一段字符数据，源与目标区域可以重叠 */
+static void TextRow_MoveChars(LCUI_TextRow dst, int dst_col,
+			      LCUI_TextRow src, int src_col, int n)
 {
-	int i;
+	if (n <= 0) {
+		return;
+	}
+	memmove(dst->codes + dst_col, src->codes + src_col,
+		sizeof(wchar_t) * n);
+	memmove(dst->bitmaps + dst_col, src->bitmaps + src_col,
+		sizeof(const LCUI_FontBitmap *) * n);
+	memmove(dst->advances + dst_col, src->advances + src_col,
+		sizeof(int) * n);
+	memmove(dst->styles + dst_col, src->styles + src_col,
+		sizeof(unsigned) * n);
+}
+
+INLINE void TextRow_SetBitmap(LCUI_TextRow txtrow, int col,
+			      const LCUI_FontBitmap *bitmap)
+{
+	txtrow->bitmaps[col] = bitmap;
+	txtrow->advances[col] = bitmap ? bitmap->advance.x : 0;
+}
+
+/** 向文本行插入一个字符 */
+static int TextRow_InsertChar(LCUI_TextRow txtrow, int ins_pos, wchar_t code,
+			      const LCUI_FontBitmap *bitmap, unsigned style)
+{
+	int len = txtrow->length;
+
 	if (ins_pos < 0) {
-		ins_pos = txtrow->length + 1 + ins_pos;
-		if (ins_pos < 0) {
-			ins_pos = 0;
-		}
-	} else if (ins_pos > txtrow->length) {
-		ins_pos = txtrow->length;
+		ins_pos = 0;
+	} else if (ins_pos > len) {
+		ins_pos = len;
 	}
-	TextRow_SetLength(txtrow, txtrow->length + 1);
-	for (i = txtrow->length - 1; i > ins_pos; --i) {
-		txtrow->string[i] = txtrow->string[i - 1];
+	if (TextRow_SetLength(txtrow, len + 1) != 0) {
+		return -ENOMEM;
 	}
-	txtrow->string[ins_pos] = txtchar;
+	TextRow_MoveChars(txtrow, ins_pos + 1, txtrow, ins_pos, len - ins_pos);
+	txtrow->codes[ins_pos] = code;
+	txtrow->styles[ins_pos] = style;
+	TextRow_SetBitmap(txtrow, ins_pos, bitmap);
 	return 0;
 }
 
-/** 向文本行插入一个字符数据副本 */
-static int TextRow_InsertCopy(LCUI_TextRow txtrow, int ins_pos,
-			      LCUI_TextChar txtchar)
+/** 获取字符在指定样式下的字体位图 */
+static const LCUI_FontBitmap *TextLayer_GetCharBitmap(LCUI_TextLayer layer,
+						      wchar_t code,
+						      unsigned style_id)
 {
-	LCUI_TextChar txtchar2;
-	txtchar2 = malloc(sizeof(LCUI_TextCharRec));
-	*txtchar2 = *txtchar;
-	return TextRow_Insert(txtrow, ins_pos, txtchar2);
-}
+	int i = 0, ret = -1;
+	int size = layer->text_default_style.pixel_size;
+	int *font_ids = layer->text_default_style.font_ids;
+	LCUI_TextStyle style = TextLayer_GetStyle(layer, style_id);
+	const LCUI_FontBitmap *bitmap;
 
-/** 更新字体位图 */
-static void TextChar_UpdateBitmap(LCUI_TextChar ch, LCUI_TextStyle style)
-{
-	int i = 0;
-	int size = style->pixel_size;
-	int *font_ids = style->font_ids;
-	if (ch->style) {
-		if (ch->style->has_family) {
-			font_ids = ch->style->font_ids;
+	if (style) {
+		if (style->has_family) {
+			font_ids = style->font_ids;
 		}
-		if (ch->style->has_pixel_size) {
-			size = ch->style->pixel_size;
+		if (style->has_pixel_size) {
+			size = style->pixel_size;
 		}
 	}
 	while (font_ids && font_ids[i] > 0) {
-		int ret = LCUIFont_GetBitmap(ch->code, font_ids[i], size,
-					     &ch->bitmap);
-		if (ret == 0) {
-			return;
+		ret = LCUIFont_GetBitmap(code, font_ids[i], size, &bitmap);
+		if (ret >= 0) {
+			break;
 		}
 		++i;
 	}
-	LCUIFont_GetBitmap(ch->code, -1, size, &ch->bitmap);
+	if (ret < 0) {
+		ret = LCUIFont_GetBitmap(code, -1, size, &bitmap);
+	}
+	if (ret > 0) {
+		layer->has_placeholder = TRUE;
+	}
+	return bitmap;
+}
+
+/**
+ * 将样式添加到样式表中
+ * 样式表接管样式的内存
+ * @returns 样式的序号，添加失败时返回 0
+ */
+static unsigned TextLayer_AddStyle(LCUI_TextLayer layer, LCUI_TextStyle style)
+{
+	unsigned capacity;
+	LCUI_TextStyle *items;
+
+	if (layer->text_styles.length >= layer->text_styles.capacity) {
+		capacity = max(layer->text_styles.capacity * 2, 8);
+		items = realloc(layer->text_styles.items,
+				sizeof(LCUI_TextStyle) * capacity);
+		if (!items) {
+			TextStyle_Destroy(style);
+			free(style);
+			return 0;
+		}
+		layer->text_styles.items = items;
+		layer->text_styles.capacity = capacity;
+	}
+	layer->text_styles.items[layer->text_styles.length++] = style;
+	return layer->text_styles.length;
 }
 
 /** 新建文本图层 */
@@ -297,9 +379,12 @@ LCUI_TextLayer TextLayer_New(void)
 	layer->enable_autowrap = FALSE;
 	layer->enable_mulitiline = FALSE;
 	layer->enable_style_tag = FALSE;
+	layer->has_placeholder = FALSE;
 	layer->word_break = LCUI_WORD_BREAK_NORMAL;
 	TextStyle_Init(&layer->text_default_style);
-	LinkedList_Init(&layer->text_styles);
+	layer->text_styles.items = NULL;
+	layer->text_styles.length = 0;
+	layer->text_styles.capacity = 0;
 	layer->task.typeset_start_row = 0;
 	layer->task.update_typeset = 0;
 	layer->task.update_bitmap = 0;
@@ -324,15 +409,18 @@ static void TextRowList_Destroy(LCUI_TextRowList list)
 	list->rows = NULL;
 }
 
-static void OnDestroyTextStyle(void *data)
-{
-	TextStyle_Destroy(data);
-	free(data);
-}
-
 static void TextLayer_DestroyStyleCache(LCUI_TextLayer layer)
 {
-	LinkedList_Clear(&layer->text_styles, OnDestroyTextStyle);
+	unsigned i;
+
+	for (i = 0; i < layer->text_styles.length; ++i) {
+		TextStyle_Destroy(layer->text_styles.items[i]);
+		free(layer->text_styles.items[i]);
+	}
+	free(layer->text_styles.items);
+	layer->text_styles.items = NULL;
+	layer->text_styles.length = 0;
+	layer->text_styles.capacity = 0;
 }
 
 /** 销毁TextLayer */
@@ -371,17 +459,11 @@ static int TextLayer_GetRowRect(LCUI_TextLayer layer, int i_row, int start_col,
 		rect->width = txtrow->width;
 	} else {
 		for (i = 0; i < start_col; ++i) {
-			if (!txtrow->string[i]->bitmap) {
-				continue;
-			}
-			rect->x += txtrow->string[i]->bitmap->advance.x;
+			rect->x += txtrow->advances[i];
 		}
 		rect->width = 0;
 		for (i = start_col; i <= end_col && i < txtrow->length; ++i) {
-			if (!txtrow->string[i]->bitmap) {
-				continue;
-			}
-			rect->width += txtrow->string[i]->bitmap->advance.x;
+			rect->width += txtrow->advances[i];
 		}
 	}
 	if (rect->width <= 0 || rect->height <= 0) {
@@ -481,14 +563,12 @@ int TextLayer_SetCaretPosByPixelPos(LCUI_TextLayer layer, int x, int y)
 	pixel_pos = layer->offset_x;
 	pixel_pos += TextLayer_GetRowStartX(layer, txtrow);
 	for (i = 0; i < txtrow->length; ++i) {
-		LCUI_TextChar txtchar;
-		txtchar = txtrow->string[i];
-		if (!txtchar->bitmap) {
+		if (!txtrow->bitmaps[i]) {
 			continue;
 		}
-		pixel_pos += txtchar->bitmap->advance.x;
+		pixel_pos += txtrow->advances[i];
 		/* 如果在当前字中心点的前面 */
-		if (x <= pixel_pos - txtchar->bitmap->advance.x / 2) {
+		if (x <= pixel_pos - txtrow->advances[i] / 2) {
 			ins_x = i;
 			break;
 		}
@@ -518,11 +598,7 @@ int TextLayer_GetCharPixelPos(LCUI_TextLayer layer, int row, int col,
 	txtrow = layer->text_rows.rows[row];
 	pixel_x = TextLayer_GetRowStartX(layer, txtrow);
 	for (i = 0; i < col; ++i) {
-		LCUI_TextChar txtchar = txtrow->string[i];
-		if (!txtchar || !txtchar->bitmap) {
-			continue;
-		}
-		pixel_x += txtchar->bitmap->advance.x;
+		pixel_x += txtrow->advances[i];
 	}
 	pixel_pos->x = pixel_x;
 	pixel_pos->y = pixel_y;
@@ -561,11 +637,11 @@ static void TextLayer_BreakTextRow(LCUI_TextLayer layer, int row, int col,
 	/* 将本行原有的行尾符转移至下一行 */
 	next->eol = txtrow->eol;
 	txtrow->eol = eol;
-	for (n = txtrow->length - 1; n >= col; --n) {
-		TextRow_Insert(next, 0, txtrow->string[n]);
-		txtrow->string[n] = NULL;
+	n = txtrow->length - col;
+	if (n > 0 && TextRow_SetLength(next, n) == 0) {
+		TextRow_MoveChars(next, 0, txtrow, col, n);
+		txtrow->length = col;
 	}
-	txtrow->length = col;
 	TextLayer_UpdateRowSize(layer, txtrow);
 	TextLayer_UpdateRowSize(layer, next);
 }
@@ -573,7 +649,7 @@ static void TextLayer_BreakTextRow(LCUI_TextLayer layer, int row, int col,
 /** 将指定行与下一行合并 */
 static void TextLayer_MergeRow(LCUI_TextLayer layer, int row)
 {
-	int i, j;
+	int i;
 	LCUI_TextRow txtrow = TextLayer_GetRow(layer, row);
 	LCUI_TextRow next = TextLayer_GetRow(layer, row + 1);
 
@@ -587,11 +663,10 @@ static void TextLayer_MergeRow(LCUI_TextLayer layer, int row)
 		}
 	}
 	i = txtrow->length;
-	TextRow_SetLength(txtrow, txtrow->length + next->length);
-	for (j = 0; j < next->length; ++i, ++j) {
-		txtrow->string[i] = next->string[j];
-		next->string[j] = NULL;
+	if (TextRow_SetLength(txtrow, txtrow->length + next->length) != 0) {
+		return;
 	}
+	TextRow_MoveChars(txtrow, i, next, 0, next->length);
 	txtrow->eol = next->eol;
 	TextLayer_UpdateRowSize(layer, txtrow);
 	TextRowList_RemoveRow(&layer->text_rows, row + 1);
@@ -604,21 +679,19 @@ static void TextLayer_TextRowTypeset(LCUI_TextLayer layer, int row)
 	int max_width =
 	    layer->fixed_width > 0 ? layer->fixed_width : layer->max_width;
 
-	LCUI_TextChar txtchar;
 	LCUI_TextRow txtrow = layer->text_rows.rows[row];
 	LCUI_BOOL autowrap =
 	    max_width > 0 && layer->enable_autowrap && layer->enable_mulitiline;
 
 	for (col = 0; col < txtrow->length; ++col) {
-		txtchar = txtrow->string[col];
-		if (!txtchar->bitmap) {
+		if (!txtrow->bitmaps[col]) {
 			continue;
 		}
 		/* 累加行宽度 */
-		row_width += txtchar->bitmap->advance.x;
+		row_width += txtrow->advances[col];
 		/* 如果是当前行的第一个字符，或者行宽度没有超过宽度限制 */
 		if (!autowrap || col < 1 || row_width <= max_width) {
-			if (ISALPHA(txtchar->code)) {
+			if (ISALPHA(txtrow->codes[col])) {
 			} else {
 				word_col = col + 1;
 			}
@@ -653,6 +726,19 @@ static void TextLayer_TextRowTypeset(LCUI_TextLayer layer, int row)
 static void TextLayer_TextTypeset(LCUI_TextLayer layer, int start_row)
 {
 	int row;
+
+	if (start_row >= layer->text_rows.length) {
+		start_row = layer->text_rows.length - 1;
+	}
+	/* 自动换行产生的行没有行尾符，文字可能会移回上一行，所以要从段落的第一
+	 * 行开始排版 */
+	while (start_row > 0 &&
+	       layer->text_rows.rows[start_row - 1]->eol == LCUI_EOL_NONE) {
+		--start_row;
+	}
+	if (start_row < 0) {
+		return;
+	}
 	/* 记录排版前各个文本行的矩形区域 */
 	TextLayer_InvalidateRowsRect(layer, start_row, -1);
 	for (row = start_row; row < layer->text_rows.length; ++row) {
@@ -665,31 +751,26 @@ static void TextLayer_TextTypeset(LCUI_TextLayer layer, int start_row)
 static const wchar_t *TextLayer_ProcessStyleTag(LCUI_TextLayer layer,
 						const wchar_t *p,
 						LinkedList *tags,
-						LCUI_TextStyle *style)
+						unsigned *style)
 {
 	LCUI_TextStyle s;
 	const wchar_t *pp;
+
 	pp = StyleTags_GetEnd(tags, p);
-	if (pp) {
-		s = StyleTags_GetTextStyle(tags);
-		if (s) {
-			TextStyle_Merge(s, &layer->text_default_style);
-			LinkedList_Append(&layer->text_styles, s);
-		}
-		*style = s;
-		return pp;
-	}
-	pp = StyleTags_GetStart(tags, p);
-	if (pp) {
-		s = StyleTags_GetTextStyle(tags);
-		if (s) {
-			TextStyle_Merge(s, &layer->text_default_style);
-			LinkedList_Append(&layer->text_styles, s);
+	if (!pp) {
+		pp = StyleTags_GetStart(tags, p);
+		if (!pp) {
+			return NULL;
 		}
-		*style = s;
-		return pp;
 	}
-	return NULL;
+	s = StyleTags_GetTextStyle(tags);
+	if (s) {
+		TextStyle_Merge(s, &layer->text_default_style);
+		*style = TextLayer_AddStyle(layer, s);
+	} else {
+		*style = 0;
+	}
+	return pp;
 }
 
 /** 对文本进行预处理 */
@@ -698,12 +779,12 @@ static int TextLayer_ProcessText(LCUI_TextLayer layer, const wchar_t *wstr,
 {
 	LCUI_EOLChar eol;
 	LCUI_TextRow txtrow;
-	LCUI_TextCharRec txtchar;
 	LinkedList tmp_tags;
 	const wchar_t *p;
+	const LCUI_FontBitmap *bitmap;
 	int cur_col, cur_row, start_row, ins_x, ins_y;
 	LCUI_BOOL need_typeset, rect_has_added;
-	LCUI_TextStyle style = NULL;
+	unsigned style = 0;
 
 	if (!wstr) {
 		return -1;
@@ -751,6 +832,7 @@ static int TextLayer_ProcessText(LCUI_TextLayer layer, const wchar_t *wstr,
 			if (*p == '\r') {
 				if (*(p + 1) == '\n') {
 					eol = LCUI_EOL_CR_LF;
+					++p;
 				} else {
 					eol = LCUI_EOL_CR;
 				}
@@ -773,10 +855,10 @@ static int TextLayer_ProcessText(LCUI_TextLayer layer, const wchar_t *wstr,
 			txtrow = TextLayer_GetRow(layer, ins_y);
 			continue;
 		}
-		txtchar.style = style;
-		txtchar.code = *p;
-		TextChar_UpdateBitmap(&txtchar, &layer->text_default_style);
-		TextRow_InsertCopy(txtrow, ins_x, &txtchar);
+		bitmap = TextLayer_GetCharBitmap(layer, *p, style);
+		if (TextRow_InsertChar(txtrow, ins_x, *p, bitmap, style) != 0) {
+			break;
+		}
 		++layer->length;
 		++ins_x;
 	}
@@ -884,7 +966,7 @@ size_t TextLayer_GetTextW(LCUI_TextLayer layer, size_t start_pos,
 	for (i = 0; row < layer->text_rows.length && i < max_len; ++row) {
 		row_ptr = layer->text_rows.rows[row];
 		for (; col < row_ptr->length && i < max_len; ++col, ++i) {
-			wstr_buff[i] = row_ptr->string[col]->code;
+			wstr_buff[i] = row_ptr->codes[col];
 		}
 	}
 	wstr_buff[i] = 0;
@@ -901,15 +983,14 @@ int TextLayer_GetWidth(LCUI_TextLayer layer)
 	for (row = 0, max_w = 0; row < layer->text_rows.length; ++row) {
 		txtrow = layer->text_rows.rows[row];
 		for (i = 0, w = 0; i < txtrow->length; ++i) {
-			if (!txtrow->string[i]->bitmap ||
-			    !txtrow->string[i]->bitmap->buffer) {
+			/* 占位位图没有像素数据，但它的步进宽度仍然有效 */
+			if (!txtrow->bitmaps[i]) {
 				continue;
 			}
-			w += txtrow->string[i]->bitmap->advance.x;
+			w += txtrow->advances[i];
 			DEBUG_MSG("[%d/%d] %d %c, width: %d/%d\n", i,
-				  txtrow->length, txtrow->string[i]->code,
-				  txtrow->string[i]->code,
-				  txtrow->string[i]->bitmap->advance.x, w);
+				  txtrow->length, txtrow->codes[i],
+				  txtrow->codes[i], txtrow->advances[i], w);
 		}
 		if (w > max_w) {
 			max_w = w;
@@ -965,7 +1046,7 @@ static int TextLayer_TextDeleteEx(LCUI_TextLayer layer, int char_y, int char_x,
 				  int n_char)
 {
 	int end_x, end_y, i, j, len;
-	LCUI_TextRow txtrow, end_txtrow, prev_txtrow;
+	LCUI_TextRow txtrow, end_txtrow;
 
 	if (char_x < 0) {
 		char_x = 0;
@@ -1007,6 +1088,7 @@ static int TextLayer_TextDeleteEx(LCUI_TextLayer layer, int char_y, int char_x,
 	} else {
 		layer->length -= n_char;
 	}
+	txtrow = layer->text_rows.rows[char_y];
 	if (end_y >= layer->text_rows.length) {
 		end_y = layer->text_rows.length - 1;
 		end_txtrow = layer->text_rows.rows[end_y];
@@ -1020,8 +1102,6 @@ static int TextLayer_TextDeleteEx(LCUI_TextLayer layer, int char_y, int char_x,
 	if (end_x == char_x && end_y == char_y) {
 		return 0;
 	}
-	/* 获取上一行文本 */
-	prev_txtrow = layer->text_rows.rows[char_y - 1];
 	// 计算起始行与结束行拼接后的长度
 	// 起始行：0 1 2 3 4 5，起点位置：2
 	// 结束行：0 1 2 3 4 5，终点位置：4
@@ -1037,29 +1117,17 @@ static int TextLayer_TextDeleteEx(LCUI_TextLayer layer, int char_y, int char_x,
 		}
 		TextLayer_InvalidateRowRect(layer, char_y, char_x, -1);
 		TextLayer_AddUpdateTypeset(layer, char_y);
-		for (i = char_x, j = end_x; j < txtrow->length; ++i, ++j) {
-			txtrow->string[i] = txtrow->string[j];
-		}
-		/* 如果当前行为空，也不是第一行，并且上一行没有结束符 */
-		if (len <= 0 && end_y > 0 &&
-		    prev_txtrow->eol != LCUI_EOL_NONE) {
-			TextRowList_RemoveRow(&layer->text_rows, end_y);
-		}
+		TextRow_MoveChars(txtrow, char_x, txtrow, end_x,
+				  txtrow->length - end_x);
 		/* 调整起始行的容量 */
 		TextRow_SetLength(txtrow, len);
 		/* 更新文本行的尺寸 */
 		TextLayer_UpdateRowSize(layer, txtrow);
 		return 0;
 	}
-	/* 如果结束点在行尾，并且该行不是最后一行 */
-	if (end_x == end_txtrow->length &&
-	    end_y < layer->text_rows.length - 1) {
-		++end_y;
-		end_txtrow = TextLayer_GetRow(layer, end_y);
-		end_x = -1;
-		len = char_x + end_txtrow->length;
+	if (TextRow_SetLength(txtrow, len) != 0) {
+		return -ENOMEM;
 	}
-	TextRow_SetLength(txtrow, len);
 	/* 标记当前行后面的所有行的矩形需区域需要刷新 */
 	TextLayer_InvalidateRowsRect(layer, char_y + 1, -1);
 	/* 移除起始行与结束行之间的文本行 */
@@ -1067,23 +1135,14 @@ static int TextLayer_TextDeleteEx(LCUI_TextLayer layer, int char_y, int char_x,
 		TextLayer_InvalidateRowRect(layer, i, 0, -1);
 		TextRowList_RemoveRow(&layer->text_rows, i);
 	}
-	i = char_x;
-	j = end_x + 1;
 	end_y = char_y + 1;
-	/* 将结束行的内容拼接至起始行 */
-	for (; i < len && j < end_txtrow->length; ++i, ++j) {
-		txtrow->string[i] = end_txtrow->string[j];
-	}
+	/* 将结束行的内容拼接至起始行，起始行的行尾符也由结束行的替代 */
+	TextRow_MoveChars(txtrow, char_x, end_txtrow, end_x, len - char_x);
+	txtrow->eol = end_txtrow->eol;
 	TextLayer_UpdateRowSize(layer, txtrow);
 	TextLayer_InvalidateRowRect(layer, end_y, 0, -1);
 	/* 移除结束行 */
 	TextRowList_RemoveRow(&layer->text_rows, end_y);
-	/* 如果起始行无内容，并且上一行没有结束符（换行符），则
-	 * 说明需要删除起始行 */
-	if (len <= 0 && char_y > 0 && prev_txtrow->eol != LCUI_EOL_NONE) {
-		TextLayer_InvalidateRowRect(layer, char_y, 0, -1);
-		TextRowList_RemoveRow(&layer->text_rows, char_y);
-	}
 	TextLayer_AddUpdateTypeset(layer, char_y);
 	return 0;
 }
@@ -1166,13 +1225,15 @@ void TextLayer_EnableStyleTag(LCUI_TextLayer layer, LCUI_BOOL enable)
 
 static void TextLayer_UpdateTextStyleCache(LCUI_TextLayer layer)
 {
-	LinkedListNode *node;
+	unsigned i;
+
 	if (!layer->text_default_style.has_family) {
 		TextStyle_SetDefaultFont(&layer->text_default_style);
 	}
 	/* 替换缺省字体，确保能够正确应用字体设置 */
-	for (LinkedList_Each(node, &layer->text_styles)) {
-		TextStyle_Merge(node->data, &layer->text_default_style);
+	for (i = 0; i < layer->text_styles.length; ++i) {
+		TextStyle_Merge(layer->text_styles.items[i],
+				&layer->text_default_style);
 	}
 }
 
@@ -1181,17 +1242,35 @@ void TextLayer_ReloadCharBitmap(LCUI_TextLayer layer)
 {
 	int row, col;
 	TextLayer_UpdateTextStyleCache(layer);
+	layer->has_placeholder = FALSE;
 	for (row = 0; row < layer->text_rows.length; ++row) {
 		LCUI_TextRow txtrow = layer->text_rows.rows[row];
 		for (col = 0; col < txtrow->length; ++col) {
-			LCUI_TextChar txtchar = txtrow->string[col];
-			TextChar_UpdateBitmap(txtchar,
-					      &layer->text_default_style);
+			TextRow_SetBitmap(txtrow, col,
+					  TextLayer_GetCharBitmap(
+					      layer, txtrow->codes[col],
+					      txtrow->styles[col]));
 		}
 		TextLayer_UpdateRowSize(layer, txtrow);
 	}
 }
 
+int TextLayer_PrepareBitmaps(LCUI_TextLayer layer, const wchar_t *wstr)
+{
+	return LCUIFont_PrepareBitmaps(wstr, layer->text_default_style.font_ids,
+				       layer->text_default_style.pixel_size);
+}
+
+LCUI_BOOL TextLayer_UpdatePlaceholders(LCUI_TextLayer layer)
+{
+	if (!layer->has_placeholder) {
+		return FALSE;
+	}
+	layer->task.update_bitmap = TRUE;
+	TextLayer_AddUpdateTypeset(layer, 0);
+	return TRUE;
+}
+
 void TextLayer_Update(LCUI_TextLayer layer, LinkedList *rects)
 {
 	if (layer->task.update_bitmap) {
@@ -1204,7 +1283,8 @@ void TextLayer_Update(LCUI_TextLayer layer, LinkedList *rects)
 	if (layer->task.update_typeset) {
 		TextLayer_TextTypeset(layer, layer->task.typeset_start_row);
 		layer->task.update_typeset = FALSE;
-		layer->task.typeset_start_row = 0;
+		/* 之后的改动会把起始行调小，不需要排版它前面的行 */
+		layer->task.typeset_start_row = layer->text_rows.length;
 	}
 	layer->width = TextLayer_GetWidth(layer);
 	/* 如果坐标偏移量有变化，记录各个文本行区域 */
@@ -1239,38 +1319,24 @@ static void TextLayer_ValidateArea(LCUI_TextLayer layer, LCUI_Rect *area)
 	LCUIRect_ValidateArea(area, width, height);
 }
 
-static void TextLayer_DrawChar(LCUI_TextLayer layer, LCUI_TextChar ch,
-			       LCUI_Graph *graph, LCUI_Pos ch_pos)
-{
-	/* 判断文字使用的前景颜色，再进行绘制 */
-	if (ch->style && ch->style->has_fore_color) {
-		FontBitmap_Mix(graph, ch_pos, ch->bitmap,
-			       ch->style->fore_color);
-	} else {
-		FontBitmap_Mix(graph, ch_pos, ch->bitmap,
-			       layer->text_default_style.fore_color);
-	}
-}
-
 static void TextLayer_DrawTextRow(LCUI_TextLayer layer, LCUI_Rect *area,
 				  LCUI_Graph *graph, LCUI_Pos layer_pos,
 				  LCUI_TextRow txtrow, int y)
 {
-	LCUI_TextChar txtchar;
 	LCUI_Pos ch_pos;
+	LCUI_TextStyle style;
+	LCUI_Color color, run_color;
+	const LCUI_FontBitmap *bitmap;
+	LCUI_GlyphRec glyphs[TEXT_GLYPH_RUN_SIZE];
+	size_t n_glyphs = 0;
 	int baseline, col, x;
 	baseline = txtrow->text_height * 4 / 5;
 	x = TextLayer_GetRowStartX(layer, txtrow) + layer->offset_x;
-	/* 确定从哪个文字开始绘制 */
+	/* 确定从哪个文字开始绘制，无字体位图的文字的宽度为 0 */
 	for (col = 0; col < txtrow->length; ++col) {
-		txtchar = txtrow->string[col];
-		/* 忽略无字体位图的文字 */
-		if (!txtchar->bitmap) {
-			continue;
-		}
-		x += txtchar->bitmap->advance.x;
+		x += txtrow->advances[col];
 		if (x > area->x) {
-			x -= txtchar->bitmap->advance.x;
+			x -= txtrow->advances[col];
 			break;
 		}
 	}
@@ -1281,33 +1347,56 @@ static void TextLayer_DrawTextRow(LCUI_TextLayer layer, LCUI_Rect *area,
 	}
 	/* 遍历该行的文字 */
 	for (; col < txtrow->length; ++col) {
-		txtchar = txtrow->string[col];
-		if (!txtchar->bitmap) {
+		bitmap = txtrow->bitmaps[col];
+		if (!bitmap) {
 			continue;
 		}
+		style = TextLayer_GetStyle(layer, txtrow->styles[col]);
+		if (style && style->has_fore_color) {
+			color = style->fore_color;
+		} else {
+			color = layer->text_default_style.fore_color;
+		}
+		/*
+		 * 相邻的同色文字会攒成一串再一起绘制，颜色变化或需要先绘制背景
+		 * 色时，先把已攒下的文字绘制出来，以保持原有的绘制顺序
+		 */
+		if (n_glyphs > 0 &&
+		    (n_glyphs >= TEXT_GLYPH_RUN_SIZE ||
+		     color.value != run_color.value ||
+		     (style && style->has_back_color))) {
+			FontBitmap_MixGlyphs(graph, NULL, glyphs, n_glyphs,
+					     run_color);
+			n_glyphs = 0;
+		}
 		/* 计算字体位图的绘制坐标 */
 		ch_pos.x = layer_pos.x + x;
 		ch_pos.y = layer_pos.y + y;
-		if (txtchar->style && txtchar->style->has_back_color) {
+		if (style && style->has_back_color) {
 			LCUI_Rect rect;
 			rect.x = ch_pos.x;
 			rect.y = ch_pos.y;
 			rect.height = txtrow->height;
-			rect.width = txtchar->bitmap->advance.x;
-			Graph_FillRect(graph, txtchar->style->back_color, &rect,
-				       TRUE);
+			rect.width = txtrow->advances[col];
+			Graph_FillRect(graph, style->back_color, &rect, TRUE);
 		}
-		ch_pos.x += txtchar->bitmap->left;
+		ch_pos.x += bitmap->left;
 		ch_pos.y += baseline;
 		ch_pos.y += (txtrow->height - baseline) / 2;
-		ch_pos.y -= txtchar->bitmap->top;
-		TextLayer_DrawChar(layer, txtchar, graph, ch_pos);
-		x += txtchar->bitmap->advance.x;
+		ch_pos.y -= bitmap->top;
+		glyphs[n_glyphs].bitmap = bitmap;
+		glyphs[n_glyphs].pos = ch_pos;
+		run_color = color;
+		++n_glyphs;
+		x += txtrow->advances[col];
 		/* 如果超过绘制区域则不继续绘制该行文本 */
 		if (x > area->x + area->width) {
 			break;
 		}
 	}
+	if (n_glyphs > 0) {
+		FontBitmap_MixGlyphs(graph, NULL, glyphs, n_glyphs, run_color);
+	}
 }
 
 int TextLayer_RenderTo(LCUI_TextLayer layer, LCUI_Rect area, LCUI_Pos layer_pos,
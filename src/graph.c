@@ -36,6 +36,7 @@
 #include <LCUI/types.h>
 #include <LCUI/util.h>
 #include <LCUI/graph.h>
+#include <LCUI/pixelformat.h>
 
 void Graph_PrintInfo(LCUI_Graph *graph)
 {
@@ -114,63 +115,37 @@ static unsigned get_pixel_size(int color_type)
 
 /*----------------------------------- RGB ----------------------------------*/
 
-static void PixelsFormatRGB(const uchar_t *in_pixels, uchar_t *out_pixels,
-			    size_t pixel_count)
-{
-	const LCUI_ARGB8888 *p_px, *p_end_px;
-	LCUI_ARGB8888 *p_out_px;
-	uchar_t *p_out_byte;
-
-	p_out_byte = out_pixels;
-	p_out_px = (LCUI_ARGB8888 *)out_pixels;
-	p_px = (const LCUI_ARGB8888 *)in_pixels;
-	/* 遍历到倒数第二个像素为止 */
-	p_end_px = p_px + pixel_count - 1;
-	for (; p_px < p_end_px; ++p_px) {
-		*p_out_px = *p_px;
-		/* 将后3字节的数据当成4字节（LCUI_ARGB8888）的像素点访问 */
-		p_out_px = (LCUI_ARGB8888 *)(((uchar_t *)p_out_px) + 3);
-	}
-	/* 最后一个像素，以逐个字节的形式写数据 */
-	p_out_byte = (uchar_t *)(p_out_px + 1);
-	*p_out_byte++ = p_px->blue;
-	*p_out_byte++ = p_px->green;
-	*p_out_byte++ = p_px->red;
-}
-
-static void PixelsFormatARGB(const uchar_t *in_pixels, uchar_t *out_pixels,
-			     size_t pixel_count)
-{
-	LCUI_ARGB8888 *p_px, *p_end_px;
-	const uchar_t *p_in_byte;
-
-	p_in_byte = in_pixels;
-	p_px = (LCUI_ARGB8888 *)out_pixels;
-	p_end_px = p_px + pixel_count;
-	while (p_px < p_end_px) {
-		p_px->blue = *p_in_byte++;
-		p_px->green = *p_in_byte++;
-		p_px->red = *p_in_byte++;
-		p_px->alpha = 255;
-		++p_px;
-	}
-}
-
 void PixelsFormat(const uchar_t *in_pixels, int in_color_type,
 		  uchar_t *out_pixels, int out_color_type, size_t pixel_count)
 {
 	switch (in_color_type) {
 	case LCUI_COLOR_TYPE_ARGB8888:
-		if (out_color_type == LCUI_COLOR_TYPE_ARGB8888) {
-			return;
+		switch (out_color_type) {
+		case LCUI_COLOR_TYPE_RGB888:
+			PixelFormat_ARGBToRGB888(out_pixels,
+						 (const LCUI_ARGB *)in_pixels,
+						 pixel_count);
+			break;
+		case LCUI_COLOR_TYPE_RGB565:
+			PixelFormat_ARGBToRGB565(out_pixels,
+						 (const LCUI_ARGB *)in_pixels,
+						 pixel_count, 0, 0, FALSE);
+			break;
+		case LCUI_COLOR_TYPE_INDEX8:
+			PixelFormat_ARGBToIndex8(out_pixels,
+						 (const LCUI_ARGB *)in_pixels,
+						 pixel_count, 0, 0, FALSE);
+			break;
+		default:
+			break;
 		}
-		PixelsFormatRGB(in_pixels, out_pixels, pixel_count);
 		break;
 	case LCUI_COLOR_TYPE_RGB888:
 		if (out_color_type == LCUI_COLOR_TYPE_RGB888) {
 			return;
 		}
-		PixelsFormatARGB(in_pixels, out_pixels, pixel_count);
+		PixelFormat_RGB888ToARGB((LCUI_ARGB *)out_pixels, in_pixels,
+					 pixel_count);
 		break;
 	default:
 		break;
@@ -179,9 +154,9 @@ void PixelsFormat(const uchar_t *in_pixels, int in_color_type,
 
 static int Graph_RGBToARGB(LCUI_Graph *graph)
 {
-	size_t x, y;
-	LCUI_ARGB *px_des, *px_row_des, *buffer;
-	uchar_t *byte_row_src, *byte_src;
+	size_t y;
+	LCUI_ARGB *px_row_des, *buffer;
+	uchar_t *byte_row_src;
 
 	graph->mem_size = sizeof(LCUI_ARGB) * graph->width * graph->height;
 	buffer = malloc(graph->mem_size);
@@ -191,21 +166,16 @@ static int Graph_RGBToARGB(LCUI_Graph *graph)
 	px_row_des = buffer;
 	byte_row_src = graph->bytes;
 	for (y = 0; y < graph->height; ++y) {
-		px_des = px_row_des;
-		byte_src = byte_row_src;
-		for (x = 0; x < graph->width; ++x) {
-			px_des->b = *byte_src++;
-			px_des->g = *byte_src++;
-			px_des->r = *byte_src++;
-			px_des->a = 255;
-			++px_des;
-		}
+		PixelFormat_RGB888ToARGB(px_row_des, byte_row_src,
+					 graph->width);
 		byte_row_src += graph->bytes_per_row;
 		px_row_des += graph->width;
 	}
 	free(graph->argb);
 	graph->argb = buffer;
 	graph->color_type = LCUI_COLOR_TYPE_ARGB8888;
+	graph->bytes_per_pixel = 4;
+	graph->bytes_per_row = graph->width * 4;
 	return 0;
 }
 
@@ -362,9 +332,9 @@ static int Graph_FillRectRGB(LCUI_Graph *graph, LCUI_Color color,
 
 static int Graph_ARGBToRGB(LCUI_Graph *graph)
 {
-	size_t x, y;
-	LCUI_ARGB *px_src, *px_row_src;
-	uchar_t *buffer, *byte_row_des, *byte_des;
+	size_t y;
+	LCUI_ARGB *px_row_src;
+	uchar_t *buffer, *byte_row_des;
 
 	graph->mem_size = sizeof(uchar_t) * graph->width * graph->height * 3;
 	buffer = malloc(graph->mem_size);
@@ -374,22 +344,16 @@ static int Graph_ARGBToRGB(LCUI_Graph *graph)
 	byte_row_des = buffer;
 	px_row_src = graph->argb;
 	for (y = 0; y < graph->height; ++y) {
-		px_src = px_row_src;
-		byte_des = byte_row_des;
-		for (x = 0; x < graph->width; ++x) {
-			px_src->b = *byte_des++;
-			px_src->g = *byte_des++;
-			px_src->r = *byte_des++;
-			px_src->a = 255;
-			++px_src;
-		}
-		byte_row_des += graph->bytes_per_row;
+		PixelFormat_ARGBToRGB888(byte_row_des, px_row_src,
+					 graph->width);
+		byte_row_des += graph->width * 3;
 		px_row_src += graph->width;
 	}
 	free(graph->argb);
 	graph->bytes = buffer;
 	graph->color_type = LCUI_COLOR_TYPE_RGB888;
 	graph->bytes_per_pixel = 3;
+	graph->bytes_per_row = graph->width * 3;
 	return 0;
 }
 
@@ -28,7 +28,9 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <LCUI_Build.h>
 #include "config.h"
@@ -56,6 +58,47 @@ enum ParserBehavior {
 	PB_ENTER    /**< 进入子元素列表 */
 };
 
+/** 模板指令类型 */
+enum UITemplateOpType {
+	OP_WIDGET,  /**< 创建部件，并作为当前部件的子部件 */
+	OP_ID,      /**< 设置部件的 id */
+	OP_CLASS,   /**< 添加部件的类，多个类名以空格分隔 */
+	OP_ATTR,    /**< 设置部件的属性 */
+	OP_TEXT,    /**< 设置部件的文本 */
+	OP_INCLUDE, /**< 实例化另一个模板，并将其内容插入当前部件 */
+	OP_END      /**< 结束当前部件 */
+};
+
+/** 模板指令 */
+typedef struct UITemplateOpRec_ {
+	int type;
+	char *name;
+	char *value;
+
+	/** 对应的 OP_END 指令的位置，在部件创建失败时用于跳过它的子部件 */
+	size_t end;
+	LCUI_UITemplate include;
+} UITemplateOpRec, *UITemplateOp;
+
+/**
+ * 界面模板
+ * 界面配置代码只在编译时解析一次，生成一组指令，之后每次实例化时只需按顺序
+ * 执行这些指令。
+ */
+struct LCUI_UITemplateRec_ {
+	size_t length;
+	size_t max_length;
+	UITemplateOp ops;
+
+	/** 当前未结束的部件指令的位置，仅在编译时使用 */
+	size_t *stack;
+	size_t depth;
+	size_t max_depth;
+
+	/** 字符串池，指令中的字符串都存放在这里 */
+	strpool_t *strings;
+};
+
 typedef struct XMLParserContextRec_ XMLParserContextRec, *XMLParserContext;
 typedef int (*ParserFuncPtr)(XMLParserContext, xmlNodePtr);
 
@@ -67,11 +110,12 @@ typedef struct Parser {
 
 struct XMLParserContextRec_ {
 	int id;
-	LCUI_Widget root;
-	LCUI_Widget widget;
-	LCUI_Widget parent_widget;
+	LCUI_BOOL has_root;
+	LCUI_BOOL has_widget;
+	LCUI_BOOL is_widget_begun;
 	LCUI_WidgetPrototypeC widget_proto;
 	ParserPtr parent_parser;
+	LCUI_UITemplate tpl;
 	const char *space;
 };
 
@@ -91,10 +135,80 @@ static void xmlPrintErrorMessage(xmlErrorPtr err)
 		     err->message);
 }
 
+static LCUI_UITemplate UITemplate_Create(void)
+{
+	LCUI_UITemplate tpl;
+
+	tpl = NEW(LCUI_UITemplateRec, 1);
+	if (!tpl) {
+		return NULL;
+	}
+	tpl->strings = strpool_create();
+	if (!tpl->strings) {
+		free(tpl);
+		return NULL;
+	}
+	return tpl;
+}
+
+static UITemplateOp UITemplate_AddOp(LCUI_UITemplate tpl, int type,
+				     const char *name, const char *value)
+{
+	size_t len;
+	UITemplateOp op, ops;
+
+	if (tpl->length >= tpl->max_length) {
+		len = tpl->max_length > 0 ? tpl->max_length * 2 : 32;
+		ops = realloc(tpl->ops, sizeof(UITemplateOpRec) * len);
+		if (!ops) {
+			return NULL;
+		}
+		tpl->ops = ops;
+		tpl->max_length = len;
+	}
+	op = &tpl->ops[tpl->length++];
+	op->type = type;
+	op->name = name ? strpool_alloc_str(tpl->strings, name) : NULL;
+	op->value = value ? strpool_alloc_str(tpl->strings, value) : NULL;
+	op->end = 0;
+	op->include = NULL;
+	return op;
+}
+
+static int UITemplate_BeginWidget(LCUI_UITemplate tpl, const char *type)
+{
+	size_t len, *stack;
+
+	if (tpl->depth >= tpl->max_depth) {
+		len = tpl->max_depth > 0 ? tpl->max_depth * 2 : 16;
+		stack = realloc(tpl->stack, sizeof(size_t) * len);
+		if (!stack) {
+			return -ENOMEM;
+		}
+		tpl->stack = stack;
+		tpl->max_depth = len;
+	}
+	if (!UITemplate_AddOp(tpl, OP_WIDGET, type, NULL)) {
+		return -ENOMEM;
+	}
+	tpl->stack[tpl->depth++] = tpl->length - 1;
+	return 0;
+}
+
+static void UITemplate_EndWidget(LCUI_UITemplate tpl)
+{
+	if (tpl->depth < 1 || !UITemplate_AddOp(tpl, OP_END, NULL, NULL)) {
+		return;
+	}
+	tpl->depth -= 1;
+	tpl->ops[tpl->stack[tpl->depth]].end = tpl->length - 1;
+}
+
 /** 解析 <resource> 元素，根据相关参数载入资源 */
 static int ParseResource(XMLParserContext ctx, xmlNodePtr node)
 {
 	xmlAttrPtr prop;
+	UITemplateOp op;
 
 	int code = PB_NEXT;
 	char *prop_val, *type = NULL, *src = NULL;
@@ -134,23 +248,20 @@ static int ParseResource(XMLParserContext ctx, xmlNodePtr node)
 			LCUI_LoadCSSString((char *)node->content, ctx->space);
 		}
 	} else if (strcmp(type, "text/xml") == 0) {
-		LCUI_Widget pack;
-		if (!src) {
+		LCUI_UITemplate pack;
+		if (!src || (!ctx->has_widget && !ctx->has_root)) {
 			EXIT(PB_WARNING);
 		}
-		pack = LCUIBuilder_LoadFile(src);
+		pack = LCUIBuilder_CompileFile(src);
 		if (!pack) {
 			EXIT(PB_WARNING);
 		}
-		if (ctx->parent_widget) {
-			Widget_Append(ctx->parent_widget, pack);
-		} else if (ctx->root) {
-			Widget_Append(ctx->root, pack);
-		} else {
-			Widget_Destroy(pack);
-			EXIT(PB_WARNING);
+		op = UITemplate_AddOp(ctx->tpl, OP_INCLUDE, NULL, NULL);
+		if (!op) {
+			LCUIBuilder_FreeTemplate(pack);
+			EXIT(PB_ERROR);
 		}
-		Widget_Unwrap(pack);
+		op->include = pack;
 	}
 exit:
 	if (src) {
@@ -171,8 +282,12 @@ static int ParseUI(XMLParserContext ctx, xmlNodePtr node)
 	if (ctx->parent_parser && ctx->parent_parser->id != ID_ROOT) {
 		return PB_ERROR;
 	}
-	ctx->widget = LCUIWidget_New(NULL);
-	ctx->root = ctx->widget;
+	if (ctx->has_root || UITemplate_BeginWidget(ctx->tpl, NULL) != 0) {
+		return PB_ERROR;
+	}
+	ctx->has_root = TRUE;
+	ctx->has_widget = TRUE;
+	ctx->is_widget_begun = TRUE;
 	return PB_ENTER;
 }
 
@@ -181,7 +296,8 @@ static int ParseWidget(XMLParserContext ctx, xmlNodePtr node)
 {
 	xmlAttrPtr prop;
 	char *prop_val = NULL, *prop_name, *type = NULL;
-	LCUI_Widget w = NULL, parent = ctx->widget;
+	char **classes = NULL;
+	int i, ret;
 
 	if (ctx->parent_parser && ctx->parent_parser->id != ID_UI &&
 	    ctx->parent_parser->id != ID_WIDGET) {
@@ -191,15 +307,18 @@ static int ParseWidget(XMLParserContext ctx, xmlNodePtr node)
 	case XML_ELEMENT_NODE:
 		break;
 	case XML_TEXT_NODE:
-		Widget_SetText(parent, (char *)node->content);
-		DEBUG_MSG("widget: %s, set text: %s\n", parent->type,
-			  (char *)node->content);
+		UITemplate_AddOp(ctx->tpl, OP_TEXT, NULL,
+				 (char *)node->content);
+		DEBUG_MSG("set text: %s\n", (char *)node->content);
 		return PB_NEXT;
 	default:
 		return PB_ERROR;
 	}
+	if (!ctx->has_widget) {
+		return PB_ERROR;
+	}
 	if (ctx->widget_proto) {
-		w = LCUIWidget_NewWithPrototype(ctx->widget_proto);
+		ret = UITemplate_BeginWidget(ctx->tpl, (char *)node->name);
 	} else {
 		for (prop = node->properties; prop; prop = prop->next) {
 			prop_val = (char *)xmlGetProp(node, prop->name);
@@ -211,35 +330,57 @@ static int ParseWidget(XMLParserContext ctx, xmlNodePtr node)
 				xmlFree(prop_val);
 			}
 		}
-		w = LCUIWidget_New(type);
+		ret = UITemplate_BeginWidget(ctx->tpl, type);
 		if (type) {
 			xmlFree(type);
 		}
 	}
-	if (!w) {
+	if (ret != 0) {
 		return PB_ERROR;
 	}
-	DEBUG_MSG("create widget: %s\n", w->type);
-	Widget_Append(parent, w);
-	ctx->widget = w;
+	ctx->is_widget_begun = TRUE;
 	for (prop = node->properties; prop; prop = prop->next) {
 		prop_val = (char *)xmlGetProp(node, prop->name);
 		if (PropNameIs(prop, "id")) {
-			DEBUG_MSG("widget: %p, set id: %s\n", w, prop_val);
-			Widget_SetId(w, prop_val);
+			UITemplate_AddOp(ctx->tpl, OP_ID, NULL, prop_val);
 		} else if (PropNameIs(prop, "class")) {
-			DEBUG_MSG("widget: %p, add class: %s\n", w, prop_val);
-			Widget_AddClass(w, prop_val);
+			if (prop_val) {
+				strlist_add(&classes, prop_val);
+			}
 		} else {
 			prop_name = malloc(strsize((const char *)prop->name));
 			strtolower(prop_name, (const char *)prop->name);
-			Widget_SetAttribute(w, prop_name, prop_val);
+			UITemplate_AddOp(ctx->tpl, OP_ATTR, prop_name,
+					 prop_val);
 			free(prop_name);
 		}
 		if (prop_val) {
 			xmlFree(prop_val);
 		}
 	}
+	/* Join the class names into one operation, so that the classes of
+	 * the widget are changed only once */
+	if (classes) {
+		char *names;
+		size_t len = 0;
+
+		for (i = 0; classes[i]; ++i) {
+			len += strlen(classes[i]) + 1;
+		}
+		names = malloc(len);
+		if (names) {
+			names[0] = 0;
+			for (i = 0; classes[i]; ++i) {
+				if (i > 0) {
+					strcat(names, " ");
+				}
+				strcat(names, classes[i]);
+			}
+			UITemplate_AddOp(ctx->tpl, OP_CLASS, NULL, names);
+			free(names);
+		}
+		strlist_free(classes);
+	}
 	return PB_ENTER;
 }
 
@@ -302,8 +443,8 @@ static void ParseNode(XMLParserContext ctx, xmlNodePtr node)
 			}
 		}
 		cur_ctx = *ctx;
-		cur_ctx.parent_widget = ctx->widget;
 		cur_ctx.widget_proto = proto;
+		cur_ctx.is_widget_begun = FALSE;
 		switch (p->parse(&cur_ctx, node)) {
 		case PB_ENTER:
 			cur_ctx.parent_parser = p;
@@ -321,78 +462,210 @@ static void ParseNode(XMLParserContext ctx, xmlNodePtr node)
 				     node->doc->name, node->line, node->name);
 			break;
 		}
-		if (!ctx->root && cur_ctx.root) {
-			ctx->root = cur_ctx.root;
+		if (cur_ctx.is_widget_begun) {
+			UITemplate_EndWidget(ctx->tpl);
+		}
+		if (!ctx->has_root && cur_ctx.has_root) {
+			ctx->has_root = TRUE;
 		}
 	}
 }
-#endif
 
-LCUI_Widget LCUIBuilder_LoadString(const char *str, int size)
+static LCUI_UITemplate LCUIBuilder_CompileDoc(xmlDocPtr doc,
+					      const char *space)
 {
-#ifndef USE_LCUI_BUILDER
-	Logger_Warning(WARN_TXT);
-#else
-	xmlDocPtr doc;
 	xmlNodePtr cur;
 	XMLParserContextRec ctx;
 
 	memset(&ctx, 0, sizeof(ctx));
-	doc = xmlParseMemory(str, size);
-	if (!doc) {
-		xmlPrintErrorMessage(xmlGetLastError());
-		Logger_Error("[builder] failed to parse xml form memory\n");
-		goto FAILED;
-	}
 	cur = xmlDocGetRootElement(doc);
+	if (!cur) {
+		Logger_Error("[builder] empty document\n");
+		return NULL;
+	}
 	if (xmlStrcasecmp(cur->name, BAD_CAST "lcui-app")) {
 		Logger_Error("[builder] error root node name: %s\n", cur->name);
-		goto FAILED;
+		return NULL;
 	}
 	if (!self.active) {
 		LCUIBuilder_Init();
 	}
+	ctx.space = space;
+	ctx.tpl = UITemplate_Create();
+	if (!ctx.tpl) {
+		return NULL;
+	}
 	ParseNode(&ctx, cur->children);
-FAILED:
-	if (doc) {
-		xmlFreeDoc(doc);
+	free(ctx.tpl->stack);
+	ctx.tpl->stack = NULL;
+	ctx.tpl->depth = 0;
+	return ctx.tpl;
+}
+
+static void UITemplate_Include(LCUI_UITemplate tpl, LCUI_Widget parent)
+{
+	LCUI_Widget pack;
+
+	pack = LCUIBuilder_Instantiate(tpl);
+	if (!pack) {
+		return;
 	}
-	return ctx.root;
+	if (!parent) {
+		Widget_Destroy(pack);
+		return;
+	}
+	Widget_Append(parent, pack);
+	Widget_Unwrap(pack);
+}
+#endif
+
+LCUI_UITemplate LCUIBuilder_CompileString(const char *str, int size)
+{
+#ifndef USE_LCUI_BUILDER
+	Logger_Warning(WARN_TXT);
+#else
+	xmlDocPtr doc;
+	LCUI_UITemplate tpl;
+
+	doc = xmlParseMemory(str, size);
+	if (!doc) {
+		xmlPrintErrorMessage(xmlGetLastError());
+		Logger_Error("[builder] failed to parse xml form memory\n");
+		return NULL;
+	}
+	tpl = LCUIBuilder_CompileDoc(doc, NULL);
+	xmlFreeDoc(doc);
+	return tpl;
 #endif
 	return NULL;
 }
 
-LCUI_Widget LCUIBuilder_LoadFile(const char *filepath)
+LCUI_UITemplate LCUIBuilder_CompileFile(const char *filepath)
 {
 #ifndef USE_LCUI_BUILDER
 	Logger_Warning(WARN_TXT);
 #else
 	xmlDocPtr doc;
-	xmlNodePtr cur;
-	XMLParserContextRec ctx;
+	LCUI_UITemplate tpl;
 
-	memset(&ctx, 0, sizeof(ctx));
-	ctx.space = filepath;
 	doc = xmlParseFile(filepath);
 	if (!doc) {
 		xmlPrintErrorMessage(xmlGetLastError());
 		Logger_Error("[builder] failed to parse xml form file\n");
-		goto FAILED;
+		return NULL;
 	}
-	cur = xmlDocGetRootElement(doc);
-	if (xmlStrcasecmp(cur->name, BAD_CAST "lcui-app")) {
-		Logger_Error("[builder] error root node name: %s\n", cur->name);
-		goto FAILED;
+	tpl = LCUIBuilder_CompileDoc(doc, filepath);
+	xmlFreeDoc(doc);
+	return tpl;
+#endif
+	return NULL;
+}
+
+LCUI_Widget LCUIBuilder_Instantiate(LCUI_UITemplate tpl)
+{
+#ifdef USE_LCUI_BUILDER
+	size_t i, depth = 0;
+	UITemplateOp op;
+	LCUI_Widget w, root = NULL, *stack;
+
+	stack = malloc(sizeof(LCUI_Widget) * (tpl->max_depth + 1));
+	if (!stack) {
+		return NULL;
 	}
-	if (!self.active) {
-		LCUIBuilder_Init();
+	for (i = 0; i < tpl->length; ++i) {
+		op = &tpl->ops[i];
+		w = depth > 0 ? stack[depth - 1] : NULL;
+		switch (op->type) {
+		case OP_WIDGET:
+			if (depth > tpl->max_depth || (!w && root)) {
+				i = op->end;
+				break;
+			}
+			w = LCUIWidget_New(op->name);
+			if (!w) {
+				i = op->end;
+				break;
+			}
+			if (depth > 0) {
+				Widget_Append(stack[depth - 1], w);
+			} else {
+				root = w;
+			}
+			stack[depth++] = w;
+			break;
+		case OP_END:
+			depth -= 1;
+			break;
+		case OP_ID:
+			Widget_SetId(w, op->value);
+			break;
+		case OP_CLASS:
+			Widget_AddClass(w, op->value);
+			break;
+		case OP_ATTR:
+			Widget_SetAttribute(w, op->name, op->value);
+			break;
+		case OP_TEXT:
+			Widget_SetText(w, op->value);
+			break;
+		case OP_INCLUDE:
+			UITemplate_Include(op->include, w ? w : root);
+			break;
+		default:
+			break;
+		}
 	}
-	ParseNode(&ctx, cur->children);
-FAILED:
-	if (doc) {
-		xmlFreeDoc(doc);
+	free(stack);
+	return root;
+#else
+	return NULL;
+#endif
+}
+
+void LCUIBuilder_FreeTemplate(LCUI_UITemplate tpl)
+{
+#ifdef USE_LCUI_BUILDER
+	size_t i;
+
+	if (!tpl) {
+		return;
 	}
-	return ctx.root;
+	for (i = 0; i < tpl->length; ++i) {
+		if (tpl->ops[i].include) {
+			LCUIBuilder_FreeTemplate(tpl->ops[i].include);
+		}
+	}
+	strpool_destroy(tpl->strings);
+	free(tpl->stack);
+	free(tpl->ops);
+	free(tpl);
 #endif
-	return NULL;
+}
+
+LCUI_Widget LCUIBuilder_LoadString(const char *str, int size)
+{
+	LCUI_Widget root;
+	LCUI_UITemplate tpl;
+
+	tpl = LCUIBuilder_CompileString(str, size);
+	if (!tpl) {
+		return NULL;
+	}
+	root = LCUIBuilder_Instantiate(tpl);
+	LCUIBuilder_FreeTemplate(tpl);
+	return root;
+}
+
+LCUI_Widget LCUIBuilder_LoadFile(const char *filepath)
+{
+	LCUI_Widget root;
+	LCUI_UITemplate tpl;
+
+	tpl = LCUIBuilder_CompileFile(filepath);
+	if (!tpl) {
+		return NULL;
+	}
+	root = LCUIBuilder_Instantiate(tpl);
+	LCUIBuilder_FreeTemplate(tpl);
+	return root;
 }
@@ -0,0 +1,669 @@
+/*
+ * css_binary.c -- Compiled stylesheet writer and loader
+ *
+ * Copyright (c) 2020, Liu chao <lc-soft@live.cn> All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of LCUI nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <LCUI_Build.h>
+#include <LCUI/LCUI.h>
+#include <LCUI/util/mmap.h>
+#include <LCUI/gui/css_library.h>
+#include <LCUI/gui/css_binary.h>
+
+#define CSS_BINARY_MAGIC "LCUICSS"
+#define CSS_BINARY_VERSION 1
+#define CSS_BINARY_BYTE_ORDER 0x01020304
+#define CSS_NO_STRING 0xffffffff
+
+/**
+ * File layout:
+ * - header
+ * - rules, a list of 32-bit words:
+ *   rank, space, nodes_count, styles_count,
+ *   nodes: { id, type, classes_count, status_count, classes..., status... }
+ *   styles: { key name, type, value }
+ * - string table, null-terminated strings referenced by their offset
+ */
+typedef struct CSSBinaryHeaderRec_ {
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;
+	uint32_t rules_count;
+	uint32_t words_count;
+	uint32_t strings_size;
+	uint32_t reserved;
+} CSSBinaryHeaderRec, *CSSBinaryHeader;
+
+typedef struct CSSRuleRec_ {
+	char *selector;
+	const char *space;
+	int rank;
+	int batch_num;
+	LCUI_StyleList list;
+} CSSRuleRec, *CSSRule;
+
+typedef struct CSSRulesRec_ {
+	const char *space;
+	CSSRule rules;
+	size_t length;
+	size_t max_length;
+	int error;
+} CSSRulesRec, *CSSRules;
+
+typedef struct CSSWriterRec_ {
+	uint32_t *words;
+	size_t words_count;
+	size_t max_words;
+
+	char *strings;
+	size_t strings_size;
+	size_t max_strings_size;
+
+	/** offsets of the strings in the string table */
+	Dict *offsets;
+	DictType offsets_dict;
+	int error;
+} CSSWriterRec, *CSSWriter;
+
+typedef struct CSSReaderRec_ {
+	const unsigned char *words;
+	size_t words_count;
+	size_t pos;
+
+	const char *strings;
+	size_t strings_size;
+	int error;
+} CSSReaderRec, *CSSReader;
+
+typedef union CSSWordRec_ {
+	uint32_t word;
+	int32_t val_int;
+	float val_float;
+} CSSWordRec;
+
+static void OnCollectRule(LCUI_StyleRule rule, void *arg)
+{
+	CSSRule r;
+	CSSRules rules = arg;
+
+	if (rules->error) {
+		return;
+	}
+	if (rules->space &&
+	    (!rule->space || strcmp(rules->space, rule->space) != 0)) {
+		return;
+	}
+	if (rules->length >= rules->max_length) {
+		size_t len = rules->max_length > 0 ? rules->max_length * 2 : 64;
+
+		r = realloc(rules->rules, sizeof(CSSRuleRec) * len);
+		if (!r) {
+			rules->error = -ENOMEM;
+			return;
+		}
+		rules->rules = r;
+		rules->max_length = len;
+	}
+	r = &rules->rules[rules->length];
+	r->selector = strdup2(rule->selector);
+	if (!r->selector) {
+		rules->error = -ENOMEM;
+		return;
+	}
+	r->space = rule->space;
+	r->rank = rule->rank;
+	r->batch_num = rule->batch_num;
+	r->list = rule->list;
+	rules->length += 1;
+}
+
+static int CompareRules(const void *a, const void *b)
+{
+	const CSSRuleRec *r1 = a, *r2 = b;
+
+	if (r1->batch_num != r2->batch_num) {
+		return r1->batch_num < r2->batch_num ? -1 : 1;
+	}
+	return strcmp(r1->selector, r2->selector);
+}
+
+static void CSSWriter_Init(CSSWriter w)
+{
+	memset(w, 0, sizeof(CSSWriterRec));
+	Dict_InitStringCopyKeyType(&w->offsets_dict);
+	w->offsets = Dict_Create(&w->offsets_dict, NULL);
+}
+
+static void CSSWriter_Destroy(CSSWriter w)
+{
+	free(w->words);
+	free(w->strings);
+	Dict_Release(w->offsets);
+	w->words = NULL;
+	w->strings = NULL;
+	w->offsets = NULL;
+}
+
+static void CSSWriter_PutWord(CSSWriter w, uint32_t word)
+{
+	uint32_t *words;
+
+	if (w->error) {
+		return;
+	}
+	if (w->words_count >= w->max_words) {
+		size_t len = w->max_words > 0 ? w->max_words * 2 : 1024;
+
+		words = realloc(w->words, sizeof(uint32_t) * len);
+		if (!words) {
+			w->error = -ENOMEM;
+			return;
+		}
+		w->words = words;
+		w->max_words = len;
+	}
+	w->words[w->words_count++] = word;
+}
+
+/** Add the string into the string table and write its offset */
+static void CSSWriter_PutString(CSSWriter w, const char *str)
+{
+	char *strings;
+	size_t len, size;
+	uintptr_t offset;
+
+	if (!str) {
+		CSSWriter_PutWord(w, CSS_NO_STRING);
+		return;
+	}
+	/* The stored offsets are increased by 1 to be distinguished from NULL */
+	offset = (uintptr_t)Dict_FetchValue(w->offsets, str);
+	if (offset > 0) {
+		CSSWriter_PutWord(w, (uint32_t)(offset - 1));
+		return;
+	}
+	len = strlen(str) + 1;
+	size = w->max_strings_size > 0 ? w->max_strings_size : 4096;
+	while (w->strings_size + len > size) {
+		size *= 2;
+	}
+	if (size > w->max_strings_size) {
+		strings = realloc(w->strings, size);
+		if (!strings) {
+			w->error = -ENOMEM;
+			return;
+		}
+		w->strings = strings;
+		w->max_strings_size = size;
+	}
+	offset = w->strings_size;
+	memcpy(w->strings + offset, str, len);
+	w->strings_size += len;
+	Dict_Add(w->offsets, (void *)str, (void *)(offset + 1));
+	CSSWriter_PutWord(w, (uint32_t)offset);
+}
+
+static void CSSWriter_PutSelectorNode(CSSWriter w, LCUI_SelectorNode node)
+{
+	uint32_t i, n_classes = 0, n_status = 0;
+
+	if (node->classes) {
+		while (node->classes[n_classes]) {
+			++n_classes;
+		}
+	}
+	if (node->status) {
+		while (node->status[n_status]) {
+			++n_status;
+		}
+	}
+	CSSWriter_PutString(w, node->id);
+	CSSWriter_PutString(w, node->type);
+	CSSWriter_PutWord(w, n_classes);
+	CSSWriter_PutWord(w, n_status);
+	for (i = 0; i < n_classes; ++i) {
+		CSSWriter_PutString(w, node->classes[i]);
+	}
+	for (i = 0; i < n_status; ++i) {
+		CSSWriter_PutString(w, node->status[i]);
+	}
+}
+
+static LCUI_BOOL CSSWriter_PutStyle(CSSWriter w, int key, LCUI_Style s)
+{
+	size_t len;
+	char *str;
+	const char *name;
+	CSSWordRec value;
+
+	name = LCUI_GetStyleName(key);
+	if (!name || !s->is_valid) {
+		return FALSE;
+	}
+	value.word = 0;
+	switch (s->type) {
+	case LCUI_STYPE_IMAGE:
+		/* The image data can not be stored */
+		return FALSE;
+	case LCUI_STYPE_STYLE:
+		str = (char *)LCUI_GetStyleValueName(s->val_style);
+		if (!str) {
+			return FALSE;
+		}
+		CSSWriter_PutString(w, name);
+		CSSWriter_PutWord(w, s->type);
+		CSSWriter_PutString(w, str);
+		return TRUE;
+	case LCUI_STYPE_STRING:
+		if (!s->val_string) {
+			return FALSE;
+		}
+		CSSWriter_PutString(w, name);
+		CSSWriter_PutWord(w, s->type);
+		CSSWriter_PutString(w, s->val_string);
+		return TRUE;
+	case LCUI_STYPE_WSTRING:
+		if (!s->val_wstring) {
+			return FALSE;
+		}
+		len = LCUI_EncodeUTF8String(NULL, s->val_wstring, 0) + 1;
+		str = malloc(len);
+		if (!str) {
+			w->error = -ENOMEM;
+			return FALSE;
+		}
+		LCUI_EncodeUTF8String(str, s->val_wstring, len);
+		CSSWriter_PutString(w, name);
+		CSSWriter_PutWord(w, s->type);
+		CSSWriter_PutString(w, str);
+		free(str);
+		return TRUE;
+	case LCUI_STYPE_SCALE:
+	case LCUI_STYPE_PX:
+	case LCUI_STYPE_PT:
+	case LCUI_STYPE_DIP:
+	case LCUI_STYPE_SP:
+		value.val_float = s->value;
+		break;
+	case LCUI_STYPE_COLOR:
+		value.word = (uint32_t)s->val_color.value;
+		break;
+	default:
+		value.val_int = s->val_int;
+		break;
+	}
+	CSSWriter_PutString(w, name);
+	CSSWriter_PutWord(w, s->type);
+	CSSWriter_PutWord(w, value.word);
+	return TRUE;
+}
+
+static LCUI_BOOL CSSWriter_PutRule(CSSWriter w, CSSRule rule)
+{
+	int i;
+	size_t pos;
+	uint32_t count = 0;
+	LinkedListNode *node;
+	LCUI_StyleListNode snode;
+	LCUI_Selector s;
+
+	s = Selector(rule->selector);
+	if (!s) {
+		return FALSE;
+	}
+	CSSWriter_PutWord(w, (uint32_t)rule->rank);
+	CSSWriter_PutString(w, rule->space);
+	CSSWriter_PutWord(w, (uint32_t)s->length);
+	pos = w->words_count;
+	CSSWriter_PutWord(w, 0);
+	for (i = 0; i < s->length; ++i) {
+		CSSWriter_PutSelectorNode(w, s->nodes[i]);
+	}
+	for (LinkedList_Each(node, rule->list)) {
+		snode = node->data;
+		if (CSSWriter_PutStyle(w, snode->key, &snode->style)) {
+			++count;
+		}
+	}
+	if (!w->error) {
+		w->words[pos] = count;
+	}
+	Selector_Delete(s);
+	return TRUE;
+}
+
+int LCUI_WriteCompiledCSSFile(const char *space, const char *filepath)
+{
+	FILE *fp;
+	size_t i;
+	int count = 0;
+	CSSRulesRec rules = { 0 };
+	CSSWriterRec writer;
+	CSSBinaryHeaderRec header = { CSS_BINARY_MAGIC };
+
+	rules.space = space;
+	LCUI_EachStyleRule(OnCollectRule, &rules);
+	qsort(rules.rules, rules.length, sizeof(CSSRuleRec), CompareRules);
+	CSSWriter_Init(&writer);
+	for (i = 0; i < rules.length; ++i) {
+		if (CSSWriter_PutRule(&writer, &rules.rules[i])) {
+			++count;
+		}
+		free(rules.rules[i].selector);
+	}
+	free(rules.rules);
+	if (rules.error || writer.error) {
+		CSSWriter_Destroy(&writer);
+		return rules.error ? rules.error : writer.error;
+	}
+	header.version = CSS_BINARY_VERSION;
+	header.byte_order = CSS_BINARY_BYTE_ORDER;
+	header.rules_count = count;
+	header.words_count = (uint32_t)writer.words_count;
+	header.strings_size = (uint32_t)writer.strings_size;
+	fp = fopen(filepath, "wb");
+	if (!fp) {
+		CSSWriter_Destroy(&writer);
+		return -ENOENT;
+	}
+	if (fwrite(&header, sizeof(header), 1, fp) != 1 ||
+	    fwrite(writer.words, sizeof(uint32_t), writer.words_count, fp) !=
+		writer.words_count ||
+	    fwrite(writer.strings, 1, writer.strings_size, fp) !=
+		writer.strings_size) {
+		count = -EIO;
+	}
+	fclose(fp);
+	CSSWriter_Destroy(&writer);
+	return count;
+}
+
+static uint32_t CSSReader_GetWord(CSSReader r)
+{
+	uint32_t word;
+
+	if (r->pos >= r->words_count) {
+		r->error = -EINVAL;
+		return 0;
+	}
+	memcpy(&word, r->words + r->pos * sizeof(uint32_t), sizeof(uint32_t));
+	r->pos += 1;
+	return word;
+}
+
+static const char *CSSReader_GetString(CSSReader r)
+{
+	uint32_t offset = CSSReader_GetWord(r);
+
+	if (offset == CSS_NO_STRING || r->error) {
+		return NULL;
+	}
+	if (offset >= r->strings_size) {
+		r->error = -EINVAL;
+		return NULL;
+	}
+	return r->strings + offset;
+}
+
+static LCUI_SelectorNode CSSReader_GetSelectorNode(CSSReader r)
+{
+	const char *str;
+	uint32_t i, n_classes, n_status;
+	LCUI_SelectorNode node;
+
+	node = NEW(LCUI_SelectorNodeRec, 1);
+	if (!node) {
+		r->error = -ENOMEM;
+		return NULL;
+	}
+	str = CSSReader_GetString(r);
+	node->id = str ? strdup2(str) : NULL;
+	str = CSSReader_GetString(r);
+	node->type = str ? strdup2(str) : NULL;
+	n_classes = CSSReader_GetWord(r);
+	n_status = CSSReader_GetWord(r);
+	for (i = 0; i < n_classes && !r->error; ++i) {
+		str = CSSReader_GetString(r);
+		if (str) {
+			sortedstrlist_add(&node->classes, str);
+		}
+	}
+	for (i = 0; i < n_status && !r->error; ++i) {
+		str = CSSReader_GetString(r);
+		if (str) {
+			sortedstrlist_add(&node->status, str);
+		}
+	}
+	if (r->error) {
+		SelectorNode_Delete(node);
+		return NULL;
+	}
+	SelectorNode_Update(node);
+	return node;
+}
+
+static void CSSReader_GetStyle(CSSReader r, Dict *keys, LCUI_StyleSheet ss)
+{
+	int key;
+	size_t len;
+	wchar_t *wstr;
+	uint32_t type;
+	const char *name, *str;
+	CSSWordRec value;
+	LCUI_StyleRec style = { 0 };
+
+	name = CSSReader_GetString(r);
+	type = CSSReader_GetWord(r);
+	value.word = CSSReader_GetWord(r);
+	if (r->error || !name) {
+		return;
+	}
+	if (type > LCUI_STYPE_WSTRING) {
+		r->error = -EINVAL;
+		return;
+	}
+	style.type = type;
+	/* The stored keys are increased by 1 to be distinguished from NULL */
+	key = (int)(intptr_t)Dict_FetchValue(keys, name) - 1;
+	if (key < 0 || key >= ss->length) {
+		Logger_Warning("[css] unknown property: %s\n", name);
+		return;
+	}
+	switch (style.type) {
+	case LCUI_STYPE_STYLE:
+	case LCUI_STYPE_STRING:
+	case LCUI_STYPE_WSTRING:
+		if (value.word >= r->strings_size) {
+			r->error = -EINVAL;
+			return;
+		}
+		str = r->strings + value.word;
+		break;
+	default:
+		str = NULL;
+		break;
+	}
+	switch (style.type) {
+	case LCUI_STYPE_STYLE:
+		style.val_style = LCUI_GetStyleValue(str);
+		if ((int)style.val_style < 0) {
+			Logger_Warning("[css] unknown value: %s\n", str);
+			return;
+		}
+		break;
+	case LCUI_STYPE_STRING:
+		style.val_string = strdup2(str);
+		break;
+	case LCUI_STYPE_WSTRING:
+		len = LCUI_DecodeUTF8String(NULL, str, 0) + 1;
+		wstr = malloc(sizeof(wchar_t) * len);
+		if (!wstr) {
+			r->error = -ENOMEM;
+			return;
+		}
+		LCUI_DecodeUTF8String(wstr, str, len);
+		style.val_wstring = wstr;
+		break;
+	case LCUI_STYPE_SCALE:
+	case LCUI_STYPE_PX:
+	case LCUI_STYPE_PT:
+	case LCUI_STYPE_DIP:
+	case LCUI_STYPE_SP:
+		style.value = value.val_float;
+		break;
+	case LCUI_STYPE_COLOR:
+		style.val_color.value = (int32_t)value.word;
+		break;
+	case LCUI_STYPE_NONE:
+	case LCUI_STYPE_AUTO:
+	case LCUI_STYPE_INT:
+	case LCUI_STYPE_BOOL:
+		style.val_int = value.val_int;
+		break;
+	default:
+		r->error = -EINVAL;
+		return;
+	}
+	style.is_valid = TRUE;
+	DestroyStyle(&ss->sheet[key]);
+	ss->sheet[key] = style;
+}
+
+static int CSSReader_GetRule(CSSReader r, Dict *keys)
+{
+	int rank;
+	const char *space;
+	uint32_t i, n_nodes, n_styles;
+	LCUI_StyleSheet ss;
+	LCUI_Selector s;
+	LCUI_SelectorNode node;
+
+	rank = (int)CSSReader_GetWord(r);
+	space = CSSReader_GetString(r);
+	n_nodes = CSSReader_GetWord(r);
+	n_styles = CSSReader_GetWord(r);
+	if (r->error || n_nodes < 1 || n_nodes >= MAX_SELECTOR_DEPTH) {
+		r->error = -EINVAL;
+		return r->error;
+	}
+	s = Selector(NULL);
+	for (i = 0; i < n_nodes; ++i) {
+		node = CSSReader_GetSelectorNode(r);
+		if (!node) {
+			Selector_Delete(s);
+			return r->error;
+		}
+		Selector_AppendNode(s, node);
+	}
+	Selector_Update(s);
+	s->rank = rank;
+	ss = StyleSheet();
+	for (i = 0; i < n_styles && !r->error; ++i) {
+		CSSReader_GetStyle(r, keys, ss);
+	}
+	if (!r->error) {
+		LCUI_PutStyleSheet(s, ss, space);
+	}
+	StyleSheet_Delete(ss);
+	Selector_Delete(s);
+	return r->error;
+}
+
+int LCUI_LoadCompiledCSS(const void *data, size_t size)
+{
+	int key, count, total;
+	uint32_t i;
+	const char *name;
+	const unsigned char *bytes = data;
+	CSSBinaryHeaderRec header;
+	CSSReaderRec reader = { 0 };
+	DictType keys_dict;
+	Dict *keys;
+
+	if (size < sizeof(header)) {
+		return -EINVAL;
+	}
+	memcpy(&header, bytes, sizeof(header));
+	if (memcmp(header.magic, CSS_BINARY_MAGIC,
+		   sizeof(CSS_BINARY_MAGIC)) != 0 ||
+	    header.byte_order != CSS_BINARY_BYTE_ORDER ||
+	    header.version != CSS_BINARY_VERSION) {
+		Logger_Error("[css] unsupported compiled stylesheet\n");
+		return -EINVAL;
+	}
+	if (header.words_count > (size - sizeof(header)) / sizeof(uint32_t) ||
+	    header.strings_size != size - sizeof(header) -
+				       header.words_count * sizeof(uint32_t)) {
+		Logger_Error("[css] the compiled stylesheet is incomplete\n");
+		return -EINVAL;
+	}
+	reader.words = bytes + sizeof(header);
+	reader.words_count = header.words_count;
+	reader.strings = (const char *)reader.words +
+			 header.words_count * sizeof(uint32_t);
+	reader.strings_size = header.strings_size;
+	if (reader.strings_size > 0 &&
+	    reader.strings[reader.strings_size - 1] != 0) {
+		return -EINVAL;
+	}
+	Dict_InitStringKeyType(&keys_dict);
+	keys = Dict_Create(&keys_dict, NULL);
+	total = LCUI_GetStyleTotal();
+	for (key = 0; key < total; ++key) {
+		name = LCUI_GetStyleName(key);
+		if (name) {
+			Dict_Add(keys, (void *)name, (void *)(intptr_t)(key + 1));
+		}
+	}
+	for (count = 0, i = 0; i < header.rules_count; ++i) {
+		if (CSSReader_GetRule(&reader, keys) != 0) {
+			Logger_Error("[css] the compiled stylesheet is broken\n");
+			break;
+		}
+		++count;
+	}
+	Dict_Release(keys);
+	return reader.error ? reader.error : count;
+}
+
+int LCUI_LoadCompiledCSSFile(const char *filepath)
+{
+	int ret;
+	LCUI_MappedFile file;
+
+	file = LCUI_MapFile(filepath);
+	if (!file) {
+		return -ENOENT;
+	}
+	ret = LCUI_LoadCompiledCSS(file->data, file->size);
+	LCUI_UnmapFile(file);
+	return ret;
+}
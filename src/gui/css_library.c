@@ -1582,6 +1582,66 @@ void LCUI_PrintCSSLibrary(void)
 	Logger_Debug("style library end\n");
 }
 
+static void StyleLink_EachRule(StyleLink link, const char *selector,
+			       LCUI_StyleRuleHandler handler, void *data)
+{
+	DictEntry *entry;
+	DictIterator *iter;
+	LinkedListNode *node;
+	LCUI_StyleRuleRec rule;
+	char fullname[MAX_SELECTOR_LEN];
+
+	if (selector) {
+		snprintf(fullname, MAX_SELECTOR_LEN, "%s %s",
+			 link->group->name, selector);
+	} else {
+		strncpy(fullname, link->group->name, MAX_SELECTOR_LEN - 1);
+		fullname[MAX_SELECTOR_LEN - 1] = 0;
+	}
+	rule.selector = fullname;
+	for (LinkedList_Each(node, &link->styles)) {
+		StyleNode snode = node->data;
+		rule.rank = snode->rank;
+		rule.batch_num = snode->batch_num;
+		rule.space = snode->space;
+		rule.list = snode->list;
+		handler(&rule, data);
+	}
+	iter = Dict_GetIterator(link->parents);
+	while ((entry = Dict_Next(iter))) {
+		StyleLink_EachRule(DictEntry_GetVal(entry), fullname, handler,
+				   data);
+	}
+	Dict_ReleaseIterator(iter);
+}
+
+void LCUI_EachStyleRule(LCUI_StyleRuleHandler handler, void *data)
+{
+	Dict *group;
+	DictEntry *entry, *entry_slg;
+	DictIterator *iter, *iter_slg;
+	StyleLinkGroup slg;
+
+	LCUIMutex_Lock(&library.mutex);
+	group = LinkedList_Get(&library.groups, 0);
+	if (!group) {
+		LCUIMutex_Unlock(&library.mutex);
+		return;
+	}
+	iter = Dict_GetIterator(group);
+	while ((entry = Dict_Next(iter))) {
+		slg = DictEntry_GetVal(entry);
+		iter_slg = Dict_GetIterator(slg->links);
+		while ((entry_slg = Dict_Next(iter_slg))) {
+			StyleLink_EachRule(DictEntry_GetVal(entry_slg), NULL,
+					   handler, data);
+		}
+		Dict_ReleaseIterator(iter_slg);
+	}
+	Dict_ReleaseIterator(iter);
+	LCUIMutex_Unlock(&library.mutex);
+}
+
 LCUI_CachedStyleSheet LCUI_GetCachedStyleSheet(LCUI_Selector s)
 {
 	LinkedList list;
@@ -49,10 +49,30 @@
 
 #define SetCSSProperty CSSStyleParser_SetCSSProperty
 
+#define STOP_SELECTOR 1
+#define STOP_KEY (1 << 1)
+#define STOP_VALUE (1 << 2)
+
 static struct CSSParserModule {
 	int count;
-	DictType dicttype; /**< 解析器表的字典类型数据 */
-	Dict *parsers;     /**< 解析器表，以名称进行索引 */
+	int max_count;
+	LCUI_CSSPropertyParser *parsers; /**< 解析器列表 */
+
+	/** character classes used to find the end of a run of characters */
+	unsigned char stop_chars[256];
+
+	/**
+	 * Perfect hash table of the property parsers
+	 * The names are hashed into buckets first, and each bucket has a seed
+	 * that places all its names into free slots of the table, so a lookup
+	 * only probes one slot.
+	 */
+	struct {
+		unsigned mask;
+		unsigned n_buckets;
+		unsigned *seeds;
+		LCUI_CSSPropertyParser *slots;
+	} table;
 } self;
 
 void CSSStyleParser_SetCSSProperty(LCUI_CSSParserStyleContext ctx, int key,
@@ -1168,6 +1188,7 @@ LCUI_CSSParserContext CSSParser_Begin(size_t buffer_size, const char *space)
 	}
 	ctx->buffer = NEW(char, buffer_size);
 	ctx->buffer_size = buffer_size;
+	ctx->pos = 0;
 	ctx->target = CSS_TARGET_NONE;
 	ctx->style.space = ctx->space;
 	ctx->style.style_handler = NULL;
@@ -1201,117 +1222,405 @@ void CSSParser_End(LCUI_CSSParserContext ctx)
 	free(ctx);
 }
 
-/** 载入CSS代码块，用于实现CSS代码的分块载入 */
-static size_t LCUI_LoadCSSBlock(LCUI_CSSParserContext ctx, const char *str)
+/** Make sure the buffer can hold n more characters and a null character */
+static int CSSParser_ReserveBuffer(LCUI_CSSParserContext ctx, size_t n)
+{
+	char *buffer;
+	size_t size = ctx->buffer_size;
+
+	if (ctx->pos + n < size) {
+		return 0;
+	}
+	while (ctx->pos + n >= size) {
+		size *= 2;
+	}
+	buffer = realloc(ctx->buffer, size);
+	if (!buffer) {
+		return -ENOMEM;
+	}
+	ctx->buffer = buffer;
+	ctx->buffer_size = size;
+	return 0;
+}
+
+static const char *FindStopChar(const char *str, const char *end, int mask)
+{
+	while (str < end && !(self.stop_chars[(unsigned char)*str] & mask)) {
+		++str;
+	}
+	return str;
+}
+
+/** Find the character, memchr() is vectorized in most C libraries */
+static const char *FindChar(const char *str, const char *end, char ch)
+{
+	const char *p = memchr(str, ch, end - str);
+	return p ? p : end;
+}
+
+/**
+ * Scan a run of characters that does not change the parser state
+ * The run is consumed as a whole instead of being passed to the parser of
+ * the current target character by character.
+ * @returns the last character of the run, or NULL if there is no run
+ */
+static const char *CSSParser_ScanRun(LCUI_CSSParserContext ctx,
+				     const char *end)
+{
+	size_t len;
+	const char *p = ctx->cur;
+
+	switch (ctx->target) {
+	case CSS_TARGET_NONE:
+		while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' ||
+				   *p == '\t')) {
+			++p;
+		}
+		return p > ctx->cur ? p - 1 : NULL;
+	case CSS_TARGET_COMMENT:
+		if (ctx->comment.is_line_comment) {
+			p = FindChar(p, end, '\n');
+		} else {
+			p = FindChar(p, end, '/');
+		}
+		return p > ctx->cur ? p - 1 : NULL;
+	case CSS_TARGET_SELECTOR:
+		p = FindStopChar(p, end, STOP_SELECTOR);
+		break;
+	case CSS_TARGET_KEY:
+		p = FindStopChar(p, end, STOP_KEY);
+		break;
+	case CSS_TARGET_VALUE:
+		if (ctx->pos == 0) {
+			switch (*p) {
+			CASE_WHITE_SPACE:
+				return NULL;
+			default:
+				break;
+			}
+		}
+		p = FindStopChar(p, end, STOP_VALUE);
+		break;
+	default:
+		return NULL;
+	}
+	len = p - ctx->cur;
+	if (len < 1 || CSSParser_ReserveBuffer(ctx, len) != 0) {
+		return NULL;
+	}
+	memcpy(ctx->buffer + ctx->pos, ctx->cur, len);
+	ctx->pos += (int)len;
+	return p - 1;
+}
+
+/**
+ * Parse the characters in [str, end)
+ * The parsers may look at the next character, so the character at the end
+ * must be readable.
+ */
+static void CSSParser_ParseRange(LCUI_CSSParserContext ctx, const char *str,
+				 const char *end)
 {
-	size_t size = 0;
+	const char *last;
 
-	ctx->cur = str;
-	while (*ctx->cur && size < ctx->buffer_size) {
+	for (ctx->cur = str; ctx->cur < end; ++ctx->cur) {
+		last = CSSParser_ScanRun(ctx, end);
+		if (last) {
+			ctx->cur = last;
+			continue;
+		}
+		if (CSSParser_ReserveBuffer(ctx, 1) != 0) {
+			break;
+		}
 		ctx->parsers[ctx->target].parse(ctx);
-		++ctx->cur;
-		++size;
 	}
-	return size;
+}
+
+static unsigned CSSPropertyTable_Hash(const char *name, unsigned seed)
+{
+	unsigned hash = 2166136261u ^ (seed * 0x9e3779b9u);
+
+	while (*name) {
+		hash ^= (unsigned char)*name++;
+		hash *= 16777619u;
+	}
+	hash ^= hash >> 15;
+	hash *= 0x2c1b3c6du;
+	hash ^= hash >> 12;
+	return hash;
+}
+
+static void CSSPropertyTable_Free(void)
+{
+	free(self.table.seeds);
+	free(self.table.slots);
+	self.table.seeds = NULL;
+	self.table.slots = NULL;
+	self.table.mask = 0;
+	self.table.n_buckets = 0;
+}
+
+/** Find a seed that places all names of the bucket into free slots */
+static LCUI_BOOL CSSPropertyTable_PlaceBucket(unsigned bucket, unsigned *slots)
+{
+	int i, n;
+	unsigned seed, slot;
+	LCUI_CSSPropertyParser sp;
+
+	for (seed = 1; seed < 4096; ++seed) {
+		for (n = 0, i = 0; i < self.count; ++i) {
+			sp = self.parsers[i];
+			if (CSSPropertyTable_Hash(sp->name, 0) %
+				self.table.n_buckets !=
+			    bucket) {
+				continue;
+			}
+			slot = CSSPropertyTable_Hash(sp->name, seed) &
+			       self.table.mask;
+			if (self.table.slots[slot]) {
+				break;
+			}
+			self.table.slots[slot] = sp;
+			slots[n++] = slot;
+		}
+		if (i >= self.count) {
+			self.table.seeds[bucket] = seed;
+			return TRUE;
+		}
+		while (n > 0) {
+			self.table.slots[slots[--n]] = NULL;
+		}
+	}
+	return FALSE;
+}
+
+static int CompareBucketSize(const void *a, const void *b)
+{
+	const unsigned *b1 = a, *b2 = b;
+
+	return (int)b2[1] - (int)b1[1];
+}
+
+/**
+ * Rebuild the perfect hash table
+ * The buckets with more names are placed first, because they are harder to
+ * place when the table is filling up.
+ */
+static int CSSPropertyTable_Build(void)
+{
+	int i;
+	unsigned b, size, *slots, (*buckets)[2];
+
+	CSSPropertyTable_Free();
+	if (self.count < 1) {
+		return 0;
+	}
+	slots = malloc(sizeof(unsigned) * self.count);
+	buckets = malloc(sizeof(*buckets) * self.count);
+	if (!slots || !buckets) {
+		free(slots);
+		free(buckets);
+		return -ENOMEM;
+	}
+	for (size = 16; size < (unsigned)self.count * 2; size *= 2);
+	while (1) {
+		self.table.mask = size - 1;
+		self.table.n_buckets = (self.count + 3) / 4;
+		self.table.seeds = NEW(unsigned, self.table.n_buckets);
+		self.table.slots = NEW(LCUI_CSSPropertyParser, size);
+		if (!self.table.seeds || !self.table.slots) {
+			break;
+		}
+		for (b = 0; b < self.table.n_buckets; ++b) {
+			buckets[b][0] = b;
+			buckets[b][1] = 0;
+		}
+		for (i = 0; i < self.count; ++i) {
+			b = CSSPropertyTable_Hash(self.parsers[i]->name, 0) %
+			    self.table.n_buckets;
+			buckets[b][1] += 1;
+		}
+		qsort(buckets, self.table.n_buckets, sizeof(*buckets),
+		      CompareBucketSize);
+		for (b = 0; b < self.table.n_buckets; ++b) {
+			if (!CSSPropertyTable_PlaceBucket(buckets[b][0],
+							  slots)) {
+				break;
+			}
+		}
+		if (b >= self.table.n_buckets) {
+			free(slots);
+			free(buckets);
+			return 0;
+		}
+		CSSPropertyTable_Free();
+		size *= 2;
+	}
+	CSSPropertyTable_Free();
+	free(slots);
+	free(buckets);
+	return -ENOMEM;
 }
 
 LCUI_CSSPropertyParser LCUI_GetCSSPropertyParser(const char *name)
 {
-	return Dict_FetchValue(self.parsers, name);
+	unsigned seed;
+	LCUI_CSSPropertyParser sp;
+
+	if (!self.table.slots) {
+		return NULL;
+	}
+	seed = self.table.seeds[CSSPropertyTable_Hash(name, 0) %
+				self.table.n_buckets];
+	sp = self.table.slots[CSSPropertyTable_Hash(name, seed) &
+			      self.table.mask];
+	if (sp && strcmp(sp->name, name) == 0) {
+		return sp;
+	}
+	return NULL;
 }
 
 int LCUI_LoadCSSFile(const char *filepath)
 {
-	size_t n;
-	FILE *fp;
-	char buff[512];
+	char tail[3] = { 0 };
+	const char *cur, *end;
+	LCUI_MappedFile file;
 	LCUI_CSSParserContext ctx;
 
-	fp = fopen(filepath, "r");
-	if (!fp) {
+	file = LCUI_MapFile(filepath);
+	if (!file) {
 		return -1;
 	}
 	ctx = CSSParser_Begin(512, filepath);
-	n = fread(buff, 1, 511, fp);
-	while (n > 0) {
-		buff[n] = 0;
-		LCUI_LoadCSSBlock(ctx, buff);
-		n = fread(buff, 1, 511, fp);
+	if (file->size < 1) {
+		CSSParser_End(ctx);
+		LCUI_UnmapFile(file);
+		return 0;
+	}
+	/* The parsers may look at the next character, so the last character
+	 * is parsed in a copy that ends with a null character */
+	cur = (const char *)file->data;
+	end = memchr(cur, 0, file->size);
+	if (!end) {
+		end = cur + file->size - 1;
+		CSSParser_ParseRange(ctx, cur, end);
+		tail[0] = file->size > 1 ? *(end - 1) : 0;
+		tail[1] = *end;
+		CSSParser_ParseRange(ctx, tail + 1, tail + 2);
+	} else {
+		CSSParser_ParseRange(ctx, cur, end);
 	}
 	CSSParser_End(ctx);
-	fclose(fp);
+	LCUI_UnmapFile(file);
 	return 0;
 }
 
 size_t LCUI_LoadCSSString(const char *str, const char *space)
 {
-	size_t len = 1;
-	const char *cur;
 	LCUI_CSSParserContext ctx;
 
 	DEBUG_MSG("parse begin\n");
 	ctx = CSSParser_Begin(512, space);
-	for (cur = str; len > 0; cur += len) {
-		len = LCUI_LoadCSSBlock(ctx, cur);
-	}
+	CSSParser_ParseRange(ctx, str, str + strlen(str));
 	CSSParser_End(ctx);
 	DEBUG_MSG("parse end\n");
 	return 0;
 }
 
+static int CSSParser_AddPropertyParser(int key, const char *name,
+				       int (*parse)(LCUI_CSSParserStyleContext,
+						    const char *))
+{
+	int i;
+	LCUI_CSSPropertyParser sp, *parsers;
+
+	for (i = 0; i < self.count; ++i) {
+		if (strcmp(self.parsers[i]->name, name) == 0) {
+			return -2;
+		}
+	}
+	if (self.count >= self.max_count) {
+		i = self.max_count > 0 ? self.max_count * 2 : 128;
+		parsers = realloc(self.parsers, sizeof(*parsers) * i);
+		if (!parsers) {
+			return -ENOMEM;
+		}
+		self.parsers = parsers;
+		self.max_count = i;
+	}
+	sp = NEW(LCUI_CSSPropertyParserRec, 1);
+	if (!sp) {
+		return -ENOMEM;
+	}
+	sp->key = key;
+	sp->parse = parse;
+	sp->name = strdup2(name);
+	self.parsers[self.count++] = sp;
+	return 0;
+}
+
 int LCUI_AddCSSPropertyParser(LCUI_CSSPropertyParser sp)
 {
-	LCUI_CSSPropertyParser new_sp;
+	int ret;
+
 	if (!sp->name || strlen(sp->name) < 1) {
 		return -1;
 	}
-	if (Dict_FetchValue(self.parsers, sp->name)) {
-		return -2;
+	ret = CSSParser_AddPropertyParser(sp->key, sp->name, sp->parse);
+	if (ret != 0) {
+		return ret;
 	}
-	self.count += 1;
-	new_sp = NEW(LCUI_CSSPropertyParserRec, 1);
-	new_sp->key = sp->key;
-	new_sp->parse = sp->parse;
-	new_sp->name = strdup2(sp->name);
-	Dict_Add(self.parsers, new_sp->name, new_sp);
-	return 0;
+	return CSSPropertyTable_Build();
 }
 
-static void DestroyStyleParser(void *privdata, void *val)
+static void InitStopChars(const char *charset, int mask)
 {
-	LCUI_CSSPropertyParser sp = val;
-	free(sp->name);
-	free(sp);
+	const char *p;
+
+	self.stop_chars[0] |= mask;
+	for (p = charset; *p; ++p) {
+		self.stop_chars[(unsigned char)*p] |= mask;
+	}
 }
 
 void LCUI_InitCSSParser(void)
 {
-	LCUI_CSSPropertyParser new_sp, sp, sp_end;
+	const char *name;
+	LCUI_CSSPropertyParser sp, sp_end;
 
 	self.count = 0;
-	Dict_InitStringKeyType(&self.dicttype);
-	self.dicttype.valDestructor = DestroyStyleParser;
-	self.parsers = Dict_Create(&self.dicttype, NULL);
+	self.max_count = 0;
+	self.parsers = NULL;
+	memset(self.stop_chars, 0, sizeof(self.stop_chars));
+	InitStopChars("/{,", STOP_SELECTOR);
+	InitStopChars(" \n\r\t;:}", STOP_KEY);
+	InitStopChars("/};", STOP_VALUE);
 	sp_end = style_parser_map + LEN(style_parser_map);
 	for (sp = style_parser_map; sp < sp_end; ++sp) {
-		new_sp = malloc(sizeof(LCUI_CSSPropertyParserRec));
-		new_sp->key = sp->key;
-		new_sp->parse = sp->parse;
 		if (!sp->name && sp->key >= 0) {
-			const char *name = LCUI_GetStyleName(sp->key);
+			name = LCUI_GetStyleName(sp->key);
 			if (!name) {
-				free(new_sp);
 				continue;
 			}
-			new_sp->name = strdup2(name);
 		} else {
-			new_sp->name = strdup2(sp->name);
+			name = sp->name;
 		}
-		Dict_Add(self.parsers, new_sp->name, new_sp);
+		CSSParser_AddPropertyParser(sp->key, name, sp->parse);
 	}
+	CSSPropertyTable_Build();
 }
 
 void LCUI_FreeCSSParser(void)
 {
-	Dict_Release(self.parsers);
+	int i;
+
+	CSSPropertyTable_Free();
+	for (i = 0; i < self.count; ++i) {
+		free(self.parsers[i]->name);
+		free(self.parsers[i]);
+	}
+	free(self.parsers);
+	self.parsers = NULL;
+	self.count = 0;
+	self.max_count = 0;
 }
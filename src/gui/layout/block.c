@@ -215,7 +215,7 @@ static void BlockLayout_Load(LCUI_BlockLayoutContext ctx)
 
 	LCUI_Widget child;
 	LCUI_Widget w = ctx->widget;
-	LinkedListNode *node;
+	size_t i;
 
 	if (ctx->rule == LCUI_LAYOUT_RULE_FIXED_WIDTH ||
 	    ctx->rule == LCUI_LAYOUT_RULE_FIXED) {
@@ -228,9 +228,7 @@ static void BlockLayout_Load(LCUI_BlockLayoutContext ctx)
 	}
 	DEBUG_MSG("%s, start\n", ctx->widget->id);
 	DEBUG_MSG("%s, max_row_width: %g\n", ctx->widget->id, max_row_width);
-	for (LinkedList_Each(node, &w->children)) {
-		child = node->data;
-
+	for (Widget_EachChild(i, child, w)) {
 		if (Widget_HasAbsolutePosition(child)) {
 			LinkedList_Append(&ctx->free_elements, child);
 			continue;
@@ -250,7 +248,7 @@ static void BlockLayout_Load(LCUI_BlockLayoutContext ctx)
 		}
 		DEBUG_MSG(
 		    "row %lu, child %lu, static size: (%g, %g), display: %d\n",
-		    ctx->rows.length, child->index, child->box.outer.width,
+		    ctx->rows.length, child->cached_index, child->box.outer.width,
 		    child->box.outer.height, child->computed_style.display);
 		switch (child->computed_style.display) {
 		case SV_INLINE_BLOCK:
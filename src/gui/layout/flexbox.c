@@ -37,7 +37,12 @@
 #include "../widget_util.h"
 #include "../widget_diff.h"
 
-typedef struct LCUI_FlexBoxLineRec_ {
+#define FLEXBOX_LINE_BUFFER_SIZE 16
+
+typedef struct LCUI_FlexBoxLineRec_ LCUI_FlexBoxLineRec;
+typedef struct LCUI_FlexBoxLineRec_ *LCUI_FlexBoxLine;
+
+struct LCUI_FlexBoxLineRec_ {
 	/** The size of it on the main axis */
 	float main_size;
 
@@ -48,9 +53,19 @@ typedef struct LCUI_FlexBoxLineRec_ {
 	float sum_of_shrink_value;
 	size_t count_of_auto_margin_items;
 
-	/** LinkedList<LCUI_Widget> elements */
-	LinkedList elements;
-} LCUI_FlexBoxLineRec, *LCUI_FlexBoxLine;
+	/**
+	 * Elements of the line
+	 * It points to the inline buffer until the line has more elements
+	 * than the buffer can hold.
+	 */
+	LCUI_Widget *elements;
+	LCUI_Widget buffer[FLEXBOX_LINE_BUFFER_SIZE];
+	size_t length;
+	size_t capacity;
+
+	/** Next line in the layout context */
+	LCUI_FlexBoxLine next;
+};
 
 typedef struct LCUI_FlexBoxLayoutContextRec_ {
 	LCUI_Widget widget;
@@ -62,48 +77,79 @@ typedef struct LCUI_FlexBoxLayoutContextRec_ {
 	float main_size;
 	float cross_size;
 
-	/** LinkedList<LCUI_FlexBoxLine> lines */
-	LinkedList lines;
-	LCUI_FlexBoxLine line;
+	/**
+	 * The first line, the lines are linked by FlexBoxLine.next
+	 * It points to first_line, which is stored in the context, so the
+	 * most common single line layout does not allocate memory.
+	 */
+	LCUI_FlexBoxLine lines;
+	LCUI_FlexBoxLineRec first_line;
+	size_t lines_count;
 
-	LinkedList free_elements;
+	/** The current line */
+	LCUI_FlexBoxLine line;
 } LCUI_FlexBoxLayoutContextRec, *LCUI_FlexBoxLayoutContext;
 
-static LCUI_FlexBoxLine FlexBoxLine_Create(void)
+static void FlexBoxLine_Init(LCUI_FlexBoxLine line)
 {
-	LCUI_FlexBoxLine line;
-
-	line = malloc(sizeof(LCUI_FlexBoxLineRec));
+	line->elements = line->buffer;
+	line->capacity = FLEXBOX_LINE_BUFFER_SIZE;
 	line->main_size = 0;
 	line->cross_size = 0;
 	line->sum_of_grow_value = 0;
 	line->sum_of_shrink_value = 0;
 	line->count_of_auto_margin_items = 0;
-	LinkedList_Init(&line->elements);
-	return line;
+	line->length = 0;
+	line->next = NULL;
 }
 
-static void FlexBoxLine_Destroy(void *arg)
+static void FlexBoxLine_Destroy(LCUI_FlexBoxLine line)
 {
-	LCUI_FlexBoxLine line = arg;
-
-	LinkedList_Clear(&line->elements, NULL);
-	free(line);
+	if (line->elements != line->buffer) {
+		free(line->elements);
+	}
+	line->elements = NULL;
+	line->length = 0;
+	line->capacity = 0;
 }
 
 static void FlexBoxLine_LoadElement(LCUI_FlexBoxLine line, LCUI_Widget w)
 {
+	size_t capacity;
+	LCUI_Widget *elements;
+
+	if (line->length >= line->capacity) {
+		capacity = line->capacity * 2;
+		if (line->elements == line->buffer) {
+			elements = malloc(capacity * sizeof(LCUI_Widget));
+			if (!elements) {
+				return;
+			}
+			memcpy(elements, line->buffer,
+			       line->length * sizeof(LCUI_Widget));
+		} else {
+			elements = realloc(line->elements,
+					   capacity * sizeof(LCUI_Widget));
+			if (!elements) {
+				return;
+			}
+		}
+		line->elements = elements;
+		line->capacity = capacity;
+	}
 	if (w->computed_style.flex.grow > 0) {
 		line->sum_of_grow_value += w->computed_style.flex.grow;
 	}
 	if (w->computed_style.flex.shrink > 0) {
 		line->sum_of_shrink_value += w->computed_style.flex.shrink;
 	}
-	LinkedList_Append(&line->elements, w);
+	line->elements[line->length++] = w;
 }
 
 static void FlexBoxLayout_NextLine(LCUI_FlexBoxLayoutContext ctx)
 {
+	LCUI_FlexBoxLine line;
+
 	if (ctx->line) {
 		ctx->main_size = max(ctx->main_size, ctx->line->main_size);
 		ctx->cross_axis += ctx->line->cross_size;
@@ -114,16 +160,28 @@ static void FlexBoxLayout_NextLine(LCUI_FlexBoxLayoutContext ctx)
 			ctx->cross_size -= ctx->widget->padding.top;
 		}
 	}
+	if (ctx->line) {
+		line = malloc(sizeof(LCUI_FlexBoxLineRec));
+		if (!line) {
+			/* Keep loading elements into the current line */
+			return;
+		}
+		FlexBoxLine_Init(line);
+		ctx->line->next = line;
+	} else {
+		line = &ctx->first_line;
+		FlexBoxLine_Init(line);
+		ctx->lines = line;
+	}
 	ctx->main_axis = ctx->widget->padding.left;
-	ctx->line = FlexBoxLine_Create();
-	LinkedList_Append(&ctx->lines, ctx->line);
+	ctx->line = line;
+	ctx->lines_count++;
 }
 
-static LCUI_FlexBoxLayoutContext FlexBoxLayout_Begin(LCUI_Widget w,
-						     LCUI_LayoutRule rule)
+static void FlexBoxLayout_Begin(LCUI_FlexBoxLayoutContext ctx, LCUI_Widget w,
+				LCUI_LayoutRule rule)
 {
 	LCUI_WidgetStyle *style = &w->computed_style;
-	ASSIGN(ctx, LCUI_FlexBoxLayoutContext);
 
 	if (rule == LCUI_LAYOUT_RULE_AUTO) {
 		ctx->is_initiative = TRUE;
@@ -165,6 +223,8 @@ static LCUI_FlexBoxLayoutContext FlexBoxLayout_Begin(LCUI_Widget w,
 		  ctx->is_initiative);
 	ctx->rule = rule;
 	ctx->line = NULL;
+	ctx->lines = NULL;
+	ctx->lines_count = 0;
 	ctx->widget = w;
 	if (style->flex.direction == SV_COLUMN) {
 		ctx->main_axis = w->padding.left;
@@ -175,24 +235,30 @@ static LCUI_FlexBoxLayoutContext FlexBoxLayout_Begin(LCUI_Widget w,
 	}
 	ctx->main_size = 0;
 	ctx->cross_size = 0;
-	LinkedList_Init(&ctx->free_elements);
-	LinkedList_Init(&ctx->lines);
 	FlexBoxLayout_NextLine(ctx);
-	return ctx;
 }
 
 static void FlexBoxLayout_End(LCUI_FlexBoxLayoutContext ctx)
 {
-	LinkedList_Clear(&ctx->lines, FlexBoxLine_Destroy);
-	LinkedList_Clear(&ctx->free_elements, NULL);
-	free(ctx);
+	LCUI_FlexBoxLine line, next;
+
+	for (line = ctx->lines; line; line = next) {
+		next = line->next;
+		FlexBoxLine_Destroy(line);
+		if (line != &ctx->first_line) {
+			free(line);
+		}
+	}
+	ctx->lines = NULL;
+	ctx->line = NULL;
+	ctx->lines_count = 0;
 }
 
 static void FlexBoxLayout_LoadRows(LCUI_FlexBoxLayoutContext ctx)
 {
 	LCUI_Widget child;
 	LCUI_FlexBoxLayoutStyle *flex = &ctx->widget->computed_style.flex;
-	LinkedListNode *node;
+	size_t i;
 
 	float basis;
 	float max_main_size = -1;
@@ -202,13 +268,11 @@ static void FlexBoxLayout_LoadRows(LCUI_FlexBoxLayoutContext ctx)
 		max_main_size = ctx->widget->box.content.width;
 	}
 	DEBUG_MSG("%s, max_main_size: %g\n", ctx->widget->id, max_main_size);
-	for (LinkedList_Each(node, &ctx->widget->children)) {
-		child = node->data;
+	for (Widget_EachChild(i, child, ctx->widget)) {
 		if (child->computed_style.display == SV_NONE) {
 			continue;
 		}
 		if (Widget_HasAbsolutePosition(child)) {
-			LinkedList_Append(&ctx->free_elements, child);
 			continue;
 		}
 		/* Clears the auto margin calculated on the last layout */
@@ -225,10 +289,10 @@ static void FlexBoxLayout_LoadRows(LCUI_FlexBoxLayoutContext ctx)
 		Widget_ComputeFlexBasisStyle(child);
 		basis = MarginX(child) + child->computed_style.flex.basis;
 		DEBUG_MSG("[line %lu][%lu] main_size: %g, basis: %g\n",
-			  ctx->lines.length, child->index, ctx->line->main_size,
+			  ctx->lines_count, child->cached_index, ctx->line->main_size,
 			  basis);
 		/* Check line wrap */
-		if (flex->wrap == SV_WRAP && ctx->line->elements.length > 0 &&
+		if (flex->wrap == SV_WRAP && ctx->line->length > 0 &&
 		    max_main_size != -1) {
 			if (ctx->line->main_size + basis - max_main_size >
 			    0.4f) {
@@ -257,7 +321,7 @@ static void FlexBoxLayout_LoadColumns(LCUI_FlexBoxLayoutContext ctx)
 {
 	LCUI_Widget child;
 	LCUI_FlexBoxLayoutStyle *flex = &ctx->widget->computed_style.flex;
-	LinkedListNode *node;
+	size_t i;
 
 	float basis;
 	float max_main_size = -1;
@@ -267,22 +331,19 @@ static void FlexBoxLayout_LoadColumns(LCUI_FlexBoxLayoutContext ctx)
 		max_main_size = ctx->widget->box.content.height;
 	}
 	DEBUG_MSG("max_main_size: %g\n", max_main_size);
-	for (LinkedList_Each(node, &ctx->widget->children)) {
-		child = node->data;
-
+	for (Widget_EachChild(i, child, ctx->widget)) {
 		if (child->computed_style.display == SV_NONE) {
 			continue;
 		}
 		if (Widget_HasAbsolutePosition(child)) {
-			LinkedList_Append(&ctx->free_elements, child);
 			continue;
 		}
 		Widget_ComputeFlexBasisStyle(child);
 		basis = MarginY(child) + child->computed_style.flex.basis;
 		DEBUG_MSG("[column %lu][%lu] main_size: %g, basis: %g\n",
-			  ctx->lines.length, child->index, ctx->line->main_size,
+			  ctx->lines_count, child->cached_index, ctx->line->main_size,
 			  basis);
-		if (flex->wrap == SV_WRAP && ctx->line->elements.length > 0 &&
+		if (flex->wrap == SV_WRAP && ctx->line->length > 0 &&
 		    max_main_size != -1) {
 			if (ctx->line->main_size + basis - max_main_size >
 			    0.4f) {
@@ -328,17 +389,17 @@ static void FlexBoxLayout_ComputeJustifyContent(LCUI_FlexBoxLayoutContext ctx,
 	free_space -= ctx->line->main_size;
 	switch (ctx->widget->computed_style.flex.justify_content) {
 	case SV_SPACE_BETWEEN:
-		if (ctx->line->elements.length > 1) {
-			*space = free_space / (ctx->line->elements.length - 1);
+		if (ctx->line->length > 1) {
+			*space = free_space / (ctx->line->length - 1);
 		}
 		*start_axis -= *space;
 		break;
 	case SV_SPACE_AROUND:
-		*space = free_space / ctx->line->elements.length;
+		*space = free_space / ctx->line->length;
 		*start_axis -= *space * 0.5f;
 		break;
 	case SV_SPACE_EVENLY:
-		*space = free_space / (ctx->line->elements.length + 1);
+		*space = free_space / (ctx->line->length + 1);
 		*start_axis += *space;
 		break;
 	case SV_RIGHT:
@@ -391,7 +452,7 @@ static void FlexBoxLayout_ReflowRow(LCUI_FlexBoxLayoutContext ctx)
 
 	LCUI_Widget w;
 	LCUI_FlexBoxLayoutStyle *flex;
-	LinkedListNode *node;
+	size_t i;
 
 	free_space = ctx->widget->box.content.width - ctx->line->main_size;
 	if (free_space >= 0) {
@@ -404,8 +465,8 @@ static void FlexBoxLayout_ReflowRow(LCUI_FlexBoxLayoutContext ctx)
 
 	/* flex-grow and flex-shrink */
 	DEBUG_MSG("%s, free_space: %g\n", ctx->widget->id, free_space);
-	for (LinkedList_Each(node, &ctx->line->elements)) {
-		w = node->data;
+	for (i = 0; i < ctx->line->length; ++i) {
+		w = ctx->line->elements[i];
 		flex = &w->computed_style.flex;
 		if (w->computed_style.height_sizing != LCUI_SIZING_RULE_FIXED) {
 			Widget_ComputeHeightStyle(w);
@@ -437,8 +498,8 @@ static void FlexBoxLayout_ReflowRow(LCUI_FlexBoxLayoutContext ctx)
 	if (free_space > 0 && ctx->line->count_of_auto_margin_items > 0) {
 		main_axis = 0;
 		k = free_space / ctx->line->count_of_auto_margin_items;
-		for (LinkedList_Each(node, &ctx->line->elements)) {
-			w = node->data;
+		for (i = 0; i < ctx->line->length; ++i) {
+			w = ctx->line->elements[i];
 			if (Widget_HasAutoStyle(w, key_margin_left)) {
 				w->margin.left = k;
 				Widget_UpdateBoxSize(w);
@@ -457,8 +518,8 @@ static void FlexBoxLayout_ReflowRow(LCUI_FlexBoxLayoutContext ctx)
 
 	main_axis = ctx->widget->padding.left;
 	FlexBoxLayout_ComputeJustifyContent(ctx, &main_axis, &space);
-	for (LinkedList_Each(node, &ctx->line->elements)) {
-		w = node->data;
+	for (i = 0; i < ctx->line->length; ++i) {
+		w = ctx->line->elements[i];
 		main_axis += space;
 		w->layout_x = main_axis;
 		Widget_UpdateBoxPosition(w);
@@ -476,7 +537,7 @@ static void FlexBoxLayout_ReflowColumn(LCUI_FlexBoxLayoutContext ctx)
 
 	LCUI_Widget w;
 	LCUI_FlexBoxLayoutStyle *flex;
-	LinkedListNode *node;
+	size_t i;
 
 	free_space = ctx->widget->box.content.height - ctx->line->main_size;
 	if (free_space >= 0) {
@@ -487,8 +548,8 @@ static void FlexBoxLayout_ReflowColumn(LCUI_FlexBoxLayoutContext ctx)
 
 	/* flex-grow and flex-shrink */
 
-	for (LinkedList_Each(node, &ctx->line->elements)) {
-		w = node->data;
+	for (i = 0; i < ctx->line->length; ++i) {
+		w = ctx->line->elements[i];
 		flex = &w->computed_style.flex;
 		if (w->computed_style.width_sizing != LCUI_SIZING_RULE_FIXED) {
 			Widget_ComputeWidthStyle(w);
@@ -519,8 +580,8 @@ static void FlexBoxLayout_ReflowColumn(LCUI_FlexBoxLayoutContext ctx)
 	if (free_space > 0 && ctx->line->count_of_auto_margin_items > 0) {
 		main_axis = 0;
 		k = free_space / ctx->line->count_of_auto_margin_items;
-		for (LinkedList_Each(node, &ctx->line->elements)) {
-			w = node->data;
+		for (i = 0; i < ctx->line->length; ++i) {
+			w = ctx->line->elements[i];
 			if (Widget_HasAutoStyle(w, key_margin_top)) {
 				w->margin.top = k;
 				Widget_UpdateBoxSize(w);
@@ -538,8 +599,8 @@ static void FlexBoxLayout_ReflowColumn(LCUI_FlexBoxLayoutContext ctx)
 
 	main_axis = ctx->widget->padding.top;
 	FlexBoxLayout_ComputeJustifyContent(ctx, &main_axis, &space);
-	for (LinkedList_Each(node, &ctx->line->elements)) {
-		w = node->data;
+	for (i = 0; i < ctx->line->length; ++i) {
+		w = ctx->line->elements[i];
 		main_axis += space;
 		w->layout_y = main_axis;
 		Widget_UpdateBoxPosition(w);
@@ -551,12 +612,12 @@ static void FlexBoxLayout_ReflowColumn(LCUI_FlexBoxLayoutContext ctx)
 static void FlexBoxLayout_AlignItemsCenter(LCUI_FlexBoxLayoutContext ctx,
 					   float base_cross_axis)
 {
-	LinkedListNode *node;
+	size_t i;
 	LCUI_Widget child;
 
 	if (ctx->widget->computed_style.flex.direction == SV_COLUMN) {
-		for (LinkedList_Each(node, &ctx->line->elements)) {
-			child = node->data;
+		for (i = 0; i < ctx->line->length; ++i) {
+			child = ctx->line->elements[i];
 			child->layout_x =
 			    base_cross_axis +
 			    (ctx->line->cross_size - child->box.outer.width) *
@@ -565,8 +626,8 @@ static void FlexBoxLayout_AlignItemsCenter(LCUI_FlexBoxLayoutContext ctx,
 		}
 		return;
 	}
-	for (LinkedList_Each(node, &ctx->line->elements)) {
-		child = node->data;
+	for (i = 0; i < ctx->line->length; ++i) {
+		child = ctx->line->elements[i];
 		child->layout_y =
 		    base_cross_axis +
 		    (ctx->line->cross_size - child->box.outer.height) * 0.5f;
@@ -577,12 +638,12 @@ static void FlexBoxLayout_AlignItemsCenter(LCUI_FlexBoxLayoutContext ctx,
 static void FlexBoxLayout_AlignItemsStretch(LCUI_FlexBoxLayoutContext ctx,
 					    float base_cross_axis)
 {
-	LinkedListNode *node;
+	size_t i;
 	LCUI_Widget child;
 
 	if (ctx->widget->computed_style.flex.direction == SV_COLUMN) {
-		for (LinkedList_Each(node, &ctx->line->elements)) {
-			child = node->data;
+		for (i = 0; i < ctx->line->length; ++i) {
+			child = ctx->line->elements[i];
 			child->layout_x = base_cross_axis;
 			if (Widget_HasAutoStyle(child, key_width)) {
 				child->width =
@@ -594,8 +655,8 @@ static void FlexBoxLayout_AlignItemsStretch(LCUI_FlexBoxLayoutContext ctx,
 		}
 		return;
 	}
-	for (LinkedList_Each(node, &ctx->line->elements)) {
-		child = node->data;
+	for (i = 0; i < ctx->line->length; ++i) {
+		child = ctx->line->elements[i];
 		child->layout_y = base_cross_axis;
 		if (Widget_HasAutoStyle(child, key_height)) {
 			child->height = ctx->line->cross_size - MarginY(child);
@@ -608,19 +669,19 @@ static void FlexBoxLayout_AlignItemsStretch(LCUI_FlexBoxLayoutContext ctx,
 static void FlexBoxLayout_AlignItemsStart(LCUI_FlexBoxLayoutContext ctx,
 					  float base_cross_axis)
 {
-	LinkedListNode *node;
+	size_t i;
 	LCUI_Widget child;
 
 	if (ctx->widget->computed_style.flex.direction == SV_COLUMN) {
-		for (LinkedList_Each(node, &ctx->line->elements)) {
-			child = node->data;
+		for (i = 0; i < ctx->line->length; ++i) {
+			child = ctx->line->elements[i];
 			child->layout_x = base_cross_axis;
 			Widget_UpdateBoxPosition(child);
 		}
 		return;
 	}
-	for (LinkedList_Each(node, &ctx->line->elements)) {
-		child = node->data;
+	for (i = 0; i < ctx->line->length; ++i) {
+		child = ctx->line->elements[i];
 		child->layout_y = base_cross_axis;
 		Widget_UpdateBoxPosition(child);
 	}
@@ -629,12 +690,12 @@ static void FlexBoxLayout_AlignItemsStart(LCUI_FlexBoxLayoutContext ctx,
 static void FlexBoxLayout_AlignItemsEnd(LCUI_FlexBoxLayoutContext ctx,
 					float base_cross_axis)
 {
-	LinkedListNode *node;
+	size_t i;
 	LCUI_Widget child;
 
 	if (ctx->widget->computed_style.flex.direction == SV_COLUMN) {
-		for (LinkedList_Each(node, &ctx->line->elements)) {
-			child = node->data;
+		for (i = 0; i < ctx->line->length; ++i) {
+			child = ctx->line->elements[i];
 			child->layout_x = base_cross_axis +
 					  ctx->line->cross_size -
 					  child->box.outer.width;
@@ -642,8 +703,8 @@ static void FlexBoxLayout_AlignItemsEnd(LCUI_FlexBoxLayoutContext ctx,
 		}
 		return;
 	}
-	for (LinkedList_Each(node, &ctx->line->elements)) {
-		child = node->data;
+	for (i = 0; i < ctx->line->length; ++i) {
+		child = ctx->line->elements[i];
 		child->layout_y = base_cross_axis + ctx->line->cross_size -
 				  child->box.outer.height;
 		Widget_UpdateBoxPosition(child);
@@ -656,7 +717,6 @@ static void FlexBoxLayout_AlignItems(LCUI_FlexBoxLayoutContext ctx)
 	float free_space = 0;
 
 	LCUI_Widget w = ctx->widget;
-	LinkedListNode *node;
 
 	if (w->computed_style.flex.direction == SV_COLUMN) {
 		cross_axis = w->padding.left;
@@ -668,9 +728,8 @@ static void FlexBoxLayout_AlignItems(LCUI_FlexBoxLayoutContext ctx)
 	if (free_space < 0) {
 		free_space = 0;
 	}
-	for (LinkedList_Each(node, &ctx->lines)) {
-		ctx->line = node->data;
-		ctx->line->cross_size += free_space / ctx->lines.length;
+	for (ctx->line = ctx->lines; ctx->line; ctx->line = ctx->line->next) {
+		ctx->line->cross_size += free_space / ctx->lines_count;
 		switch (w->computed_style.flex.align_items) {
 		case SV_CENTER:
 			FlexBoxLayout_AlignItemsCenter(ctx, cross_axis);
@@ -699,11 +758,9 @@ static void FlexBoxLayout_AlignItems(LCUI_FlexBoxLayoutContext ctx)
 static void FlexBoxLayout_Reflow(LCUI_FlexBoxLayoutContext ctx)
 {
 	LCUI_Widget w = ctx->widget;
-	LinkedListNode *node;
 
 	DEBUG_MSG("widget: %s, start\n", w->id);
-	for (LinkedList_Each(node, &ctx->lines)) {
-		ctx->line = node->data;
+	for (ctx->line = ctx->lines; ctx->line; ctx->line = ctx->line->next) {
 		if (w->computed_style.flex.direction == SV_COLUMN) {
 			FlexBoxLayout_ReflowColumn(ctx);
 		} else {
@@ -716,9 +773,14 @@ static void FlexBoxLayout_Reflow(LCUI_FlexBoxLayoutContext ctx)
 
 static void FlexBoxLayout_ReflowFreeElements(LCUI_FlexBoxLayoutContext ctx)
 {
-	LinkedListNode *node;
-	for (LinkedList_Each(node, &ctx->free_elements)) {
-		Widget_AutoReflow(node->data, LCUI_LAYOUT_RULE_FIXED);
+	LCUI_Widget child;
+	size_t i;
+
+	for (Widget_EachChild(i, child, ctx->widget)) {
+		if (child->computed_style.display != SV_NONE &&
+		    Widget_HasAbsolutePosition(child)) {
+			Widget_AutoReflow(child, LCUI_LAYOUT_RULE_FIXED);
+		}
 	}
 }
 
@@ -800,12 +862,12 @@ static void FlexBoxLayout_ApplySize(LCUI_FlexBoxLayoutContext ctx)
 
 void LCUIFlexBoxLayout_Reflow(LCUI_Widget w, LCUI_LayoutRule rule)
 {
-	LCUI_FlexBoxLayoutContext ctx;
-
-	ctx = FlexBoxLayout_Begin(w, rule);
-	FlexBoxLayout_Load(ctx);
-	FlexBoxLayout_ApplySize(ctx);
-	FlexBoxLayout_Reflow(ctx);
-	FlexBoxLayout_ReflowFreeElements(ctx);
-	FlexBoxLayout_End(ctx);
+	LCUI_FlexBoxLayoutContextRec ctx;
+
+	FlexBoxLayout_Begin(&ctx, w, rule);
+	FlexBoxLayout_Load(&ctx);
+	FlexBoxLayout_ApplySize(&ctx);
+	FlexBoxLayout_Reflow(&ctx);
+	FlexBoxLayout_ReflowFreeElements(&ctx);
+	FlexBoxLayout_End(&ctx);
 }
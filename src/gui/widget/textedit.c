@@ -58,6 +58,15 @@ typedef struct LCUI_TextEditRec_ {
 	LCUI_TextLayer layer_mask;        /**< 屏蔽后的文本层 */
 	LCUI_TextLayer layer_placeholder; /**< 占位符的文本层 */
 	LCUI_TextLayer layer;             /**< 当前使用的文本层 */
+	LCUI_TextBuffer buffer;           /**< 文本内容及编辑历史 */
+
+	/**
+	 * A paragraph of the source layer whose offset in the text buffer is
+	 * known, the caret offset is counted from it
+	 */
+	int anchor_row;
+	size_t anchor_offset;
+
 	LCUI_ObjectWatcher value_watcher;
 	LCUI_Widget scrollbars[2];      /**< 两个滚动条 */
 	LCUI_Widget caret;              /**< 文本插入符 */
@@ -71,6 +80,7 @@ typedef struct LCUI_TextEditRec_ {
 	LinkedList text_tags;           /**< 当前处理的标签列表 */
 	LCUI_BOOL tasks[TASK_TOTAL];    /**< 待处理的任务 */
 	LCUI_Mutex mutex;               /**< 互斥锁 */
+	int bitmaps_ready_handler_id;   /**< 字体位图预渲染完成事件的处理器 */
 } LCUI_TextEditRec, *LCUI_TextEdit;
 
 typedef enum {
@@ -214,6 +224,187 @@ static void TextBlock_OnDestroy(void *arg)
 	free(blk);
 }
 
+/** Get the number of characters of a text row in the text buffer */
+static size_t TextEdit_GetRowLength(LCUI_TextRow txtrow)
+{
+	switch (txtrow->eol) {
+	case LCUI_EOL_NONE:
+		return txtrow->length;
+	case LCUI_EOL_CR_LF:
+		return txtrow->length + 2;
+	default:
+		break;
+	}
+	return txtrow->length + 1;
+}
+
+/**
+ * Move the anchor to the first row of the paragraph containing the row
+ * Editing or typesetting the source layer never changes the rows before the
+ * paragraph where it starts, so the anchor stays valid as long as it is kept
+ * before that paragraph.
+ */
+static void TextEdit_MoveAnchor(LCUI_TextEdit edit, int row)
+{
+	LCUI_TextRowList rows = &edit->layer_source->text_rows;
+
+	if (edit->anchor_row >= rows->length) {
+		edit->anchor_row = 0;
+		edit->anchor_offset = 0;
+	}
+	if (row >= rows->length) {
+		row = rows->length - 1;
+	}
+	while (row > 0 && rows->rows[row - 1]->eol == LCUI_EOL_NONE) {
+		--row;
+	}
+	while (edit->anchor_row < row) {
+		edit->anchor_offset +=
+		    TextEdit_GetRowLength(rows->rows[edit->anchor_row]);
+		++edit->anchor_row;
+	}
+	while (edit->anchor_row > row && edit->anchor_row > 0) {
+		--edit->anchor_row;
+		edit->anchor_offset -=
+		    TextEdit_GetRowLength(rows->rows[edit->anchor_row]);
+	}
+}
+
+/** Keep the anchor before the source layer is changed from the row */
+static void TextEdit_KeepAnchorBefore(LCUI_TextEdit edit, int row)
+{
+	if (edit->anchor_row > row) {
+		TextEdit_MoveAnchor(edit, row);
+	}
+}
+
+/** Get the offset of the caret of the source layer in the text buffer */
+static size_t TextEdit_GetCaretOffset(LCUI_TextEdit edit)
+{
+	int row;
+	size_t offset;
+	LCUI_TextLayer layer = edit->layer_source;
+
+	TextEdit_MoveAnchor(edit, layer->insert_y);
+	offset = edit->anchor_offset;
+	for (row = edit->anchor_row;
+	     row < layer->insert_y && row < layer->text_rows.length; ++row) {
+		offset += TextEdit_GetRowLength(layer->text_rows.rows[row]);
+	}
+	return offset + layer->insert_x;
+}
+
+/** Set the caret by the offset in the text buffer counted from the row */
+static void TextEdit_SetLayerCaret(LCUI_TextLayer layer, int row,
+				   size_t offset)
+{
+	size_t len;
+	LCUI_TextRow txtrow;
+
+	for (; row < layer->text_rows.length; ++row) {
+		txtrow = layer->text_rows.rows[row];
+		if (offset <= (size_t)txtrow->length) {
+			break;
+		}
+		len = TextEdit_GetRowLength(txtrow);
+		/* The offset is inside "\r\n" */
+		if (offset < len) {
+			offset = txtrow->length;
+			break;
+		}
+		offset -= len;
+	}
+	TextLayer_SetCaretPos(layer, row, (int)offset);
+}
+
+/** Set the caret of the source layer by the offset in the text buffer */
+static void TextEdit_SetCaretOffset(LCUI_TextEdit edit, size_t offset)
+{
+	TextEdit_MoveAnchor(edit, edit->anchor_row);
+	while (edit->anchor_row > 0 && edit->anchor_offset > offset) {
+		TextEdit_MoveAnchor(edit, edit->anchor_row - 1);
+	}
+	TextEdit_SetLayerCaret(edit->layer_source, edit->anchor_row,
+			       offset - edit->anchor_offset);
+}
+
+/**
+ * Get the number of characters of the layer after the caret, which are
+ * len characters in the text buffer
+ * A line break is one character in the layer, but "\r\n" is two characters
+ * in the text buffer.
+ */
+static int TextEdit_GetLayerLength(LCUI_TextLayer layer, size_t len)
+{
+	int n = 0;
+	int row = layer->insert_y;
+	size_t col = layer->insert_x;
+	size_t eol_len;
+	LCUI_TextRow txtrow;
+
+	for (; row < layer->text_rows.length && len > 0; ++row, col = 0) {
+		txtrow = layer->text_rows.rows[row];
+		if (txtrow->length - col >= len) {
+			return n + (int)len;
+		}
+		n += (int)(txtrow->length - col);
+		len -= txtrow->length - col;
+		eol_len = TextEdit_GetRowLength(txtrow) - txtrow->length;
+		if (eol_len > 0) {
+			n += 1;
+			len -= min(len, eol_len);
+		}
+	}
+	return n;
+}
+
+/** Keep the anchor before the rows which will be typeset */
+static void TextEdit_UpdateAnchor(LCUI_TextEdit edit)
+{
+	LCUI_TextLayer layer = edit->layer_source;
+
+	if (layer->task.update_typeset) {
+		TextEdit_KeepAnchorBefore(edit, layer->task.typeset_start_row);
+	}
+}
+
+/** Get the number of characters in the buffer removed by backspace */
+static size_t TextEdit_GetBackspaceLength(LCUI_TextLayer layer)
+{
+	LCUI_TextRow txtrow;
+
+	if (layer->insert_x > 0) {
+		return 1;
+	}
+	if (layer->insert_y < 1) {
+		return 0;
+	}
+	txtrow = layer->text_rows.rows[layer->insert_y - 1];
+	return txtrow->eol == LCUI_EOL_CR_LF ? 2 : 1;
+}
+
+/** Get the number of characters in the buffer removed by delete */
+static size_t TextEdit_GetDeleteLength(LCUI_TextLayer layer)
+{
+	LCUI_TextRow txtrow;
+
+	if (layer->insert_y >= layer->text_rows.length) {
+		return 0;
+	}
+	txtrow = layer->text_rows.rows[layer->insert_y];
+	if (layer->insert_x < txtrow->length) {
+		return 1;
+	}
+	if (txtrow->eol == LCUI_EOL_CR_LF) {
+		return 2;
+	}
+	if (txtrow->eol != LCUI_EOL_NONE ||
+	    layer->insert_y < layer->text_rows.length - 1) {
+		return 1;
+	}
+	return 0;
+}
+
 static int TextEdit_AddTextBlock(LCUI_Widget widget, const wchar_t *wtext,
 				 TextBlockAction action, TextBlockOwner owner)
 {
@@ -294,6 +485,46 @@ static int TextEdit_AddTextBlock(LCUI_Widget widget, const wchar_t *wtext,
 	return 0;
 }
 
+/**
+ * Add the text of the source blocks to the text buffer
+ * A long text is split into several blocks, they are added as one edit so
+ * that it can be undone at once.
+ */
+static void TextEdit_CommitTextBlocks(LCUI_Widget widget,
+				      LinkedListNode *node)
+{
+	size_t pos, len;
+	wchar_t *text, *p;
+	LCUI_TextBlock block = node->data;
+	LCUI_TextEdit edit = GetData(widget);
+	LinkedListNode *next;
+
+	if (block->action == TEXT_BLOCK_ACTION_APPEND) {
+		pos = TextBuffer_GetLength(edit->buffer);
+	} else {
+		pos = TextEdit_GetCaretOffset(edit);
+	}
+	len = block->length;
+	for (next = node->next; next; next = next->next) {
+		block = next->data;
+		if (block->type == TEXT_BLOCK_BEGIN) {
+			break;
+		}
+		len += block->length;
+	}
+	text = malloc(sizeof(wchar_t) * (len + 1));
+	if (!text) {
+		return;
+	}
+	for (p = text; node != next; node = node->next) {
+		block = node->data;
+		wmemcpy(p, block->text, block->length);
+		p += block->length;
+	}
+	TextBuffer_Insert(edit->buffer, pos, text, len);
+	free(text);
+}
+
 /** 更新文本框内的字体位图 */
 static void TextEdit_ProcTextBlock(LCUI_Widget widget, LCUI_TextBlock txtblk)
 {
@@ -306,6 +537,12 @@ static void TextEdit_ProcTextBlock(LCUI_Widget widget, LCUI_TextBlock txtblk)
 	case TEXT_BLOCK_OWNER_SOURCE:
 		layer = edit->layer_source;
 		tags = &edit->text_tags;
+		if (txtblk->action == TEXT_BLOCK_ACTION_APPEND) {
+			TextEdit_KeepAnchorBefore(edit,
+						  layer->text_rows.length - 1);
+		} else {
+			TextEdit_KeepAnchorBefore(edit, layer->insert_y);
+		}
 		break;
 	case TEXT_BLOCK_OWNER_PLACEHOLDER:
 		layer = edit->layer_placeholder;
@@ -360,6 +597,7 @@ static void TextEdit_UpdateTextLayer(LCUI_Widget w)
 	style.fore_color = PLACEHOLDER_COLOR;
 	TextLayer_SetTextStyle(edit->layer_placeholder, &style);
 	TextStyle_Destroy(&style);
+	TextEdit_UpdateAnchor(edit);
 	TextLayer_Update(edit->layer, &rects);
 	for (LinkedList_Each(node, &rects)) {
 		LCUIRect_ToRectF(node->data, &rect, 1.0f / scale);
@@ -376,6 +614,7 @@ static void TextEdit_OnTask(LCUI_Widget widget, int task)
 	if (edit->tasks[TASK_SET_TEXT]) {
 		LinkedList blocks;
 		LinkedListNode *node;
+		LCUI_TextBlock block;
 		LCUI_WidgetEventRec ev;
 
 		LinkedList_Init(&blocks);
@@ -383,7 +622,12 @@ static void TextEdit_OnTask(LCUI_Widget widget, int task)
 		LinkedList_Concat(&blocks, &edit->text_blocks);
 		LCUIMutex_Unlock(&edit->mutex);
 		for (LinkedList_Each(node, &blocks)) {
-			TextEdit_ProcTextBlock(widget, node->data);
+			block = node->data;
+			if (block->owner == TEXT_BLOCK_OWNER_SOURCE &&
+			    block->type == TEXT_BLOCK_BEGIN) {
+				TextEdit_CommitTextBlocks(widget, node);
+			}
+			TextEdit_ProcTextBlock(widget, block);
 		}
 		TextBlocks_Clear(&blocks);
 		LCUI_InitWidgetEvent(&ev, "change");
@@ -424,6 +668,7 @@ static void TextEdit_OnResize(LCUI_Widget w, float width, float height)
 	LinkedList_Init(&rects);
 	TextLayer_SetFixedSize(edit->layer, (int)(width * scale), (int)(width * scale));
 	TextLayer_SetMaxSize(edit->layer, (int)(height * scale), (int)(height * scale));
+	TextEdit_UpdateAnchor(edit);
 	TextLayer_Update(edit->layer, &rects);
 	TextLayer_ClearInvalidRect(edit->layer);
 	for (LinkedList_Each(node, &rects)) {
@@ -518,6 +763,9 @@ void TextEdit_ClearText(LCUI_Widget widget)
 		}
 	}
 	TextLayer_ClearText(edit->layer_source);
+	edit->anchor_row = 0;
+	edit->anchor_offset = 0;
+	TextBuffer_Clear(edit->buffer);
 	StyleTags_Clear(&edit->text_tags);
 	edit->tasks[TASK_UPDATE] = TRUE;
 	Widget_AddTask(widget, LCUI_WTASK_USER);
@@ -529,13 +777,13 @@ size_t TextEdit_GetTextW(LCUI_Widget w, size_t start, size_t max_len,
 			 wchar_t *buf)
 {
 	LCUI_TextEdit edit = GetData(w);
-	return TextLayer_GetTextW(edit->layer_source, start, max_len, buf);
+	return TextBuffer_GetText(edit->buffer, start, max_len, buf);
 }
 
 size_t TextEdit_GetTextLength(LCUI_Widget w)
 {
 	LCUI_TextEdit edit = GetData(w);
-	return edit->layer_source->length;
+	return TextBuffer_GetLength(edit->buffer);
 }
 
 LCUI_Object TextEdit_GetProperty(LCUI_Widget w, const char *name)
@@ -678,14 +926,29 @@ static void TextEdit_OnBlur(LCUI_Widget widget, LCUI_WidgetEvent e, void *arg)
 
 static void TextEdit_TextBackspace(LCUI_Widget widget, int n_ch)
 {
+	size_t pos, len;
 	LCUI_TextEdit edit;
 	LCUI_WidgetEventRec ev;
 
 	edit = Widget_GetData(widget, self.prototype);
 	LCUIMutex_Lock(&edit->mutex);
-	TextLayer_TextBackspace(edit->layer_source, n_ch);
-	if (edit->password_char) {
-		TextLayer_TextBackspace(edit->layer_mask, n_ch);
+	for (; n_ch > 0; --n_ch) {
+		len = TextEdit_GetBackspaceLength(edit->layer_source);
+		if (len < 1) {
+			break;
+		}
+		pos = TextEdit_GetCaretOffset(edit);
+		if (TextBuffer_Delete(edit->buffer, pos - len, len) != 0) {
+			break;
+		}
+		/* Backspace at the start of a row removes the line break of
+		 * the previous row */
+		TextEdit_KeepAnchorBefore(edit,
+					  edit->layer_source->insert_y - 1);
+		TextLayer_TextBackspace(edit->layer_source, 1);
+		if (edit->password_char) {
+			TextLayer_TextBackspace(edit->layer_mask, 1);
+		}
 	}
 	TextCaret_Refresh(edit->caret);
 	edit->tasks[TASK_UPDATE] = TRUE;
@@ -697,21 +960,119 @@ static void TextEdit_TextBackspace(LCUI_Widget widget, int n_ch)
 
 static void TextEdit_TextDelete(LCUI_Widget widget, int n_ch)
 {
+	size_t pos, len;
+	LCUI_TextEdit edit;
+	LCUI_WidgetEventRec ev;
+
+	edit = Widget_GetData(widget, self.prototype);
+	LCUIMutex_Lock(&edit->mutex);
+	for (; n_ch > 0; --n_ch) {
+		len = TextEdit_GetDeleteLength(edit->layer_source);
+		if (len < 1) {
+			break;
+		}
+		pos = TextEdit_GetCaretOffset(edit);
+		if (TextBuffer_Delete(edit->buffer, pos, len) != 0) {
+			break;
+		}
+		TextLayer_TextDelete(edit->layer_source, 1);
+		if (edit->password_char) {
+			TextLayer_TextDelete(edit->layer_mask, 1);
+		}
+	}
+	TextCaret_Refresh(edit->caret);
+	edit->tasks[TASK_UPDATE] = TRUE;
+	Widget_AddTask(widget, LCUI_WTASK_USER);
+	LCUIMutex_Unlock(&edit->mutex);
+	LCUI_InitWidgetEvent(&ev, "change");
+	Widget_TriggerEvent(widget, &ev, NULL);
+}
+
+/**
+ * Apply a change of the text buffer to the text layers
+ * Only the changed text is deleted and inserted, so the style tags and the
+ * rows outside the change are kept.
+ */
+static int TextEdit_ApplyChange(LCUI_Widget widget, LCUI_TextChange change)
+{
+	wchar_t *text = NULL;
 	LCUI_TextEdit edit;
 	LCUI_WidgetEventRec ev;
 
 	edit = Widget_GetData(widget, self.prototype);
+	if (change->inserted > 0) {
+		text = malloc(sizeof(wchar_t) * (change->inserted + 1));
+		if (!text) {
+			return -ENOMEM;
+		}
+		TextBuffer_GetText(edit->buffer, change->start,
+				   change->inserted, text);
+		text[change->inserted] = 0;
+	}
 	LCUIMutex_Lock(&edit->mutex);
-	TextLayer_TextDelete(edit->layer_source, n_ch);
+	TextEdit_SetCaretOffset(edit, change->start);
+	TextEdit_KeepAnchorBefore(edit, edit->layer_source->insert_y);
+	if (change->deleted > 0) {
+		TextLayer_TextDelete(
+		    edit->layer_source,
+		    TextEdit_GetLayerLength(edit->layer_source,
+					    change->deleted));
+	}
+	if (text) {
+		TextLayer_InsertTextW(edit->layer_source, text,
+				      &edit->text_tags);
+	}
 	if (edit->password_char) {
-		TextLayer_TextDelete(edit->layer_mask, n_ch);
+		TextEdit_SetLayerCaret(edit->layer_mask, 0, change->start);
+		if (change->deleted > 0) {
+			TextLayer_TextDelete(
+			    edit->layer_mask,
+			    TextEdit_GetLayerLength(edit->layer_mask,
+						    change->deleted));
+		}
+		if (text) {
+			fillchar(text, edit->password_char);
+			TextLayer_InsertTextW(edit->layer_mask, text, NULL);
+		}
 	}
 	TextCaret_Refresh(edit->caret);
 	edit->tasks[TASK_UPDATE] = TRUE;
 	Widget_AddTask(widget, LCUI_WTASK_USER);
 	LCUIMutex_Unlock(&edit->mutex);
+	free(text);
 	LCUI_InitWidgetEvent(&ev, "change");
 	Widget_TriggerEvent(widget, &ev, NULL);
+	return 0;
+}
+
+int TextEdit_Undo(LCUI_Widget w)
+{
+	LCUI_TextChangeRec change;
+	LCUI_TextEdit edit = GetData(w);
+
+	if (TextBuffer_Undo(edit->buffer, &change) != 0) {
+		return -1;
+	}
+	if (TextEdit_ApplyChange(w, &change) != 0) {
+		TextBuffer_Redo(edit->buffer, &change);
+		return -ENOMEM;
+	}
+	return 0;
+}
+
+int TextEdit_Redo(LCUI_Widget w)
+{
+	LCUI_TextChangeRec change;
+	LCUI_TextEdit edit = GetData(w);
+
+	if (TextBuffer_Redo(edit->buffer, &change) != 0) {
+		return -1;
+	}
+	if (TextEdit_ApplyChange(w, &change) != 0) {
+		TextBuffer_Undo(edit->buffer, &change);
+		return -ENOMEM;
+	}
+	return 0;
 }
 
 /** 处理按键事件 */
@@ -767,6 +1128,22 @@ static void TextEdit_OnKeyDown(LCUI_Widget widget, LCUI_WidgetEvent e,
 	case LCUI_KEY_DELETE:
 		TextEdit_TextDelete(widget, 1);
 		return;
+	case LCUI_KEY_Z:
+		if (!e->key.ctrl_key || edit->is_read_only) {
+			break;
+		}
+		if (e->key.shift_key) {
+			TextEdit_Redo(widget);
+		} else {
+			TextEdit_Undo(widget);
+		}
+		return;
+	case LCUI_KEY_Y:
+		if (!e->key.ctrl_key || edit->is_read_only) {
+			break;
+		}
+		TextEdit_Redo(widget);
+		return;
 	default:
 		break;
 	}
@@ -877,6 +1254,23 @@ static void TextEdit_SetAttr(LCUI_Widget w, const char *name, const char *val)
 	}
 }
 
+/** 重新排版使用了占位字体位图的文本 */
+static void TextEdit_OnFontBitmapsReady(LCUI_SysEvent e, void *arg)
+{
+	LCUI_Widget w = e->data;
+	LCUI_TextEdit edit = GetData(w);
+	LCUI_BOOL updated;
+
+	updated = TextLayer_UpdatePlaceholders(edit->layer_source);
+	updated = TextLayer_UpdatePlaceholders(edit->layer_mask) || updated;
+	updated =
+	    TextLayer_UpdatePlaceholders(edit->layer_placeholder) || updated;
+	if (updated) {
+		edit->tasks[TASK_UPDATE] = TRUE;
+		Widget_AddTask(w, LCUI_WTASK_USER);
+	}
+}
+
 static void TextEdit_OnInit(LCUI_Widget w)
 {
 	LCUI_TextEdit edit = AddData(w);
@@ -890,6 +1284,9 @@ static void TextEdit_OnInit(LCUI_Widget w)
 	edit->layer_source = TextLayer_New();
 	edit->layer_placeholder = TextLayer_New();
 	edit->layer = edit->layer_source;
+	edit->buffer = TextBuffer_New();
+	edit->anchor_row = 0;
+	edit->anchor_offset = 0;
 	edit->value_watcher = NULL;
 	edit->text_block_size = TEXT_BLOCK_SIZE;
 	edit->caret = LCUIWidget_New("textcaret");
@@ -912,16 +1309,20 @@ static void TextEdit_OnInit(LCUI_Widget w)
 	Widget_Hide(edit->caret);
 	LCUIMutex_Init(&edit->mutex);
 	CSSFontStyle_Init(&edit->style);
+	edit->bitmaps_ready_handler_id = LCUI_BindEvent(
+	    LCUI_FONT_BITMAPS_READY, TextEdit_OnFontBitmapsReady, w, NULL);
 }
 
 static void TextEdit_OnDestroy(LCUI_Widget widget)
 {
 	LCUI_TextEdit edit = GetData(widget);
 
+	LCUI_UnbindEvent(edit->bitmaps_ready_handler_id);
 	edit->layer = NULL;
 	TextLayer_Destroy(edit->layer_source);
 	TextLayer_Destroy(edit->layer_placeholder);
 	TextLayer_Destroy(edit->layer_mask);
+	TextBuffer_Destroy(edit->buffer);
 	CSSFontStyle_Destroy(&edit->style);
 	TextBlocks_Clear(&edit->text_blocks);
 	if (edit->value_watcher) {
@@ -991,6 +1392,11 @@ static void TextEdit_OnValueChanged(LCUI_Object value, void *arg)
 {
 	LCUI_Widget w = arg;
 
+	/* The notification may be deferred until the widget has been
+	 * destroyed, there is no need to update its content */
+	if (w->state == LCUI_WSTATE_DELETED) {
+		return;
+	}
 	if (value->type == LCUI_StringObject) {
 		TextEdit_SetText(w, value->value.string);
 	} else if (value->type == LCUI_WStringObject) {
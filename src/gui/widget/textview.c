@@ -63,6 +63,7 @@ typedef struct LCUI_TextViewRec_ {
 
 static struct LCUI_TextViewModule {
 	int key_word_break;
+	int bitmaps_ready_handler_id;
 	LinkedList list;
 	LCUI_WidgetPrototype prototype;
 } self;
@@ -405,12 +406,29 @@ size_t LCUIWidget_RefreshTextView(void)
 	return count;
 }
 
+/** 重新排版使用了占位字体位图的文本 */
+static void TextView_OnFontBitmapsReady(LCUI_SysEvent e, void *arg)
+{
+	LCUI_TextView txt;
+	LinkedListNode *node;
+
+	for (LinkedList_Each(node, &self.list)) {
+		txt = node->data;
+		if (txt->widget->state != LCUI_WSTATE_DELETED &&
+		    TextLayer_UpdatePlaceholders(txt->layer)) {
+			TextView_Update(txt->widget);
+		}
+	}
+}
+
 static void TextVIew_OnTask(LCUI_Widget w, int task)
 {
 	LCUI_TextView txt;
 
 	txt = GetData(w);
 	if (txt->task.update_content) {
+		/* 新文本的字体位图在工作线程中渲染，排版时不必等待 */
+		TextLayer_PrepareBitmaps(txt->layer, txt->task.content);
 		TextLayer_SetTextW(txt->layer, txt->task.content, NULL);
 		TextView_Update(w);
 		free(txt->task.content);
@@ -444,9 +462,13 @@ void LCUIWidget_AddTextView(void)
 	self.prototype->runtask = TextVIew_OnTask;
 	LCUI_AddCSSPropertyParser(&parser);
 	LinkedList_Init(&self.list);
+	self.bitmaps_ready_handler_id = LCUI_BindEvent(
+	    LCUI_FONT_BITMAPS_READY, TextView_OnFontBitmapsReady, NULL, NULL);
 }
 
 void LCUIWidget_FreeTextView(void)
 {
+	LCUI_UnbindEvent(self.bitmaps_ready_handler_id);
+	self.bitmaps_ready_handler_id = -1;
 	LinkedList_ClearData(&self.list, NULL);
 }
@@ -34,16 +34,33 @@
 #include <LCUI_Build.h>
 #include <LCUI/LCUI.h>
 #include <LCUI/image.h>
+#include <LCUI/settings.h>
 #include <LCUI/gui/metrics.h>
 #include <LCUI/gui/widget.h>
 #include "widget_background.h"
 
 #define ComputeActual LCUIMetrics_ComputeActual
 
+/** the minimum interval (ms) to repaint a progressively loaded image */
+#define PROGRESSIVE_PAINT_INTERVAL 100
+
 typedef struct ImageCacheRec_ {
+	char *key;
 	char *path;
+	size_t size;
 	LCUI_Graph image;
+
+	/** widgets that use this image */
 	LinkedList refs;
+
+	/** whether the image is being decoded by the async worker */
+	LCUI_BOOL loading;
+
+	/** whether the image data can be quoted by widgets */
+	LCUI_BOOL ready;
+
+	/** the node in the LRU list, only linked when there are no refs */
+	LinkedListNode node;
 } ImageCacheRec, *ImageCache;
 
 typedef struct ImageRefRec_ {
@@ -51,13 +68,55 @@ typedef struct ImageRefRec_ {
 	ImageCache cache;
 } ImageRefRec, *ImageRef;
 
+typedef struct ImageLoaderRec_ {
+	int status;
+	unsigned width;
+	unsigned height;
+	LCUI_BOOL progressive;
+	int64_t paint_time;
+	ImageCache cache;
+} ImageLoaderRec, *ImageLoader;
+
 static struct LCUI_WidgetBackgroundModule {
 	LCUI_BOOL active;
 	DictType dtype;
 	Dict *images;
 	RBTree refs;
+
+	/** unreferenced images, the least recently used first */
+	LinkedList lru;
+
+	/** the maximum bytes of the decoded images to keep */
+	size_t cache_size;
+
+	int settings_change_handler_id;
+	LCUI_ImageCacheStatsRec stats;
 } self;
 
+static ImageCache CreateImageCache(const char *key, const char *path)
+{
+	ImageCache cache;
+
+	cache = NEW(ImageCacheRec, 1);
+	cache->key = strdup2(key);
+	cache->path = strdup2(path);
+	cache->loading = TRUE;
+	cache->node.data = cache;
+	Graph_Init(&cache->image);
+	LinkedList_Init(&cache->refs);
+	return cache;
+}
+
+static void FreeImageCache(ImageCache cache)
+{
+	Graph_Free(&cache->image);
+	free(cache->path);
+	free(cache->key);
+	cache->path = NULL;
+	cache->key = NULL;
+	free(cache);
+}
+
 static void DestroyImageCache(ImageCache cache)
 {
 	LinkedListNode *node;
@@ -68,10 +127,17 @@ static void DestroyImageCache(ImageCache cache)
 		Graph_Init(&w->computed_style.background.image);
 		LinkedList_DeleteNode(&cache->refs, node);
 	}
-	Graph_Free(&cache->image);
-	free(cache->path);
-	cache->path = NULL;
-	free(cache);
+	/* The async worker is still writing the image, it will be freed
+	 * after loading is complete */
+	if (cache->loading) {
+		return;
+	}
+	if (cache->node.prev) {
+		LinkedList_Unlink(&self.lru, &cache->node);
+		self.stats.unused_memory -= cache->size;
+	}
+	self.stats.memory -= cache->size;
+	FreeImageCache(cache);
 }
 
 static void ImageCacheDestructor(void *privdata, void *data)
@@ -79,6 +145,26 @@ static void ImageCacheDestructor(void *privdata, void *data)
 	DestroyImageCache(data);
 }
 
+/** Remove the least recently used images until the cache fits the budget */
+static void TrimImageCache(void)
+{
+	ImageCache cache;
+	LinkedListNode *node;
+
+	while (self.stats.memory > self.cache_size && self.lru.length > 0) {
+		node = LinkedList_GetNode(&self.lru, 0);
+		cache = node->data;
+		Dict_Delete(self.images, cache->key);
+	}
+}
+
+static void RetainImageCache(ImageCache cache)
+{
+	LinkedList_AppendNode(&self.lru, &cache->node);
+	self.stats.unused_memory += cache->size;
+	TrimImageCache();
+}
+
 static void AddImageRef(LCUI_Widget widget, ImageCache cache)
 {
 	ASSIGN(ref, ImageRef);
@@ -86,6 +172,10 @@ static void AddImageRef(LCUI_Widget widget, ImageCache cache)
 	ref->widget = widget;
 	RBTree_CustomInsert(&self.refs, widget, ref);
 	LinkedList_Append(&cache->refs, widget);
+	if (cache->node.prev) {
+		LinkedList_Unlink(&self.lru, &cache->node);
+		self.stats.unused_memory -= cache->size;
+	}
 }
 
 static ImageRef GetImageRef(LCUI_Widget widget)
@@ -93,6 +183,12 @@ static ImageRef GetImageRef(LCUI_Widget widget)
 	return RBTree_CustomGetData(&self.refs, widget);
 }
 
+/**
+ * Stop the widget from using the cached image
+ * The background-image style of the widget is kept, only the quote of the
+ * decoded image is released, so the image can be swapped for another size
+ * of it or for the image given by the style.
+ */
 static void DeleteImageRef(LCUI_Widget widget)
 {
 	ImageRef ref;
@@ -109,39 +205,155 @@ static void DeleteImageRef(LCUI_Widget widget)
 			continue;
 		}
 		RBTree_CustomErase(&self.refs, node->data);
-		Widget_UnsetStyle(w, key_background_image);
 		Graph_Init(&w->computed_style.background.image);
 		LinkedList_DeleteNode(&cache->refs, node);
 		break;
 	}
 	RBTree_CustomErase(&self.refs, widget);
-	if (cache->refs.length < 1) {
-		Dict_Delete(self.images, cache->path);
+	if (cache->refs.length < 1 && !cache->loading) {
+		RetainImageCache(cache);
 	}
 }
 
-static void ExecLoadImage(void *arg1, void *arg2)
+static void UpdateImageRefs(ImageCache cache)
 {
-	char *path = arg2;
-	LCUI_Graph image;
-	LCUI_Widget w = arg1;
-	ImageCache cache;
+	LinkedListNode *node;
 
-	Graph_Init(&image);
-	if (LCUI_ReadImageFile(path, &image) != 0) {
+	for (LinkedList_Each(node, &cache->refs)) {
+		LCUI_Widget w = node->data;
+		Graph_Quote(&w->computed_style.background.image,
+			    &cache->image, NULL);
+		Widget_InvalidateArea(w, NULL, SV_BORDER_BOX);
+	}
+}
+
+/**
+ * Compute the size that the background image needs to be decoded to
+ * Only the cover and contain size of a widget with fixed width and height
+ * can be determined before the image is loaded, in other cases the image
+ * is decoded at full size.
+ */
+static void Widget_ComputeBackgroundImageSize(LCUI_Widget w, unsigned *width,
+					      unsigned *height)
+{
+	float box_width, box_height;
+	LCUI_StyleSheet ss = w->style;
+	LCUI_Style s = &ss->sheet[key_background_size];
+
+	*width = 0;
+	*height = 0;
+	if (!s->is_valid || s->type != LCUI_STYPE_STYLE ||
+	    (s->val_style != SV_COVER && s->val_style != SV_CONTAIN)) {
 		return;
 	}
-	cache = NEW(ImageCacheRec, 1);
-	cache->image = image;
-	cache->path = strdup2(path);
-	LinkedList_Init(&cache->refs);
-	if (Dict_Add(self.images, cache->path, cache) == 0) {
-		AddImageRef(w, cache);
+	box_width = LCUIMetrics_ComputeStyle(&ss->sheet[key_width]);
+	box_height = LCUIMetrics_ComputeStyle(&ss->sheet[key_height]);
+	if (box_width <= 0 || box_height <= 0) {
+		return;
+	}
+	if (w->computed_style.box_sizing == SV_CONTENT_BOX) {
+		box_width += w->padding.left + w->padding.right;
+		box_width += w->computed_style.border.left.width;
+		box_width += w->computed_style.border.right.width;
+		box_height += w->padding.top + w->padding.bottom;
+		box_height += w->computed_style.border.top.width;
+		box_height += w->computed_style.border.bottom.width;
+	}
+	*width = ComputeActual(box_width, LCUI_STYPE_PX);
+	*height = ComputeActual(box_height, LCUI_STYPE_PX);
+	/* The contain size only needs the image to fit into the box */
+	if (s->val_style == SV_CONTAIN) {
+		*width = 0;
+	}
+}
+
+static char *GetImageKey(const char *path, unsigned width, unsigned height)
+{
+	char *key;
+	size_t len;
+
+	if (width < 1 && height < 1) {
+		return strdup2(path);
+	}
+	len = strlen(path) + 24;
+	key = malloc(len * sizeof(char));
+	if (key) {
+		snprintf(key, len, "%s?%ux%u", path, width, height);
+	}
+	return key;
+}
+
+static void OnImageProgress(void *arg1, void *arg2)
+{
+	ImageCache cache = arg1;
+
+	if (!self.active || !cache->loading) {
+		return;
+	}
+	cache->ready = TRUE;
+	UpdateImageRefs(cache);
+}
+
+static void OnImageLoaded(void *arg1, void *arg2)
+{
+	ImageLoader loader = arg1;
+	ImageCache cache = loader->cache;
+
+	cache->loading = FALSE;
+	if (!self.active) {
+		FreeImageCache(cache);
+		return;
+	}
+	if (loader->status != 0) {
+		cache->ready = FALSE;
+		Dict_Delete(self.images, cache->key);
+		return;
+	}
+	cache->ready = TRUE;
+	cache->size = cache->image.mem_size;
+	self.stats.memory += cache->size;
+	UpdateImageRefs(cache);
+	if (cache->refs.length < 1) {
+		RetainImageCache(cache);
 	} else {
-		DestroyImageCache(cache);
+		TrimImageCache();
+	}
+}
+
+static void OnImageRowsLoaded(void *arg, unsigned row, unsigned rows)
+{
+	ImageLoader loader = arg;
+
+	if (loader->paint_time > 0 && LCUI_GetTimeDelta(loader->paint_time) <
+					  PROGRESSIVE_PAINT_INTERVAL) {
+		return;
+	}
+	loader->paint_time = LCUI_GetTime();
+	LCUI_PostSimpleTask(OnImageProgress, loader->cache, NULL);
+}
+
+/** Decode the image in the async worker and notify the main thread */
+static void ExecLoadImage(void *arg1, void *arg2)
+{
+	ImageLoader loader = arg1;
+	LCUI_ImageReaderRec reader = { 0 };
+	LCUI_TaskRec task = { 0 };
+
+	reader.target_width = loader->width;
+	reader.target_height = loader->height;
+	if (loader->progressive) {
+		reader.fn_rows = OnImageRowsLoaded;
+		reader.rows_arg = loader;
+	}
+	loader->status = LCUI_ReadImageFileEx(&reader, loader->cache->path,
+					      &loader->cache->image);
+	task.func = OnImageLoaded;
+	task.arg[0] = loader;
+	task.destroy_arg[0] = free;
+	if (!LCUI_PostTask(&task)) {
+		OnImageLoaded(loader, NULL);
+		free(loader);
 	}
-	Graph_Quote(&w->computed_style.background.image, &cache->image, NULL);
-	Widget_InvalidateArea(w, NULL, SV_BORDER_BOX);
 }
 
 static int OnCompareWidget(void *data, const void *keydata)
@@ -158,44 +370,88 @@ static int OnCompareWidget(void *data, const void *keydata)
 
 static void AsyncLoadImage(LCUI_Widget widget, const char *path)
 {
+	char *key;
 	ImageRef ref;
 	ImageCache cache;
+	ImageLoader loader;
+	LCUI_SettingsRec settings;
 	LCUI_TaskRec task = { 0 };
-	LCUI_Style s = &widget->style->sheet[key_background_image];
+	unsigned width, height;
 
 	if (!self.active) {
 		return;
 	}
-	if (Widget_CheckStyleType(widget, key_background_image, string)) {
-		ref = GetImageRef(widget);
-		if (ref && strcmp(ref->cache->path, s->string) == 0) {
-			return;
-		}
-		if (ref) {
-			DeleteImageRef(widget);
-		}
+	Widget_ComputeBackgroundImageSize(widget, &width, &height);
+	key = GetImageKey(path, width, height);
+	if (!key) {
+		return;
+	}
+	ref = GetImageRef(widget);
+	if (ref && strcmp(ref->cache->key, key) == 0) {
+		free(key);
+		return;
+	}
+	if (ref) {
+		DeleteImageRef(widget);
 	}
-	cache = Dict_FetchValue(self.images, path);
+	/* Reuse the decoded image, or wait for the loading one */
+	cache = Dict_FetchValue(self.images, key);
 	if (cache) {
+		free(key);
+		self.stats.hits++;
 		AddImageRef(widget, cache);
-		Graph_Quote(&widget->computed_style.background.image,
-			    &cache->image, NULL);
-		Widget_InvalidateArea(widget, NULL, SV_BORDER_BOX);
+		if (cache->ready) {
+			Graph_Quote(&widget->computed_style.background.image,
+				    &cache->image, NULL);
+			Widget_InvalidateArea(widget, NULL, SV_BORDER_BOX);
+		}
 		return;
 	}
+	self.stats.misses++;
+	cache = CreateImageCache(key, path);
+	free(key);
+	Dict_Add(self.images, cache->key, cache);
+	AddImageRef(widget, cache);
+	Settings_Init(&settings);
+	loader = NEW(ImageLoaderRec, 1);
+	loader->cache = cache;
+	loader->width = width;
+	loader->height = height;
+	loader->progressive = settings.progressive_image_loading;
 	task.func = ExecLoadImage;
-	task.arg[0] = widget;
-	task.arg[1] = strdup2(path);
-	task.destroy_arg[1] = free;
+	task.arg[0] = loader;
 	LCUI_PostAsyncTask(&task);
 }
 
+static void OnSettingsChangeEvent(LCUI_SysEvent e, void *arg)
+{
+	LCUI_SettingsRec settings;
+
+	Settings_Init(&settings);
+	self.cache_size = settings.image_cache_size;
+	TrimImageCache();
+}
+
+void LCUIWidget_GetImageCacheStats(LCUI_ImageCacheStats stats)
+{
+	*stats = self.stats;
+	stats->images = self.images ? Dict_Size(self.images) : 0;
+}
+
 void LCUIWidget_InitImageLoader(void)
 {
 	RBTree_Init(&self.refs);
+	LinkedList_Init(&self.lru);
 	Dict_InitStringKeyType(&self.dtype);
 	self.dtype.valDestructor = ImageCacheDestructor;
 	self.images = Dict_Create(&self.dtype, NULL);
+	/*
+	 * The global settings are not reset until LCUI_InitApp() is called,
+	 * use the default size until the settings change event is received.
+	 */
+	self.cache_size = LCUI_DEFAULT_IMAGE_CACHE_SIZE;
+	self.settings_change_handler_id = LCUI_BindEvent(
+	    LCUI_SETTINGS_CHANGE, OnSettingsChangeEvent, NULL, NULL);
 	RBTree_OnCompare(&self.refs, OnCompareWidget);
 	RBTree_OnDestroy(&self.refs, free);
 	self.active = TRUE;
@@ -203,10 +459,13 @@ void LCUIWidget_InitImageLoader(void)
 
 void LCUIWidget_FreeImageLoader(void)
 {
+	LCUI_UnbindEvent(self.settings_change_handler_id);
+	self.settings_change_handler_id = -1;
+	self.active = FALSE;
 	Dict_Release(self.images);
 	RBTree_Destroy(&self.refs);
+	LinkedList_Init(&self.lru);
 	self.images = NULL;
-	self.active = FALSE;
 }
 
 void Widget_InitBackground(LCUI_Widget w)
@@ -261,8 +520,8 @@ void Widget_ComputeBackgroundStyle(LCUI_Widget widget)
 					Graph_Init(&bg->image);
 					break;
 				}
-				Graph_Quote(&bg->image, s->image, NULL);
 				DeleteImageRef(widget);
+				Graph_Quote(&bg->image, s->image, NULL);
 			default:
 				break;
 			}
@@ -32,6 +32,26 @@ void LCUIWidget_InitImageLoader(void);
 
 void LCUIWidget_FreeImageLoader(void);
 
+typedef struct LCUI_ImageCacheStatsRec_ {
+	/** the number of background images found in the cache */
+	size_t hits;
+
+	/** the number of background images that need to be decoded */
+	size_t misses;
+
+	/** the number of images in the cache */
+	size_t images;
+
+	/** the bytes of all decoded images */
+	size_t memory;
+
+	/** the bytes of images that are not used by any widget */
+	size_t unused_memory;
+} LCUI_ImageCacheStatsRec, *LCUI_ImageCacheStats;
+
+/** Get the statistics of the background image cache */
+LCUI_API void LCUIWidget_GetImageCacheStats(LCUI_ImageCacheStats stats);
+
 void Widget_InitBackground(LCUI_Widget w);
 
 void Widget_DestroyBackground(LCUI_Widget w);
@@ -136,6 +136,9 @@ void Widget_ExecDestroy(LCUI_Widget w)
 	Widget_DestroyBackground(w);
 	Widget_DestroyEventTrigger(w);
 	Widget_DestroyChildren(w);
+	/* The children post surface events to the root widget when they are
+	 * unlinked, drop them before the root widget is freed */
+	LCUIWidget_ClearEventTarget(w);
 	Widget_ClearPrototype(w);
 	if (w->title) {
 		free(w->title);
@@ -165,16 +168,6 @@ void Widget_Destroy(LCUI_Widget w)
 		return;
 	}
 	if (w->parent) {
-		LCUI_Widget child;
-		LinkedListNode *node;
-
-		/* Update the index of the siblings behind it */
-		node = w->node.next;
-		while (node) {
-			child = node->data;
-			child->index -= 1;
-			node = node->next;
-		}
 		if (w->computed_style.position != SV_ABSOLUTE) {
 			Widget_AddTask(w->parent, LCUI_WTASK_REFLOW);
 		}
@@ -211,6 +204,7 @@ void Widget_Empty(LCUI_Widget w)
 	}
 	LinkedList_ClearData(&w->children_show, NULL);
 	LinkedList_Concat(&LCUIWidget.trash, &w->children);
+	w->child_index.valid = 0;
 	Widget_InvalidateArea(w, NULL, SV_GRAPH_BOX);
 	Widget_UpdateStyle(w, TRUE);
 }
@@ -408,7 +402,8 @@ void Widget_SortChildrenShow(LCUI_Widget w)
 			ts = &target->computed_style;
 			if (s->z_index == ts->z_index) {
 				if (s->position == ts->position) {
-					if (child->index < target->index) {
+					if (Widget_GetIndex(child) <
+					    Widget_GetIndex(target)) {
 						continue;
 					}
 				} else if (s->position < ts->position) {
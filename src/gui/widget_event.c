@@ -44,6 +44,7 @@
 /* clang-format off */
 
 #define DBLCLICK_INTERVAL 500
+#define EVENT_POOL_CHUNK_SIZE 128
 
 typedef struct TouchCapturerRec_ {
 	LinkedList points;
@@ -61,19 +62,25 @@ typedef struct LCUI_WidgetEventPackRec_ {
 	void *data;                   /**< 额外数据 */
 	void(*destroy_data)(void *); /**< 数据的销毁函数 */
 	LCUI_Widget widget;           /**< 当前处理该事件的部件 */
+	LCUI_Widget owner;            /**< 接收该事件的部件 */
 	LCUI_WidgetEventRec event;    /**< 事件数据 */
+	LinkedListNode node;          /**< 在事件队列或空闲列表中的结点 */
+	LinkedListNode owner_node;    /**< 在部件的待处理事件列表中的结点 */
 } LCUI_WidgetEventPackRec, *LCUI_WidgetEventPack;
 
+/**
+ * 事件包内存块
+ * 事件包按块分配且地址固定不变，以便部件通过侵入式链表记录待处理的事件
+ */
+typedef struct EventPoolChunkRec_ {
+	LinkedListNode node;
+	LCUI_WidgetEventPackRec packs[EVENT_POOL_CHUNK_SIZE];
+} EventPoolChunkRec, *EventPoolChunk;
+
 enum WidgetStatusType {
 	WST_HOVER, WST_ACTIVE, WST_FOCUS, WST_TOTAL
 };
 
-/** 部件事件记录结点 */
-typedef struct WidgetEventRecordRec_ {
-	LCUI_Widget widget; /**< 所属部件 */
-	LinkedList records; /**< 事件记录列表 */
-} WidgetEventRecordRec, *WidgetEventRecord;
-
 /** 事件标识号与名称的映射记录 */
 typedef struct EventMappingRec_ {
 	int id;
@@ -95,7 +102,9 @@ static struct LCUIWidgetEvnetModule {
 	LCUI_Widget targets[WST_TOTAL]; /**< 相关的部件 */
 	LinkedList events;              /**< 已绑定的事件 */
 	LinkedList event_mappings;	/**< 事件标识号和名称映射记录列表  */
-	RBTree event_records;		/**< 当前正执行的事件的记录 */
+	LinkedList event_queue;		/**< 待分发的事件包队列 */
+	LinkedList free_packs;		/**< 空闲的事件包 */
+	LinkedList pool_chunks;		/**< 事件包内存块列表 */
 	RBTree event_names;		/**< 事件名称表，以标识号作为索引 */
 	DictType event_ids_type;
 	Dict *event_ids;		/**< 事件标识号表，以事件名称作为索引 */
@@ -133,34 +142,58 @@ static void DestroyWidgetEvent(LCUI_WidgetEvent e)
 	}
 }
 
-static void DirectDestroyWidgetEventPack(void *data)
+/** 从池中取出一个事件包，调用前需要锁定互斥锁 */
+static LCUI_WidgetEventPack EventPool_Alloc(void)
 {
-	LCUI_WidgetEventPack pack = data;
-	if (pack->data && pack->destroy_data) {
-		pack->destroy_data(pack->data);
+	size_t i;
+	EventPoolChunk chunk;
+	LinkedListNode *node;
+
+	node = self.free_packs.head.next;
+	if (!node) {
+		chunk = malloc(sizeof(EventPoolChunkRec));
+		if (!chunk) {
+			return NULL;
+		}
+		chunk->node.data = chunk;
+		LinkedList_AppendNode(&self.pool_chunks, &chunk->node);
+		for (i = 0; i < EVENT_POOL_CHUNK_SIZE; ++i) {
+			chunk->packs[i].node.data = &chunk->packs[i];
+			chunk->packs[i].owner_node.data = &chunk->packs[i];
+			LinkedList_AppendNode(&self.free_packs,
+					      &chunk->packs[i].node);
+		}
+		node = self.free_packs.head.next;
 	}
-	DestroyWidgetEvent(&pack->event);
-	pack->data = NULL;
-	free(pack);
+	LinkedList_Unlink(&self.free_packs, node);
+	return node->data;
 }
 
-static void DestoryWidgetEventRecord(void *data)
+/** 将事件包放回池中，调用前需要锁定互斥锁 */
+static void EventPool_Free(LCUI_WidgetEventPack pack)
 {
-	WidgetEventRecord record = data;
-	LinkedList_Clear(&record->records, DirectDestroyWidgetEventPack);
-	free(record);
+	if (pack->owner) {
+		LinkedList_Unlink(&pack->owner->pending_events,
+				  &pack->owner_node);
+	}
+	pack->owner = NULL;
+	pack->widget = NULL;
+	pack->data = NULL;
+	pack->destroy_data = NULL;
+	/* 插入到空闲列表的头部，让下次分配时优先复用最近用过的事件包 */
+	LinkedList_InsertNode(&self.free_packs, 0, &pack->node);
 }
 
-static int CompareWidgetEventRecord(void *data, const void *keydata)
+/** 销毁事件包内的数据，并将它放回池中 */
+static void ReleaseWidgetEventPack(LCUI_WidgetEventPack pack)
 {
-	WidgetEventRecord record = data;
-	if (record->widget == (LCUI_Widget)keydata) {
-		return 0;
-	} else if (record->widget < (LCUI_Widget)keydata) {
-		return -1;
-	} else {
-		return 1;
+	if (pack->data && pack->destroy_data) {
+		pack->destroy_data(pack->data);
 	}
+	DestroyWidgetEvent(&pack->event);
+	LCUIMutex_Lock(&self.mutex);
+	EventPool_Free(pack);
+	LCUIMutex_Unlock(&self.mutex);
 }
 
 static void DestroyWidgetEventHandler(void *arg)
@@ -191,52 +224,6 @@ void LCUI_InitWidgetEvent(LCUI_WidgetEvent e, const char *name)
 	e->data = NULL;
 }
 
-/**
- * 添加事件记录
- * 记录当前待处理的事件和目标部件，方便在部件被销毁时清除待处理的事件
- */
-static void Widget_AddEventRecord(LCUI_Widget widget, LCUI_WidgetEventPack pack)
-{
-	WidgetEventRecord record;
-
-	LCUIMutex_Lock(&self.mutex);
-	record = RBTree_CustomGetData(&self.event_records, widget);
-	if (!record) {
-		record = NEW(WidgetEventRecordRec, 1);
-		LinkedList_Init(&record->records);
-		record->widget = widget;
-		RBTree_CustomInsert(&self.event_records, widget, record);
-	}
-	LinkedList_Append(&record->records, pack);
-	LCUIMutex_Unlock(&self.mutex);
-}
-
-/** 删除事件记录 */
-static int Widget_DeleteEventRecord(LCUI_Widget widget,
-				    LCUI_WidgetEventPack pack)
-{
-	int ret = 0;
-	WidgetEventRecord record;
-	LinkedListNode *node, *prev;
-
-	LCUIMutex_Lock(&self.mutex);
-	record = RBTree_CustomGetData(&self.event_records, widget);
-	if (!record) {
-		LCUIMutex_Unlock(&self.mutex);
-		return -1;
-	}
-	for (LinkedList_Each(node, &record->records)) {
-		prev = node->prev;
-		if (node->data == pack) {
-			LinkedList_DeleteNode(&record->records, node);
-			node = prev;
-			ret = 1;
-		}
-	}
-	LCUIMutex_Unlock(&self.mutex);
-	return ret;
-}
-
 /** 将原始事件转换成部件事件 */
 static void WidgetEventTranslator(LCUI_Event e, LCUI_WidgetEventPack pack)
 {
@@ -294,16 +281,6 @@ static int CopyWidgetEvent(LCUI_WidgetEvent dst, const LCUI_WidgetEvent src)
 	return 0;
 }
 
-/** 销毁部件事件包 */
-static void DestroyWidgetEventPack(void *arg)
-{
-	LCUI_WidgetEventPack pack = arg;
-	/* 如果删除成功则说明有记录，需要销毁数据 */
-	if (Widget_DeleteEventRecord(pack->event.target, pack) == 1) {
-		DirectDestroyWidgetEventPack(pack);
-	}
-}
-
 static void DestroyTouchCapturer(void *arg)
 {
 	TouchCapturer tc = arg;
@@ -583,18 +560,9 @@ static int Widget_TriggerEventEx(LCUI_Widget widget, LCUI_WidgetEventPack pack)
 	return Widget_TriggerEventEx(widget->parent, pack);
 }
 
-static void OnWidgetEvent(LCUI_Event e, LCUI_WidgetEventPack pack)
-{
-	if (pack->widget) {
-		Widget_TriggerEventEx(pack->widget, pack);
-	}
-}
-
 LCUI_BOOL Widget_PostEvent(LCUI_Widget widget, LCUI_WidgetEvent ev, void *data,
 			   void (*destroy_data)(void *))
 {
-	LCUI_Event sys_ev;
-	LCUI_TaskRec task;
 	LCUI_WidgetEventPack pack;
 
 	if (widget->state == LCUI_WSTATE_DELETED) {
@@ -603,30 +571,62 @@ LCUI_BOOL Widget_PostEvent(LCUI_Widget widget, LCUI_WidgetEvent ev, void *data,
 	if (!ev->target) {
 		ev->target = widget;
 	}
-	/* 准备任务 */
-	task.func = (LCUI_TaskFunc)OnWidgetEvent;
-	task.arg[0] = malloc(sizeof(LCUI_EventRec));
-	task.arg[1] = malloc(sizeof(LCUI_WidgetEventPackRec));
-	/* 这两个参数都需要在任务执行完后释放 */
-	task.destroy_arg[1] = DestroyWidgetEventPack;
-	task.destroy_arg[0] = free;
-	sys_ev = task.arg[0];
-	pack = task.arg[1];
-	sys_ev->data = pack;
-	sys_ev->type = ev->type;
-	pack->data = data;
-	pack->widget = widget;
-	pack->destroy_data = destroy_data;
-	CopyWidgetEvent(&pack->event, ev);
-	Widget_AddEventRecord(widget, pack);
-	/* 把任务扔给当前跑主循环的线程 */
-	if (!LCUI_PostTask(&task)) {
-		LCUITask_Destroy(&task);
+	LCUIMutex_Lock(&self.mutex);
+	pack = EventPool_Alloc();
+	if (!pack) {
+		LCUIMutex_Unlock(&self.mutex);
+		if (data && destroy_data) {
+			destroy_data(data);
+		}
 		return FALSE;
 	}
+	if (CopyWidgetEvent(&pack->event, ev) != 0) {
+		DestroyWidgetEvent(&pack->event);
+		EventPool_Free(pack);
+		LCUIMutex_Unlock(&self.mutex);
+		if (data && destroy_data) {
+			destroy_data(data);
+		}
+		return FALSE;
+	}
+	pack->data = data;
+	pack->destroy_data = destroy_data;
+	pack->widget = widget;
+	pack->owner = widget;
+	/* 记录到部件的待处理事件列表中，以便在部件销毁时取消这些事件 */
+	LinkedList_AppendNode(&widget->pending_events, &pack->owner_node);
+	LinkedList_AppendNode(&self.event_queue, &pack->node);
+	LCUIMutex_Unlock(&self.mutex);
+	/* 事件会由跑主循环的线程在 LCUI_ProcessEvents() 中分发 */
+	LCUI_WakeUp();
 	return TRUE;
 }
 
+size_t LCUIWidget_ProcessEvents(void)
+{
+	size_t count = 0;
+	LinkedListNode *node;
+	LCUI_WidgetEventPack pack;
+
+	while (1) {
+		LCUIMutex_Lock(&self.mutex);
+		node = self.event_queue.head.next;
+		if (!node) {
+			LCUIMutex_Unlock(&self.mutex);
+			break;
+		}
+		LinkedList_Unlink(&self.event_queue, node);
+		LCUIMutex_Unlock(&self.mutex);
+		pack = node->data;
+		if (pack->widget) {
+			Widget_TriggerEventEx(pack->widget, pack);
+		}
+		ReleaseWidgetEventPack(pack);
+		++count;
+	}
+	return count;
+}
+
 int Widget_TriggerEvent(LCUI_Widget widget, LCUI_WidgetEvent e, void *data)
 {
 	LCUI_WidgetEventPackRec pack;
@@ -644,19 +644,10 @@ int Widget_TriggerEvent(LCUI_Widget widget, LCUI_WidgetEvent e, void *data)
 int Widget_StopEventPropagation(LCUI_Widget widget)
 {
 	LinkedListNode *node;
-	WidgetEventRecord record;
 	LCUI_WidgetEventPack pack;
 
-	if (self.event_records.total_node <= 1) {
-		return 0;
-	}
 	LCUIMutex_Lock(&self.mutex);
-	record = RBTree_CustomGetData(&self.event_records, widget);
-	if (!record) {
-		LCUIMutex_Unlock(&self.mutex);
-		return -1;
-	}
-	for (LinkedList_Each(node, &record->records)) {
+	for (LinkedList_Each(node, &widget->pending_events)) {
 		pack = node->data;
 		pack->event.cancel_bubble = TRUE;
 	}
@@ -841,20 +832,15 @@ static void ClearFocusTarget(LCUI_Widget target)
 void LCUIWidget_ClearEventTarget(LCUI_Widget widget)
 {
 	LinkedListNode *node;
-	WidgetEventRecord record;
 	LCUI_WidgetEventPack pack;
 
-	if (self.event_records.total_node <= 1) {
-		return;
-	}
 	LCUIMutex_Lock(&self.mutex);
-	record = RBTree_CustomGetData(&self.event_records, widget);
-	if (record) {
-		for (LinkedList_Each(node, &record->records)) {
-			pack = node->data;
-			pack->widget = NULL;
-			pack->event.cancel_bubble = TRUE;
-		}
+	while (widget && (node = widget->pending_events.head.next)) {
+		pack = node->data;
+		pack->widget = NULL;
+		pack->owner = NULL;
+		pack->event.cancel_bubble = TRUE;
+		LinkedList_Unlink(&widget->pending_events, node);
 	}
 	LCUIMutex_Unlock(&self.mutex);
 	ClearMouseOverTarget(widget);
@@ -1293,7 +1279,9 @@ void LCUIWidget_InitEvent(void)
 
 	LCUIMutex_Init(&self.mutex);
 	RBTree_Init(&self.event_names);
-	RBTree_Init(&self.event_records);
+	LinkedList_Init(&self.event_queue);
+	LinkedList_Init(&self.free_packs);
+	LinkedList_Init(&self.pool_chunks);
 	LinkedList_Init(&self.events);
 	LinkedList_Init(&self.event_mappings);
 	self.targets[WST_ACTIVE] = NULL;
@@ -1321,8 +1309,6 @@ void LCUIWidget_InitEvent(void)
 	BindSysEvent(LCUI_KEYUP, OnKeyboardEvent);
 	BindSysEvent(LCUI_TOUCH, OnTouch);
 	BindSysEvent(LCUI_TEXTINPUT, OnTextInput);
-	RBTree_OnCompare(&self.event_records, CompareWidgetEventRecord);
-	RBTree_OnDestroy(&self.event_records, DestoryWidgetEventRecord);
 	LinkedList_Init(&self.touch_capturers);
 }
 
@@ -1335,7 +1321,15 @@ void LCUIWidget_FreeEvent(void)
 		LCUI_UnbindEvent(*id);
 	}
 	RBTree_Destroy(&self.event_names);
-	RBTree_Destroy(&self.event_records);
+	while ((node = self.event_queue.head.next)) {
+		LinkedList_Unlink(&self.event_queue, node);
+		ReleaseWidgetEventPack(node->data);
+	}
+	while ((node = self.pool_chunks.head.next)) {
+		LinkedList_Unlink(&self.pool_chunks, node);
+		free(node->data);
+	}
+	LinkedList_Init(&self.free_packs);
 	Dict_Release(self.event_ids);
 	TouchCapturers_Clear(&self.touch_capturers);
 	LinkedList_Clear(&self.events, free);
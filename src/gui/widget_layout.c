@@ -38,10 +38,88 @@
 #include "layout/flexbox.h"
 #include "widget_diff.h"
 
+static void Widget_GetAvailableSize(LCUI_Widget w, float *width,
+				    float *height)
+{
+	if (w->parent) {
+		*width = w->parent->box.content.width;
+		*height = w->parent->box.content.height;
+	} else {
+		*width = w->box.content.width;
+		*height = w->box.content.height;
+	}
+}
+
+static LCUI_BOOL Widget_RestoreLayoutCache(LCUI_Widget w,
+					   LCUI_LayoutRule rule,
+					   float available_width,
+					   float available_height)
+{
+	LCUI_WidgetLayoutCacheRec *cache = &w->layout_cache;
+
+	if (!cache->is_valid || cache->rule != rule ||
+	    cache->available_width != available_width ||
+	    cache->available_height != available_height ||
+	    cache->content_width != w->box.content.width ||
+	    cache->content_height != w->box.content.height) {
+		return FALSE;
+	}
+	/*
+	 * The position of the children has not changed since the last layout,
+	 * so we only need to restore the size of the widget itself.
+	 */
+	w->width = cache->width;
+	w->height = cache->height;
+	w->max_content_width = cache->max_content_width;
+	w->max_content_height = cache->max_content_height;
+	Widget_UpdateBoxSize(w);
+	return TRUE;
+}
+
+static void Widget_SaveLayoutCache(LCUI_Widget w, LCUI_LayoutRule rule,
+				   float available_width,
+				   float available_height,
+				   float content_width, float content_height)
+{
+	LCUI_WidgetLayoutCacheRec *cache = &w->layout_cache;
+
+	cache->rule = rule;
+	cache->available_width = available_width;
+	cache->available_height = available_height;
+	cache->content_width = content_width;
+	cache->content_height = content_height;
+	cache->width = w->width;
+	cache->height = w->height;
+	cache->max_content_width = w->max_content_width;
+	cache->max_content_height = w->max_content_height;
+	cache->is_valid = TRUE;
+}
+
+void Widget_InvalidateLayoutCache(LCUI_Widget w)
+{
+	/*
+	 * The layout of each ancestor depends on the size of its descendants,
+	 * so the cache of the whole ancestor chain must be invalidated.
+	 */
+	for (; w; w = w->parent) {
+		w->layout_cache.is_valid = FALSE;
+	}
+}
+
 void Widget_Reflow(LCUI_Widget w, LCUI_LayoutRule rule)
 {
+	float available_width, available_height;
+	float content_width = w->box.content.width;
+	float content_height = w->box.content.height;
 	LCUI_WidgetEventRec ev = { 0 };
 
+	Widget_GetAvailableSize(w, &available_width, &available_height);
+	if (Widget_RestoreLayoutCache(w, rule, available_width,
+				      available_height)) {
+		DEBUG_MSG("id: %s, type: %s, hit layout cache\n", w->id,
+			  w->type);
+		goto done;
+	}
 	switch (w->computed_style.display) {
 	case SV_BLOCK:
 	case SV_INLINE_BLOCK:
@@ -54,6 +132,10 @@ void Widget_Reflow(LCUI_Widget w, LCUI_LayoutRule rule)
 	default:
 		break;
 	}
+	Widget_SaveLayoutCache(w, rule, available_width, available_height,
+			       content_width, content_height);
+
+done:
 	ev.cancel_bubble = TRUE;
 	ev.type = LCUI_WEVENT_AFTERLAYOUT;
 	Widget_TriggerEvent(w, &ev, NULL);
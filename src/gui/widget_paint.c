@@ -477,7 +477,7 @@ static LCUI_WidgetRenderer WidgetRenderer(LCUI_Widget w,
 	DEBUG_MSG(
 	    "[%s][%d/%d] content_rect: (%d,%d,%d,%d), "
 	    "canvas_rect: (%d,%d,%d,%d)\n",
-	    w->id, w->index, w->parent ? w->parent->children_show.length : 1,
+	    w->id, w->cached_index, w->parent ? w->parent->children_show.length : 1,
 	    that->actual_content_rect.x, that->actual_content_rect.y,
 	    that->actual_content_rect.width, that->actual_content_rect.height,
 	    that->paint->canvas.quote.left, that->paint->canvas.quote.top,
@@ -641,7 +641,7 @@ static size_t WidgetRenderer_Render(LCUI_WidgetRenderer renderer)
 	char filename[256];
 	static size_t frame = 0;
 #endif
-	DEBUG_MSG("[%d] %s: start render\n", that->target->index,
+	DEBUG_MSG("[%d] %s: start render\n", that->target->cached_index,
 		  that->target->type);
 	/* 如果部件有需要绘制的内容 */
 	if (that->can_render_self) {
@@ -694,7 +694,7 @@ static size_t WidgetRenderer_Render(LCUI_WidgetRenderer renderer)
 		LCUI_WritePNGFile(filename, &that->root_paint->canvas);
 #endif
 		DEBUG_MSG("[%d] %s: end render, count: %lu\n",
-			  that->target->index, that->target->type, count);
+			  that->target->cached_index, that->target->type, count);
 		return count;
 	}
 	/* 若需要绘制的是当前部件图层，则先混合部件自身位图和内容位图，得出当
@@ -730,7 +730,7 @@ static size_t WidgetRenderer_Render(LCUI_WidgetRenderer renderer)
 		renderer->target->id);
 	LCUI_WritePNGFile(filename, &that->root_paint->canvas);
 #endif
-	DEBUG_MSG("[%d] %s: end render, count: %lu\n", that->target->index,
+	DEBUG_MSG("[%d] %s: end render, count: %lu\n", that->target->cached_index,
 		  that->target->type, count);
 	return count;
 }
@@ -753,10 +753,10 @@ size_t Widget_Render(LCUI_Widget w, LCUI_PaintContext paint)
 	Widget_ComputeActualPaddingBox(w, &style);
 	Widget_ComputeActualContentBox(w, &style);
 	renderer = WidgetRenderer(w, paint, &style, NULL);
-	DEBUG_MSG("[%d] %s: start render\n", renderer->target->index,
+	DEBUG_MSG("[%d] %s: start render\n", renderer->target->cached_index,
 		  renderer->target->type);
 	count = WidgetRenderer_Render(renderer);
-	DEBUG_MSG("[%d] %s: end render, count: %lu\n", renderer->target->index,
+	DEBUG_MSG("[%d] %s: end render, count: %lu\n", renderer->target->cached_index,
 		  renderer->target->type, count);
 	WidgetRenderer_Delete(renderer);
 	return count;
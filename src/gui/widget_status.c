@@ -101,14 +101,14 @@ void Widget_UpdateStatus(LCUI_Widget widget)
 	if (!widget->parent) {
 		return;
 	}
-	if (widget->index == widget->parent->children.length - 1) {
+	if (!Widget_GetNext(widget)) {
 		Widget_AddStatus(widget, "last-child");
 		child = Widget_GetPrev(widget);
 		if (child) {
 			Widget_RemoveStatus(child, "last-child");
 		}
 	}
-	if (widget->index == 0) {
+	if (!Widget_GetPrev(widget)) {
 		Widget_AddStatus(widget, "first-child");
 		child = Widget_GetNext(widget);
 		if (child) {
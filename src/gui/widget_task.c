@@ -143,6 +143,22 @@ void Widget_UpdateTaskStatus(LCUI_Widget widget)
 	}
 }
 
+/** Check whether the task may change the layout result of the widget */
+static LCUI_BOOL IsLayoutTask(int task)
+{
+	switch (task) {
+	case LCUI_WTASK_TITLE:
+	case LCUI_WTASK_SHADOW:
+	case LCUI_WTASK_BACKGROUND:
+	case LCUI_WTASK_ZINDEX:
+	case LCUI_WTASK_OPACITY:
+		return FALSE;
+	default:
+		break;
+	}
+	return TRUE;
+}
+
 void Widget_AddTaskForChildren(LCUI_Widget widget, int task)
 {
 	LCUI_Widget child;
@@ -161,7 +177,10 @@ void Widget_AddTask(LCUI_Widget widget, int task)
 	if (widget->state == LCUI_WSTATE_DELETED) {
 		return;
 	}
-	DEBUG_MSG("[%lu] %s, %d\n", widget->index, widget->type, task);
+	DEBUG_MSG("[%lu] %s, %d\n", widget->cached_index, widget->type, task);
+	if (IsLayoutTask(task)) {
+		Widget_InvalidateLayoutCache(widget);
+	}
 	widget->task.for_self = TRUE;
 	widget->task.states[task] = TRUE;
 	widget = widget->parent;
@@ -377,9 +396,10 @@ static size_t Widget_UpdateChildren(LCUI_Widget w, LCUI_WidgetTaskContext ctx)
 			continue;
 		}
 		if (count > 0) {
-			data->progress = max(child->index, data->progress);
+			data->progress =
+			    max(Widget_GetIndex(child), data->progress);
 			if (data->progress > w->children_show.length) {
-				data->progress = child->index;
+				data->progress = Widget_GetIndex(child);
 			}
 			update_count += 1;
 		}
@@ -424,11 +444,13 @@ static void Widget_UpdateSelf(LCUI_Widget w, LCUI_WidgetTaskContext ctx)
 {
 	int i;
 	LCUI_BOOL *states;
+	LCUI_BOOL has_layout_task = FALSE;
 
 	states = w->task.states;
 	w->task.for_self = FALSE;
 	for (i = 0; i < LCUI_WTASK_REFLOW; ++i) {
 		if (states[i]) {
+			has_layout_task = has_layout_task || IsLayoutTask(i);
 			if (w->proto && w->proto->runtask) {
 				w->proto->runtask(w, i);
 			}
@@ -441,6 +463,14 @@ static void Widget_UpdateSelf(LCUI_Widget w, LCUI_WidgetTaskContext ctx)
 	if (states[LCUI_WTASK_USER] && w->proto && w->proto->runtask) {
 		states[LCUI_WTASK_USER] = FALSE;
 		w->proto->runtask(w, LCUI_WTASK_USER);
+		has_layout_task = TRUE;
+	}
+	/*
+	 * Some states are set without Widget_AddTask(), e.g. by the refresh
+	 * style task, so the layout cache may have been saved after them.
+	 */
+	if (has_layout_task) {
+		Widget_InvalidateLayoutCache(w);
 	}
 	Widget_AddState(w, LCUI_WSTATE_UPDATED);
 }
@@ -517,6 +547,18 @@ size_t LCUIWidget_Update(void)
 	return count;
 }
 
+LCUI_BOOL LCUIWidget_HasPendingUpdates(void)
+{
+	LCUI_Widget root = LCUIWidget_GetRoot();
+
+	if (self.refresh_all || !root) {
+		return TRUE;
+	}
+	return root->task.for_self || root->task.for_children ||
+	       root->invalid_area_type > LCUI_INVALID_AREA_TYPE_NONE ||
+	       root->has_child_invalid_area;
+}
+
 void Widget_UpdateWithProfile(LCUI_Widget w, LCUI_WidgetTasksProfile profile)
 {
 	LCUI_WidgetTaskContext ctx;
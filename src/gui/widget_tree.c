@@ -29,6 +29,7 @@
  */
 
 #include <assert.h>
+#include <errno.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -36,6 +37,75 @@
 #include <LCUI/LCUI.h>
 #include <LCUI/gui/widget.h>
 
+#define CHILD_INDEX_MIN_CAPACITY 8
+
+/** 将父部件的子部件索引标记为从该部件的位置开始失效 */
+static void Widget_InvalidateIndex(LCUI_Widget w)
+{
+	LCUI_Widget parent = w->parent;
+
+	/* 只有在有效范围内的部件的 index 才是准确的 */
+	if (w->cached_index < parent->child_index.valid &&
+	    parent->child_index.items[w->cached_index] == w) {
+		parent->child_index.valid = w->cached_index;
+	}
+}
+
+int Widget_UpdateChildIndex(LCUI_Widget w)
+{
+	size_t i, capacity;
+	LCUI_Widget child;
+	LCUI_Widget *items;
+	LinkedListNode *node;
+
+	if (w->child_index.valid >= w->children.length) {
+		return 0;
+	}
+	if (w->child_index.capacity < w->children.length) {
+		capacity = max(w->child_index.capacity * 2,
+			       CHILD_INDEX_MIN_CAPACITY);
+		capacity = max(capacity, w->children.length);
+		items = realloc(w->child_index.items,
+				capacity * sizeof(LCUI_Widget));
+		if (!items) {
+			return -ENOMEM;
+		}
+		w->child_index.items = items;
+		w->child_index.capacity = capacity;
+	}
+	i = w->child_index.valid;
+	if (i > 0) {
+		node = w->child_index.items[i - 1]->node.next;
+	} else {
+		node = w->children.head.next;
+	}
+	for (; node; node = node->next, ++i) {
+		child = node->data;
+		child->cached_index = i;
+		w->child_index.items[i] = child;
+	}
+	w->child_index.valid = i;
+	return 0;
+}
+
+size_t Widget_GetIndex(LCUI_Widget w)
+{
+	size_t i;
+	LCUI_Widget prev;
+
+	if (!w->parent || Widget_UpdateChildIndex(w->parent) == 0) {
+		return w->cached_index;
+	}
+	/* 索引因内存不足而未能更新，改为统计它前面的部件数量 */
+	i = 0;
+	prev = Widget_GetPrev(w);
+	while (prev) {
+		prev = Widget_GetPrev(prev);
+		++i;
+	}
+	return i;
+}
+
 int Widget_Append(LCUI_Widget parent, LCUI_Widget widget)
 {
 	LCUI_WidgetEventRec ev = { 0 };
@@ -49,8 +119,14 @@ int Widget_Append(LCUI_Widget parent, LCUI_Widget widget)
 	Widget_Unlink(widget);
 	widget->parent = parent;
 	widget->state = LCUI_WSTATE_CREATED;
-	widget->index = parent->children.length;
+	widget->cached_index = parent->children.length;
 	LinkedList_AppendNode(&parent->children, &widget->node);
+	/* 如果索引是完整的，则直接追加到末尾，免得下次访问时再遍历 */
+	if (parent->child_index.valid == widget->cached_index &&
+	    parent->child_index.capacity > widget->cached_index) {
+		parent->child_index.items[widget->cached_index] = widget;
+		parent->child_index.valid += 1;
+	}
 	ev.cancel_bubble = TRUE;
 	ev.type = LCUI_WEVENT_LINK;
 	Widget_UpdateStyle(widget, TRUE);
@@ -65,9 +141,7 @@ int Widget_Append(LCUI_Widget parent, LCUI_Widget widget)
 
 int Widget_Prepend(LCUI_Widget parent, LCUI_Widget widget)
 {
-	LCUI_Widget child;
 	LCUI_WidgetEventRec ev = { 0 };
-	LinkedListNode *node;
 
 	if (!parent || !widget) {
 		return -1;
@@ -75,20 +149,13 @@ int Widget_Prepend(LCUI_Widget parent, LCUI_Widget widget)
 	if (parent == widget) {
 		return -2;
 	}
-	child = widget->parent;
 	Widget_Unlink(widget);
-	widget->index = 0;
+	widget->cached_index = 0;
 	widget->parent = parent;
 	widget->state = LCUI_WSTATE_CREATED;
-	node = &widget->node;
-	LinkedList_InsertNode(&parent->children, 0, node);
-	/** 修改它后面的部件的 index 值 */
-	node = node->next;
-	while (node) {
-		child = node->data;
-		child->index += 1;
-		node = node->next;
-	}
+	LinkedList_InsertNode(&parent->children, 0, &widget->node);
+	/* 它后面的部件的 index 值会在下次访问索引时更新 */
+	parent->child_index.valid = 0;
 	ev.cancel_bubble = TRUE;
 	ev.type = LCUI_WEVENT_LINK;
 	Widget_TriggerEvent(widget, &ev, NULL);
@@ -103,6 +170,7 @@ int Widget_Prepend(LCUI_Widget parent, LCUI_Widget widget)
 int Widget_Unwrap(LCUI_Widget widget)
 {
 	size_t len;
+	LCUI_BOOL is_first, is_last;
 	LCUI_Widget child;
 	LCUI_WidgetEventRec ev = { 0 };
 	LinkedList *children;
@@ -113,6 +181,8 @@ int Widget_Unwrap(LCUI_Widget widget)
 	}
 	children = &widget->parent->children;
 	len = widget->children.length;
+	is_first = !Widget_GetPrev(widget);
+	is_last = !Widget_GetNext(widget);
 	if (len > 0) {
 		node = LinkedList_GetNode(&widget->children, 0);
 		Widget_RemoveStatus(node->data, "first-child");
@@ -132,6 +202,11 @@ int Widget_Unwrap(LCUI_Widget widget)
 		Widget_TriggerEvent(child, &ev, NULL);
 		LinkedList_Unlink(&widget->children, node);
 		LinkedList_Link(children, target, node);
+		/*
+		 * 事件处理器可能已经重建了索引，所以每次改动链表后都要让它失效，
+		 * 插入位置后面的部件的 index 都变了
+		 */
+		widget->parent->child_index.valid = 0;
 		child->parent = widget->parent;
 		ev.type = LCUI_WEVENT_LINK;
 		Widget_TriggerEvent(child, &ev, NULL);
@@ -140,10 +215,11 @@ int Widget_Unwrap(LCUI_Widget widget)
 		node = prev;
 		--len;
 	}
-	if (widget->index == 0) {
+	widget->child_index.valid = 0;
+	if (is_first) {
 		Widget_AddStatus(target->next->data, "first-child");
 	}
-	if (widget->index == children->length - 1) {
+	if (is_last) {
 		node = LinkedList_GetNodeAtTail(children, 0);
 		Widget_AddStatus(node->data, "last-child");
 	}
@@ -160,33 +236,30 @@ int Widget_Unlink(LCUI_Widget w)
 	if (!w->parent) {
 		return -1;
 	}
-	node = &w->node;
-	if (w->index == w->parent->children.length - 1) {
+	if (!Widget_GetNext(w)) {
 		Widget_RemoveStatus(w, "last-child");
 		child = Widget_GetPrev(w);
 		if (child) {
 			Widget_AddStatus(child, "last-child");
 		}
 	}
-	if (w->index == 0) {
+	if (!Widget_GetPrev(w)) {
 		Widget_RemoveStatus(w, "first-child");
 		child = Widget_GetNext(w);
 		if (child) {
 			Widget_AddStatus(child, "first-child");
 		}
 	}
-	/** 修改它后面的部件的 index 值 */
-	node = node->next;
-	while (node) {
-		child = node->data;
-		child->index -= 1;
-		node = node->next;
-	}
 	node = &w->node;
 	ev.cancel_bubble = TRUE;
 	ev.type = LCUI_WEVENT_UNLINK;
 	Widget_TriggerEvent(w, &ev, NULL);
 	LinkedList_Unlink(&w->parent->children, node);
+	/*
+	 * 在移除结点之后再让索引失效，以免 unlink 事件处理器重建的索引中还留着
+	 * 这个部件，它后面的部件的 index 值会在下次访问索引时更新
+	 */
+	Widget_InvalidateIndex(w);
 	LinkedList_Unlink(&w->parent->children_show, &w->node_show);
 	Widget_PostSurfaceEvent(w, LCUI_WEVENT_UNLINK, TRUE);
 	Widget_AddTask(w->parent, LCUI_WTASK_REFLOW);
@@ -214,11 +287,16 @@ LCUI_Widget Widget_GetNext(LCUI_Widget w)
 
 LCUI_Widget Widget_GetChild(LCUI_Widget w, size_t index)
 {
-	LinkedListNode *node = LinkedList_GetNode(&w->children, index);
-	if (node) {
-		return node->data;
+	LinkedListNode *node;
+
+	if (index >= w->children.length) {
+		return NULL;
 	}
-	return NULL;
+	if (Widget_UpdateChildIndex(w) == 0) {
+		return w->child_index.items[index];
+	}
+	node = LinkedList_GetNode(&w->children, index);
+	return node ? node->data : NULL;
 }
 
 static void Widget_OnDestroy(void *arg)
@@ -232,6 +310,10 @@ void Widget_DestroyChildren(LCUI_Widget w)
 	 * 一块内存空间的，销毁部件列表会把部件释放掉，所以把这个操作放在后面 */
 	LinkedList_ClearData(&w->children_show, NULL);
 	LinkedList_ClearData(&w->children, Widget_OnDestroy);
+	free(w->child_index.items);
+	w->child_index.items = NULL;
+	w->child_index.capacity = 0;
+	w->child_index.valid = 0;
 }
 
 static void _LCUIWidget_PrintTree(LCUI_Widget w, int depth, const char *prefix)
@@ -37,6 +37,7 @@
 #include <LCUI/util/logger.h>
 #include <LCUI/graph.h>
 #include <LCUI/image.h>
+#include "scaler.h"
 
 #ifdef USE_LIBJPEG
 
@@ -165,6 +166,28 @@ static void *jpeg_malloc(j_decompress_ptr cinfo, size_t size)
 				       size);
 }
 
+/**
+ * Let libjpeg scale the image down while decoding, it supports the scaling
+ * ratios 1/1, 1/2, 1/4 and 1/8 by reducing the IDCT size.
+ */
+static void JPEGReader_SetScale(j_decompress_ptr cinfo, unsigned width,
+				unsigned height)
+{
+	unsigned denom;
+
+	if (width < 1 && height < 1) {
+		return;
+	}
+	for (denom = 8; denom > 1; denom /= 2) {
+		if ((width < 1 || cinfo->image_width / denom >= width) &&
+		    (height < 1 || cinfo->image_height / denom >= height)) {
+			break;
+		}
+	}
+	cinfo->scale_num = 1;
+	cinfo->scale_denom = denom;
+}
+
 int LCUI_ReadJPEGHeader(LCUI_ImageReader reader)
 {
 	size_t size;
@@ -238,11 +261,12 @@ int LCUI_InitJPEGReader(LCUI_ImageReader reader)
 int LCUI_ReadJPEG(LCUI_ImageReader reader, LCUI_Graph *graph)
 {
 #ifdef USE_LIBJPEG
-	uchar_t *bytep;
+	uchar_t *bytep, tmp;
 	JSAMPARRAY buffer;
 	j_decompress_ptr cinfo;
-	int k, row_stride;
-	unsigned x;
+	LCUI_ImageScalerRec scaler;
+	unsigned x, rows, factor;
+	int row_stride;
 
 	if (reader->type != LCUI_JPEG_READER) {
 		return -EINVAL;
@@ -253,28 +277,38 @@ int LCUI_ReadJPEG(LCUI_ImageReader reader, LCUI_Graph *graph)
 		}
 	}
 	cinfo = reader->data;
+	JPEGReader_SetScale(cinfo, reader->target_width, reader->target_height);
 	jpeg_start_decompress(cinfo);
 	/* 暂时不处理其它色彩类型的图像 */
 	if (cinfo->num_components != 3) {
 		return -ENOSYS;
 	}
+	/* 如果 IDCT 缩放后的尺寸仍然过大，则再用盒式滤波器缩小 */
+	factor = ImageScaler_ComputeFactor(
+	    cinfo->output_width, cinfo->output_height, reader->target_width,
+	    reader->target_height);
 	graph->color_type = LCUI_COLOR_TYPE_RGB;
-	if (0 !=
-	    Graph_Create(graph, cinfo->output_width, cinfo->output_height)) {
+	if (0 != ImageScaler_Init(&scaler, graph, cinfo->output_width,
+				  cinfo->output_height, factor)) {
+		ImageScaler_Destroy(&scaler);
 		return -ENOMEM;
 	}
 	row_stride = cinfo->output_width * cinfo->output_components;
 	buffer = cinfo->mem->alloc_sarray((j_common_ptr)cinfo, JPOOL_IMAGE,
 					  row_stride, 1);
 	while (cinfo->output_scanline < cinfo->output_height) {
-		bytep = graph->bytes;
-		bytep += cinfo->output_scanline * graph->bytes_per_row;
 		jpeg_read_scanlines(cinfo, buffer, 1);
-		for (x = 0; x < graph->width; ++x) {
-			k = x * 3;
-			*bytep++ = buffer[0][k + 2];
-			*bytep++ = buffer[0][k + 1];
-			*bytep++ = buffer[0][k];
+		/* RGB -> BGR */
+		bytep = buffer[0];
+		for (x = 0; x < cinfo->output_width; ++x, bytep += 3) {
+			tmp = bytep[0];
+			bytep[0] = bytep[2];
+			bytep[2] = tmp;
+		}
+		rows = ImageScaler_WriteRow(&scaler, buffer[0]);
+		if (rows > 0 && reader->fn_rows) {
+			reader->fn_rows(reader->rows_arg, scaler.row - rows,
+					rows);
 		}
 		if (reader->fn_prog) {
 			reader->fn_prog(reader->prog_arg,
@@ -282,6 +316,11 @@ int LCUI_ReadJPEG(LCUI_ImageReader reader, LCUI_Graph *graph)
 					    cinfo->output_height);
 		}
 	}
+	rows = ImageScaler_Flush(&scaler);
+	if (rows > 0 && reader->fn_rows) {
+		reader->fn_rows(reader->rows_arg, scaler.row - rows, rows);
+	}
+	ImageScaler_Destroy(&scaler);
 	return 0;
 #else
 	Logger_Warning("warning: not JPEG support!");
@@ -46,6 +46,7 @@
 #ifdef USE_LIBPNG
 #include <png.h>
 #include <LCUI/image.h>
+#include "scaler.h"
 
 #define PNG_BYTES_TO_CHECK 4
 
@@ -80,6 +81,99 @@ static void PNGReader_OnRead(png_structp png_ptr, png_bytep buffer,
 		}
 	}
 }
+static void PNGReader_EmitRows(LCUI_ImageReader reader, unsigned row,
+			       unsigned count)
+{
+	if (count > 0 && reader->fn_rows) {
+		reader->fn_rows(reader->rows_arg, row, count);
+	}
+}
+
+/** 逐行解码并缩小图像，无需保存原尺寸的图像 */
+static int PNGReader_ReadScaledRows(LCUI_ImageReader reader,
+				    LCUI_Graph *graph, unsigned factor)
+{
+	png_uint_32 i;
+	png_bytep row;
+	unsigned rows;
+	LCUI_ImageScalerRec scaler;
+	LCUI_PNGReader png_reader = reader->data;
+	LCUI_ImageHeader header = &reader->header;
+
+	row = malloc(png_get_rowbytes(png_reader->png_ptr,
+				      png_reader->info_ptr));
+	if (!row) {
+		return -ENOMEM;
+	}
+	if (ImageScaler_Init(&scaler, graph, header->width, header->height,
+			     factor) != 0) {
+		ImageScaler_Destroy(&scaler);
+		free(row);
+		return -ENOMEM;
+	}
+	for (i = 0; i < header->height; ++i) {
+		png_read_row(png_reader->png_ptr, row, NULL);
+		rows = ImageScaler_WriteRow(&scaler, row);
+		PNGReader_EmitRows(reader, scaler.row - rows, rows);
+		if (reader->fn_prog) {
+			reader->fn_prog(reader->prog_arg,
+					100.0f * i / header->height);
+		}
+	}
+	rows = ImageScaler_Flush(&scaler);
+	PNGReader_EmitRows(reader, scaler.row - rows, rows);
+	ImageScaler_Destroy(&scaler);
+	free(row);
+	return 0;
+}
+
+/**
+ * 隔行扫描的图像在最后一遍扫描完成前，各行的数据都是不完整的，因此需要先解码出
+ * 完整的图像再缩小
+ */
+static int PNGReader_ReadScaledInterlacedRows(LCUI_ImageReader reader,
+					      LCUI_Graph *graph,
+					      unsigned factor,
+					      int number_passes)
+{
+	int pass;
+	png_uint_32 i;
+	LCUI_Graph full;
+	LCUI_ImageScalerRec scaler;
+	LCUI_PNGReader png_reader = reader->data;
+
+	Graph_Init(&full);
+	full.color_type = graph->color_type;
+	if (Graph_Create(&full, reader->header.width,
+			 reader->header.height) != 0) {
+		return -ENOMEM;
+	}
+	for (pass = 0; pass < number_passes; ++pass) {
+		for (i = 0; i < full.height; ++i) {
+			png_read_row(png_reader->png_ptr,
+				     full.bytes + i * full.bytes_per_row, NULL);
+		}
+		if (reader->fn_prog) {
+			reader->fn_prog(reader->prog_arg,
+					100.0f * (pass + 1) / number_passes);
+		}
+	}
+	if (ImageScaler_Init(&scaler, graph, full.width, full.height,
+			     factor) != 0) {
+		ImageScaler_Destroy(&scaler);
+		Graph_Free(&full);
+		return -ENOMEM;
+	}
+	for (i = 0; i < full.height; ++i) {
+		ImageScaler_WriteRow(&scaler,
+				     full.bytes + i * full.bytes_per_row);
+	}
+	ImageScaler_Flush(&scaler);
+	PNGReader_EmitRows(reader, 0, scaler.row);
+	ImageScaler_Destroy(&scaler);
+	Graph_Free(&full);
+	return 0;
+}
 #else
 #include <LCUI/image.h>
 #endif
@@ -168,6 +262,7 @@ int LCUI_ReadPNG(LCUI_ImageReader reader, LCUI_Graph *graph)
 	LCUI_ImageHeader header;
 	LCUI_PNGReader png_reader;
 	int pass, number_passes, ret = 0;
+	unsigned factor;
 	float progress;
 
 	if (reader->type != LCUI_PNG_READER) {
@@ -186,19 +281,9 @@ int LCUI_ReadPNG(LCUI_ImageReader reader, LCUI_Graph *graph)
 	switch (header->color_type) {
 	case LCUI_COLOR_TYPE_ARGB:
 		graph->color_type = LCUI_COLOR_TYPE_ARGB;
-		ret = Graph_Create(graph, header->width, header->height);
-		if (ret != 0) {
-			ret = -ENOMEM;
-			break;
-		}
 		break;
 	case LCUI_COLOR_TYPE_RGB:
 		graph->color_type = LCUI_COLOR_TYPE_RGB;
-		ret = Graph_Create(graph, header->width, header->height);
-		if (ret != 0) {
-			ret = -ENOMEM;
-			break;
-		}
 		break;
 	default:
 		/* 其它色彩类型的图像就不处理了 */
@@ -208,10 +293,25 @@ int LCUI_ReadPNG(LCUI_ImageReader reader, LCUI_Graph *graph)
 	png_set_expand(png_ptr);
 	number_passes = png_set_interlace_handling(png_ptr);
 	png_read_update_info(png_ptr, info_ptr);
+	factor = ImageScaler_ComputeFactor(header->width, header->height,
+					   reader->target_width,
+					   reader->target_height);
+	if (factor > 1) {
+		if (number_passes > 1) {
+			return PNGReader_ReadScaledInterlacedRows(
+			    reader, graph, factor, number_passes);
+		}
+		return PNGReader_ReadScaledRows(reader, graph, factor);
+	}
+	ret = Graph_Create(graph, header->width, header->height);
+	if (ret != 0) {
+		return -ENOMEM;
+	}
 	for (pass = 0; pass < number_passes; ++pass) {
 		for (i = 0; i < graph->height; ++i) {
 			row = graph->bytes + i * graph->bytes_per_row;
 			png_read_row(png_ptr, row, NULL);
+			PNGReader_EmitRows(reader, i, 1);
 			if (reader->fn_prog) {
 				progress = 100.0f * i / graph->height;
 				reader->fn_prog(reader->prog_arg, progress);
@@ -35,6 +35,7 @@
 #include <LCUI_Build.h>
 #include "config.h"
 #include <LCUI/types.h>
+#include <LCUI/util/mmap.h>
 #include <LCUI/graph.h>
 #include <LCUI/image.h>
 
@@ -81,6 +82,50 @@ void LCUI_SetImageReaderForFile(LCUI_ImageReader reader, FILE *fp)
 	reader->fn_rewind = FileStream_OnRewind;
 }
 
+static size_t MemoryStream_OnRead(void *data, void *buffer, size_t size)
+{
+	LCUI_ImageMemoryStream stream = data;
+
+	if (size > stream->size - stream->pos) {
+		size = stream->size - stream->pos;
+	}
+	memcpy(buffer, stream->data + stream->pos, size);
+	stream->pos += size;
+	return size;
+}
+
+static void MemoryStream_OnSkip(void *data, long offset)
+{
+	LCUI_ImageMemoryStream stream = data;
+
+	if (offset < 0 && (size_t)-offset > stream->pos) {
+		stream->pos = 0;
+	} else if (offset > 0 && (size_t)offset > stream->size - stream->pos) {
+		stream->pos = stream->size;
+	} else {
+		stream->pos += offset;
+	}
+}
+
+static void MemoryStream_OnRewind(void *data)
+{
+	LCUI_ImageMemoryStream stream = data;
+
+	stream->pos = 0;
+}
+
+void LCUI_SetImageReaderForMemory(LCUI_ImageReader reader, const void *data,
+				  size_t size)
+{
+	reader->memory.data = data;
+	reader->memory.size = size;
+	reader->memory.pos = 0;
+	reader->stream_data = &reader->memory;
+	reader->fn_skip = MemoryStream_OnSkip;
+	reader->fn_read = MemoryStream_OnRead;
+	reader->fn_rewind = MemoryStream_OnRewind;
+}
+
 static int DetectImageType(const char *filename)
 {
 	int i;
@@ -163,61 +208,68 @@ int LCUI_ReadImage(LCUI_ImageReader reader, LCUI_Graph *out)
 	return -2;
 }
 
-int LCUI_ReadImageFile(const char *filepath, LCUI_Graph *out)
+int LCUI_ReadImageFileEx(LCUI_ImageReader reader, const char *filepath,
+			 LCUI_Graph *out)
 {
 	int ret;
-	FILE *fp;
-	LCUI_ImageReaderRec reader = { 0 };
+	LCUI_MappedFile file;
 
-	fp = fopen(filepath, "rb");
-	if (!fp) {
+	file = LCUI_MapFile(filepath);
+	if (!file) {
 		return -ENOENT;
 	}
 	ret = DetectImageType(filepath);
-	LCUI_SetImageReaderForFile(&reader, fp);
+	LCUI_SetImageReaderForMemory(reader, file->data, file->size);
 	if (ret >= 0) {
-		ret = LCUI_InitImageReaderByType(&reader, ret);
+		ret = LCUI_InitImageReaderByType(reader, ret);
 	}
 	if (ret < 0) {
-		if (LCUI_InitImageReader(&reader) != 0) {
-			fclose(fp);
+		if (LCUI_InitImageReader(reader) != 0) {
+			LCUI_UnmapFile(file);
 			return -2;
 		}
 	}
-	if (LCUI_SetImageReaderJump(&reader)) {
+	if (LCUI_SetImageReaderJump(reader)) {
 		ret = -2;
 	} else {
-		ret = LCUI_ReadImage(&reader, out);
+		ret = LCUI_ReadImage(reader, out);
 	}
-	LCUI_DestroyImageReader(&reader);
-	fclose(fp);
+	LCUI_DestroyImageReader(reader);
+	LCUI_UnmapFile(file);
 	return ret;
 }
 
+int LCUI_ReadImageFile(const char *filepath, LCUI_Graph *out)
+{
+	LCUI_ImageReaderRec reader = { 0 };
+
+	return LCUI_ReadImageFileEx(&reader, filepath, out);
+}
+
 int LCUI_GetImageSize(const char *filepath, int *width, int *height)
 {
 	int ret;
-	FILE *fp;
+	LCUI_MappedFile file;
 	LCUI_ImageReaderRec reader = { 0 };
 
-	fp = fopen(filepath, "rb");
-	if (!fp) {
+	file = LCUI_MapFile(filepath);
+	if (!file) {
 		return -ENOENT;
 	}
 	ret = DetectImageType(filepath);
-	LCUI_SetImageReaderForFile(&reader, fp);
+	LCUI_SetImageReaderForMemory(&reader, file->data, file->size);
 	if (ret >= 0) {
 		ret = LCUI_InitImageReaderByType(&reader, ret);
 	}
 	if (ret < 0) {
 		if (LCUI_InitImageReader(&reader) != 0) {
-			fclose(fp);
+			LCUI_UnmapFile(file);
 			return -2;
 		}
 	}
 	*width = reader.header.width;
 	*height = reader.header.height;
 	LCUI_DestroyImageReader(&reader);
-	fclose(fp);
+	LCUI_UnmapFile(file);
 	return 0;
 }
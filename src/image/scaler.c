@@ -0,0 +1,185 @@
+/*
+ * scaler.c -- Row-streamed image scaler
+ *
+ * Copyright (c) 2020, Liu chao <lc-soft@live.cn> All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of LCUI nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <LCUI_Build.h>
+#include <LCUI/types.h>
+#include <LCUI/util/math.h>
+#include <LCUI/graph.h>
+#include "scaler.h"
+
+unsigned ImageScaler_ComputeFactor(unsigned width, unsigned height,
+				   unsigned target_width, unsigned target_height)
+{
+	unsigned fx, fy;
+
+	if (target_width < 1 && target_height < 1) {
+		return 1;
+	}
+	fx = target_width > 0 ? width / target_width : width;
+	fy = target_height > 0 ? height / target_height : height;
+	if (target_width < 1) {
+		fx = fy;
+	} else if (target_height > 0) {
+		fx = min(fx, fy);
+	}
+	return fx > 1 ? fx : 1;
+}
+
+int ImageScaler_Init(LCUI_ImageScaler scaler, LCUI_Graph *graph,
+		     unsigned width, unsigned height, unsigned factor)
+{
+	unsigned dst_width = (width + factor - 1) / factor;
+	unsigned dst_height = (height + factor - 1) / factor;
+
+	scaler->row = 0;
+	scaler->group_rows = 0;
+	scaler->factor = factor;
+	scaler->src_width = width;
+	scaler->src_height = height;
+	scaler->graph = graph;
+	scaler->sums = NULL;
+	if (Graph_Create(graph, dst_width, dst_height) != 0) {
+		return -ENOMEM;
+	}
+	if (factor > 1) {
+		scaler->sums = calloc(graph->bytes_per_row, sizeof(unsigned));
+		if (!scaler->sums) {
+			return -ENOMEM;
+		}
+	}
+	return 0;
+}
+
+static void ImageScaler_WriteGroup(LCUI_ImageScaler scaler)
+{
+	unsigned x, c, count, cols, alpha, color;
+	unsigned bpp = scaler->graph->bytes_per_pixel;
+	unsigned *sum = scaler->sums;
+	LCUI_BOOL is_argb =
+	    scaler->graph->color_type == LCUI_COLOR_TYPE_ARGB;
+	uchar_t *dst;
+
+	dst = scaler->graph->bytes + scaler->row * scaler->graph->bytes_per_row;
+	for (x = 0; x < scaler->graph->width; ++x) {
+		cols = scaler->src_width - x * scaler->factor;
+		cols = min(cols, scaler->factor);
+		count = cols * scaler->group_rows;
+		for (c = 0; c < bpp; ++c) {
+			dst[c] = (uchar_t)((sum[c] + count / 2) / count);
+			sum[c] = 0;
+		}
+		/* Unpremultiply the average color */
+		if (is_argb && dst[3] < 255) {
+			alpha = dst[3];
+			for (c = 0; c < 3; ++c) {
+				if (alpha < 1) {
+					dst[c] = 0;
+					continue;
+				}
+				color = (dst[c] * 255 + alpha / 2) / alpha;
+				dst[c] = (uchar_t)min(color, 255);
+			}
+		}
+		dst += bpp;
+		sum += bpp;
+	}
+	scaler->group_rows = 0;
+	scaler->row++;
+}
+
+unsigned ImageScaler_WriteRow(LCUI_ImageScaler scaler, const uchar_t *row)
+{
+	unsigned x, c, i;
+	unsigned bpp = scaler->graph->bytes_per_pixel;
+	unsigned *sum;
+	LCUI_BOOL is_argb =
+	    scaler->graph->color_type == LCUI_COLOR_TYPE_ARGB;
+
+	if (scaler->row >= scaler->graph->height) {
+		return 0;
+	}
+	if (scaler->factor == 1) {
+		memcpy(scaler->graph->bytes +
+			   scaler->row * scaler->graph->bytes_per_row,
+		       row, scaler->graph->bytes_per_row);
+		scaler->row++;
+		return 1;
+	}
+	/*
+	 * Sum the pixels of each box horizontally
+	 * The colors of ARGB pixels are premultiplied by their alpha values,
+	 * otherwise the color of the transparent pixels bleeds into the
+	 * edges of the opaque area.
+	 */
+	for (x = 0, i = 0; x < scaler->src_width; ++i) {
+		sum = scaler->sums + i * bpp;
+		for (; x < scaler->src_width && x < (i + 1) * scaler->factor;
+		     ++x) {
+			if (is_argb) {
+				for (c = 0; c < 3; ++c) {
+					sum[c] += (row[c] * row[3] + 127) / 255;
+				}
+				sum[3] += row[3];
+				row += 4;
+				continue;
+			}
+			for (c = 0; c < bpp; ++c) {
+				sum[c] += *row++;
+			}
+		}
+	}
+	scaler->group_rows++;
+	if (scaler->group_rows < scaler->factor) {
+		return 0;
+	}
+	ImageScaler_WriteGroup(scaler);
+	return 1;
+}
+
+unsigned ImageScaler_Flush(LCUI_ImageScaler scaler)
+{
+	if (scaler->group_rows < 1 || scaler->row >= scaler->graph->height) {
+		return 0;
+	}
+	ImageScaler_WriteGroup(scaler);
+	return 1;
+}
+
+void ImageScaler_Destroy(LCUI_ImageScaler scaler)
+{
+	if (scaler->sums) {
+		free(scaler->sums);
+	}
+	scaler->sums = NULL;
+	scaler->graph = NULL;
+}
@@ -0,0 +1,87 @@
+/*
+ * scaler.h -- Row-streamed image scaler
+ *
+ * Copyright (c) 2020, Liu chao <lc-soft@live.cn> All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of LCUI nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LCUI_IMAGE_SCALER_H
+#define LCUI_IMAGE_SCALER_H
+
+/**
+ * Row-streamed box filter
+ * Source rows are written one by one and averaged into the destination graph
+ * by a integer factor, so the full-size image never needs to be stored.
+ */
+typedef struct LCUI_ImageScalerRec_ {
+	/** the number of source pixels per destination pixel on each axis */
+	unsigned factor;
+	unsigned src_width;
+	unsigned src_height;
+
+	/** the number of source rows accumulated into the current group */
+	unsigned group_rows;
+
+	/** the next destination row to be written */
+	unsigned row;
+
+	/** the sums of each channel of the current row group */
+	unsigned *sums;
+
+	LCUI_Graph *graph;
+} LCUI_ImageScalerRec, *LCUI_ImageScaler;
+
+/**
+ * Compute the largest integer factor that keeps the scaled size not less
+ * than the target size
+ */
+unsigned ImageScaler_ComputeFactor(unsigned width, unsigned height,
+				   unsigned target_width,
+				   unsigned target_height);
+
+/**
+ * Initialize the scaler and create the destination graph
+ * The color type of the graph must be set before calling this function.
+ */
+int ImageScaler_Init(LCUI_ImageScaler scaler, LCUI_Graph *graph,
+		     unsigned width, unsigned height, unsigned factor);
+
+/**
+ * Write a source row
+ * The pixel format of the row must be the same as the destination graph.
+ * @returns the number of destination rows completed by this row
+ */
+unsigned ImageScaler_WriteRow(LCUI_ImageScaler scaler, const uchar_t *row);
+
+/**
+ * Flush the incomplete row group at the bottom edge
+ * @returns the number of destination rows completed
+ */
+unsigned ImageScaler_Flush(LCUI_ImageScaler scaler);
+
+void ImageScaler_Destroy(LCUI_ImageScaler scaler);
+
+#endif
@@ -61,6 +61,13 @@
 #define STATE_ACTIVE 1
 #define STATE_KILLED 0
 
+/**
+ * The maximum number of queued input events
+ * When the main loop falls behind, new motion events are merged into the last
+ * queued one instead of growing the queue.
+ */
+#define LCUI_MAX_QUEUED_EVENTS 1024
+
 typedef struct LCUI_MainLoopRec_ {
 	int state;       /**< 主循环的状态 */
 	LCUI_Thread tid; /**< 当前运行该主循环的线程的ID */
@@ -92,6 +99,21 @@ static struct LCUI_System {
 		LCUI_EventTrigger trigger;	/**< 系统事件容器 */
 		LCUI_Mutex mutex;		/**< 互斥锁 */
 	} event;
+	struct {
+		LCUI_Mutex mutex;
+		LCUI_SysEventRec *events;	/**< 等待分发的输入事件 */
+		size_t length;
+		size_t capacity;
+		LCUI_SysEventRec *spare;	/**< 备用的事件缓存 */
+		size_t spare_capacity;
+
+		/** 当前正在分发的事件所合并的原始事件 */
+		const LCUI_SysEventRec *coalesced;
+		size_t coalesced_count;
+
+		int64_t frame_start_time;	/**< 本帧最早的输入事件的时间 */
+		long latency;			/**< 最近一次的输入延迟 */
+	} input;
 } System;
 
 #define LCUI_WORKER_NUM 4
@@ -113,6 +135,12 @@ static struct LCUI_App {
 	LCUI_ProfileRec profile;
 	LCUI_FrameProfile frame;
 	int settings_change_handler_id;
+	struct {
+		LCUI_Mutex mutex;
+		LCUI_Cond cond;
+		LCUI_BOOL signaled;		/**< 是否有新的事件或任务 */
+		LCUI_BOOL waiting;		/**< 主循环是否正在等待 */
+	} wakeup;
 } MainApp;
 
 /* clang-format on */
@@ -153,6 +181,7 @@ static void LCUIProfile_Print(LCUI_Profile profile)
 			     frame->widget_tasks.destroy_time);
 		Logger_Debug("render: %zu, %ldms, %ldms\n", frame->render_count,
 			     frame->render_time, frame->present_time);
+		Logger_Debug("input_latency: %ldms\n", frame->input_latency);
 	}
 }
 
@@ -188,6 +217,8 @@ static void OnSettingsChangeEvent(LCUI_SysEvent e, void *arg)
 	StepTimer_SetFrameLimit(MainApp.timer, MainApp.settings.frame_rate_cap);
 }
 
+static long LCUI_EndInputFrame(void);
+
 void LCUI_RunFrameWithProfile(LCUI_FrameProfile profile)
 {
 	profile->timers_time = clock();
@@ -209,27 +240,61 @@ void LCUI_RunFrameWithProfile(LCUI_FrameProfile profile)
 	profile->present_time = clock();
 	LCUIDisplay_Present();
 	profile->present_time = clock() - profile->present_time;
+	profile->input_latency = LCUI_EndInputFrame();
 }
 
-void LCUI_RunFrame(void)
+/** Run a frame and return the amount of work done in it */
+static size_t LCUI_RunFrameWithCount(void)
 {
-	LCUI_ProcessTimers();
-	LCUI_ProcessEvents();
+	size_t count;
+
+	count = LCUI_ProcessTimers();
+	count += LCUI_ProcessEvents();
 	LCUICursor_Update();
-	LCUIWidget_Update();
+	count += LCUIWidget_Update();
 	LCUIDisplay_Update();
-	LCUIDisplay_Render();
+	count += LCUIDisplay_Render();
 	LCUIDisplay_Present();
+	LCUI_EndInputFrame();
+	return count;
+}
+
+void LCUI_RunFrame(void)
+{
+	LCUI_RunFrameWithCount();
 }
 
 static void LCUI_InitEvent(void)
 {
 	LCUIMutex_Init(&System.event.mutex);
+	LCUIMutex_Init(&System.input.mutex);
 	System.event.trigger = EventTrigger();
+	System.input.events = NULL;
+	System.input.length = 0;
+	System.input.capacity = 0;
+	System.input.spare = NULL;
+	System.input.spare_capacity = 0;
+	System.input.coalesced = NULL;
+	System.input.coalesced_count = 0;
+	System.input.frame_start_time = 0;
+	System.input.latency = -1;
 }
 
 static void LCUI_FreeEvent(void)
 {
+	size_t i;
+
+	for (i = 0; i < System.input.length; ++i) {
+		LCUI_DestroyEvent(&System.input.events[i]);
+	}
+	free(System.input.events);
+	free(System.input.spare);
+	System.input.events = NULL;
+	System.input.spare = NULL;
+	System.input.length = 0;
+	System.input.capacity = 0;
+	System.input.spare_capacity = 0;
+	LCUIMutex_Destroy(&System.input.mutex);
 	LCUIMutex_Destroy(&System.event.mutex);
 	EventTrigger_Destroy(System.event.trigger);
 	System.event.trigger = NULL;
@@ -285,13 +350,11 @@ int LCUI_UnbindEvent(int handler_id)
 	return ret;
 }
 
-int LCUI_TriggerEvent(LCUI_SysEvent e, void *arg)
+static int LCUI_DispatchEvent(LCUI_SysEvent e, void *arg)
 {
-	if (System.state != STATE_ACTIVE) {
-		return -1;
-	}
 	int ret;
 	SysEventPackRec pack;
+
 	pack.arg = arg;
 	pack.event = e;
 	LCUIMutex_Lock(&System.event.mutex);
@@ -300,6 +363,153 @@ int LCUI_TriggerEvent(LCUI_SysEvent e, void *arg)
 	return ret;
 }
 
+int LCUI_TriggerEvent(LCUI_SysEvent e, void *arg)
+{
+	int ret;
+
+	if (System.state != STATE_ACTIVE) {
+		return -1;
+	}
+	e->timestamp = LCUI_GetTime();
+	ret = LCUI_DispatchEvent(e, arg);
+	LCUI_WakeUp();
+	return ret;
+}
+
+int LCUI_PostEvent(LCUI_SysEvent e)
+{
+	size_t capacity;
+	LCUI_SysEvent tail;
+	LCUI_SysEventRec *events;
+
+	if (System.state != STATE_ACTIVE) {
+		LCUI_DestroyEvent(e);
+		return -1;
+	}
+	if (!e->timestamp) {
+		e->timestamp = LCUI_GetTime();
+	}
+	LCUIMutex_Lock(&System.input.mutex);
+	if (System.input.length >= LCUI_MAX_QUEUED_EVENTS) {
+		tail = &System.input.events[System.input.length - 1];
+		if (e->type == LCUI_MOUSEMOVE && tail->type == LCUI_MOUSEMOVE) {
+			tail->timestamp = e->timestamp;
+			tail->motion.x = e->motion.x;
+			tail->motion.y = e->motion.y;
+			tail->motion.xrel += e->motion.xrel;
+			tail->motion.yrel += e->motion.yrel;
+			LCUIMutex_Unlock(&System.input.mutex);
+			LCUI_WakeUp();
+			return 0;
+		}
+	}
+	if (System.input.length >= System.input.capacity) {
+		capacity = max(System.input.capacity * 2, 64);
+		events = realloc(System.input.events,
+				 capacity * sizeof(LCUI_SysEventRec));
+		if (!events) {
+			LCUIMutex_Unlock(&System.input.mutex);
+			LCUI_DestroyEvent(e);
+			return -ENOMEM;
+		}
+		System.input.events = events;
+		System.input.capacity = capacity;
+	}
+	System.input.events[System.input.length++] = *e;
+	LCUIMutex_Unlock(&System.input.mutex);
+	LCUI_WakeUp();
+	return 0;
+}
+
+size_t LCUI_GetCoalescedEvents(const LCUI_SysEventRec **events)
+{
+	*events = System.input.coalesced;
+	return System.input.coalesced_count;
+}
+
+long LCUI_GetInputLatency(void)
+{
+	return System.input.latency;
+}
+
+/**
+ * Dispatch the queued input events
+ * The queue is detached before dispatching, so the event handlers can post
+ * new events or run a nested main loop safely.
+ */
+static size_t LCUI_DispatchInputEvents(void)
+{
+	size_t i, j, n, capacity, coalesced_count;
+	const LCUI_SysEventRec *coalesced;
+	LCUI_SysEventRec *events, ev;
+
+	LCUIMutex_Lock(&System.input.mutex);
+	n = System.input.length;
+	if (n < 1) {
+		LCUIMutex_Unlock(&System.input.mutex);
+		return 0;
+	}
+	events = System.input.events;
+	capacity = System.input.capacity;
+	System.input.events = System.input.spare;
+	System.input.capacity = System.input.spare_capacity;
+	System.input.length = 0;
+	System.input.spare = NULL;
+	System.input.spare_capacity = 0;
+	LCUIMutex_Unlock(&System.input.mutex);
+
+	coalesced = System.input.coalesced;
+	coalesced_count = System.input.coalesced_count;
+	if (!System.input.frame_start_time) {
+		System.input.frame_start_time = events[0].timestamp;
+	}
+	for (i = 0; i < n; i = j) {
+		ev = events[i];
+		for (j = i + 1; ev.type == LCUI_MOUSEMOVE && j < n; ++j) {
+			if (events[j].type != LCUI_MOUSEMOVE) {
+				break;
+			}
+			ev.timestamp = events[j].timestamp;
+			ev.motion.x = events[j].motion.x;
+			ev.motion.y = events[j].motion.y;
+			ev.motion.xrel += events[j].motion.xrel;
+			ev.motion.yrel += events[j].motion.yrel;
+		}
+		System.input.coalesced = events + i;
+		System.input.coalesced_count = j - i;
+		LCUI_DispatchEvent(&ev, NULL);
+	}
+	System.input.coalesced = coalesced;
+	System.input.coalesced_count = coalesced_count;
+	for (i = 0; i < n; ++i) {
+		LCUI_DestroyEvent(&events[i]);
+	}
+	LCUIMutex_Lock(&System.input.mutex);
+	if (System.input.spare) {
+		free(events);
+	} else {
+		System.input.spare = events;
+		System.input.spare_capacity = capacity;
+	}
+	LCUIMutex_Unlock(&System.input.mutex);
+	return n;
+}
+
+/**
+ * Update the input latency after the frame is presented
+ * @returns the input latency of this frame, -1 if the frame handled no input
+ */
+static long LCUI_EndInputFrame(void)
+{
+	if (!System.input.frame_start_time) {
+		return -1;
+	}
+	System.input.latency =
+	    (long)LCUI_GetTimeDelta(System.input.frame_start_time);
+	System.input.frame_start_time = 0;
+	return System.input.latency;
+}
+
 int LCUI_CreateTouchEvent(LCUI_SysEvent e, LCUI_TouchPoint points, int n_points)
 {
 	e->type = LCUI_TOUCH;
@@ -342,6 +552,9 @@ size_t LCUI_ProcessEvents(void)
 	if (MainApp.driver_ready) {
 		MainApp.driver->ProcessEvents();
 	}
+	count = LCUI_DispatchInputEvents();
+	count += LCUIWidget_ProcessEvents();
+	count += Object_FlushNotifications();
 	while (LCUIWorker_RunTask(MainApp.main_worker)) {
 		++count;
 	}
@@ -354,9 +567,61 @@ LCUI_BOOL LCUI_PostTask(LCUI_Task task)
 		return FALSE;
 	}
 	LCUIWorker_PostTask(MainApp.main_worker, task);
+	LCUI_WakeUp();
 	return TRUE;
 }
 
+void LCUI_WakeUp(void)
+{
+	if (!MainApp.active) {
+		return;
+	}
+	LCUIMutex_Lock(&MainApp.wakeup.mutex);
+	MainApp.wakeup.signaled = TRUE;
+	if (MainApp.wakeup.waiting) {
+		if (MainApp.driver_ready && MainApp.driver->WakeUp) {
+			MainApp.driver->WakeUp();
+		}
+		LCUICond_Signal(&MainApp.wakeup.cond);
+	}
+	LCUIMutex_Unlock(&MainApp.wakeup.mutex);
+}
+
+/**
+ * Sleep until something wakes up the main loop or the next timer expires
+ * The main loop calls this function instead of running empty frames, the
+ * input, posted tasks, timers and the widget changes made from other threads
+ * all end the sleep by calling LCUI_WakeUp().
+ */
+static void LCUIApp_WaitWakeUp(void)
+{
+	long timeout = LCUI_GetNextTimerDelay();
+
+	if (timeout == 0) {
+		return;
+	}
+	LCUIMutex_Lock(&MainApp.wakeup.mutex);
+	if (MainApp.wakeup.signaled || LCUIWidget_HasPendingUpdates()) {
+		MainApp.wakeup.signaled = FALSE;
+		LCUIMutex_Unlock(&MainApp.wakeup.mutex);
+		return;
+	}
+	MainApp.wakeup.waiting = TRUE;
+	if (MainApp.driver_ready && MainApp.driver->WaitEvent) {
+		LCUIMutex_Unlock(&MainApp.wakeup.mutex);
+		MainApp.driver->WaitEvent((int)timeout);
+		LCUIMutex_Lock(&MainApp.wakeup.mutex);
+	} else if (timeout < 0) {
+		LCUICond_Wait(&MainApp.wakeup.cond, &MainApp.wakeup.mutex);
+	} else {
+		LCUICond_TimedWait(&MainApp.wakeup.cond, &MainApp.wakeup.mutex,
+				   (unsigned)timeout);
+	}
+	MainApp.wakeup.waiting = FALSE;
+	MainApp.wakeup.signaled = FALSE;
+	LCUIMutex_Unlock(&MainApp.wakeup.mutex);
+}
+
 void LCUI_PostAsyncTaskTo(LCUI_Task task, int worker_id)
 {
 	int id = 0;
@@ -417,17 +682,19 @@ int LCUIMainLoop_Run(LCUI_MainLoop loop)
 	DEBUG_MSG("loop: %p, enter\n", loop);
 	MainApp.loop = loop;
 	while (loop->state != STATE_EXITED) {
+		/* 记录性能数据时需要连续的帧，所以不进入空闲等待 */
 		if (MainApp.settings.record_profile) {
 			MainApp.frame = LCUIProfile_BeginFrame(
 			    &MainApp.profile, &MainApp.settings);
 			LCUI_RunFrameWithProfile(MainApp.frame);
 			LCUIProfile_EndFrame(&MainApp.profile,
 					     &MainApp.settings);
-		} else {
-			LCUI_RunFrame();
+			StepTimer_Remain(MainApp.timer);
+		} else if (LCUI_RunFrameWithCount() > 0) {
+			StepTimer_Remain(MainApp.timer);
+		} else if (loop->state != STATE_EXITED) {
+			LCUIApp_WaitWakeUp();
 		}
-
-		StepTimer_Remain(MainApp.timer);
 		/* 如果当前运行的主循环不是自己 */
 		while (MainApp.loop != loop) {
 			loop->state = STATE_PAUSED;
@@ -450,6 +717,7 @@ int LCUIMainLoop_Run(LCUI_MainLoop loop)
 void LCUIMainLoop_Quit(LCUI_MainLoop loop)
 {
 	loop->state = STATE_EXITED;
+	LCUI_WakeUp();
 }
 
 void LCUIMainLoop_Destroy(LCUI_MainLoop loop)
@@ -472,6 +740,10 @@ void LCUI_InitApp(LCUI_AppDriver app)
 	MainApp.timer = StepTimer_Create();
 	LCUICond_Init(&MainApp.loop_changed);
 	LCUIMutex_Init(&MainApp.loop_mutex);
+	LCUICond_Init(&MainApp.wakeup.cond);
+	LCUIMutex_Init(&MainApp.wakeup.mutex);
+	MainApp.wakeup.signaled = FALSE;
+	MainApp.wakeup.waiting = FALSE;
 	LinkedList_Init(&MainApp.loops);
 	LCUIProfile_Init(&MainApp.profile);
 	LCUI_ResetSettings();
@@ -524,6 +796,8 @@ static void LCUI_FreeApp(void)
 	StepTimer_Destroy(MainApp.timer);
 	LCUIMutex_Destroy(&MainApp.loop_mutex);
 	LCUICond_Destroy(&MainApp.loop_changed);
+	LCUIMutex_Destroy(&MainApp.wakeup.mutex);
+	LCUICond_Destroy(&MainApp.wakeup.cond);
 	LinkedList_Clear(&MainApp.loops, OnDeleteMainLoop);
 	if (MainApp.driver_ready) {
 		LCUI_DestroyAppDriver(MainApp.driver);
@@ -573,6 +847,7 @@ static void LCUIApp_QuitAllMainLoop(void)
 			loop->state = STATE_EXITED;
 		}
 	}
+	LCUI_WakeUp();
 }
 
 static void LCUI_ShowCopyrightText(void)
@@ -650,6 +925,7 @@ void LCUI_InitBase(void)
 	System.state = STATE_ACTIVE;
 	System.thread = LCUIThread_SelfID();
 	LCUI_ShowCopyrightText();
+	LCUI_InitMappedFiles();
 	LCUI_InitEvent();
 	LCUI_InitFontLibrary();
 	LCUI_InitTimer();
@@ -702,6 +978,8 @@ int LCUI_Destroy(void)
 	LCUI_FreeTimer();
 	LCUI_FreeEvent();
 	LCUI_FreeMetrics();
+	LCUI_FreeMappedFiles();
+	Logger_Flush();
 	return System.exit_code;
 }
 
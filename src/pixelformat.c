@@ -0,0 +1,321 @@
+/*
+ * pixelformat.c -- Pixel format conversion
+ *
+ * Copyright (c) 2020, Liu chao <lc-soft@live.cn> All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of LCUI nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include <LCUI_Build.h>
+#include <LCUI/types.h>
+#include <LCUI/pixelformat.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define USE_SSE2
+#endif
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#define USE_SSSE3
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define USE_NEON
+#endif
+/* The packed pixels are accessed as 32-bit words in little-endian order */
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define USE_SWAR
+#endif
+
+/** 4x4 Bayer matrix, the values are in the range 0 to 15 */
+static const uchar_t bayer4x4[4][4] = {
+	{ 0, 8, 2, 10 }, { 12, 4, 14, 6 }, { 3, 11, 1, 9 }, { 15, 7, 13, 5 }
+};
+
+/**
+ * Dither thresholds of a row for a channel quantized to the given bits
+ * The threshold is in the range [0, 256 >> bits), it is added to the channel
+ * value before the low bits are dropped.
+ */
+static void GetDitherRow(uchar_t thresholds[4], int x, int y, int bits)
+{
+	int i;
+	int shift = bits - 4;
+
+	for (i = 0; i < 4; ++i) {
+		uchar_t v = bayer4x4[y & 3][(x + i) & 3];
+		thresholds[i] = shift > 0 ? v >> shift : v << -shift;
+	}
+}
+
+INLINE uchar_t AddSat(uchar_t a, uchar_t b)
+{
+	unsigned v = a + b;
+	return v > 255 ? 255 : (uchar_t)v;
+}
+
+/*--------------------------------- RGB888 ---------------------------------*/
+
+INLINE void StoreU32(uchar_t *out, uint32_t v)
+{
+	memcpy(out, &v, sizeof(v));
+}
+
+INLINE uint32_t LoadU32(const uchar_t *in)
+{
+	uint32_t v;
+	memcpy(&v, in, sizeof(v));
+	return v;
+}
+
+void PixelFormat_ARGBToRGB888(uchar_t *out, const LCUI_ARGB *in,
+			      size_t count)
+{
+	size_t i = 0;
+	const uint32_t *px = (const uint32_t *)in;
+
+#ifdef USE_SSSE3
+	const __m128i mask = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13,
+					   14, -1, -1, -1, -1);
+	/* A store writes 16 bytes for 12 bytes of output, so stop early */
+	for (; i + 6 <= count; i += 4, out += 12) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(px + i));
+		_mm_storeu_si128((__m128i *)out, _mm_shuffle_epi8(v, mask));
+	}
+#endif
+#ifdef USE_SWAR
+	/* Pack four pixels into three 32-bit words */
+	for (; i + 4 <= count; i += 4, out += 12) {
+		uint32_t p0 = px[i];
+		uint32_t p1 = px[i + 1];
+		uint32_t p2 = px[i + 2];
+		uint32_t p3 = px[i + 3];
+
+		StoreU32(out, (p0 & 0xffffff) | (p1 << 24));
+		StoreU32(out + 4, ((p1 >> 8) & 0xffff) | (p2 << 16));
+		StoreU32(out + 8, ((p2 >> 16) & 0xff) | (p3 << 8));
+	}
+#endif
+	for (; i < count; ++i) {
+		*out++ = in[i].b;
+		*out++ = in[i].g;
+		*out++ = in[i].r;
+	}
+}
+
+void PixelFormat_RGB888ToARGB(LCUI_ARGB *out, const uchar_t *in,
+			      size_t count)
+{
+	size_t i = 0;
+	uint32_t *px = (uint32_t *)out;
+
+#ifdef USE_SWAR
+	/* Unpack three 32-bit words into four pixels */
+	for (; i + 4 <= count; i += 4, in += 12) {
+		uint32_t w0 = LoadU32(in);
+		uint32_t w1 = LoadU32(in + 4);
+		uint32_t w2 = LoadU32(in + 8);
+
+		px[i] = w0 | 0xff000000;
+		px[i + 1] = (w0 >> 24) | (w1 << 8) | 0xff000000;
+		px[i + 2] = (w1 >> 16) | (w2 << 16) | 0xff000000;
+		px[i + 3] = (w2 >> 8) | 0xff000000;
+	}
+#endif
+	for (; i < count; ++i) {
+		out[i].b = *in++;
+		out[i].g = *in++;
+		out[i].r = *in++;
+		out[i].a = 255;
+	}
+}
+
+/*--------------------------------- RGB565 ---------------------------------*/
+
+INLINE uint16_t ToRGB565(uchar_t r, uchar_t g, uchar_t b)
+{
+	return (uint16_t)(((r & 0xf8) << 8) | ((g & 0xfc) << 3) | (b >> 3));
+}
+
+#ifdef USE_SSE2
+
+static size_t ConvertRGB565_SSE2(uint16_t *out, const LCUI_ARGB *in,
+				 size_t count, const uchar_t *rb_thresholds,
+				 const uchar_t *g_thresholds)
+{
+	size_t i;
+	__m128i v0, v1, r, g, b;
+	const __m128i r_mask = _mm_set1_epi32(0xf800);
+	const __m128i g_mask = _mm_set1_epi32(0x07e0);
+	const __m128i b_mask = _mm_set1_epi32(0x001f);
+	const __m128i bias32 = _mm_set1_epi32(0x8000);
+	const __m128i bias16 = _mm_set1_epi16((short)0x8000);
+	__m128i thresholds = _mm_setzero_si128();
+
+	if (rb_thresholds) {
+		/* Each pixel gets the thresholds of its column in BGRA order */
+		thresholds = _mm_setr_epi8(
+		    rb_thresholds[0], g_thresholds[0], rb_thresholds[0], 0,
+		    rb_thresholds[1], g_thresholds[1], rb_thresholds[1], 0,
+		    rb_thresholds[2], g_thresholds[2], rb_thresholds[2], 0,
+		    rb_thresholds[3], g_thresholds[3], rb_thresholds[3], 0);
+	}
+	for (i = 0; i + 8 <= count; i += 8) {
+		v0 = _mm_loadu_si128((const __m128i *)(in + i));
+		v1 = _mm_loadu_si128((const __m128i *)(in + i + 4));
+		v0 = _mm_adds_epu8(v0, thresholds);
+		v1 = _mm_adds_epu8(v1, thresholds);
+
+		r = _mm_and_si128(_mm_srli_epi32(v0, 8), r_mask);
+		g = _mm_and_si128(_mm_srli_epi32(v0, 5), g_mask);
+		b = _mm_and_si128(_mm_srli_epi32(v0, 3), b_mask);
+		v0 = _mm_or_si128(_mm_or_si128(r, g), b);
+
+		r = _mm_and_si128(_mm_srli_epi32(v1, 8), r_mask);
+		g = _mm_and_si128(_mm_srli_epi32(v1, 5), g_mask);
+		b = _mm_and_si128(_mm_srli_epi32(v1, 3), b_mask);
+		v1 = _mm_or_si128(_mm_or_si128(r, g), b);
+
+		/* There is no unsigned saturating pack in SSE2, so bias the
+		 * values into the signed range and back */
+		v0 = _mm_sub_epi32(v0, bias32);
+		v1 = _mm_sub_epi32(v1, bias32);
+		v0 = _mm_add_epi16(_mm_packs_epi32(v0, v1), bias16);
+		_mm_storeu_si128((__m128i *)(out + i), v0);
+	}
+	return i;
+}
+
+#endif
+
+#ifdef USE_NEON
+
+static size_t ConvertRGB565_NEON(uint16_t *out, const LCUI_ARGB *in,
+				 size_t count, const uchar_t *rb_thresholds,
+				 const uchar_t *g_thresholds)
+{
+	size_t i;
+	uint8x8x4_t v;
+	uint16x8_t r, g, b;
+	uint8x8_t rb_dither = vdup_n_u8(0);
+	uint8x8_t g_dither = vdup_n_u8(0);
+
+	if (rb_thresholds) {
+		uchar_t rb[8], g8[8];
+
+		for (i = 0; i < 8; ++i) {
+			rb[i] = rb_thresholds[i & 3];
+			g8[i] = g_thresholds[i & 3];
+		}
+		rb_dither = vld1_u8(rb);
+		g_dither = vld1_u8(g8);
+	}
+	for (i = 0; i + 8 <= count; i += 8) {
+		/* Deinterleave 8 pixels into the B, G, R and A planes */
+		v = vld4_u8((const uint8_t *)(in + i));
+		b = vshll_n_u8(vqadd_u8(v.val[0], rb_dither), 8);
+		g = vshll_n_u8(vqadd_u8(v.val[1], g_dither), 8);
+		r = vshll_n_u8(vqadd_u8(v.val[2], rb_dither), 8);
+		r = vsriq_n_u16(r, g, 5);
+		r = vsriq_n_u16(r, b, 11);
+		vst1q_u16(out + i, r);
+	}
+	return i;
+}
+
+#endif
+
+void PixelFormat_ARGBToRGB565(uchar_t *out, const LCUI_ARGB *in,
+			      size_t count, int x, int y, LCUI_BOOL dither)
+{
+	size_t i = 0;
+	uchar_t rb_thresholds[4], g_thresholds[4];
+	const uchar_t *rb = NULL, *g = NULL;
+	uint16_t *px = (uint16_t *)out;
+
+	if (dither) {
+		GetDitherRow(rb_thresholds, x, y, 5);
+		GetDitherRow(g_thresholds, x, y, 6);
+		rb = rb_thresholds;
+		g = g_thresholds;
+	}
+#if defined(USE_SSE2)
+	i = ConvertRGB565_SSE2(px, in, count, rb, g);
+#elif defined(USE_NEON)
+	i = ConvertRGB565_NEON(px, in, count, rb, g);
+#endif
+	if (!dither) {
+		for (; i < count; ++i) {
+			px[i] = ToRGB565(in[i].r, in[i].g, in[i].b);
+		}
+		return;
+	}
+	for (; i < count; ++i) {
+		px[i] = ToRGB565(AddSat(in[i].r, rb[i & 3]),
+				 AddSat(in[i].g, g[i & 3]),
+				 AddSat(in[i].b, rb[i & 3]));
+	}
+}
+
+/*--------------------------------- Index8 ---------------------------------*/
+
+INLINE uchar_t ToIndex8(uchar_t r, uchar_t g, uchar_t b)
+{
+	return (uchar_t)((r & 0xe0) | ((g & 0xe0) >> 3) | (b >> 6));
+}
+
+void PixelFormat_ARGBToIndex8(uchar_t *out, const LCUI_ARGB *in,
+			      size_t count, int x, int y, LCUI_BOOL dither)
+{
+	size_t i;
+	uchar_t rg[4], b[4];
+
+	if (!dither) {
+		for (i = 0; i < count; ++i) {
+			out[i] = ToIndex8(in[i].r, in[i].g, in[i].b);
+		}
+		return;
+	}
+	GetDitherRow(rg, x, y, 3);
+	GetDitherRow(b, x, y, 2);
+	for (i = 0; i < count; ++i) {
+		out[i] = ToIndex8(AddSat(in[i].r, rg[i & 3]),
+				  AddSat(in[i].g, rg[i & 3]),
+				  AddSat(in[i].b, b[i & 3]));
+	}
+}
+
+void PixelFormat_GetIndex8Palette(LCUI_ARGB palette[256])
+{
+	unsigned i;
+
+	for (i = 0; i < 256; ++i) {
+		palette[i].r = (uchar_t)((i >> 5) * 255 / 7);
+		palette[i].g = (uchar_t)(((i >> 2) & 7) * 255 / 7);
+		palette[i].b = (uchar_t)((i & 3) * 255 / 3);
+		palette[i].a = 255;
+	}
+}
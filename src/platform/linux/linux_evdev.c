@@ -0,0 +1,946 @@
+/*
+ * linux_evdev.c -- evdev input support for linux.
+ *
+ * Copyright (c) 2020, Liu chao <lc-soft@live.cn> All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of LCUI nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include <LCUI_Build.h>
+#if defined(LCUI_BUILD_IN_LINUX) && defined(HAVE_LINUX_INPUT_H) && \
+    defined(HAVE_SYS_EPOLL_H)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/input.h>
+#include <LCUI/LCUI.h>
+#include <LCUI/thread.h>
+#include <LCUI/input.h>
+#include <LCUI/ime.h>
+#include <LCUI/display.h>
+#include <LCUI/platform.h>
+#include LCUI_EVENTS_H
+#include <LCUI/platform/linux/linux_evdev.h>
+
+#define EVDEV_MAX_DEVICES 16
+#define EVDEV_MAX_SLOTS 10
+#define EVDEV_MAX_KEYS 16
+#define EVDEV_READ_EVENTS 64
+#define EVDEV_KEYMAP_SIZE 128
+#define EVDEV_WHEEL_DELTA 20
+
+#ifndef input_event_sec
+#define input_event_sec time.tv_sec
+#define input_event_usec time.tv_usec
+#endif
+
+#define BITS_PER_LONG (sizeof(long) * 8)
+#define NBITS(N) (((N) + BITS_PER_LONG - 1) / BITS_PER_LONG)
+#define TEST_BIT(BITS, N) \
+	((BITS[(N) / BITS_PER_LONG] >> ((N) % BITS_PER_LONG)) & 1)
+#define SET_BIT(BITS, N) \
+	(BITS[(N) / BITS_PER_LONG] |= 1UL << ((N) % BITS_PER_LONG))
+#define CLEAR_BIT(BITS, N) \
+	(BITS[(N) / BITS_PER_LONG] &= ~(1UL << ((N) % BITS_PER_LONG)))
+
+typedef struct EvdevKeyRec_ {
+	/** the LCUI key code */
+	int code;
+
+	/** the character of the key on the US layout, 0 if not printable */
+	char ch;
+	char shift_ch;
+} EvdevKeyRec;
+
+typedef struct EvdevAxisRec_ {
+	int min;
+	int max;
+} EvdevAxisRec;
+
+typedef struct EvdevSlotRec_ {
+	/** the tracking id of the contact, -1 if the slot is unused */
+	int id;
+	int x, y;
+
+	/** the tracking id last posted to LCUI, -1 if none */
+	int posted_id;
+
+	/** the new state of the contact, LCUI_NONE if it is not changed */
+	int state;
+} EvdevSlotRec;
+
+typedef struct EvdevDeviceRec_ {
+	int fd;
+	int caps;
+	char *path;
+
+	/** whether the event time is reported by CLOCK_MONOTONIC */
+	LCUI_BOOL kernel_time;
+
+	/** whether the kernel dropped events, skip until the next report */
+	LCUI_BOOL dropped;
+
+	/** the bytes of the incomplete event of the last read */
+	unsigned char partial[sizeof(struct input_event)];
+	size_t partial_len;
+
+	EvdevAxisRec abs_x, abs_y;
+	EvdevAxisRec mt_x, mt_y;
+
+	int rel_x, rel_y, wheel;
+	int abs_pos_x, abs_pos_y;
+	LCUI_BOOL abs_moved;
+
+	/** the key and button changes of the current report */
+	struct input_event keys[EVDEV_MAX_KEYS];
+	int n_keys;
+
+	/** the keys and buttons posted as held down */
+	unsigned long key_bits[NBITS(KEY_MAX + 1)];
+
+	int slot;
+	LCUI_BOOL touch_changed;
+	EvdevSlotRec slots[EVDEV_MAX_SLOTS];
+
+	int64_t timestamp;
+} EvdevDeviceRec, *EvdevDevice;
+
+static struct LCUI_LinuxEvdevDriver {
+	int epoll_fd;
+	int wakeup_pipe[2];
+	int caps;
+	size_t n_devices;
+	EvdevDeviceRec devices[EVDEV_MAX_DEVICES];
+
+	int mouse_x, mouse_y;
+	int primary_touch_id;
+	LCUI_BOOL shift_key, ctrl_key, caps_lock;
+	int keypress_handler_id;
+
+	LCUI_Thread tid;
+	LCUI_BOOL active;
+} evdev;
+
+static const EvdevKeyRec evdev_keymap[EVDEV_KEYMAP_SIZE] = {
+	[KEY_ESC] = { LCUI_KEY_ESCAPE, 0, 0 },
+	[KEY_1] = { LCUI_KEY_1, '1', '!' },
+	[KEY_2] = { LCUI_KEY_2, '2', '@' },
+	[KEY_3] = { LCUI_KEY_3, '3', '#' },
+	[KEY_4] = { LCUI_KEY_4, '4', '$' },
+	[KEY_5] = { LCUI_KEY_5, '5', '%' },
+	[KEY_6] = { LCUI_KEY_6, '6', '^' },
+	[KEY_7] = { LCUI_KEY_7, '7', '&' },
+	[KEY_8] = { LCUI_KEY_8, '8', '*' },
+	[KEY_9] = { LCUI_KEY_9, '9', '(' },
+	[KEY_0] = { LCUI_KEY_0, '0', ')' },
+	[KEY_MINUS] = { LCUI_KEY_MINUS, '-', '_' },
+	[KEY_EQUAL] = { LCUI_KEY_EQUAL, '=', '+' },
+	[KEY_BACKSPACE] = { LCUI_KEY_BACKSPACE, 0, 0 },
+	[KEY_TAB] = { LCUI_KEY_TAB, 0, 0 },
+	[KEY_Q] = { LCUI_KEY_Q, 'q', 'Q' },
+	[KEY_W] = { LCUI_KEY_W, 'w', 'W' },
+	[KEY_E] = { LCUI_KEY_E, 'e', 'E' },
+	[KEY_R] = { LCUI_KEY_R, 'r', 'R' },
+	[KEY_T] = { LCUI_KEY_T, 't', 'T' },
+	[KEY_Y] = { LCUI_KEY_Y, 'y', 'Y' },
+	[KEY_U] = { LCUI_KEY_U, 'u', 'U' },
+	[KEY_I] = { LCUI_KEY_I, 'i', 'I' },
+	[KEY_O] = { LCUI_KEY_O, 'o', 'O' },
+	[KEY_P] = { LCUI_KEY_P, 'p', 'P' },
+	[KEY_LEFTBRACE] = { LCUI_KEY_BRACKETLEFT, '[', '{' },
+	[KEY_RIGHTBRACE] = { LCUI_KEY_BRACKETRIGHT, ']', '}' },
+	[KEY_ENTER] = { LCUI_KEY_ENTER, 0, 0 },
+	[KEY_LEFTCTRL] = { LCUI_KEY_CONTROL, 0, 0 },
+	[KEY_A] = { LCUI_KEY_A, 'a', 'A' },
+	[KEY_S] = { LCUI_KEY_S, 's', 'S' },
+	[KEY_D] = { LCUI_KEY_D, 'd', 'D' },
+	[KEY_F] = { LCUI_KEY_F, 'f', 'F' },
+	[KEY_G] = { LCUI_KEY_G, 'g', 'G' },
+	[KEY_H] = { LCUI_KEY_H, 'h', 'H' },
+	[KEY_J] = { LCUI_KEY_J, 'j', 'J' },
+	[KEY_K] = { LCUI_KEY_K, 'k', 'K' },
+	[KEY_L] = { LCUI_KEY_L, 'l', 'L' },
+	[KEY_SEMICOLON] = { LCUI_KEY_SEMICOLON, ';', ':' },
+	[KEY_APOSTROPHE] = { LCUI_KEY_APOSTROPHE, '\'', '"' },
+	[KEY_GRAVE] = { LCUI_KEY_GRAVE, '`', '~' },
+	[KEY_LEFTSHIFT] = { LCUI_KEY_SHIFT, 0, 0 },
+	[KEY_BACKSLASH] = { LCUI_KEY_BACKSLASH, '\\', '|' },
+	[KEY_Z] = { LCUI_KEY_Z, 'z', 'Z' },
+	[KEY_X] = { LCUI_KEY_X, 'x', 'X' },
+	[KEY_C] = { LCUI_KEY_C, 'c', 'C' },
+	[KEY_V] = { LCUI_KEY_V, 'v', 'V' },
+	[KEY_B] = { LCUI_KEY_B, 'b', 'B' },
+	[KEY_N] = { LCUI_KEY_N, 'n', 'N' },
+	[KEY_M] = { LCUI_KEY_M, 'm', 'M' },
+	[KEY_COMMA] = { LCUI_KEY_COMMA, ',', '<' },
+	[KEY_DOT] = { LCUI_KEY_PERIOD, '.', '>' },
+	[KEY_SLASH] = { LCUI_KEY_SLASH, '/', '?' },
+	[KEY_RIGHTSHIFT] = { LCUI_KEY_SHIFT, 0, 0 },
+	[KEY_LEFTALT] = { LCUI_KEY_ALT, 0, 0 },
+	[KEY_SPACE] = { LCUI_KEY_SPACE, ' ', ' ' },
+	[KEY_CAPSLOCK] = { LCUI_KEY_CAPITAL, 0, 0 },
+	[KEY_RIGHTCTRL] = { LCUI_KEY_CONTROL, 0, 0 },
+	[KEY_RIGHTALT] = { LCUI_KEY_ALT, 0, 0 },
+	[KEY_HOME] = { LCUI_KEY_HOME, 0, 0 },
+	[KEY_UP] = { LCUI_KEY_UP, 0, 0 },
+	[KEY_PAGEUP] = { LCUI_KEY_PAGEUP, 0, 0 },
+	[KEY_LEFT] = { LCUI_KEY_LEFT, 0, 0 },
+	[KEY_RIGHT] = { LCUI_KEY_RIGHT, 0, 0 },
+	[KEY_END] = { LCUI_KEY_END, 0, 0 },
+	[KEY_DOWN] = { LCUI_KEY_DOWN, 0, 0 },
+	[KEY_PAGEDOWN] = { LCUI_KEY_PAGEDOWN, 0, 0 },
+	[KEY_INSERT] = { LCUI_KEY_INSERT, 0, 0 },
+	[KEY_DELETE] = { LCUI_KEY_DELETE, 0, 0 }
+};
+
+static int EvdevAxis_Scale(const EvdevAxisRec *axis, int value, int size)
+{
+	if (axis->max <= axis->min) {
+		return value;
+	}
+	return (int)((int64_t)(value - axis->min) * size /
+		     (axis->max - axis->min + 1));
+}
+
+static void EvdevAxis_Init(EvdevAxisRec *axis, int fd, int code)
+{
+	struct input_absinfo info;
+
+	axis->min = 0;
+	axis->max = 0;
+	if (ioctl(fd, EVIOCGABS(code), &info) == 0) {
+		axis->min = info.minimum;
+		axis->max = info.maximum;
+	}
+}
+
+/** Query the capabilities of the device, a non-device file supports all */
+static int EvdevDevice_InitCaps(EvdevDevice dev)
+{
+	unsigned long evbits[NBITS(EV_MAX + 1)] = { 0 };
+	unsigned long keybits[NBITS(KEY_MAX + 1)] = { 0 };
+	unsigned long absbits[NBITS(ABS_MAX + 1)] = { 0 };
+
+	dev->caps = 0;
+	if (ioctl(dev->fd, EVIOCGBIT(0, sizeof(evbits)), evbits) < 0) {
+		return LCUI_EVDEV_POINTER | LCUI_EVDEV_KEYBOARD |
+		       LCUI_EVDEV_TOUCH;
+	}
+	ioctl(dev->fd, EVIOCGBIT(EV_KEY, sizeof(keybits)), keybits);
+	ioctl(dev->fd, EVIOCGBIT(EV_ABS, sizeof(absbits)), absbits);
+	if (TEST_BIT(evbits, EV_REL)) {
+		dev->caps |= LCUI_EVDEV_POINTER;
+	}
+	if (TEST_BIT(evbits, EV_KEY) && TEST_BIT(keybits, KEY_A)) {
+		dev->caps |= LCUI_EVDEV_KEYBOARD;
+	}
+	if (TEST_BIT(evbits, EV_ABS)) {
+		if (TEST_BIT(absbits, ABS_MT_POSITION_X)) {
+			dev->caps |= LCUI_EVDEV_TOUCH;
+			EvdevAxis_Init(&dev->mt_x, dev->fd, ABS_MT_POSITION_X);
+			EvdevAxis_Init(&dev->mt_y, dev->fd, ABS_MT_POSITION_Y);
+		} else if (TEST_BIT(absbits, ABS_X)) {
+			dev->caps |= LCUI_EVDEV_POINTER;
+		}
+		EvdevAxis_Init(&dev->abs_x, dev->fd, ABS_X);
+		EvdevAxis_Init(&dev->abs_y, dev->fd, ABS_Y);
+	}
+	return dev->caps;
+}
+
+static int EvdevDevice_Open(EvdevDevice dev, const char *path)
+{
+	int i, clk = CLOCK_MONOTONIC;
+
+	memset(dev, 0, sizeof(EvdevDeviceRec));
+	dev->fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+	if (dev->fd < 0) {
+		return -errno;
+	}
+	dev->caps = EvdevDevice_InitCaps(dev);
+	if (!dev->caps) {
+		close(dev->fd);
+		dev->fd = -1;
+		return -ENODEV;
+	}
+	/* Let the kernel report the event time by the same clock as
+	 * LCUI_GetTime(), then the input latency can be measured from the
+	 * moment the hardware generated the event */
+	dev->kernel_time = ioctl(dev->fd, EVIOCSCLOCKID, &clk) == 0;
+	for (i = 0; i < EVDEV_MAX_SLOTS; ++i) {
+		dev->slots[i].id = -1;
+		dev->slots[i].posted_id = -1;
+	}
+	dev->path = strdup(path);
+	return 0;
+}
+
+static void EvdevDevice_Close(EvdevDevice dev)
+{
+	if (dev->fd < 0) {
+		return;
+	}
+	if (evdev.epoll_fd >= 0) {
+		epoll_ctl(evdev.epoll_fd, EPOLL_CTL_DEL, dev->fd, NULL);
+	}
+	close(dev->fd);
+	free(dev->path);
+	dev->path = NULL;
+	dev->fd = -1;
+}
+
+static void Evdev_PostMouseMotion(EvdevDevice dev, int x, int y)
+{
+	LCUI_SysEventRec ev = { 0 };
+
+	x = max(0, min(x, LCUIDisplay_GetWidth() - 1));
+	y = max(0, min(y, LCUIDisplay_GetHeight() - 1));
+	if (x == evdev.mouse_x && y == evdev.mouse_y) {
+		return;
+	}
+	ev.type = LCUI_MOUSEMOVE;
+	ev.timestamp = dev->timestamp;
+	ev.motion.x = x;
+	ev.motion.y = y;
+	ev.motion.xrel = x - evdev.mouse_x;
+	ev.motion.yrel = y - evdev.mouse_y;
+	evdev.mouse_x = x;
+	evdev.mouse_y = y;
+	LCUI_PostEvent(&ev);
+}
+
+static void Evdev_PostButton(EvdevDevice dev, int button, int value)
+{
+	LCUI_SysEventRec ev = { 0 };
+
+	ev.type = value ? LCUI_MOUSEDOWN : LCUI_MOUSEUP;
+	ev.timestamp = dev->timestamp;
+	ev.button.x = evdev.mouse_x;
+	ev.button.y = evdev.mouse_y;
+	ev.button.button = button;
+	LCUI_PostEvent(&ev);
+}
+
+static void Evdev_PostKey(EvdevDevice dev, int code, int value)
+{
+	char ch;
+	LCUI_SysEventRec ev = { 0 };
+	const EvdevKeyRec *key;
+
+	if (code >= EVDEV_KEYMAP_SIZE || !evdev_keymap[code].code) {
+		return;
+	}
+	key = &evdev_keymap[code];
+	switch (code) {
+	case KEY_LEFTSHIFT:
+	case KEY_RIGHTSHIFT:
+		evdev.shift_key = value != 0;
+		break;
+	case KEY_LEFTCTRL:
+	case KEY_RIGHTCTRL:
+		evdev.ctrl_key = value != 0;
+		break;
+	case KEY_CAPSLOCK:
+		if (value == 1) {
+			evdev.caps_lock = !evdev.caps_lock;
+		}
+		break;
+	default:
+		break;
+	}
+	/* A value of 2 means auto-repeat, it is reported as another key down */
+	ev.type = value ? LCUI_KEYDOWN : LCUI_KEYUP;
+	ev.timestamp = dev->timestamp;
+	ev.key.code = key->code;
+	ev.key.shift_key = evdev.shift_key;
+	ev.key.ctrl_key = evdev.ctrl_key;
+	LCUI_PostEvent(&ev);
+	if (!value || !key->ch || evdev.ctrl_key) {
+		return;
+	}
+	ch = evdev.shift_key ? key->shift_ch : key->ch;
+	if (evdev.caps_lock && key->code >= LCUI_KEY_A &&
+	    key->code <= LCUI_KEY_Z) {
+		ch = ch == key->ch ? key->shift_ch : key->ch;
+	}
+	ev.type = LCUI_KEYPRESS;
+	ev.key.code = ch;
+	LCUI_PostEvent(&ev);
+}
+
+static void Evdev_PostTouch(EvdevDevice dev)
+{
+	int i, n = 0;
+	EvdevSlotRec *slot;
+	LCUI_SysEventRec ev = { 0 };
+	LCUI_TouchPointRec points[EVDEV_MAX_SLOTS];
+
+	for (i = 0; i < EVDEV_MAX_SLOTS; ++i) {
+		slot = &dev->slots[i];
+		if (slot->id < 0) {
+			continue;
+		}
+		points[n].id = slot->id;
+		points[n].x = EvdevAxis_Scale(&dev->mt_x, slot->x,
+					      LCUIDisplay_GetWidth());
+		points[n].y = EvdevAxis_Scale(&dev->mt_y, slot->y,
+					      LCUIDisplay_GetHeight());
+		points[n].state = slot->state == LCUI_NONE ? LCUI_TOUCHMOVE
+							   : slot->state;
+		if (slot->state == LCUI_TOUCHDOWN &&
+		    evdev.primary_touch_id < 0) {
+			evdev.primary_touch_id = slot->id;
+		}
+		points[n].is_primary = slot->id == evdev.primary_touch_id;
+		if (slot->state == LCUI_TOUCHUP) {
+			if (slot->id == evdev.primary_touch_id) {
+				evdev.primary_touch_id = -1;
+			}
+			slot->id = -1;
+		}
+		slot->posted_id = slot->id;
+		slot->state = LCUI_NONE;
+		++n;
+	}
+	if (n < 1 || LCUI_CreateTouchEvent(&ev, points, n) != 0) {
+		return;
+	}
+	ev.timestamp = dev->timestamp;
+	LCUI_PostEvent(&ev);
+}
+
+/** Post the events accumulated since the last report */
+static void EvdevDevice_Flush(EvdevDevice dev)
+{
+	int i;
+	struct input_event *key;
+
+	if (dev->rel_x || dev->rel_y) {
+		Evdev_PostMouseMotion(dev, evdev.mouse_x + dev->rel_x,
+				      evdev.mouse_y + dev->rel_y);
+	} else if (dev->abs_moved) {
+		Evdev_PostMouseMotion(
+		    dev,
+		    EvdevAxis_Scale(&dev->abs_x, dev->abs_pos_x,
+				    LCUIDisplay_GetWidth()),
+		    EvdevAxis_Scale(&dev->abs_y, dev->abs_pos_y,
+				    LCUIDisplay_GetHeight()));
+	}
+	if (dev->wheel) {
+		LCUI_SysEventRec ev = { 0 };
+
+		ev.type = LCUI_MOUSEWHEEL;
+		ev.timestamp = dev->timestamp;
+		ev.wheel.x = evdev.mouse_x;
+		ev.wheel.y = evdev.mouse_y;
+		ev.wheel.delta = dev->wheel * EVDEV_WHEEL_DELTA;
+		LCUI_PostEvent(&ev);
+	}
+	for (i = 0; i < dev->n_keys; ++i) {
+		key = &dev->keys[i];
+		if (key->code <= KEY_MAX) {
+			if (key->value) {
+				SET_BIT(dev->key_bits, key->code);
+			} else {
+				CLEAR_BIT(dev->key_bits, key->code);
+			}
+		}
+		switch (key->code) {
+		case BTN_TOUCH:
+			/* Multi-touch devices report contacts as touch events */
+			if (!(dev->caps & LCUI_EVDEV_TOUCH)) {
+				Evdev_PostButton(dev, LCUI_KEY_LEFTBUTTON,
+						 key->value);
+			}
+			break;
+		case BTN_LEFT:
+			Evdev_PostButton(dev, LCUI_KEY_LEFTBUTTON, key->value);
+			break;
+		case BTN_RIGHT:
+			Evdev_PostButton(dev, LCUI_KEY_RIGHTBUTTON,
+					 key->value);
+			break;
+		default:
+			Evdev_PostKey(dev, key->code, key->value);
+			break;
+		}
+	}
+	if (dev->touch_changed) {
+		Evdev_PostTouch(dev);
+	}
+	dev->rel_x = 0;
+	dev->rel_y = 0;
+	dev->wheel = 0;
+	dev->n_keys = 0;
+	dev->abs_moved = FALSE;
+	dev->touch_changed = FALSE;
+}
+
+static void EvdevDevice_HandleAbs(EvdevDevice dev, struct input_event *e)
+{
+	EvdevSlotRec *slot = NULL;
+
+	if (dev->slot >= 0 && dev->slot < EVDEV_MAX_SLOTS) {
+		slot = &dev->slots[dev->slot];
+	}
+	switch (e->code) {
+	case ABS_X:
+		dev->abs_pos_x = e->value;
+		dev->abs_moved = !(dev->caps & LCUI_EVDEV_TOUCH);
+		break;
+	case ABS_Y:
+		dev->abs_pos_y = e->value;
+		dev->abs_moved = !(dev->caps & LCUI_EVDEV_TOUCH);
+		break;
+	case ABS_MT_SLOT:
+		dev->slot = e->value;
+		break;
+	case ABS_MT_TRACKING_ID:
+		if (!slot) {
+			break;
+		}
+		if (e->value < 0) {
+			slot->state = LCUI_TOUCHUP;
+		} else {
+			slot->id = e->value;
+			slot->state = LCUI_TOUCHDOWN;
+		}
+		dev->touch_changed = TRUE;
+		break;
+	case ABS_MT_POSITION_X:
+		if (slot) {
+			slot->x = e->value;
+			dev->touch_changed = TRUE;
+		}
+		break;
+	case ABS_MT_POSITION_Y:
+		if (slot) {
+			slot->y = e->value;
+			dev->touch_changed = TRUE;
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+/** Discard the changes of the report which the kernel failed to complete */
+static void EvdevDevice_Drop(EvdevDevice dev)
+{
+	int i;
+
+	for (i = 0; i < EVDEV_MAX_SLOTS; ++i) {
+		dev->slots[i].id = dev->slots[i].posted_id;
+		dev->slots[i].state = LCUI_NONE;
+	}
+	dev->rel_x = 0;
+	dev->rel_y = 0;
+	dev->wheel = 0;
+	dev->n_keys = 0;
+	dev->abs_moved = FALSE;
+	dev->touch_changed = FALSE;
+	dev->dropped = TRUE;
+}
+
+static void EvdevDevice_AddKey(EvdevDevice dev, int code, int value)
+{
+	struct input_event *key;
+
+	if (dev->n_keys >= EVDEV_MAX_KEYS) {
+		EvdevDevice_Flush(dev);
+	}
+	key = &dev->keys[dev->n_keys++];
+	memset(key, 0, sizeof(struct input_event));
+	key->type = EV_KEY;
+	key->code = code;
+	key->value = value;
+}
+
+/**
+ * Query the state of the device after the kernel dropped events, and post
+ * the changes that were lost
+ * If the state cannot be queried, all keys are released and all contacts
+ * are lifted.
+ */
+static void EvdevDevice_Resync(EvdevDevice dev)
+{
+	int i, code;
+	EvdevSlotRec *slot;
+	struct input_absinfo info;
+	unsigned long keys[NBITS(KEY_MAX + 1)];
+	struct {
+		__u32 code;
+		__s32 values[EVDEV_MAX_SLOTS];
+	} ids, xs, ys;
+
+	if (ioctl(dev->fd, EVIOCGKEY(sizeof(keys)), keys) < 0) {
+		memset(keys, 0, sizeof(keys));
+	}
+	for (code = 0; code <= KEY_MAX; ++code) {
+		if (TEST_BIT(keys, code) != TEST_BIT(dev->key_bits, code)) {
+			EvdevDevice_AddKey(dev, code,
+					   (int)TEST_BIT(keys, code));
+		}
+	}
+	if (!(dev->caps & LCUI_EVDEV_TOUCH) &&
+	    ioctl(dev->fd, EVIOCGABS(ABS_X), &info) == 0) {
+		dev->abs_pos_x = info.value;
+		dev->abs_moved = TRUE;
+	}
+	if (!(dev->caps & LCUI_EVDEV_TOUCH) &&
+	    ioctl(dev->fd, EVIOCGABS(ABS_Y), &info) == 0) {
+		dev->abs_pos_y = info.value;
+		dev->abs_moved = TRUE;
+	}
+	ids.code = ABS_MT_TRACKING_ID;
+	xs.code = ABS_MT_POSITION_X;
+	ys.code = ABS_MT_POSITION_Y;
+	if (!(dev->caps & LCUI_EVDEV_TOUCH) ||
+	    ioctl(dev->fd, EVIOCGMTSLOTS(sizeof(ids)), &ids) < 0 ||
+	    ioctl(dev->fd, EVIOCGMTSLOTS(sizeof(xs)), &xs) < 0 ||
+	    ioctl(dev->fd, EVIOCGMTSLOTS(sizeof(ys)), &ys) < 0) {
+		for (i = 0; i < EVDEV_MAX_SLOTS; ++i) {
+			ids.values[i] = -1;
+		}
+	}
+	/* Lift the contacts which ended or were replaced while the events
+	 * were dropped, before the new contacts are reported */
+	for (i = 0; i < EVDEV_MAX_SLOTS; ++i) {
+		slot = &dev->slots[i];
+		if (slot->id >= 0 && slot->id != ids.values[i]) {
+			slot->state = LCUI_TOUCHUP;
+			dev->touch_changed = TRUE;
+		}
+	}
+	EvdevDevice_Flush(dev);
+	for (i = 0; i < EVDEV_MAX_SLOTS; ++i) {
+		slot = &dev->slots[i];
+		if (ids.values[i] < 0) {
+			continue;
+		}
+		if (slot->id != ids.values[i]) {
+			slot->id = ids.values[i];
+			slot->state = LCUI_TOUCHDOWN;
+		}
+		slot->x = xs.values[i];
+		slot->y = ys.values[i];
+		dev->touch_changed = TRUE;
+	}
+	/* The primary contact may have been lifted with the dropped events */
+	for (i = 0; i < EVDEV_MAX_SLOTS; ++i) {
+		if (dev->slots[i].id >= 0 &&
+		    dev->slots[i].id == evdev.primary_touch_id) {
+			break;
+		}
+	}
+	if (i == EVDEV_MAX_SLOTS && (dev->caps & LCUI_EVDEV_TOUCH)) {
+		evdev.primary_touch_id = -1;
+	}
+	if (ioctl(dev->fd, EVIOCGABS(ABS_MT_SLOT), &info) == 0) {
+		dev->slot = info.value;
+	}
+	EvdevDevice_Flush(dev);
+}
+
+static void EvdevDevice_HandleEvent(EvdevDevice dev, struct input_event *e)
+{
+	if (dev->kernel_time) {
+		dev->timestamp = (int64_t)e->input_event_sec * 1000 +
+				 e->input_event_usec / 1000;
+	}
+	if (dev->dropped) {
+		if (e->type == EV_SYN && e->code == SYN_REPORT) {
+			dev->dropped = FALSE;
+			EvdevDevice_Resync(dev);
+		}
+		return;
+	}
+	switch (e->type) {
+	case EV_SYN:
+		if (e->code == SYN_REPORT) {
+			EvdevDevice_Flush(dev);
+		} else if (e->code == SYN_DROPPED) {
+			EvdevDevice_Drop(dev);
+		}
+		break;
+	case EV_REL:
+		if (e->code == REL_X) {
+			dev->rel_x += e->value;
+		} else if (e->code == REL_Y) {
+			dev->rel_y += e->value;
+		} else if (e->code == REL_WHEEL) {
+			dev->wheel += e->value;
+		}
+		break;
+	case EV_ABS:
+		EvdevDevice_HandleAbs(dev, e);
+		break;
+	case EV_KEY:
+		EvdevDevice_AddKey(dev, e->code, e->value);
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * Read all available events of the device
+ * @returns the number of the events, -1 if the device is closed
+ */
+static int EvdevDevice_Read(EvdevDevice dev)
+{
+	ssize_t n;
+	size_t i, len;
+	int count = 0;
+	struct input_event events[EVDEV_READ_EVENTS];
+	unsigned char *buf = (unsigned char *)events;
+
+	while (1) {
+		len = dev->partial_len;
+		memcpy(buf, dev->partial, len);
+		n = read(dev->fd, buf + len, sizeof(events) - len);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return errno == EAGAIN ? count : -1;
+		}
+		if (n == 0) {
+			return -1;
+		}
+		if (!dev->kernel_time) {
+			dev->timestamp = LCUI_GetTime();
+		}
+		len += n;
+		for (i = 0; i < len / sizeof(struct input_event); ++i) {
+			EvdevDevice_HandleEvent(dev, &events[i]);
+			++count;
+		}
+		dev->partial_len = len % sizeof(struct input_event);
+		memcpy(dev->partial, buf + len - dev->partial_len,
+		       dev->partial_len);
+	}
+}
+
+static void LinuxEvdevThread(void *arg)
+{
+	int i, n;
+	EvdevDevice dev;
+	struct epoll_event events[EVDEV_MAX_DEVICES + 1];
+
+	while (evdev.active) {
+		n = epoll_wait(evdev.epoll_fd, events, EVDEV_MAX_DEVICES + 1,
+			       -1);
+		for (i = 0; i < n && evdev.active; ++i) {
+			dev = events[i].data.ptr;
+			if (!dev) {
+				continue;
+			}
+			if (EvdevDevice_Read(dev) < 0) {
+				Logger_Debug("[input] device closed: %s\n",
+					     dev->path);
+				EvdevDevice_Close(dev);
+			}
+		}
+	}
+	LCUIThread_Exit(NULL);
+}
+
+static void OnKeyPress(LCUI_SysEvent e, void *arg)
+{
+	wchar_t text[2] = { e->key.code, 0 };
+	LCUIIME_Commit(text, 1);
+}
+
+static void Evdev_AddDevice(const char *path)
+{
+	EvdevDevice dev;
+	struct epoll_event ev;
+
+	if (evdev.n_devices >= EVDEV_MAX_DEVICES) {
+		return;
+	}
+	dev = &evdev.devices[evdev.n_devices];
+	if (EvdevDevice_Open(dev, path) != 0) {
+		return;
+	}
+	ev.events = EPOLLIN;
+	ev.data.ptr = dev;
+	if (epoll_ctl(evdev.epoll_fd, EPOLL_CTL_ADD, dev->fd, &ev) == 0) {
+		evdev.caps |= dev->caps;
+		evdev.n_devices++;
+		Logger_Debug("[input] open device: %s, caps: %d\n", path,
+			     dev->caps);
+		return;
+	}
+	/* A regular file cannot be polled, its recorded events are replayed
+	 * at once */
+	if (errno == EPERM) {
+		Logger_Debug("[input] replay events from: %s\n", path);
+		EvdevDevice_Read(dev);
+		EvdevDevice_Flush(dev);
+	}
+	EvdevDevice_Close(dev);
+}
+
+static void Evdev_ScanDevices(void)
+{
+	DIR *dir;
+	struct dirent *entry;
+	char path[512];
+
+	dir = opendir("/dev/input");
+	if (!dir) {
+		return;
+	}
+	while ((entry = readdir(dir))) {
+		if (strncmp(entry->d_name, "event", 5) != 0) {
+			continue;
+		}
+		snprintf(path, sizeof(path), "/dev/input/%s", entry->d_name);
+		Evdev_AddDevice(path);
+	}
+	closedir(dir);
+}
+
+static void Evdev_AddDevices(const char *paths)
+{
+	char *str, *path, *saveptr;
+
+	str = strdup(paths);
+	if (!str) {
+		return;
+	}
+	for (path = strtok_r(str, ":", &saveptr); path;
+	     path = strtok_r(NULL, ":", &saveptr)) {
+		Evdev_AddDevice(path);
+	}
+	free(str);
+}
+
+static void Evdev_CloseDevices(void)
+{
+	size_t i;
+
+	for (i = 0; i < evdev.n_devices; ++i) {
+		EvdevDevice_Close(&evdev.devices[i]);
+	}
+	close(evdev.epoll_fd);
+	evdev.epoll_fd = -1;
+	evdev.n_devices = 0;
+	evdev.caps = 0;
+}
+
+static int Evdev_InitWakeUpPipe(void)
+{
+	int i, flags;
+
+	if (pipe(evdev.wakeup_pipe) != 0) {
+		return -errno;
+	}
+	for (i = 0; i < 2; ++i) {
+		flags = fcntl(evdev.wakeup_pipe[i], F_GETFL);
+		fcntl(evdev.wakeup_pipe[i], F_SETFL, flags | O_NONBLOCK);
+		fcntl(evdev.wakeup_pipe[i], F_SETFD, FD_CLOEXEC);
+	}
+	return 0;
+}
+
+int LCUI_InitLinuxEvdev(void)
+{
+	struct epoll_event ev;
+	const char *paths = getenv("LCUI_INPUT_DEVICES");
+
+	if (evdev.active) {
+		return evdev.caps;
+	}
+	evdev.caps = 0;
+	evdev.n_devices = 0;
+	evdev.primary_touch_id = -1;
+	evdev.keypress_handler_id = -1;
+	evdev.mouse_x = LCUIDisplay_GetWidth() / 2;
+	evdev.mouse_y = LCUIDisplay_GetHeight() / 2;
+	evdev.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (evdev.epoll_fd < 0) {
+		Logger_Error("[input] epoll_create1 failed\n");
+		return 0;
+	}
+	if (paths) {
+		Evdev_AddDevices(paths);
+	} else {
+		Evdev_ScanDevices();
+	}
+	if (evdev.n_devices < 1 || Evdev_InitWakeUpPipe() != 0) {
+		Evdev_CloseDevices();
+		return 0;
+	}
+	ev.events = EPOLLIN;
+	ev.data.ptr = NULL;
+	epoll_ctl(evdev.epoll_fd, EPOLL_CTL_ADD, evdev.wakeup_pipe[0], &ev);
+	if (evdev.caps & LCUI_EVDEV_KEYBOARD) {
+		evdev.keypress_handler_id =
+		    LCUI_BindEvent(LCUI_KEYPRESS, OnKeyPress, NULL, NULL);
+	}
+	evdev.active = TRUE;
+	LCUIThread_Create(&evdev.tid, LinuxEvdevThread, NULL);
+	Logger_Debug("[input] evdev driver thread: %lld\n", evdev.tid);
+	return evdev.caps;
+}
+
+int LCUI_GetLinuxEvdevCaps(void)
+{
+	return evdev.active ? evdev.caps : 0;
+}
+
+void LCUI_FreeLinuxEvdev(void)
+{
+	char c = 0;
+
+	if (!evdev.active) {
+		return;
+	}
+	evdev.active = FALSE;
+	if (write(evdev.wakeup_pipe[1], &c, 1) == 1) {
+		LCUIThread_Join(evdev.tid, NULL);
+	}
+	close(evdev.wakeup_pipe[0]);
+	close(evdev.wakeup_pipe[1]);
+	if (evdev.keypress_handler_id >= 0) {
+		LCUI_UnbindEvent(evdev.keypress_handler_id);
+		evdev.keypress_handler_id = -1;
+	}
+	Evdev_CloseDevices();
+}
+
+#endif
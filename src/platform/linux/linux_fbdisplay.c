@@ -47,11 +47,13 @@
 #include <LCUI/display.h>
 #include <LCUI/platform.h>
 #include <LCUI/painter.h>
+#include <LCUI/pixelformat.h>
 #include LCUI_DISPLAY_H
 #include LCUI_EVENTS_H
 
 #define MIN_WIDTH 320
 #define MIN_HEIGHT 240
+#define MAX_PAGES 3
 
 enum SurfaceTaskType { TASK_RESIZE, TASK_DELETE, TASK_TOTAL_NUM };
 
@@ -87,9 +89,34 @@ static struct LCUI_DisplayModule {
 
 		struct fb_var_screeninfo var_info;
 		struct fb_fix_screeninfo fix_info;
+		/** the screen info to be restored on exit */
+		struct fb_var_screeninfo orig_var_info;
+		/** the palette to be restored on exit */
 		struct fb_cmap cmap;
+		__u16 cmap_buf[256 * 3];
+
+		/** whether FBIO_WAITFORVSYNC is supported */
+		LCUI_BOOL vsync;
+
+		/** whether to dither the pixels on 8-bit and 16-bit screens */
+		LCUI_BOOL dither;
 	} fb;
 
+	/**
+	 * Pages of the virtual screen
+	 * If the driver supports panning, the surface is presented to the back
+	 * page and then the display is panned to it, otherwise there is only
+	 * one page and it is always visible.
+	 */
+	struct LCUI_FrameBufferPage {
+		LCUI_Graph canvas;
+
+		/** rectangles that are out of date in this page */
+		LinkedList rects;
+	} pages[MAX_PAGES];
+	unsigned num_pages;
+	unsigned front_page;
+
 	unsigned width;
 	unsigned height;
 
@@ -207,84 +234,76 @@ static void FBSurface_EndPaint(LCUI_Surface surface, LCUI_PaintContext paint)
 	LCUIPainter_End(paint);
 }
 
-static void FBDisplay_SyncRect16(LCUI_Graph *canvas, int x, int y)
+static void FBDisplay_SyncRect16(LCUI_Graph *page, LCUI_Graph *canvas, int x,
+				 int y)
 {
-	uint32_t iy, ix;
+	int iy;
 	LCUI_Rect rect;
-	LCUI_ARGB *pixel, *pixel_row;
-	unsigned char *dst, *dst_row;
+	LCUI_Graph *source;
+	LCUI_ARGB *pixel_row;
+	unsigned char *dst_row;
 
 	Graph_GetValidRect(canvas, &rect);
-	pixel_row = canvas->argb + rect.y * canvas->width + rect.x;
-	dst_row = display.fb.mem + y * display.canvas.bytes_per_row + x * 2;
-	for (iy = 0; iy < rect.width; ++iy) {
-		dst = dst_row;
-		pixel = pixel_row;
-		for (ix = 0; ix < rect.width; ++ix) {
-			dst[0] = (pixel->r & 0xF8) | (pixel->b >> 5);
-			dst[1] = ((pixel->g & 0x1C) << 3) | (pixel->b >> 3);
-		}
-		pixel_row += canvas->width;
-		dst_row += display.canvas.bytes_per_row;
+	source = Graph_GetQuote(canvas);
+	pixel_row = source->argb + rect.y * source->width + rect.x;
+	dst_row = page->bytes + y * page->bytes_per_row + x * 2;
+	for (iy = 0; iy < rect.height; ++iy) {
+		PixelFormat_ARGBToRGB565(dst_row, pixel_row, rect.width, x,
+					 y + iy, display.fb.dither);
+		pixel_row += source->width;
+		dst_row += page->bytes_per_row;
 	}
 }
 
-static void FBDisplay_SyncRect8(LCUI_Graph *canvas, int x, int y)
+static void FBDisplay_SyncRect8(LCUI_Graph *page, LCUI_Graph *canvas, int x,
+				int y)
 {
-	uint32_t ix, iy;
+	int iy;
 	LCUI_Rect rect;
-	LCUI_ARGB *pixel, *pixel_row;
-	unsigned char *dst, *dst_row;
-	unsigned int r, g, b, i;
-	struct fb_cmap cmap;
-	__u16 cmap_buf[256 * 3] = { 0 };
-
-	cmap.start = 0;
-	cmap.len = 255;
-	cmap.transp = 0;
-	cmap.red = cmap_buf;
-	cmap.green = cmap_buf + 256;
-	cmap.blue = cmap_buf + 512;
+	LCUI_Graph *source;
+	LCUI_ARGB *pixel_row;
+	unsigned char *dst_row;
 
 	Graph_GetValidRect(canvas, &rect);
-	pixel_row = canvas->argb + rect.y * canvas->width + rect.x;
-	dst_row = display.fb.mem + y * display.canvas.bytes_per_row + x;
+	source = Graph_GetQuote(canvas);
+	pixel_row = source->argb + rect.y * source->width + rect.x;
+	dst_row = page->bytes + y * page->bytes_per_row + x;
 	for (iy = 0; iy < rect.height; ++iy) {
-		dst = dst_row;
-		pixel = pixel_row;
-		for (ix = 0; ix < rect.width; ++ix, ++dst) {
-			r = pixel->r * 0.92;
-			g = pixel->g * 0.92;
-			b = pixel->b * 0.92;
-
-			i = ((r & 0xc0)) + ((g & 0xf0) >> 2) +
-			    ((b & 0xc0) >> 6);
-
-			cmap.red[i] = r * 256;
-			cmap.green[i] = g * 256;
-			cmap.blue[i] = b * 256;
-			*dst = (((r & 0xc0)) + ((g & 0xf0) >> 2) +
-				((b & 0xc0) >> 6));
-		}
-		pixel_row += canvas->width;
-		dst_row += display.canvas.bytes_per_row;
+		PixelFormat_ARGBToIndex8(dst_row, pixel_row, rect.width, x,
+					 y + iy, display.fb.dither);
+		pixel_row += source->width;
+		dst_row += page->bytes_per_row;
 	}
-	ioctl(display.fb.dev_fd, FBIOPUTCMAP, &cmap);
 }
 
-static void FBDisplay_SyncRect24(LCUI_Graph *canvas, int x, int y)
+static void FBDisplay_SyncRect24(LCUI_Graph *page, LCUI_Graph *canvas, int x,
+				 int y)
 {
-	Graph_Replace(&display.canvas, canvas, x, y);
-}
+	int iy;
+	LCUI_Rect rect;
+	LCUI_Graph *source;
+	LCUI_ARGB *pixel_row;
+	unsigned char *dst_row;
 
-#include <LCUI/image.h>
+	Graph_GetValidRect(canvas, &rect);
+	source = Graph_GetQuote(canvas);
+	pixel_row = source->argb + rect.y * source->width + rect.x;
+	dst_row = page->bytes + y * page->bytes_per_row + x * 3;
+	for (iy = 0; iy < rect.height; ++iy) {
+		PixelFormat_ARGBToRGB888(dst_row, pixel_row, rect.width);
+		pixel_row += source->width;
+		dst_row += page->bytes_per_row;
+	}
+}
 
-static void FBDisplay_SyncRect32(LCUI_Graph *canvas, int x, int y)
+static void FBDisplay_SyncRect32(LCUI_Graph *page, LCUI_Graph *canvas, int x,
+				 int y)
 {
-	Graph_Replace(&display.canvas, canvas, x, y);
+	Graph_Replace(page, canvas, x, y);
 }
 
-static void FBDisplay_SyncRect(LCUI_Surface surface, LCUI_Rect *rect)
+static void FBDisplay_SyncRect(LCUI_Graph *page, LCUI_Surface surface,
+			       LCUI_Rect *rect)
 {
 	int x, y;
 	LCUI_Graph canvas;
@@ -306,31 +325,89 @@ static void FBDisplay_SyncRect(LCUI_Surface surface, LCUI_Rect *rect)
 	/* Write pixels to the framebuffer by pixel format */
 	switch (display.fb.var_info.bits_per_pixel) {
 	case 32:
-		FBDisplay_SyncRect32(&canvas, x, y);
+		FBDisplay_SyncRect32(page, &canvas, x, y);
 		break;
 	case 24:
-		FBDisplay_SyncRect24(&canvas, x, y);
+		FBDisplay_SyncRect24(page, &canvas, x, y);
 		break;
 	case 16:
-		FBDisplay_SyncRect16(&canvas, x, y);
+		FBDisplay_SyncRect16(page, &canvas, x, y);
 		break;
 	case 8:
-		FBDisplay_SyncRect8(&canvas, x, y);
+		FBDisplay_SyncRect8(page, &canvas, x, y);
 		break;
 	default:
 		break;
 	}
 }
 
+static void FBDisplay_WaitVSync(void)
+{
+#ifdef FBIO_WAITFORVSYNC
+	__u32 crtc = 0;
+
+	if (!display.fb.vsync) {
+		return;
+	}
+	if (ioctl(display.fb.dev_fd, FBIO_WAITFORVSYNC, &crtc) != 0) {
+		Logger_Debug("[display] FBIO_WAITFORVSYNC is not supported\n");
+		display.fb.vsync = FALSE;
+	}
+#endif
+}
+
+static void FBDisplay_PanToPage(unsigned i)
+{
+	display.fb.var_info.xoffset = 0;
+	display.fb.var_info.yoffset = display.height * i;
+	if (ioctl(display.fb.dev_fd, FBIOPAN_DISPLAY, &display.fb.var_info) !=
+	    0) {
+		Logger_Error("[display] framebuffer pan failed\n");
+		return;
+	}
+	display.front_page = i;
+}
+
 static void FBSurface_Present(LCUI_Surface surface)
 {
+	unsigned i;
 	LinkedListNode *node;
+	struct LCUI_FrameBufferPage *page;
+
 	LCUIMutex_Lock(&surface->mutex);
-	for (LinkedList_Each(node, &surface->rects)) {
-		FBDisplay_SyncRect(surface, node->data);
+	if (display.num_pages < 2) {
+		page = &display.pages[0];
+		FBDisplay_WaitVSync();
+		for (LinkedList_Each(node, &surface->rects)) {
+			FBDisplay_SyncRect(&page->canvas, surface, node->data);
+		}
+		LinkedList_Clear(&surface->rects, free);
+		LCUIMutex_Unlock(&surface->mutex);
+		return;
+	}
+	if (surface->rects.length < 1) {
+		LCUIMutex_Unlock(&surface->mutex);
+		return;
+	}
+	/* The updated rectangles are out of date in every page, but only the
+	 * back page needs to be brought up to date now */
+	for (i = 0; i < display.num_pages; ++i) {
+		for (LinkedList_Each(node, &surface->rects)) {
+			RectList_Add(&display.pages[i].rects, node->data);
+		}
 	}
 	LinkedList_Clear(&surface->rects, free);
+	i = (display.front_page + 1) % display.num_pages;
+	page = &display.pages[i];
+	for (LinkedList_Each(node, &page->rects)) {
+		FBDisplay_SyncRect(&page->canvas, surface, node->data);
+	}
+	RectList_Clear(&page->rects);
 	LCUIMutex_Unlock(&surface->mutex);
+	/* The pan takes effect at the next vertical blank, wait for it so that
+	 * the old front page is no longer scanned out when it is drawn next */
+	FBDisplay_PanToPage(i);
+	FBDisplay_WaitVSync();
 }
 
 /** 更新 surface，应用缓存的变更 */
@@ -439,8 +516,87 @@ static void FBDisplay_PrintInfo(void)
 	    display.fb.var_info.transp.offset);
 }
 
+/**
+ * Try to enlarge the virtual screen for page flipping
+ * The page count can be set by LCUI_FRAMEBUFFER_PAGES, it defaults to 2.
+ */
+static unsigned FBDisplay_InitPages(void)
+{
+	unsigned n = 2;
+	const char *str = getenv("LCUI_FRAMEBUFFER_PAGES");
+	struct fb_var_screeninfo var_info = display.fb.var_info;
+
+	if (str) {
+		n = strtoul(str, NULL, 10);
+		n = max(1, min(n, MAX_PAGES));
+	}
+	for (; n > 1; --n) {
+		if (display.fb.var_info.yres_virtual >= display.height * n) {
+			break;
+		}
+		var_info.yres_virtual = display.height * n;
+		var_info.yoffset = 0;
+		if (ioctl(display.fb.dev_fd, FBIOPUT_VSCREENINFO, &var_info) ==
+		    0) {
+			break;
+		}
+	}
+	ioctl(display.fb.dev_fd, FBIOGET_VSCREENINFO, &display.fb.var_info);
+	ioctl(display.fb.dev_fd, FBIOGET_FSCREENINFO, &display.fb.fix_info);
+	n = min(n, display.fb.var_info.yres_virtual / display.height);
+	n = min(n, display.fb.fix_info.smem_len /
+		       (display.fb.fix_info.line_length * display.height));
+	if (n < 2) {
+		return 1;
+	}
+	/* Make sure that the driver can pan the display */
+	display.fb.var_info.xoffset = 0;
+	display.fb.var_info.yoffset = 0;
+	if (ioctl(display.fb.dev_fd, FBIOPAN_DISPLAY, &display.fb.var_info) !=
+	    0) {
+		Logger_Warning("[display] framebuffer panning is not "
+			       "supported, page flipping is disabled\n");
+		return 1;
+	}
+	return n;
+}
+
+/** Set the fixed palette used by PixelFormat_ARGBToIndex8() */
+static void FBDisplay_InitPalette(void)
+{
+	unsigned i;
+	struct fb_cmap cmap;
+	LCUI_ARGB palette[256];
+	__u16 cmap_buf[256 * 3];
+
+	display.fb.cmap.start = 0;
+	display.fb.cmap.len = 256;
+	display.fb.cmap.transp = NULL;
+	display.fb.cmap.red = display.fb.cmap_buf;
+	display.fb.cmap.green = display.fb.cmap_buf + 256;
+	display.fb.cmap.blue = display.fb.cmap_buf + 512;
+	if (ioctl(display.fb.dev_fd, FBIOGETCMAP, &display.fb.cmap) != 0) {
+		display.fb.cmap.len = 0;
+	}
+	cmap = display.fb.cmap;
+	cmap.red = cmap_buf;
+	cmap.green = cmap_buf + 256;
+	cmap.blue = cmap_buf + 512;
+	cmap.len = 256;
+	PixelFormat_GetIndex8Palette(palette);
+	for (i = 0; i < 256; ++i) {
+		cmap.red[i] = palette[i].r * 257;
+		cmap.green[i] = palette[i].g * 257;
+		cmap.blue[i] = palette[i].b * 257;
+	}
+	ioctl(display.fb.dev_fd, FBIOPUTCMAP, &cmap);
+}
+
 static void FBDisplay_InitCanvas(void)
 {
+	unsigned i;
+	size_t page_size;
+
 	display.canvas.width = display.width;
 	display.canvas.height = display.height;
 	display.canvas.bytes = display.fb.mem;
@@ -454,11 +610,19 @@ static void FBDisplay_InitCanvas(void)
 		display.canvas.color_type = LCUI_COLOR_TYPE_RGB888;
 		break;
 	case 8:
-		ioctl(display.fb.dev_fd, FBIOGETCMAP, &display.fb.cmap);
+		FBDisplay_InitPalette();
 	default:
 		break;
 	}
 	memset(display.canvas.bytes, 0, display.canvas.mem_size);
+	page_size = display.canvas.bytes_per_row * display.height;
+	for (i = 0; i < display.num_pages; ++i) {
+		display.pages[i].canvas = display.canvas;
+		display.pages[i].canvas.bytes = display.fb.mem + page_size * i;
+		display.pages[i].canvas.mem_size = page_size;
+		LinkedList_Init(&display.pages[i].rects);
+	}
+	display.front_page = 0;
 }
 
 static void FBDisplay_InitSurface(void)
@@ -475,6 +639,8 @@ static void FBDisplay_InitSurface(void)
 
 static int FBDisplay_Init(void)
 {
+	const char *str;
+
 	display.fb.dev_path = getenv("LCUI_FRAMEBUFFER_DEVICE");
 	if (!display.fb.dev_path) {
 		display.fb.dev_path = "/dev/fb0";
@@ -487,8 +653,14 @@ static int FBDisplay_Init(void)
 	}
 	ioctl(display.fb.dev_fd, FBIOGET_VSCREENINFO, &display.fb.var_info);
 	ioctl(display.fb.dev_fd, FBIOGET_FSCREENINFO, &display.fb.fix_info);
+	display.fb.orig_var_info = display.fb.var_info;
 	display.width = display.fb.var_info.xres;
 	display.height = display.fb.var_info.yres;
+	display.num_pages = FBDisplay_InitPages();
+	display.fb.vsync = TRUE;
+	str = getenv("LCUI_FRAMEBUFFER_DITHER");
+	display.fb.dither = !str || strcmp(str, "0") != 0;
+	Logger_Debug("[display] framebuffer pages: %u\n", display.num_pages);
 	display.fb.mem_len = display.fb.fix_info.smem_len;
 	display.fb.mem = mmap(NULL, display.fb.mem_len, PROT_READ | PROT_WRITE,
 			      MAP_SHARED, display.fb.dev_fd, 0);
@@ -535,12 +707,26 @@ LCUI_DisplayDriver LCUI_CreateLinuxFBDisplayDriver(void)
 
 void LCUI_DestroyLinuxFBDisplayDriver(LCUI_DisplayDriver driver)
 {
+	unsigned i;
+
+	for (i = 0; i < display.num_pages; ++i) {
+		RectList_Clear(&display.pages[i].rects);
+	}
+	/* Restore the virtual screen size and the pan offset */
+	if (memcmp(&display.fb.var_info, &display.fb.orig_var_info,
+		   sizeof(display.fb.var_info)) != 0) {
+		ioctl(display.fb.dev_fd, FBIOPUT_VSCREENINFO,
+		      &display.fb.orig_var_info);
+	}
+	display.front_page = 0;
 	if (munmap(display.fb.mem, display.fb.mem_len) != 0) {
 		perror("[display] framebuffer munmap failed");
 	}
 	switch (display.fb.var_info.bits_per_pixel) {
 	case 8:
-		ioctl(display.fb.dev_fd, FBIOPUTCMAP, &display.fb.cmap);
+		if (display.fb.cmap.len > 0) {
+			ioctl(display.fb.dev_fd, FBIOPUTCMAP, &display.fb.cmap);
+		}
 	default:
 		Graph_Free(&display.surface.canvas);
 		break;
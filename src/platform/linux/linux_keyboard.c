@@ -49,6 +49,7 @@
 #include <LCUI/ime.h>
 #include LCUI_EVENTS_H
 #include LCUI_KEYBOARD_H
+#include <LCUI/platform/linux/linux_evdev.h>
 
 static struct LCUI_LinuxKeyboardDriver {
 #ifdef USE_LINUX_INPUT_EVENT
@@ -275,6 +276,12 @@ void LCUI_InitLinuxKeyboard(void)
 		LCUI_InitLinuxX11Keyboard();
 		return;
 	}
+#endif
+#if defined(HAVE_LINUX_INPUT_H) && defined(HAVE_SYS_EPOLL_H)
+	/* The evdev driver is started by the mouse driver */
+	if (LCUI_GetLinuxEvdevCaps() & LCUI_EVDEV_KEYBOARD) {
+		return;
+	}
 #endif
 	InitLinuxKeybord();
 }
@@ -47,6 +47,7 @@
 #include <LCUI/display.h>
 #include LCUI_EVENTS_H
 #include LCUI_MOUSE_H
+#include <LCUI/platform/linux/linux_evdev.h>
 
 enum MouseButtonId { MOUSE_BUTTON_LEFT = 1, MOUSE_BUTTON_RIGHT = 1 << 1 };
 
@@ -62,63 +63,60 @@ static struct LCUI_LinuxMouseDriver {
 	LCUI_BOOL active;
 } mouse;
 
-static void DispathMouseButtonEvent(int button, int state)
+static void PostMouseButtonEvent(int button, int state, int64_t timestamp)
 {
 	LCUI_SysEventRec ev = { 0 };
+
 	if (mouse.button_state[button - 1]) {
-		if (!(state & button)) {
-			ev.type = LCUI_MOUSEUP;
-			ev.button.x = mouse.x;
-			ev.button.y = mouse.y;
-			ev.button.button = button;
-			mouse.button_state[button - 1] = 0;
-			LCUI_TriggerEvent(&ev, NULL);
-			LCUI_DestroyEvent(&ev);
+		if (state & button) {
+			return;
 		}
+		ev.type = LCUI_MOUSEUP;
+		mouse.button_state[button - 1] = 0;
 	} else if (state & button) {
 		ev.type = LCUI_MOUSEDOWN;
-		ev.button.x = mouse.x;
-		ev.button.y = mouse.y;
-		ev.button.button = button;
 		mouse.button_state[button - 1] = 1;
-		LCUI_TriggerEvent(&ev, NULL);
-		LCUI_DestroyEvent(&ev);
+	} else {
+		return;
 	}
+	ev.timestamp = timestamp;
+	ev.button.x = mouse.x;
+	ev.button.y = mouse.y;
+	ev.button.button = button;
+	LCUI_PostEvent(&ev);
 }
 
-static void DispatchMouseEvent(void *arg1, void *arg2)
+static void PostMouseEvent(const signed char *buf)
 {
-	char *buf = arg1;
 	int state = buf[0] & 0x07;
 	LCUI_SysEventRec ev = { 0 };
 
-	mouse.x += buf[1];
-	mouse.y -= buf[2];
-	mouse.x = max(0, mouse.x);
-	mouse.y = max(0, mouse.y);
-	mouse.x = min(LCUIDisplay_GetWidth(), mouse.x);
-	mouse.y = min(LCUIDisplay_GetHeight(), mouse.y);
-	ev.type = LCUI_MOUSEMOVE;
-	ev.motion.x = mouse.x;
-	ev.motion.y = mouse.y;
-	ev.motion.xrel = buf[1];
-	ev.motion.yrel = -buf[2];
-	LCUI_TriggerEvent(&ev, NULL);
-	LCUI_DestroyEvent(&ev);
-	DispathMouseButtonEvent(MOUSE_BUTTON_LEFT, state);
-	DispathMouseButtonEvent(MOUSE_BUTTON_RIGHT, state);
+	ev.timestamp = LCUI_GetTime();
+	if (buf[1] || buf[2]) {
+		mouse.x += buf[1];
+		mouse.y -= buf[2];
+		mouse.x = max(0, mouse.x);
+		mouse.y = max(0, mouse.y);
+		mouse.x = min(LCUIDisplay_GetWidth(), mouse.x);
+		mouse.y = min(LCUIDisplay_GetHeight(), mouse.y);
+		ev.type = LCUI_MOUSEMOVE;
+		ev.motion.x = mouse.x;
+		ev.motion.y = mouse.y;
+		ev.motion.xrel = buf[1];
+		ev.motion.yrel = -buf[2];
+		LCUI_PostEvent(&ev);
+	}
+	PostMouseButtonEvent(MOUSE_BUTTON_LEFT, state, ev.timestamp);
+	PostMouseButtonEvent(MOUSE_BUTTON_RIGHT, state, ev.timestamp);
 }
 
 static void LinuxMouseThread(void *arg)
 {
-	char buf[6];
+	signed char buf[6];
 	fd_set readfds;
 	struct timeval tv;
-	LCUI_TaskRec task = { 0 };
 
 	mouse.active = TRUE;
-	task.func = DispatchMouseEvent;
-	task.destroy_arg[0] = free;
 	while (mouse.active) {
 		tv.tv_sec = 0;
 		tv.tv_usec = 500000;
@@ -130,13 +128,7 @@ static void LinuxMouseThread(void *arg)
 			if (read(mouse.dev_fd, buf, 6) <= 0) {
 				continue;
 			}
-			task.arg[0] = malloc(sizeof(char) * 6);
-			if (!task.arg[0]) {
-				perror("[input] mouse driver");
-				continue;
-			}
-			memcpy(task.arg[0], buf, sizeof(char) * 6);
-			LCUI_PostTask(&task);
+			PostMouseEvent(buf);
 		}
 	}
 }
@@ -175,6 +167,12 @@ void LCUI_InitLinuxMouse(void)
 		LCUI_InitLinuxX11Mouse();
 		return;
 	}
+#endif
+#if defined(HAVE_LINUX_INPUT_H) && defined(HAVE_SYS_EPOLL_H)
+	if (LCUI_InitLinuxEvdev() &
+	    (LCUI_EVDEV_POINTER | LCUI_EVDEV_TOUCH)) {
+		return;
+	}
 #endif
 	InitLinuxMouse();
 }
@@ -186,6 +184,9 @@ void LCUI_FreeLinuxMouse(void)
 		LCUI_FreeLinuxX11Mouse();
 		return;
 	}
+#endif
+#if defined(HAVE_LINUX_INPUT_H) && defined(HAVE_SYS_EPOLL_H)
+	LCUI_FreeLinuxEvdev();
 #endif
 	FreeLinuxMouse();
 }
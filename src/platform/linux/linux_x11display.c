@@ -31,6 +31,7 @@
 #include "config.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <LCUI_Build.h>
 #define LCUI_SURFACE_C
 #if defined(LCUI_BUILD_IN_LINUX) && defined(LCUI_VIDEO_DRIVER_X11)
@@ -40,6 +41,13 @@
 #include LCUI_DISPLAY_H
 #include LCUI_EVENTS_H
 
+#ifdef HAVE_X11_EXTENSIONS_XSHM_H
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <X11/extensions/XShm.h>
+#define USE_XSHM
+#endif
+
 #define MIN_WIDTH 320
 #define MIN_HEIGHT 240
 
@@ -79,6 +87,13 @@ typedef struct LCUI_SurfaceRec_ {
 	XImage *ximage; /**< 适用于 X11 的图像数据 */
 	LCUI_BOOL is_ready; /**< 标志，标识当前的表面是否已经准备好 */
 	LCUI_Graph fb; /**< 帧缓存，它里面的数据会映射到窗口中 */
+#ifdef USE_XSHM
+	/** shared memory segment of the ximage, shmaddr is NULL if not used */
+	XShmSegmentInfo shminfo;
+
+	/** whether the X server is still reading the ximage */
+	LCUI_BOOL shm_pending;
+#endif
 	LCUI_Mutex mutex; /**< 互斥锁 */
 	LCUI_SurfaceTasks tasks;
 	LinkedList rects;    /**< 列表，记录当前需要重绘的区域 */
@@ -90,6 +105,16 @@ static struct X11_Display {
 	LinkedList surfaces;       /**< 表面列表 */
 	LCUI_X11AppDriver app;     /**< X11 应用驱动 */
 	LCUI_EventTrigger trigger; /**< 事件触发器 */
+#ifdef USE_XSHM
+	/** whether the MIT-SHM extension is available */
+	LCUI_BOOL shm_available;
+
+	/** the event type of XShmCompletionEvent */
+	int shm_completion;
+
+	/** whether an X error occurred while attaching the shared memory */
+	LCUI_BOOL shm_error;
+#endif
 } x11 = { 0 };
 
 static void X11Surface_ReleaseTask(LCUI_Surface surface, int type)
@@ -120,6 +145,107 @@ static LCUI_Surface GetSurfaceByWindow(Window win)
 	return NULL;
 }
 
+#ifdef USE_XSHM
+
+static int X11_OnShmAttachError(Display *dpy, XErrorEvent *ev)
+{
+	x11.shm_error = TRUE;
+	return 0;
+}
+
+/**
+ * Create the ximage in a shared memory segment, so that presenting the frame
+ * buffer does not need to copy it through the X protocol.
+ * It will fail on remote displays, in that case the caller should fallback
+ * to XCreateImage().
+ */
+static LCUI_BOOL X11Surface_CreateShmImage(LCUI_Surface s, Visual *visual,
+					   int depth, int width, int height)
+{
+	XImage *img;
+	XShmSegmentInfo *info = &s->shminfo;
+	int (*handler)(Display *, XErrorEvent *);
+
+	img = XShmCreateImage(x11.app->display, visual, depth, ZPixmap, NULL,
+			      info, width, height);
+	if (!img) {
+		return FALSE;
+	}
+	info->shmid = shmget(IPC_PRIVATE, img->bytes_per_line * img->height,
+			     IPC_CREAT | 0600);
+	if (info->shmid < 0) {
+		XDestroyImage(img);
+		return FALSE;
+	}
+	info->shmaddr = shmat(info->shmid, NULL, 0);
+	if (info->shmaddr == (char *)-1) {
+		shmctl(info->shmid, IPC_RMID, NULL);
+		info->shmaddr = NULL;
+		XDestroyImage(img);
+		return FALSE;
+	}
+	info->readOnly = False;
+	x11.shm_error = FALSE;
+	handler = XSetErrorHandler(X11_OnShmAttachError);
+	XShmAttach(x11.app->display, info);
+	XSync(x11.app->display, False);
+	XSetErrorHandler(handler);
+	/* The segment will be destroyed after the last process detaches it */
+	shmctl(info->shmid, IPC_RMID, NULL);
+	if (x11.shm_error) {
+		shmdt(info->shmaddr);
+		info->shmaddr = NULL;
+		XDestroyImage(img);
+		return FALSE;
+	}
+	img->data = info->shmaddr;
+	s->ximage = img;
+	s->fb.width = width;
+	s->fb.height = height;
+	s->fb.bytes = (uchar_t *)img->data;
+	s->fb.bytes_per_pixel = img->bits_per_pixel / 8;
+	s->fb.bytes_per_row = img->bytes_per_line;
+	s->fb.mem_size = img->bytes_per_line * img->height;
+	memset(s->fb.bytes, 0, s->fb.mem_size);
+	return TRUE;
+}
+
+/** Wait for the X server to finish reading the shared ximage */
+static void X11Surface_WaitPresent(LCUI_Surface s)
+{
+	if (s->shm_pending) {
+		XSync(x11.app->display, False);
+		s->shm_pending = FALSE;
+	}
+}
+
+#endif
+
+static void X11Surface_DestroyImage(LCUI_Surface s)
+{
+	if (!s->ximage) {
+		return;
+	}
+#ifdef USE_XSHM
+	if (s->shminfo.shmaddr) {
+		X11Surface_WaitPresent(s);
+		XShmDetach(x11.app->display, &s->shminfo);
+		/* The data is not allocated by Xlib, so don't let it be freed */
+		s->ximage->data = NULL;
+		XDestroyImage(s->ximage);
+		shmdt(s->shminfo.shmaddr);
+		s->shminfo.shmaddr = NULL;
+		s->ximage = NULL;
+		Graph_Init(&s->fb);
+		return;
+	}
+#endif
+	/* The ximage data is the frame buffer, it will be freed together */
+	XDestroyImage(s->ximage);
+	s->ximage = NULL;
+	Graph_Init(&s->fb);
+}
+
 static void X11Surface_OnResize(LCUI_Surface s, int width, int height)
 {
 	int depth;
@@ -128,10 +254,7 @@ static void X11Surface_OnResize(LCUI_Surface s, int width, int height)
 	if (width == s->width && height == s->height && s->ximage && s->gc) {
 		return;
 	}
-	if (s->ximage) {
-		XDestroyImage(s->ximage);
-		s->ximage = NULL;
-	}
+	X11Surface_DestroyImage(s);
 	if (s->gc) {
 		XFreeGC(x11.app->display, s->gc);
 		s->gc = NULL;
@@ -149,8 +272,18 @@ static void X11Surface_OnResize(LCUI_Surface s, int width, int height)
 		Logger_Error("[x11display] unsupport depth: %d.\n", depth);
 		break;
 	}
-	Graph_Create(&s->fb, width, height);
 	visual = DefaultVisual(x11.app->display, x11.app->screen);
+#ifdef USE_XSHM
+	if (x11.shm_available) {
+		if (X11Surface_CreateShmImage(s, visual, depth, width, height)) {
+			goto create_gc;
+		}
+		Logger_Warning("[x11display] cannot use MIT-SHM, "
+			       "fallback to XPutImage.\n");
+		x11.shm_available = FALSE;
+	}
+#endif
+	Graph_Create(&s->fb, width, height);
 	s->ximage = XCreateImage(x11.app->display, visual, depth, ZPixmap, 0,
 				 (char *)(s->fb.bytes), width, height, 32, 0);
 	if (!s->ximage) {
@@ -158,6 +291,9 @@ static void X11Surface_OnResize(LCUI_Surface s, int width, int height)
 		Logger_Error("[x11display] create XImage faild.\n");
 		return;
 	}
+#ifdef USE_XSHM
+create_gc:
+#endif
 	gcv.graphics_exposures = False;
 	s->gc =
 	    XCreateGC(x11.app->display, s->window, GCGraphicsExposures, &gcv);
@@ -241,9 +377,7 @@ static void OnDestroySurface(void *data)
 
 	X11Surface_ClearTasks(s);
 	LinkedList_Clear(&s->rects, free);
-	if (s->ximage) {
-		XDestroyImage(s->ximage);
-	}
+	X11Surface_DestroyImage(s);
 	if (s->gc) {
 		XFreeGC(x11.app->display, s->gc);
 	}
@@ -270,6 +404,10 @@ static LCUI_Surface X11Surface_New(void)
 	surface->gc = NULL;
 	surface->ximage = NULL;
 	surface->is_ready = FALSE;
+#ifdef USE_XSHM
+	surface->shminfo.shmaddr = NULL;
+	surface->shm_pending = FALSE;
+#endif
 	surface->node.data = surface;
 	surface->width = MIN_WIDTH;
 	surface->height = MIN_HEIGHT;
@@ -367,6 +505,25 @@ static void X11Surface_Present(LCUI_Surface surface)
 {
 	LinkedListNode *node;
 	LCUIMutex_Lock(&surface->mutex);
+#ifdef USE_XSHM
+	if (surface->shminfo.shmaddr) {
+		for (LinkedList_Each(node, &surface->rects)) {
+			LCUI_Rect *rect = node->data;
+			/* Only the last request needs a completion event */
+			XShmPutImage(x11.app->display, surface->window,
+				     surface->gc, surface->ximage, rect->x,
+				     rect->y, rect->x, rect->y, rect->width,
+				     rect->height, !node->next);
+		}
+		if (surface->rects.length > 0) {
+			surface->shm_pending = TRUE;
+			XFlush(x11.app->display);
+		}
+		LinkedList_Clear(&surface->rects, free);
+		LCUIMutex_Unlock(&surface->mutex);
+		return;
+	}
+#endif
 	for (LinkedList_Each(node, &surface->rects)) {
 		LCUI_Rect *rect = node->data;
 		XPutImage(x11.app->display, surface->window, surface->gc,
@@ -381,6 +538,11 @@ static void X11Surface_Present(LCUI_Surface surface)
 static void X11Surface_Update(LCUI_Surface surface)
 {
 	int i;
+#ifdef USE_XSHM
+	/* The frame buffer will be painted after this, so make sure that the
+	 * previous frame has been copied by the X server */
+	X11Surface_WaitPresent(surface);
+#endif
 	for (i = 0; i < TASK_TOTAL_NUM; ++i) {
 		if (surface->tasks[i].is_valid) {
 			X11Surface_RunTask(surface, i);
@@ -457,10 +619,25 @@ static void OnConfigureNotify(LCUI_Event e, void *arg)
 	dpy_ev.type = LCUI_DEVENT_RESIZE;
 	dpy_ev.resize.width = xce.width;
 	dpy_ev.resize.height = xce.height;
+	/* The frame buffer may be in use by the present thread */
+	LCUIDisplay_WaitPresent();
 	X11Surface_OnResize(s, xce.width, xce.height);
 	EventTrigger_Trigger(x11.trigger, LCUI_DEVENT_RESIZE, &dpy_ev);
 }
 
+#ifdef USE_XSHM
+
+static void OnShmCompletion(LCUI_Event e, void *arg)
+{
+	XShmCompletionEvent *ev = arg;
+	LCUI_Surface s = GetSurfaceByWindow(ev->drawable);
+	if (s) {
+		s->shm_pending = FALSE;
+	}
+}
+
+#endif
+
 LCUI_DisplayDriver LCUI_CreateLinuxX11DisplayDriver(void)
 {
 	ASSIGN(driver, LCUI_DisplayDriver);
@@ -493,6 +670,15 @@ LCUI_DisplayDriver LCUI_CreateLinuxX11DisplayDriver(void)
 	LinkedList_Init(&x11.surfaces);
 	LCUI_BindSysEvent(Expose, OnExpose, NULL, NULL);
 	LCUI_BindSysEvent(ConfigureNotify, OnConfigureNotify, NULL, NULL);
+#ifdef USE_XSHM
+	x11.shm_available = XShmQueryExtension(x11.app->display);
+	if (x11.shm_available) {
+		x11.shm_completion =
+		    XShmGetEventBase(x11.app->display) + ShmCompletion;
+		LCUI_BindSysEvent(x11.shm_completion, OnShmCompletion, NULL,
+				  NULL);
+	}
+#endif
 	x11.trigger = EventTrigger();
 	x11.is_inited = TRUE;
 	return driver;
@@ -504,6 +690,12 @@ void LCUI_DestroyLinuxX11DisplayDriver(LCUI_DisplayDriver driver)
 	LinkedList_ClearData(&x11.surfaces, OnDestroySurface);
 	LCUI_UnbindSysEvent(ConfigureNotify, OnConfigureNotify);
 	LCUI_UnbindSysEvent(Expose, OnExpose);
+#ifdef USE_XSHM
+	if (x11.shm_completion) {
+		LCUI_UnbindSysEvent(x11.shm_completion, OnShmCompletion);
+		x11.shm_completion = 0;
+	}
+#endif
 	x11.trigger = NULL;
 	x11.is_inited = FALSE;
 	free(driver);
@@ -31,6 +31,10 @@
 #include "config.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/select.h>
 #include <LCUI_Build.h>
 #if defined(LCUI_BUILD_IN_LINUX) && defined(LCUI_VIDEO_DRIVER_X11)
 #include <LCUI/LCUI.h>
@@ -53,24 +57,58 @@ void LCUI_SetLinuxX11MainWindow(Window win)
 	XFlush(x11.display);
 }
 
-static LCUI_BOOL X11_WaitEvent(void)
+static void X11_WaitEvent(int timeout_ms)
 {
-	int fd;
+	int fd, maxfd;
 	fd_set fdset;
-	struct timeval tv;
+	char buf[64];
+	struct timeval tv, *ptv = NULL;
+
 	XFlush(x11.display);
-	fd = ConnectionNumber(x11.display);
 	if (XEventsQueued(x11.display, QueuedAlready)) {
-		return TRUE;
+		return;
 	}
+	fd = ConnectionNumber(x11.display);
+	maxfd = max(fd, x11.wakeup_pipe[0]);
 	FD_ZERO(&fdset);
 	FD_SET(fd, &fdset);
-	tv.tv_sec = 0;
-	tv.tv_usec = 10000;
-	if (select(fd + 1, &fdset, NULL, NULL, &tv) == 1) {
-		return XPending(x11.display);
+	FD_SET(x11.wakeup_pipe[0], &fdset);
+	if (timeout_ms >= 0) {
+		tv.tv_sec = timeout_ms / 1000;
+		tv.tv_usec = (timeout_ms % 1000) * 1000;
+		ptv = &tv;
+	}
+	if (select(maxfd + 1, &fdset, NULL, NULL, ptv) < 1) {
+		return;
+	}
+	if (FD_ISSET(x11.wakeup_pipe[0], &fdset)) {
+		while (read(x11.wakeup_pipe[0], buf, sizeof(buf)) > 0);
+	}
+}
+
+static void X11_WakeUp(void)
+{
+	char c = 0;
+
+	/* The pipe is non-blocking, a full pipe already means a wakeup */
+	if (write(x11.wakeup_pipe[1], &c, 1) < 0) {
+		return;
+	}
+}
+
+static int X11_InitWakeUpPipe(void)
+{
+	int i, flags;
+
+	if (pipe(x11.wakeup_pipe) != 0) {
+		return -errno;
 	}
-	return FALSE;
+	for (i = 0; i < 2; ++i) {
+		flags = fcntl(x11.wakeup_pipe[i], F_GETFL);
+		fcntl(x11.wakeup_pipe[i], F_SETFL, flags | O_NONBLOCK);
+		fcntl(x11.wakeup_pipe[i], F_SETFD, FD_CLOEXEC);
+	}
+	return 0;
 }
 
 static LCUI_BOOL X11_DispatchEvent(void)
@@ -92,7 +130,9 @@ static LCUI_BOOL X11_DispatchEvent(void)
 static void X11_ProcessEvents(void)
 {
 	int i;
-	if (!X11_WaitEvent()) {
+
+	XFlush(x11.display);
+	if (!XPending(x11.display)) {
 		return;
 	}
 	for (i = 0; X11_DispatchEvent() && i < 100; ++i);
@@ -128,16 +168,26 @@ void LCUI_PreInitLinuxX11App(void *data)
 LCUI_AppDriver LCUI_CreateLinuxX11AppDriver(void)
 {
 	ASSIGN(app, LCUI_AppDriver);
+	/* The surfaces may be presented on a separate thread */
+	XInitThreads();
 	x11.display = XOpenDisplay(NULL);
 	if (!x11.display) {
 		free(app);
 		return NULL;
 	}
+	if (X11_InitWakeUpPipe() != 0) {
+		Logger_Error("[x11] cannot create the wakeup pipe\n");
+		XCloseDisplay(x11.display);
+		free(app);
+		return NULL;
+	}
 	x11.screen = DefaultScreen(x11.display);
 	x11.win_root = RootWindow(x11.display, x11.screen);
 	x11.cmap = DefaultColormap(x11.display, x11.screen);
 	x11.wm_delete = XInternAtom(x11.display, "WM_DELETE_WINDOW", FALSE);
 	app->ProcessEvents = X11_ProcessEvents;
+	app->WaitEvent = X11_WaitEvent;
+	app->WakeUp = X11_WakeUp;
 	app->BindSysEvent = X11_BindSysEvent;
 	app->UnbindSysEvent = X11_UnbindSysEvent;
 	app->UnbindSysEvent2 = X11_UnbindSysEvent2;
@@ -151,6 +201,8 @@ void LCUI_DestroyLinuxX11AppDriver(LCUI_AppDriver app)
 {
 	EventTrigger_Destroy(x11.trigger);
 	XCloseDisplay(x11.display);
+	close(x11.wakeup_pipe[0]);
+	close(x11.wakeup_pipe[1]);
 	x11.trigger = NULL;
 	free(app);
 }
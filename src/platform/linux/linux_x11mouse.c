@@ -43,7 +43,7 @@
 static void OnMotionNotify(LCUI_Event e, void *arg)
 {
 	XEvent *ev = arg;
-	LCUI_SysEventRec sys_ev;
+	LCUI_SysEventRec sys_ev = { 0 };
 	static LCUI_Pos mouse_pos = { 0, 0 };
 	sys_ev.type = LCUI_MOUSEMOVE;
 	sys_ev.motion.x = ev->xmotion.x;
@@ -52,14 +52,13 @@ static void OnMotionNotify(LCUI_Event e, void *arg)
 	sys_ev.motion.yrel = ev->xmotion.y - mouse_pos.y;
 	mouse_pos.x = ev->xmotion.x;
 	mouse_pos.y = ev->xmotion.y;
-	LCUI_TriggerEvent(&sys_ev, NULL);
-	LCUI_DestroyEvent(&sys_ev);
+	LCUI_PostEvent(&sys_ev);
 }
 
 static void OnButtonPress(LCUI_Event e, void *arg)
 {
 	XEvent *ev = arg;
-	LCUI_SysEventRec sys_ev;
+	LCUI_SysEventRec sys_ev = { 0 };
 
 	if (ev->xbutton.button == Button4) {
 		sys_ev.type = LCUI_MOUSEWHEEL;
@@ -77,20 +76,18 @@ static void OnButtonPress(LCUI_Event e, void *arg)
 		sys_ev.button.y = ev->xbutton.y;
 		sys_ev.button.button = ev->xbutton.button;
 	}
-	LCUI_TriggerEvent(&sys_ev, NULL);
-	LCUI_DestroyEvent(&sys_ev);
+	LCUI_PostEvent(&sys_ev);
 }
 
 static void OnButtonRelease(LCUI_Event e, void *arg)
 {
 	XEvent *ev = arg;
-	LCUI_SysEventRec sys_ev;
+	LCUI_SysEventRec sys_ev = { 0 };
 	sys_ev.type = LCUI_MOUSEUP;
 	sys_ev.button.x = ev->xbutton.x;
 	sys_ev.button.y = ev->xbutton.y;
 	sys_ev.button.button = ev->xbutton.button;
-	LCUI_TriggerEvent(&sys_ev, NULL);
-	LCUI_DestroyEvent(&sys_ev);
+	LCUI_PostEvent(&sys_ev);
 }
 
 void LCUI_InitLinuxX11Mouse(void)
@@ -89,6 +89,8 @@ static LCUI_AppDriver LCUI_CreateUWPAppDriver(App^ app)
 	driver->UnbindSysEvent = UWPApp_UnbindSysEvent;
 	driver->UnbindSysEvent2 = UWPApp_UnbindSysEvent2;
 	driver->ProcessEvents = UWPApp_ProcessEvents;
+	driver->WaitEvent = NULL;
+	driver->WakeUp = NULL;
 	driver->GetData = UWPApp_GetData;
 	UWPApp.core = app;
 	return driver;
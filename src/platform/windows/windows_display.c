@@ -508,6 +508,8 @@ static void OnWMSize(LCUI_Event e, void *arg)
 	dpy_ev.type = LCUI_DEVENT_RESIZE;
 	dpy_ev.resize.width = LOWORD(msg->lParam);
 	dpy_ev.resize.height = HIWORD(msg->lParam);
+	/* The frame buffer may be in use by the present thread */
+	LCUIDisplay_WaitPresent();
 	WinSurface_ResizeFrameBuffer(surface, dpy_ev.resize.width,
 				     dpy_ev.resize.height);
 	EventTrigger_Trigger(win.trigger, LCUI_DEVENT_RESIZE, &dpy_ev);
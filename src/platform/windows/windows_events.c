@@ -47,6 +47,7 @@ static struct WindowsDriver {
 	HINSTANCE dll_instance;		/**< 动态库中的资源句柄 */
 	LCUI_EventTrigger trigger;
 	const wchar_t *class_name;
+	DWORD thread_id;		/**< 处理消息的线程的ID */
 } win;
 
 static LRESULT CALLBACK WndProc(HWND hwnd, UINT msg,
@@ -90,6 +91,18 @@ static void WIN_ProcessEvents(void)
 	}
 }
 
+static void WIN_WaitEvent(int timeout_ms)
+{
+	DWORD timeout = timeout_ms < 0 ? INFINITE : (DWORD)timeout_ms;
+	MsgWaitForMultipleObjectsEx(0, NULL, timeout, QS_ALLINPUT,
+				    MWMO_INPUTAVAILABLE);
+}
+
+static void WIN_WakeUp(void)
+{
+	PostThreadMessage(win.thread_id, WM_NULL, 0, 0);
+}
+
 static int WIN_BindSysEvent(int event_id, LCUI_EventFunc func,
 			    void *data, void(*destroy_data)(void*))
 {
@@ -163,10 +176,13 @@ LCUI_AppDriver LCUI_CreateWinAppDriver(void)
 	app->id = LCUI_APP_WINDOWS;
 	app->GetData = WIN_GetData;
 	app->ProcessEvents = WIN_ProcessEvents;
+	app->WaitEvent = WIN_WaitEvent;
+	app->WakeUp = WIN_WakeUp;
 	app->BindSysEvent = WIN_BindSysEvent;
 	app->UnbindSysEvent = WIN_UnbindSysEvent;
 	app->UnbindSysEvent2 = WIN_UnbindSysEvent2;
 	win.trigger = EventTrigger();
+	win.thread_id = GetCurrentThreadId();
 	win.active = TRUE;
 	return app;
 }
@@ -40,7 +40,7 @@
 static void OnMouseMessage(LCUI_Event ev, void *arg)
 {
 	MSG *msg = arg;
-	LCUI_SysEventRec sys_ev;
+	LCUI_SysEventRec sys_ev = { 0 };
 	static POINT mouse_pos = { 0, 0 };
 	sys_ev.type = LCUI_NONE;
 	switch (msg->message) {
@@ -144,8 +144,7 @@ static void OnMouseMessage(LCUI_Event ev, void *arg)
 	default: break;
 	}
 	if (sys_ev.type != LCUI_NONE) {
-		LCUI_TriggerEvent(&sys_ev, NULL);
-		LCUI_DestroyEvent(&sys_ev);
+		LCUI_PostEvent(&sys_ev);
 	}
 }
 
@@ -65,5 +65,8 @@ void LCUI_ResetSettings(void)
 	self.record_profile = FALSE;
 	self.fps_meter = FALSE;
 	self.paint_flashing = FALSE;
+	self.progressive_image_loading = FALSE;
+	self.image_cache_size = LCUI_DEFAULT_IMAGE_CACHE_SIZE;
+	self.pipelined_present = FALSE;
 	TriggerSettingsChangedEvent();
 }
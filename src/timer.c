@@ -121,6 +121,7 @@ int LCUITimer_Set(long int n_ms, void(*func)(void *), void *arg,
 	timer->node.data = timer;
 	TimerList_AddNode(&timer->node);
 	LCUIMutex_Unlock(&self.mutex);
+	LCUI_WakeUp();
 	DEBUG_MSG("set timer, id: %ld, total_ms: %ld\n", timer->id,
 		  timer->total_ms);
 	return timer->id;
@@ -176,6 +177,9 @@ int LCUITimer_Continue(int timer_id)
 		timer->state = STATE_RUN;
 	}
 	LCUIMutex_Unlock(&self.mutex);
+	if (timer) {
+		LCUI_WakeUp();
+	}
 	return timer ? 0 : -1;
 }
 
@@ -193,6 +197,9 @@ int LCUITimer_Reset(int timer_id, long int n_ms)
 		timer->start_time = LCUI_GetTime();
 	}
 	LCUIMutex_Unlock(&self.mutex);
+	if (timer) {
+		LCUI_WakeUp();
+	}
 	return timer ? 0 : -1;
 }
 
@@ -225,12 +232,12 @@ size_t LCUI_ProcessTimers(void)
 		if (!node) {
 			break;
 		}
-		count += 1;
 		lost_ms = (long)LCUI_GetTimeDelta(timer->start_time);
 		/* 若流失的时间未达到总定时时长 */
 		if (lost_ms - timer->pause_ms < timer->total_ms) {
 			break;
 		}
+		count += 1;
 		/* 若需要重复使用，则重置剩余等待时间 */
 		LinkedList_Unlink(&self.timers, node);
 		timer->callback(timer->arg);
@@ -246,6 +253,35 @@ size_t LCUI_ProcessTimers(void)
 	return count;
 }
 
+long LCUI_GetNextTimerDelay(void)
+{
+	Timer timer;
+	LinkedListNode *node;
+	long ms, delay = -1;
+
+	if (!self.active) {
+		return -1;
+	}
+	LCUIMutex_Lock(&self.mutex);
+	for (LinkedList_Each(node, &self.timers)) {
+		timer = node->data;
+		if (!timer || timer->state != STATE_RUN) {
+			continue;
+		}
+		ms = (long)LCUI_GetTimeDelta(timer->start_time);
+		ms = timer->total_ms - ms + timer->pause_ms;
+		if (ms <= 0) {
+			delay = 0;
+			break;
+		}
+		if (delay < 0 || ms < delay) {
+			delay = ms;
+		}
+	}
+	LCUIMutex_Unlock(&self.mutex);
+	return delay;
+}
+
 void LCUI_InitTimer(void)
 {
 	self.active = TRUE;
@@ -36,17 +36,24 @@
 #include <locale.h>
 
 #include <LCUI_Build.h>
+#include <LCUI/types.h>
 #include <LCUI/util/charset.h>
 
-/* clang-format off */
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define USE_SSE2
+#endif
 
-#define MAX_SAVE_NUM 20
+/* clang-format off */
 
 #define UNI_SUR_HIGH_START  0xD800
 #define UNI_SUR_HIGH_END    0xDBFF
 #define UNI_SUR_LOW_START   0xDC00
 #define UNI_SUR_LOW_END     0xDFFF
 
+#define UNI_REPLACEMENT_CHAR 0xFFFD
+#define UNI_MAX_LEGAL        0x10FFFF
+
 /* The maximum possible value which will fit into four bytes of
    UTF-8. This is larger than UNICODE_MAXIMUM. */
 #define UNICODE_UTF8_4 0x1fffff
@@ -82,52 +89,158 @@ static size_t decode(wchar_t *wcs, const char *str, size_t maxlen, int codepage)
 }
 #endif
 
-static size_t utf8_to_ucs2(const char *utf8, wchar_t *ucs2)
+/**
+ * Decode a code point from a UTF-8 sequence
+ * The sequence is fully validated: overlong forms, surrogates and code points
+ * beyond U+10FFFF are rejected. An invalid sequence is decoded as U+FFFD and
+ * consumes its maximal valid prefix, or one byte if the lead byte is invalid.
+ * @returns the number of bytes consumed
+ */
+INLINE size_t utf8_decode_char(const unsigned char *s, size_t len,
+			       uint32_t *ch, int *invalid)
 {
-	size_t i, count;
-	wchar_t unicode;
-	const unsigned char *byte;
-	unsigned char buf[MAX_SAVE_NUM];
-
-	byte = (unsigned char *)utf8;
-	if ((*byte >> 7) == 0) {    // 0xxxxxxx
-		*ucs2 = *byte;
+	size_t i, n;
+	uint32_t c = s[0];
+	unsigned char lo = 0x80, hi = 0xBF;
+
+	if (c < 0x80) {
+		*ch = c;
 		return 1;
 	}
-	if ((*byte >> 5) == 6) {    // 110xxxxx
-		count = 2;
-	} else if ((*byte >> 4) == 14) {    // 1110xxxx
-		count = 3;
-	} else if ((*byte >> 3) == 30) {    // 11110xxx
-		count = 4;
-	} else if ((*byte >> 2) == 62) {    // 111110xx
-		count = 5;
-	} else if ((*byte >> 1) == 126) {    // 1111110x
-		count = 6;
+	if (c >= 0xC2 && c <= 0xDF) {
+		n = 2;
+		c &= 0x1F;
+	} else if (c >= 0xE0 && c <= 0xEF) {
+		n = 3;
+		c &= 0x0F;
+	} else if (c >= 0xF0 && c <= 0xF4) {
+		n = 4;
+		c &= 0x07;
 	} else {
-		return 0;
+		*ch = UNI_REPLACEMENT_CHAR;
+		*invalid = 1;
+		return 1;
 	}
-	for (i = 0; i < count; ++i) {
-		buf[i] = *byte++;
+	/* The second byte also rules out overlong forms, surrogates and the
+	 * code points beyond U+10FFFF */
+	switch (s[0]) {
+	case 0xE0: lo = 0xA0; break;
+	case 0xED: hi = 0x9F; break;
+	case 0xF0: lo = 0x90; break;
+	case 0xF4: hi = 0x8F; break;
+	default: break;
 	}
-	unicode = buf[0];
-	if (unicode >= 0xF0) {
-		unicode = (wchar_t)(buf[0] & 0x07) << 18;
-		unicode |= (wchar_t)(buf[1] & 0x3F) << 12;
-		unicode |= (wchar_t)(buf[2] & 0x3F) << 6;
-		unicode |= (wchar_t)(buf[3] & 0x3F);
-	} else if (unicode >= 0xE0) {
-		unicode = (wchar_t)(buf[0] & 0x0F) << 12;
-		unicode |= (wchar_t)(buf[1] & 0x3F) << 6;
-		unicode |= (wchar_t)(buf[2] & 0x3F);
-	} else if (unicode >= 0xC0) {
-		unicode = (wchar_t)(buf[0] & 0x1F) << 6;
-		unicode |= (wchar_t)(buf[1] & 0x3F);
+	for (i = 1; i < n; ++i) {
+		if (i >= len || s[i] < lo || s[i] > hi) {
+			*ch = UNI_REPLACEMENT_CHAR;
+			*invalid = 1;
+			return i;
+		}
+		c = (c << 6) | (s[i] & 0x3F);
+		lo = 0x80;
+		hi = 0xBF;
 	}
-	*ucs2 = unicode;
-	return count;
+	*ch = c;
+	return n;
+}
+
+#ifdef USE_SSE2
+
+INLINE unsigned ascii_mask_length(unsigned mask)
+{
+#ifdef __GNUC__
+	return (unsigned)__builtin_ctz(mask);
+#else
+	unsigned i = 0;
+	while (!(mask & 1)) {
+		mask >>= 1;
+		++i;
+	}
+	return i;
+#endif
+}
+
+INLINE void widen_ascii(wchar_t *wcs, __m128i v)
+{
+	__m128i zero = _mm_setzero_si128();
+	__m128i lo = _mm_unpacklo_epi8(v, zero);
+	__m128i hi = _mm_unpackhi_epi8(v, zero);
+
+	if (sizeof(wchar_t) == 2) {
+		_mm_storeu_si128((__m128i *)wcs, lo);
+		_mm_storeu_si128((__m128i *)(wcs + 8), hi);
+		return;
+	}
+	_mm_storeu_si128((__m128i *)wcs, _mm_unpacklo_epi16(lo, zero));
+	_mm_storeu_si128((__m128i *)(wcs + 4), _mm_unpackhi_epi16(lo, zero));
+	_mm_storeu_si128((__m128i *)(wcs + 8), _mm_unpacklo_epi16(hi, zero));
+	_mm_storeu_si128((__m128i *)(wcs + 12), _mm_unpackhi_epi16(hi, zero));
+}
+
+/**
+ * Decode the leading ASCII characters, 16 or 32 bytes per iteration
+ * Both len and max_len must be at least 16. The output may be written past
+ * the returned length, but never past max_len.
+ * @returns the number of characters decoded
+ */
+static size_t utf8_decode_ascii(wchar_t *wcs, const unsigned char *s,
+				size_t len, size_t max_len)
+{
+	unsigned mask;
+	size_t i = 0;
+	__m128i v0, v1;
+
+	len = len < max_len ? len : max_len;
+	for (; i + 32 <= len; i += 32) {
+		v0 = _mm_loadu_si128((const __m128i *)(s + i));
+		v1 = _mm_loadu_si128((const __m128i *)(s + i + 16));
+		if (_mm_movemask_epi8(_mm_or_si128(v0, v1))) {
+			break;
+		}
+		if (wcs) {
+			widen_ascii(wcs + i, v0);
+			widen_ascii(wcs + i + 16, v1);
+		}
+	}
+	for (; i + 16 <= len; i += 16) {
+		v0 = _mm_loadu_si128((const __m128i *)(s + i));
+		mask = (unsigned)_mm_movemask_epi8(v0);
+		if (wcs) {
+			widen_ascii(wcs + i, v0);
+		}
+		if (mask) {
+			return i + ascii_mask_length(mask);
+		}
+	}
+	return i;
+}
+
+#else
+
+/** Decode the leading ASCII characters, 8 bytes per iteration */
+static size_t utf8_decode_ascii(wchar_t *wcs, const unsigned char *s,
+				size_t len, size_t max_len)
+{
+	size_t i, j;
+	uint64_t v;
+
+	len = len < max_len ? len : max_len;
+	for (i = 0; i + 8 <= len; i += 8) {
+		memcpy(&v, s + i, 8);
+		if (v & 0x8080808080808080ULL) {
+			break;
+		}
+		if (wcs) {
+			for (j = 0; j < 8; ++j) {
+				wcs[i + j] = s[i + j];
+			}
+		}
+	}
+	return i;
 }
 
+#endif
+
 /* https://github.com/benkasminbullock/unicode-c/blob/master/unicode.c#L310 */
 
 size_t ucs2_to_utf8(int32_t ucs2, unsigned char *utf8)
@@ -167,82 +280,216 @@ size_t ucs2_to_utf8(int32_t ucs2, unsigned char *utf8)
 	return 0;
 }
 
-static size_t DecodeUTF8(wchar_t *wcs, const char *str, size_t max_len)
+size_t LCUI_DecodeUTF8(wchar_t *wcs, const char *str, size_t len,
+		       size_t max_len, size_t *errors)
 {
-	size_t n;
+	int invalid = 0;
+	size_t i = 0, n, units;
 	size_t count = 0;
+	size_t n_errors = 0;
+	uint32_t ch;
 
-	wchar_t buf;
-	wchar_t *wp = wcs;
-
-	const char *p = str;
+	const unsigned char *s = (const unsigned char *)str;
 
-	if (wcs) {
-		while (*p) {
-			count += 1;
-			if (count > max_len) {
-				count -= 1;
+	if (!wcs) {
+		max_len = SIZE_MAX;
+	}
+	while (i < len) {
+		if (s[i] < 0x80 && len - i >= 16 && max_len - count >= 16) {
+			n = utf8_decode_ascii(wcs ? wcs + count : NULL, s + i,
+					      len - i, max_len - count);
+			i += n;
+			count += n;
+			if (i >= len) {
 				break;
 			}
-			n = utf8_to_ucs2(p, wp);
-			if (n > 0) {
-				p += n;
-				++wp;
-			} else {
-				++p;
-			}
 		}
-		if (count < max_len) {
-			wcs[count] = 0;
+		n = utf8_decode_char(s + i, len - i, &ch, &invalid);
+		units = sizeof(wchar_t) == 2 && ch > 0xFFFF ? 2 : 1;
+		if (count + units > max_len) {
+			break;
 		}
-	} else {
-		while (*p) {
-			n = utf8_to_ucs2(p, &buf);
-			if (n > 0) {
-				p += n;
+		if (wcs) {
+			if (units == 2) {
+				ch -= 0x10000;
+				wcs[count] = (wchar_t)(UNI_SUR_HIGH_START +
+						       (ch >> 10));
+				wcs[count + 1] = (wchar_t)(UNI_SUR_LOW_START +
+							   (ch & 0x3FF));
 			} else {
-				++p;
+				wcs[count] = (wchar_t)ch;
 			}
-			count += 1;
 		}
+		if (invalid) {
+			n_errors += 1;
+			invalid = 0;
+		}
+		i += n;
+		count += units;
+	}
+	if (wcs && count < max_len) {
+		wcs[count] = 0;
+	}
+	if (errors) {
+		*errors = n_errors;
 	}
 	return count;
 }
 
-size_t EncodeToUTF8(char *str, const wchar_t *wcs, size_t max_len)
+#ifdef USE_SSE2
+
+/**
+ * Encode the leading ASCII characters, 16 characters per iteration
+ * @returns the number of characters encoded
+ */
+static size_t utf8_encode_ascii(char *str, const wchar_t *wcs, size_t len,
+				size_t max_len)
 {
-	size_t n;
-	size_t count = 0;
+	size_t i;
+	__m128i a, b, c, d, v;
+	__m128i zero = _mm_setzero_si128();
+
+	len = len < max_len ? len : max_len;
+	for (i = 0; i + 16 <= len; i += 16) {
+		a = _mm_loadu_si128((const __m128i *)(wcs + i));
+		b = _mm_loadu_si128((const __m128i *)(wcs + i + 16 / sizeof(wchar_t)));
+		if (sizeof(wchar_t) == 2) {
+			v = _mm_and_si128(_mm_or_si128(a, b),
+					  _mm_set1_epi16((short)0xFF80));
+			if (_mm_movemask_epi8(_mm_cmpeq_epi16(v, zero)) !=
+			    0xFFFF) {
+				break;
+			}
+			v = _mm_packus_epi16(a, b);
+		} else {
+			c = _mm_loadu_si128((const __m128i *)(wcs + i + 8));
+			d = _mm_loadu_si128((const __m128i *)(wcs + i + 12));
+			v = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+			v = _mm_and_si128(v, _mm_set1_epi32(~0x7F));
+			if (_mm_movemask_epi8(_mm_cmpeq_epi32(v, zero)) !=
+			    0xFFFF) {
+				break;
+			}
+			/* All values are less than 0x80, so the signed
+			 * saturation does not change them */
+			v = _mm_packus_epi16(_mm_packs_epi32(a, b),
+					     _mm_packs_epi32(c, d));
+		}
+		if (str) {
+			_mm_storeu_si128((__m128i *)(str + i), v);
+		}
+	}
+	return i;
+}
+
+#endif
 
-	char *p = str;
-	unsigned char buf[MAX_SAVE_NUM];
+size_t LCUI_EncodeUTF8(char *str, const wchar_t *wcs, size_t len,
+		       size_t max_len, size_t *errors)
+{
+	size_t i = 0, n, bytes;
+	size_t count = 0;
+	size_t n_errors = 0;
+	uint32_t ch, low;
 
-	const wchar_t *wp = wcs;
+	unsigned char *p = (unsigned char *)str;
 
-	if (str) {
-		while (*wp) {
-			n = ucs2_to_utf8(*wp, buf);
+	if (!str) {
+		max_len = SIZE_MAX;
+	}
+	while (i < len) {
+#ifdef USE_SSE2
+		if ((uint32_t)wcs[i] < 0x80 && len - i >= 16 &&
+		    max_len - count >= 16) {
+			n = utf8_encode_ascii(str ? str + count : NULL, wcs + i,
+					      len - i, max_len - count);
+			i += n;
 			count += n;
-			if (count > max_len) {
-				count -= n;
+			if (i >= len) {
 				break;
 			}
-			strncpy(p, (char *)buf, n);
-			p += n;
-			++wp;
 		}
-		if (count < max_len) {
-			str[count] = 0;
+#endif
+		n = 1;
+		ch = (uint32_t)wcs[i];
+		if (sizeof(wchar_t) == 2) {
+			ch &= 0xFFFF;
 		}
-	} else {
-		while (*wp) {
-			count += ucs2_to_utf8(*wp, buf);
-			++wp;
+		if (ch >= UNI_SUR_HIGH_START && ch <= UNI_SUR_LOW_END) {
+			low = i + 1 < len ? (uint32_t)wcs[i + 1] & 0xFFFF : 0;
+			if (sizeof(wchar_t) == 2 && ch <= UNI_SUR_HIGH_END &&
+			    low >= UNI_SUR_LOW_START &&
+			    low <= UNI_SUR_LOW_END) {
+				ch = 0x10000 + ((ch - UNI_SUR_HIGH_START) << 10) +
+				     (low - UNI_SUR_LOW_START);
+				n = 2;
+			} else {
+				ch = UNI_REPLACEMENT_CHAR;
+				n_errors += 1;
+			}
+		} else if (ch > UNI_MAX_LEGAL) {
+			ch = UNI_REPLACEMENT_CHAR;
+			n_errors += 1;
+		}
+		if (ch < 0x80) {
+			bytes = 1;
+		} else if (ch < 0x800) {
+			bytes = 2;
+		} else if (ch < 0x10000) {
+			bytes = 3;
+		} else {
+			bytes = 4;
 		}
+		if (count + bytes > max_len) {
+			break;
+		}
+		if (str) {
+			switch (bytes) {
+			case 1:
+				p[count] = (unsigned char)ch;
+				break;
+			case 2:
+				p[count] = (unsigned char)(0xC0 | (ch >> 6));
+				p[count + 1] = (unsigned char)(0x80 | (ch & 0x3F));
+				break;
+			case 3:
+				p[count] = (unsigned char)(0xE0 | (ch >> 12));
+				p[count + 1] =
+				    (unsigned char)(0x80 | ((ch >> 6) & 0x3F));
+				p[count + 2] = (unsigned char)(0x80 | (ch & 0x3F));
+				break;
+			default:
+				p[count] = (unsigned char)(0xF0 | (ch >> 18));
+				p[count + 1] =
+				    (unsigned char)(0x80 | ((ch >> 12) & 0x3F));
+				p[count + 2] =
+				    (unsigned char)(0x80 | ((ch >> 6) & 0x3F));
+				p[count + 3] = (unsigned char)(0x80 | (ch & 0x3F));
+				break;
+			}
+		}
+		i += n;
+		count += bytes;
+	}
+	if (str && count < max_len) {
+		str[count] = 0;
+	}
+	if (errors) {
+		*errors = n_errors;
 	}
 	return count;
 }
 
+static size_t DecodeUTF8(wchar_t *wcs, const char *str, size_t max_len)
+{
+	return LCUI_DecodeUTF8(wcs, str, strlen(str), max_len, NULL);
+}
+
+size_t EncodeToUTF8(char *str, const wchar_t *wcs, size_t max_len)
+{
+	return LCUI_EncodeUTF8(str, wcs, wcslen(wcs), max_len, NULL);
+}
+
 size_t LCUI_DecodeString(wchar_t *wstr, const char *str, size_t max_len,
 			 int encoding)
 {
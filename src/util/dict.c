@@ -3,7 +3,9 @@
  * This file implements in memory hash tables with insert/del/replace/find/
  * get-random-element operations. Hash tables will auto resize if needed
  * tables of power of two in size are used, collisions are handled by
- * chaining. See the source code for more information... :)
+ * open addressing: entries are stored inline in the slot array and probed
+ * group by group through a parallel array of control bytes. See the source
+ * code for more information... :)
  *
  * Copyright (c) 2006-2012, Salvatore Sanfilippo <antirez at gmail dot com>
  * All rights reserved.
@@ -44,22 +46,141 @@
 #include <LCUI_Build.h>
 #include <LCUI/LCUI.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define USE_SSE2
+#endif
+
 /* Using Dict_EnableResize() / Dict_DisableResize() we make possible to
- * enable/disable resizing of the hash table as needed. This is very important
- * for Redis, as we use copy-on-write and don't want to move too much memory
- * around when there is a child performing saving operations.
+ * enable/disable resizing of the hash table as needed.
  *
  * Note that even when dict_can_resize is set to 0, not all resizes are
- * prevented: an hash table is still allowed to grow if the ratio between
- * the number of elements and the buckets > dict_force_resize_ratio. */
+ * prevented: an hash table is still allowed to grow if it is nearly full. */
 static int dict_can_resize = 1;
-static unsigned int dict_force_resize_ratio = 5;
+
+/*
+ * Every slot has a control byte: the empty and deleted slots are marked with
+ * the high bit set, and the used slots store the low 7 bits of the key hash.
+ * Lookups compare a whole group of control bytes at once and only compare
+ * the keys of the slots whose control byte matches.
+ */
+#define CTRL_EMPTY ((unsigned char)0x80)
+#define CTRL_DELETED ((unsigned char)0xfe)
+#define CTRL_IS_FULL(C) (((C)&0x80) == 0)
+
+#define DICT_H1(HASH) ((HASH) >> 7)
+#define DICT_H2(HASH) ((unsigned char)((HASH)&0x7f))
+
+/* The maximum number of used and deleted slots, 7/8 of the table size */
+#define DICT_MAX_LOAD(SIZE) ((SIZE) - (SIZE) / 8)
+
+#ifdef USE_SSE2
+
+#define GROUP_WIDTH 16
+
+typedef unsigned GroupMask;
+
+/** 找出组内与控制字节 c 相同的槽 */
+INLINE GroupMask Group_Match(const unsigned char *ctrl, unsigned char c)
+{
+	__m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+	__m128i match = _mm_set1_epi8((char)c);
+	return (GroupMask)_mm_movemask_epi8(_mm_cmpeq_epi8(group, match));
+}
+
+/** 找出组内的空槽 */
+INLINE GroupMask Group_MatchEmpty(const unsigned char *ctrl)
+{
+	return Group_Match(ctrl, CTRL_EMPTY);
+}
+
+/** 找出组内的空槽和已删除的槽 */
+INLINE GroupMask Group_MatchAvailable(const unsigned char *ctrl)
+{
+	__m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+	return (GroupMask)_mm_movemask_epi8(group);
+}
+
+INLINE unsigned GroupMask_LowestIndex(GroupMask mask)
+{
+#ifdef __GNUC__
+	return (unsigned)__builtin_ctz(mask);
+#else
+	unsigned i = 0;
+	while (!(mask & 1)) {
+		mask >>= 1;
+		++i;
+	}
+	return i;
+#endif
+}
+
+#else
+
+/*
+ * Without SSE2 the control bytes are compared eight at a time in a 64-bit
+ * integer, the mask has the high bit of each matched byte set.
+ */
+#define GROUP_WIDTH 8
+#define GROUP_LSBS 0x0101010101010101ULL
+#define GROUP_MSBS 0x8080808080808080ULL
+
+typedef uint64_t GroupMask;
+
+INLINE uint64_t Group_Load(const unsigned char *ctrl)
+{
+	uint64_t group;
+
+	memcpy(&group, ctrl, sizeof(group));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	group = __builtin_bswap64(group);
+#endif
+	return group;
+}
+
+/**
+ * 找出组内与控制字节 c 相同的槽
+ * 借位可能导致误报，但只会误报已用的槽，比较 key 时会排除它们
+ */
+INLINE GroupMask Group_Match(const unsigned char *ctrl, unsigned char c)
+{
+	uint64_t x = Group_Load(ctrl) ^ (GROUP_LSBS * c);
+	return (x - GROUP_LSBS) & ~x & GROUP_MSBS;
+}
+
+/** 找出组内的空槽，只有空槽的最高位为 1 且第二位为 0 */
+INLINE GroupMask Group_MatchEmpty(const unsigned char *ctrl)
+{
+	uint64_t group = Group_Load(ctrl);
+	return group & (~group << 6) & GROUP_MSBS;
+}
+
+/** 找出组内的空槽和已删除的槽 */
+INLINE GroupMask Group_MatchAvailable(const unsigned char *ctrl)
+{
+	return Group_Load(ctrl) & GROUP_MSBS;
+}
+
+INLINE unsigned GroupMask_LowestIndex(GroupMask mask)
+{
+#ifdef __GNUC__
+	return (unsigned)__builtin_ctzll(mask) >> 3;
+#else
+	unsigned i = 0;
+	while (!(mask & 0x80)) {
+		mask >>= 8;
+		++i;
+	}
+	return i;
+#endif
+}
+
+#endif
 
 /* -------------------------- private prototypes ---------------------------- */
 
 static int Dict_ExpandIfNeeded(Dict *ht);
 static unsigned long Dict_NextPower(unsigned long size);
-static int Dict_KeyIndex(Dict *ht, const void *key);
 static int Dict_Init(Dict *ht, DictType *type, void *privdata);
 
 /* -------------------------- hash functions -------------------------------- */
@@ -117,13 +238,41 @@ unsigned int Dict_GenCaseHashFunction(const unsigned char *buf, int len)
 
 /* ----------------------------- API implementation ------------------------- */
 
-/** 重置哈希表 */
-static void Dict_Reset(DictHashTable *ht)
+/**
+ * 对哈希值进行二次混淆
+ * 部分 key 类型使用的是恒等哈希函数，直接取它的低位作为控制字节会让相邻
+ * 的 key 聚集在同一组槽中，所以需要让每一位都能影响槽的位置和控制字节
+ */
+INLINE unsigned int Dict_Hash(Dict *d, const void *key)
+{
+	unsigned int h = Dict_HashKey(d, key);
+
+	h ^= h >> 16;
+	h *= 0x85ebca6bU;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35U;
+	h ^= h >> 16;
+	return h;
+}
+
+INLINE void Dict_SetCtrl(Dict *d, unsigned long i, unsigned char c)
+{
+	d->ctrl[i] = c;
+	/* 末尾的控制字节是开头一组的副本，这样在表尾读取一整组时不用回绕 */
+	if (i < GROUP_WIDTH) {
+		d->ctrl[d->size + i] = c;
+	}
+}
+
+/** 重置字典的槽数组 */
+static void Dict_Reset(Dict *d)
 {
-	ht->table = NULL;
-	ht->size = 0;
-	ht->sizemask = 0;
-	ht->used = 0;
+	d->ctrl = NULL;
+	d->entries = NULL;
+	d->size = 0;
+	d->sizemask = 0;
+	d->used = 0;
+	d->deleted = 0;
 }
 
 Dict *Dict_Create(DictType *type, void *privdata)
@@ -143,108 +292,120 @@ static int Dict_Init(Dict *d, DictType *type, void *privdata)
 {
 	d->type = type;
 	d->iterators = 0;
-	d->rehashidx = -1;
 	d->privdata = privdata;
-	Dict_Reset(&d->ht[0]);
-	Dict_Reset(&d->ht[1]);
+	Dict_Reset(d);
 	return 0;
 }
 
-int Dict_Resize(Dict *d)
+/**
+ * 查找 key 所在的槽
+ * 按三角数序列逐组探测，每组的控制字节一次比较完，遇到含有空槽的组即可
+ * 确定 key 不存在
+ * @returns 如果 key 不存在，则返回 -1
+ */
+static long Dict_FindIndex(Dict *d, const void *key, unsigned int hash)
 {
-	int minimal;
-	if (!dict_can_resize || Dict_IsRehashing(d)) {
+	GroupMask mask;
+	unsigned long i, n, pos, step = 0;
+	unsigned char h2 = DICT_H2(hash);
+
+	if (d->size == 0) {
 		return -1;
 	}
-	minimal = d->ht[0].used;
-	if (minimal < DICT_HT_INITIAL_SIZE) {
-		minimal = DICT_HT_INITIAL_SIZE;
+	pos = DICT_H1(hash) & d->sizemask;
+	for (n = d->size / GROUP_WIDTH; n > 0; --n) {
+		mask = Group_Match(d->ctrl + pos, h2);
+		while (mask) {
+			i = (pos + GroupMask_LowestIndex(mask)) & d->sizemask;
+			if (Dict_CompareKeys(d, key, d->entries[i].key)) {
+				return (long)i;
+			}
+			mask &= mask - 1;
+		}
+		if (Group_MatchEmpty(d->ctrl + pos)) {
+			break;
+		}
+		step += GROUP_WIDTH;
+		pos = (pos + step) & d->sizemask;
 	}
-	return Dict_Expand(d, minimal);
+	return -1;
 }
 
-int Dict_Expand(Dict *d, unsigned long size)
+/** 查找可用于存放新元素的槽，调用前需要确保字典里还有可用的槽 */
+static unsigned long Dict_FindFreeSlot(Dict *d, unsigned int hash)
 {
-	DictHashTable n;
-	unsigned long realsize;
-	if (Dict_IsRehashing(d) || d->ht[0].used > size) {
-		return -1;
-	}
-	/* 计算哈希表的(真正)大小 */
-	realsize = Dict_NextPower(size);
-	n.used = 0;
-	n.size = realsize;
-	n.sizemask = realsize - 1;
-	n.table = calloc(realsize, sizeof(DictEntry *));
-	/* 如果字典的 0 号哈希表未初始化，则将新建的哈希表作为字典的 0 号哈
-	 * 希表，否则，将新建哈希表作为字典的 1 号哈希表，并将它用于 rehash
-	 */
-	if (d->ht[0].table == NULL) {
-		d->ht[0] = n;
-	} else {
-		d->ht[1] = n;
-		d->rehashidx = 0;
+	GroupMask mask;
+	unsigned long pos, step = 0;
+
+	pos = DICT_H1(hash) & d->sizemask;
+	while (1) {
+		mask = Group_MatchAvailable(d->ctrl + pos);
+		if (mask) {
+			return (pos + GroupMask_LowestIndex(mask)) &
+			       d->sizemask;
+		}
+		step += GROUP_WIDTH;
+		pos = (pos + step) & d->sizemask;
 	}
-	return 0;
 }
 
-int Dict_Rehash(Dict *d, int n)
+/** 以新的大小重建槽数组，已删除的槽也会在此时被清除 */
+static int Dict_Rebuild(Dict *d, unsigned long size)
 {
-	if (!Dict_IsRehashing(d)) {
-		return 0;
+	unsigned long i, j;
+	unsigned int hash;
+	unsigned char *ctrl;
+	DictEntry *entries;
+	Dict old = *d;
+
+	ctrl = malloc(size + GROUP_WIDTH);
+	entries = malloc(size * sizeof(DictEntry));
+	if (!ctrl || !entries) {
+		free(ctrl);
+		free(entries);
+		return -1;
 	}
-	while (n--) {
-		DictEntry *de, *nextde;
-		if (d->ht[0].used == 0) {
-			free(d->ht[0].table);
-			d->ht[0] = d->ht[1];
-			Dict_Reset(&d->ht[1]);
-			d->rehashidx = -1;
-			return 0;
-		}
-		assert(d->ht[0].size > (unsigned)d->rehashidx);
-		while (d->ht[0].table[d->rehashidx] == NULL) {
-			d->rehashidx++;
-		}
-		de = d->ht[0].table[d->rehashidx];
-		while (de) {
-			unsigned int h;
-			nextde = de->next;
-			h = Dict_HashKey(d, de->key) & d->ht[1].sizemask;
-			de->next = d->ht[1].table[h];
-			d->ht[1].table[h] = de;
-			d->ht[0].used--;
-			d->ht[1].used++;
-			de = nextde;
+	memset(ctrl, CTRL_EMPTY, size + GROUP_WIDTH);
+	d->ctrl = ctrl;
+	d->entries = entries;
+	d->size = size;
+	d->sizemask = size - 1;
+	d->deleted = 0;
+	for (i = 0; i < old.size; ++i) {
+		if (!CTRL_IS_FULL(old.ctrl[i])) {
+			continue;
 		}
-		d->ht[0].table[d->rehashidx] = NULL;
-		d->rehashidx++;
+		hash = Dict_Hash(d, old.entries[i].key);
+		j = Dict_FindFreeSlot(d, hash);
+		Dict_SetCtrl(d, j, DICT_H2(hash));
+		d->entries[j] = old.entries[i];
 	}
-	return 1;
+	free(old.ctrl);
+	free(old.entries);
+	return 0;
 }
 
-#define timeInMilliseconds LCUI_GetTime
-
-int Dict_RehashMilliseconds(Dict *d, int ms)
+int Dict_Resize(Dict *d)
 {
-	long long start = timeInMilliseconds();
-	int rehashes = 0;
+	unsigned long minimal;
 
-	while (Dict_Rehash(d, 100)) {
-		rehashes += 100;
-		if (timeInMilliseconds() - start > ms) {
-			break;
-		}
+	if (!dict_can_resize || d->iterators > 0) {
+		return -1;
+	}
+	minimal = d->used;
+	if (minimal < DICT_HT_INITIAL_SIZE) {
+		minimal = DICT_HT_INITIAL_SIZE;
 	}
-	return rehashes;
+	return Dict_Expand(d, minimal);
 }
 
-/** 在字典没有迭代器的情况下，rehash 一个元素 */
-static void Dict_RehashStep(Dict *d)
+int Dict_Expand(Dict *d, unsigned long size)
 {
-	if (d->iterators == 0) {
-		Dict_Rehash(d, 1);
+	if (d->used > size) {
+		return -1;
 	}
+	/* 让 size 个元素能够在负载上限内存放 */
+	return Dict_Rebuild(d, Dict_NextPower(size + size / 7 + 1));
 }
 
 int Dict_Add(Dict *d, void *key, void *val)
@@ -273,24 +434,25 @@ int Dict_AddCopy(Dict *d, void *key, const void *val)
 
 DictEntry *Dict_AddRaw(Dict *d, void *key)
 {
-	int index;
+	unsigned long i;
+	unsigned int hash;
 	DictEntry *entry;
-	DictHashTable *ht;
 
-	/* 如果可以执行 rehash 操作，则执行平摊 rehash 操作 */
-	if (Dict_IsRehashing(d)) {
-		Dict_RehashStep(d);
+	hash = Dict_Hash(d, key);
+	if (Dict_FindIndex(d, key, hash) != -1) {
+		return NULL;
 	}
-	/* 计算 key 的 index 值，如果 key 已经存在，Dict_KeyIndex 返回 -1 */
-	if ((index = Dict_KeyIndex(d, key)) == -1) {
+	if (Dict_ExpandIfNeeded(d) != 0) {
 		return NULL;
 	}
-	/* 判断是否正在进行 rehash ，选择相应的表 */
-	ht = Dict_IsRehashing(d) ? &d->ht[1] : &d->ht[0];
-	entry = malloc(sizeof(*entry));
-	entry->next = ht->table[index];
-	ht->table[index] = entry;
-	ht->used++;
+	i = Dict_FindFreeSlot(d, hash);
+	if (d->ctrl[i] == CTRL_DELETED) {
+		d->deleted--;
+	}
+	Dict_SetCtrl(d, i, DICT_H2(hash));
+	d->used++;
+	entry = &d->entries[i];
+	entry->v.val = NULL;
 	Dict_SetKey(d, entry, key);
 	return entry;
 }
@@ -317,43 +479,28 @@ DictEntry *Dict_ReplaceRaw(Dict *d, void *key)
 /* 删除字典中的指定元素 */
 static int Dict_GenericDelete(Dict *d, const void *key, int nofree)
 {
-	int table;
-	unsigned int h, idx;
-	DictEntry *he, *prev_he;
-	if (d->ht[0].size == 0) {
+	long i;
+	DictEntry *entry;
+
+	i = Dict_FindIndex(d, key, Dict_Hash(d, key));
+	if (i < 0) {
 		return -1;
 	}
-	if (Dict_IsRehashing(d)) {
-		Dict_RehashStep(d);
-	}
-	h = Dict_HashKey(d, key);
-	for (table = 0; table <= 1; table++) {
-		idx = h & d->ht[table].sizemask;
-		he = d->ht[table].table[idx];
-		prev_he = NULL;
-		while (he) {
-			if (Dict_CompareKeys(d, key, he->key)) {
-				if (prev_he) {
-					prev_he->next = he->next;
-				} else {
-					d->ht[table].table[idx] = he->next;
-				}
-				if (!nofree) {
-					Dict_FreeKey(d, he);
-					Dict_FreeVal(d, he);
-				}
-				free(he);
-				d->ht[table].used--;
-				return 0;
-			}
-			prev_he = he;
-			he = he->next;
-		}
-		if (!Dict_IsRehashing(d)) {
-			break;
-		}
+	entry = &d->entries[i];
+	if (!nofree) {
+		Dict_FreeKey(d, entry);
+		Dict_FreeVal(d, entry);
 	}
-	return -1;
+	d->used--;
+	if (d->used == 0) {
+		memset(d->ctrl, CTRL_EMPTY, d->size + GROUP_WIDTH);
+		d->deleted = 0;
+		return 0;
+	}
+	/* 其它 key 的探测序列可能经过这个槽，所以只能标记为已删除 */
+	Dict_SetCtrl(d, i, CTRL_DELETED);
+	d->deleted++;
+	return 0;
 }
 
 int Dict_Delete(Dict *ht, const void *key)
@@ -366,58 +513,38 @@ int Dict_DeleteNoFree(Dict *ht, const void *key)
 	return Dict_GenericDelete(ht, key, 1);
 }
 
-/** 清除字典中指定的哈希表 */
-static void Dict_Clear(Dict *d, DictHashTable *ht)
+/** 清除字典中的所有元素 */
+static void Dict_Clear(Dict *d)
 {
 	unsigned long i;
-	DictEntry *he, *next_he;
-	for (i = 0; i < ht->size && ht->used > 0; i++) {
-		he = ht->table[i];
-		while (he) {
-			next_he = he->next;
-			Dict_FreeKey(d, he);
-			Dict_FreeVal(d, he);
-			free(he);
-			ht->used--;
-			he = next_he;
+
+	for (i = 0; i < d->size && d->used > 0; i++) {
+		if (CTRL_IS_FULL(d->ctrl[i])) {
+			Dict_FreeKey(d, &d->entries[i]);
+			Dict_FreeVal(d, &d->entries[i]);
+			d->used--;
 		}
 	}
-	free(ht->table);
-	Dict_Reset(ht);
+	free(d->ctrl);
+	free(d->entries);
+	Dict_Reset(d);
 }
 
 void Dict_Release(Dict *d)
 {
-	Dict_Clear(d, &d->ht[0]);
-	Dict_Clear(d, &d->ht[1]);
+	Dict_Clear(d);
 	free(d);
 }
 
 DictEntry *Dict_Find(Dict *d, const void *key)
 {
-	DictEntry *he;
-	unsigned int h, idx, table;
-	if (d->ht[0].size == 0) {
+	long i;
+
+	if (d->used == 0) {
 		return NULL;
 	}
-	if (Dict_IsRehashing(d)) {
-		Dict_RehashStep(d);
-	}
-	h = Dict_HashKey(d, key);
-	for (table = 0; table <= 1; table++) {
-		idx = h & d->ht[table].sizemask;
-		he = d->ht[table].table[idx];
-		while (he) {
-			if (Dict_CompareKeys(d, key, he->key)) {
-				return he;
-			}
-			he = he->next;
-		}
-		if (!Dict_IsRehashing(d)) {
-			return NULL;
-		}
-	}
-	return NULL;
+	i = Dict_FindIndex(d, key, Dict_Hash(d, key));
+	return i < 0 ? NULL : &d->entries[i];
 }
 
 void *Dict_FetchValue(Dict *d, const void *key)
@@ -430,11 +557,9 @@ DictIterator *Dict_GetIterator(Dict *d)
 {
 	DictIterator *iter = malloc(sizeof(*iter));
 	iter->d = d;
-	iter->table = 0;
 	iter->index = -1;
 	iter->safe = 0;
 	iter->entry = NULL;
-	iter->next_entry = NULL;
 	return iter;
 }
 
@@ -447,43 +572,26 @@ DictIterator *Dict_GetSafeIterator(Dict *d)
 
 DictEntry *Dict_Next(DictIterator *iter)
 {
-	DictHashTable *ht;
-	while (1) {
-		if (iter->entry) {
-			iter->entry = iter->next_entry;
-			if (iter->entry) {
-				iter->next_entry = iter->entry->next;
-				return iter->entry;
-			}
-			continue;
-		}
-		/* 如果迭代器是新的(未使用过)，那么初始化新迭代器 */
-		ht = &iter->d->ht[iter->table];
-		if (iter->safe && iter->index == -1 && iter->table == 0) {
-			iter->d->iterators++;
-		}
-		iter->index++;
-		if (iter->index >= (signed)ht->size) {
-			if (Dict_IsRehashing(iter->d) && iter->table == 0) {
-				iter->table++;
-				iter->index = 0;
-				ht = &iter->d->ht[1];
-			} else {
-				break;
-			}
-		}
-		iter->entry = ht->table[iter->index];
-		if (iter->entry) {
-			iter->next_entry = iter->entry->next;
+	Dict *d = iter->d;
+
+	/* 如果迭代器是新的(未使用过)，那么记录安全迭代器的数量 */
+	if (iter->safe && iter->index == -1) {
+		d->iterators++;
+	}
+	while (++iter->index < (long)d->size) {
+		if (CTRL_IS_FULL(d->ctrl[iter->index])) {
+			iter->entry = &d->entries[iter->index];
 			return iter->entry;
 		}
 	}
+	iter->index = (long)d->size;
+	iter->entry = NULL;
 	return NULL;
 }
 
 void Dict_ReleaseIterator(DictIterator *iter)
 {
-	if (iter->safe && !(iter->index == -1 && iter->table == 0)) {
+	if (iter->safe && iter->index != -1) {
 		iter->d->iterators--;
 	}
 	free(iter);
@@ -491,42 +599,15 @@ void Dict_ReleaseIterator(DictIterator *iter)
 
 DictEntry *Dict_GetRandomKey(Dict *d)
 {
-	DictEntry *he, *orighe;
-	unsigned int h;
-	int listlen, listele;
+	unsigned long i;
 
 	if (Dict_Size(d) == 0) {
 		return NULL;
 	}
-	if (Dict_IsRehashing(d)) {
-		Dict_RehashStep(d);
-	}
-	if (Dict_IsRehashing(d)) {
-		do {
-			h = rand() % (d->ht[0].size + d->ht[1].size);
-			if (h >= d->ht[0].size) {
-				he = d->ht[1].table[h - d->ht[0].size];
-			} else {
-				he = d->ht[0].table[h];
-			}
-		} while (he == NULL);
-	} else {
-		do {
-			h = rand() & d->ht[0].sizemask;
-			he = d->ht[0].table[h];
-		} while (he == NULL);
-	}
-	listlen = 0;
-	orighe = he;
-	while (he) {
-		he = he->next;
-		listlen++;
-	}
-	/* 从链表里随机取一项 */
-	listele = rand() % listlen;
-	he = orighe;
-	while (listele--) he = he->next;
-	return he;
+	do {
+		i = rand() & d->sizemask;
+	} while (!CTRL_IS_FULL(d->ctrl[i]));
+	return &d->entries[i];
 }
 
 /* ------------------------- private functions ------------------------------ */
@@ -534,27 +615,28 @@ DictEntry *Dict_GetRandomKey(Dict *d)
 /* Expand the hash table if needed */
 static int Dict_ExpandIfNeeded(Dict *d)
 {
-	/* Incremental rehashing already in progress. Return. */
-	if (Dict_IsRehashing(d)) {
+	unsigned long size = d->size;
+
+	/* If the hash table is empty expand it to the intial size. */
+	if (size == 0) {
+		return Dict_Rebuild(d, DICT_HT_INITIAL_SIZE);
+	}
+	if (d->used + d->deleted < DICT_MAX_LOAD(size)) {
 		return 0;
 	}
-	/* If the hash table is empty expand it to the intial size. */
-	if (d->ht[0].size == 0) {
-		return Dict_Expand(d, DICT_HT_INITIAL_SIZE);
-	}
-	/* If we reached the 1:1 ratio, and we are allowed to resize the hash
-	 * table (global setting) or we should avoid it but the ratio between
-	 * elements/buckets is over the "safe" threshold, we resize doubling
-	 * the number of buckets. */
-	if (d->ht[0].used >= d->ht[0].size &&
-	    (dict_can_resize ||
-	     d->ht[0].used / d->ht[0].size > dict_force_resize_ratio)) {
-		return Dict_Expand(
-		    d, ((d->ht[0].size > d->ht[0].used) ? d->ht[0].size
-							: d->ht[0].used) *
-			   2);
+	/* Rebuilding moves the entries, so it is postponed until the table
+	 * is nearly full while safe iterators are in use or resizing is
+	 * disabled. */
+	if ((d->iterators > 0 || !dict_can_resize) &&
+	    d->used + d->deleted + 1 < size) {
+		return 0;
 	}
-	return 0;
+	/* If most of the used slots are deleted, rebuild the table in the
+	 * same size to drop them, otherwise double the number of slots. */
+	if (d->used >= DICT_MAX_LOAD(size) / 2) {
+		size *= 2;
+	}
+	return Dict_Rebuild(d, size);
 }
 
 static unsigned long Dict_NextPower(unsigned long size)
@@ -570,103 +652,47 @@ static unsigned long Dict_NextPower(unsigned long size)
 	}
 }
 
-/**
- * 获取字典中与 key 对应的空槽的索引
- * @returns 如果 key 已经存在，则返回 -1
- */
-static int Dict_KeyIndex(Dict *d, const void *key)
-{
-	DictEntry *he;
-	unsigned int h, idx, table;
-	if (Dict_ExpandIfNeeded(d) == -1) {
-		return -1;
-	}
-	h = Dict_HashKey(d, key);
-	for (table = 0; table <= 1; table++) {
-		idx = h & d->ht[table].sizemask;
-		he = d->ht[table].table[idx];
-		while (he) {
-			if (Dict_CompareKeys(d, key, he->key)) {
-				return -1;
-			}
-			he = he->next;
-		}
-		if (!Dict_IsRehashing(d)) {
-			break;
-		}
-	}
-	return idx;
-}
-
 void Dict_Empty(Dict *d)
 {
-	Dict_Clear(d, &d->ht[0]);
-	Dict_Clear(d, &d->ht[1]);
-	d->rehashidx = -1;
+	Dict_Clear(d);
 	d->iterators = 0;
 }
 
-#define DICT_STATS_VECTLEN 50
-static void Dict_PrintStatsHt(DictHashTable *ht)
+void Dict_PrintStats(Dict *d)
 {
-	unsigned long totchainlen = 0;
-	unsigned long clvector[DICT_STATS_VECTLEN];
-	unsigned long i, slots = 0, chainlen, maxchainlen = 0;
-	if (ht->used == 0) {
+	unsigned int hash;
+	unsigned long i, pos, step, probes;
+	unsigned long total_probes = 0, max_probes = 0;
+
+	if (d->used == 0) {
 		Logger_Info("No stats available for empty dictionaries\n");
 		return;
 	}
-	for (i = 0; i < DICT_STATS_VECTLEN; i++) clvector[i] = 0;
-	for (i = 0; i < ht->size; i++) {
-		DictEntry *he;
-		if (ht->table[i] == NULL) {
-			clvector[0]++;
+	for (i = 0; i < d->size; i++) {
+		if (!CTRL_IS_FULL(d->ctrl[i])) {
 			continue;
 		}
-		slots++;
-		chainlen = 0;
-		he = ht->table[i];
-		while (he) {
-			chainlen++;
-			he = he->next;
+		/* 统计找到该元素需要探测的组数 */
+		hash = Dict_Hash(d, d->entries[i].key);
+		pos = DICT_H1(hash) & d->sizemask;
+		for (step = 0, probes = 1;
+		     ((i - pos) & d->sizemask) >= GROUP_WIDTH; ++probes) {
+			step += GROUP_WIDTH;
+			pos = (pos + step) & d->sizemask;
 		}
-		if (chainlen < DICT_STATS_VECTLEN) {
-			clvector[chainlen]++;
-		} else {
-			clvector[DICT_STATS_VECTLEN - 1]++;
+		if (probes > max_probes) {
+			max_probes = probes;
 		}
-		if (chainlen > maxchainlen) {
-			maxchainlen = chainlen;
-		}
-		totchainlen += chainlen;
+		total_probes += probes;
 	}
 	printf("Hash table stats:\n");
-	printf(" table size: %ld\n", ht->size);
-	printf(" number of elements: %ld\n", ht->used);
-	printf(" different slots: %ld\n", slots);
-	printf(" max chain length: %ld\n", maxchainlen);
-	printf(" avg chain length (counted): %.02f\n",
-	       (float)totchainlen / slots);
-	printf(" avg chain length (computed): %.02f\n",
-	       (float)ht->used / slots);
-	printf(" Chain length distribution:\n");
-	for (i = 0; i < DICT_STATS_VECTLEN - 1; i++) {
-		if (clvector[i] == 0) {
-			continue;
-		}
-		printf("   %s%ld: %ld (%.02f%%)\n",
-		       (i == DICT_STATS_VECTLEN - 1) ? ">= " : "", i,
-		       clvector[i], ((float)clvector[i] / ht->size) * 100);
-	}
-}
-
-void Dict_PrintStats(Dict *d)
-{
-	Dict_PrintStatsHt(&d->ht[0]);
-	if (Dict_IsRehashing(d)) {
-		printf("-- Rehashing into ht[1]:\n");
-		Dict_PrintStatsHt(&d->ht[1]);
-	}
+	printf(" table size: %ld\n", d->size);
+	printf(" number of elements: %ld\n", d->used);
+	printf(" deleted slots: %ld\n", d->deleted);
+	printf(" group width: %d\n", GROUP_WIDTH);
+	printf(" max probe length: %ld\n", max_probes);
+	printf(" avg probe length: %.02f\n",
+	       (float)total_probes / d->used);
 }
 
 void Dict_EnableResize(void)
@@ -28,14 +28,78 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <stdarg.h>
 #include <wchar.h>
 #include <LCUI_Build.h>
+#include <LCUI/types.h>
 #include <LCUI/thread.h>
+#include <LCUI/util/math.h>
 #include <LCUI/util/logger.h>
 
 #define BUFFER_SIZE 2048
 
+/** size of the ring buffer of each thread, must be a power of two */
+#define RING_SIZE (64 * 1024)
+#define RING_MASK (RING_SIZE - 1)
+
+#define BATCH_SIZE 8192
+
+#define RECORD_ALIGN 8
+#define RECORD_PADDING 0xff
+
+#ifdef _WIN32
+#define ThreadKey DWORD
+#define ThreadKey_Create(KEY, DTOR) \
+	((*(KEY) = FlsAlloc(DTOR)) == FLS_OUT_OF_INDEXES ? -1 : 0)
+#define ThreadKey_Get(KEY) FlsGetValue(KEY)
+#define ThreadKey_Set(KEY, VAL) FlsSetValue(KEY, VAL)
+#define THREAD_KEY_DTOR VOID WINAPI
+/* volatile accesses have acquire/release semantics on MSVC */
+#define LoadAcquire(P) (*(volatile size_t *)(P))
+#define StoreRelease(P, V) (*(volatile size_t *)(P) = (V))
+#define FullBarrier() MemoryBarrier()
+#else
+#define ThreadKey pthread_key_t
+#define ThreadKey_Create(KEY, DTOR) pthread_key_create(KEY, DTOR)
+#define ThreadKey_Get(KEY) pthread_getspecific(KEY)
+#define ThreadKey_Set(KEY, VAL) pthread_setspecific(KEY, VAL)
+#define THREAD_KEY_DTOR void
+#define LoadAcquire(P) __atomic_load_n(P, __ATOMIC_ACQUIRE)
+#define StoreRelease(P, V) __atomic_store_n(P, V, __ATOMIC_RELEASE)
+#define FullBarrier() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#endif
+
+typedef struct LogRecordRec_ {
+	/** the size of the record, including this header and the padding */
+	unsigned size;
+	/** 0 for char text, 1 for wchar_t text, or RECORD_PADDING */
+	unsigned type;
+} LogRecordRec, *LogRecord;
+
+/**
+ * Ring buffer of preformatted records
+ * It has a single producer, the thread it belongs to, and a single consumer
+ * at a time, the drain, so the positions only need acquire/release ordering.
+ */
+typedef struct LogBufferRec_ {
+	/** write position, only changed by the producer */
+	size_t head;
+	/** read position, only changed by the consumer */
+	size_t tail;
+	/** the number of messages dropped because the buffer was full */
+	size_t dropped;
+	/** the number of dropped messages the consumer has reported */
+	size_t reported;
+	/** the thread of this buffer has exited */
+	LCUI_BOOL exited;
+	char text[BUFFER_SIZE];
+	wchar_t textw[BUFFER_SIZE];
+	unsigned char data[RING_SIZE];
+	struct LogBufferRec_ *next;
+} LogBufferRec, *LogBuffer;
+
 static struct Logger {
 	char inited;
 	char buffer[BUFFER_SIZE];
@@ -44,26 +108,433 @@ static struct Logger {
 	void(*handlerw)(const wchar_t*);
 	LoggerLevel level;
 	LCUI_Mutex mutex;
+
+	/** async mode, it is read by the logging threads without a lock */
+	size_t async;
+	LCUI_BOOL active;
+	LCUI_BOOL key_created;
+	ThreadKey key;
+	LCUI_Cond cond;
+	LCUI_Thread thread;
+	/** the logger thread is waiting on the cond for new records */
+	size_t waiting;
+	/** buffers of all threads, protected by the mutex */
+	LogBuffer buffers;
+	/** dropped messages of the buffers which have been freed */
+	size_t dropped;
+
+	/**
+	 * The following members are protected by the drain_mutex, which
+	 * serializes the writing of the records. The handlers are called with
+	 * only this mutex locked, so they do not block the logging threads.
+	 */
+	LCUI_Mutex drain_mutex;
+	LCUI_BOOL draining;
+	/** records taken out of the ring buffers, waiting to be written */
+	unsigned char *pending;
+	size_t pending_len;
+	size_t pending_size;
+	char batch[BATCH_SIZE];
+	wchar_t batchw[BATCH_SIZE];
+	size_t batch_len;
+	size_t batchw_len;
 } logger = { 0 };
 
+static void Logger_Init(void)
+{
+	if (!logger.inited) {
+		LCUIMutex_Init(&logger.mutex);
+		LCUIMutex_Init(&logger.drain_mutex);
+		logger.inited = 1;
+	}
+}
+
 void Logger_SetLevel(LoggerLevel level)
 {
 	logger.level = level;
 }
 
+static void LogBuffer_Unlink(LogBuffer buf)
+{
+	LogBuffer *prev = &logger.buffers;
+
+	while (*prev != buf) {
+		prev = &(*prev)->next;
+	}
+	*prev = buf->next;
+	logger.dropped += buf->dropped;
+}
+
+static THREAD_KEY_DTOR LogBuffer_OnThreadExit(void *arg)
+{
+	LogBuffer buf = arg;
+
+	if (!buf) {
+		return;
+	}
+	LCUIMutex_Lock(&logger.mutex);
+	/* Let the logger thread free it after the records are written */
+	if (LoadAcquire(&buf->head) != buf->tail) {
+		buf->exited = TRUE;
+		LCUIMutex_Unlock(&logger.mutex);
+		return;
+	}
+	LogBuffer_Unlink(buf);
+	LCUIMutex_Unlock(&logger.mutex);
+	free(buf);
+}
+
+static LogBuffer Logger_GetBuffer(void)
+{
+	LogBuffer buf;
+
+	buf = ThreadKey_Get(logger.key);
+	if (buf) {
+		return buf;
+	}
+	buf = malloc(sizeof(LogBufferRec));
+	if (!buf) {
+		return NULL;
+	}
+	buf->head = 0;
+	buf->tail = 0;
+	buf->dropped = 0;
+	buf->reported = 0;
+	buf->exited = FALSE;
+	LCUIMutex_Lock(&logger.mutex);
+	buf->next = logger.buffers;
+	logger.buffers = buf;
+	LCUIMutex_Unlock(&logger.mutex);
+	ThreadKey_Set(logger.key, buf);
+	return buf;
+}
+
+/** Wake the logger thread if it is waiting for new records */
+static void Logger_WakeUp(void)
+{
+	/* Pairs with the barrier in Logger_Thread(), either the logger thread
+	 * sees the new record or this thread sees that it is waiting */
+	FullBarrier();
+	if (!LoadAcquire(&logger.waiting)) {
+		return;
+	}
+	LCUIMutex_Lock(&logger.mutex);
+	/* The cond is destroyed after the logger thread has stopped */
+	if (logger.waiting && logger.active) {
+		LCUICond_Signal(&logger.cond);
+	}
+	LCUIMutex_Unlock(&logger.mutex);
+}
+
+/**
+ * Copy a formatted message into the ring buffer of the current thread
+ * It does not wait for the handlers, the message is dropped if there is
+ * not enough space.
+ */
+static int Logger_Push(LogBuffer buf, unsigned type, const void *text,
+		       size_t len)
+{
+	size_t used, pos, pad, size;
+	LogRecord record;
+
+	size = sizeof(LogRecordRec) + len;
+	size = (size + RECORD_ALIGN - 1) & ~(size_t)(RECORD_ALIGN - 1);
+	pos = buf->head & RING_MASK;
+	/* A record is always contiguous, skip the tail end if it is too short */
+	pad = RING_SIZE - pos < size ? RING_SIZE - pos : 0;
+	used = buf->head - LoadAcquire(&buf->tail);
+	if (RING_SIZE - used < pad + size) {
+		StoreRelease(&buf->dropped, buf->dropped + 1);
+		Logger_WakeUp();
+		return -1;
+	}
+	if (pad > 0) {
+		record = (LogRecord)(buf->data + pos);
+		record->size = (unsigned)pad;
+		record->type = RECORD_PADDING;
+		pos = 0;
+	}
+	record = (LogRecord)(buf->data + pos);
+	record->size = (unsigned)size;
+	record->type = type;
+	memcpy(record + 1, text, len);
+	StoreRelease(&buf->head, buf->head + pad + size);
+	Logger_WakeUp();
+	return 0;
+}
+
+static void Logger_FlushBatch(void)
+{
+	if (logger.batch_len > 0) {
+		logger.batch[logger.batch_len] = 0;
+		if (logger.handler) {
+			logger.handler(logger.batch);
+		} else {
+			fputs(logger.batch, stdout);
+		}
+		logger.batch_len = 0;
+	}
+	if (logger.batchw_len > 0) {
+		logger.batchw[logger.batchw_len] = 0;
+		if (logger.handlerw) {
+			logger.handlerw(logger.batchw);
+		} else {
+			fputws(logger.batchw, stdout);
+		}
+		logger.batchw_len = 0;
+	}
+}
+
+static void Logger_AppendBatch(const char *text, size_t len)
+{
+	if (logger.batchw_len > 0 || logger.batch_len + len >= BATCH_SIZE) {
+		Logger_FlushBatch();
+	}
+	memcpy(logger.batch + logger.batch_len, text, len);
+	logger.batch_len += len;
+}
+
+static void Logger_AppendBatchW(const wchar_t *text, size_t len)
+{
+	if (logger.batch_len > 0 || logger.batchw_len + len >= BATCH_SIZE) {
+		Logger_FlushBatch();
+	}
+	memcpy(logger.batchw + logger.batchw_len, text,
+	       len * sizeof(wchar_t));
+	logger.batchw_len += len;
+}
+
+/** Append a record to the pending records, the drain_mutex must be locked */
+static int Logger_AddPending(unsigned type, const void *text, size_t len)
+{
+	size_t size, pending_size;
+	unsigned char *pending;
+	LogRecord record;
+
+	size = sizeof(LogRecordRec) + len;
+	size = (size + RECORD_ALIGN - 1) & ~(size_t)(RECORD_ALIGN - 1);
+	if (logger.pending_len + size > logger.pending_size) {
+		pending_size = max(logger.pending_size * 2, RING_SIZE);
+		pending_size = max(pending_size, logger.pending_len + size);
+		pending = realloc(logger.pending, pending_size);
+		if (!pending) {
+			return -1;
+		}
+		logger.pending = pending;
+		logger.pending_size = pending_size;
+	}
+	record = (LogRecord)(logger.pending + logger.pending_len);
+	record->size = (unsigned)size;
+	record->type = type;
+	memcpy(record + 1, text, len);
+	logger.pending_len += size;
+	return 0;
+}
+
+/**
+ * Take the records out of the ring buffer
+ * Both the mutex and the drain_mutex must be locked.
+ */
+static void LogBuffer_Collect(LogBuffer buf)
+{
+	int len;
+	size_t head, tail, dropped;
+	char str[64];
+	LogRecord record;
+
+	head = LoadAcquire(&buf->head);
+	for (tail = buf->tail; tail != head; tail += record->size) {
+		record = (LogRecord)(buf->data + (tail & RING_MASK));
+		if (record->type == RECORD_PADDING) {
+			continue;
+		}
+		/* Keep the rest in the ring buffer for the next drain */
+		if (Logger_AddPending(record->type, record + 1,
+				      record->size - sizeof(LogRecordRec)) !=
+		    0) {
+			break;
+		}
+	}
+	StoreRelease(&buf->tail, tail);
+	dropped = LoadAcquire(&buf->dropped);
+	if (dropped != buf->reported) {
+		len = snprintf(str, sizeof(str),
+			       "[logger] %lu messages dropped\n",
+			       (unsigned long)(dropped - buf->reported));
+		if (Logger_AddPending(0, str, len + 1) == 0) {
+			buf->reported = dropped;
+		}
+	}
+}
+
+static LCUI_BOOL Logger_HasRecords(void)
+{
+	LogBuffer buf;
+
+	for (buf = logger.buffers; buf; buf = buf->next) {
+		if (LoadAcquire(&buf->head) != buf->tail ||
+		    LoadAcquire(&buf->dropped) != buf->reported) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/**
+ * Write the records of all threads
+ * The records are taken out of the ring buffers with the mutex locked, and
+ * written after it is unlocked, so a slow handler does not block the
+ * threads that are logging.
+ */
+static void Logger_Drain(void)
+{
+	size_t pos;
+	LogRecord record;
+	LogBuffer buf, next;
+
+	LCUIMutex_Lock(&logger.drain_mutex);
+	/* A handler is flushing the logger, the records are written by the
+	 * outer drain */
+	if (logger.draining) {
+		LCUIMutex_Unlock(&logger.drain_mutex);
+		return;
+	}
+	logger.draining = TRUE;
+	LCUIMutex_Lock(&logger.mutex);
+	for (buf = logger.buffers; buf; buf = next) {
+		next = buf->next;
+		LogBuffer_Collect(buf);
+		if (buf->exited && LoadAcquire(&buf->head) == buf->tail) {
+			LogBuffer_Unlink(buf);
+			free(buf);
+		}
+	}
+	LCUIMutex_Unlock(&logger.mutex);
+	for (pos = 0; pos < logger.pending_len; pos += record->size) {
+		record = (LogRecord)(logger.pending + pos);
+		if (record->type) {
+			Logger_AppendBatchW((wchar_t *)(record + 1),
+					    wcslen((wchar_t *)(record + 1)));
+		} else {
+			Logger_AppendBatch((char *)(record + 1),
+					   strlen((char *)(record + 1)));
+		}
+	}
+	logger.pending_len = 0;
+	Logger_FlushBatch();
+	fflush(stdout);
+	logger.draining = FALSE;
+	LCUIMutex_Unlock(&logger.drain_mutex);
+}
+
+static void Logger_Thread(void *arg)
+{
+	LCUIMutex_Lock(&logger.mutex);
+	while (logger.active) {
+		StoreRelease(&logger.waiting, TRUE);
+		/* Pairs with the barrier in Logger_WakeUp() */
+		FullBarrier();
+		if (!Logger_HasRecords()) {
+			LCUICond_Wait(&logger.cond, &logger.mutex);
+		}
+		StoreRelease(&logger.waiting, FALSE);
+		LCUIMutex_Unlock(&logger.mutex);
+		Logger_Drain();
+		LCUIMutex_Lock(&logger.mutex);
+	}
+	LCUIMutex_Unlock(&logger.mutex);
+	LCUIThread_Exit(NULL);
+}
+
+int Logger_SetAsync(LCUI_BOOL enable)
+{
+	Logger_Init();
+	if (!enable) {
+		if (!logger.async) {
+			return 0;
+		}
+		StoreRelease(&logger.async, FALSE);
+		LCUIMutex_Lock(&logger.mutex);
+		logger.active = FALSE;
+		LCUICond_Signal(&logger.cond);
+		LCUIMutex_Unlock(&logger.mutex);
+		/* The threads that are still logging will not signal the cond
+		 * after they see that the logger thread is not active */
+		LCUIThread_Join(logger.thread, NULL);
+		LCUICond_Destroy(&logger.cond);
+		Logger_Flush();
+		LCUIMutex_Lock(&logger.drain_mutex);
+		free(logger.pending);
+		logger.pending = NULL;
+		logger.pending_size = 0;
+		LCUIMutex_Unlock(&logger.drain_mutex);
+		return 0;
+	}
+	if (logger.async) {
+		return 0;
+	}
+	if (!logger.key_created) {
+		if (ThreadKey_Create(&logger.key, LogBuffer_OnThreadExit) != 0) {
+			return -1;
+		}
+		logger.key_created = TRUE;
+	}
+	LCUICond_Init(&logger.cond);
+	logger.active = TRUE;
+	if (LCUIThread_Create(&logger.thread, Logger_Thread, NULL) != 0) {
+		logger.active = FALSE;
+		LCUICond_Destroy(&logger.cond);
+		return -1;
+	}
+	StoreRelease(&logger.async, TRUE);
+	return 0;
+}
+
+void Logger_Flush(void)
+{
+	Logger_Init();
+	Logger_Drain();
+}
+
+size_t Logger_GetDroppedCount(void)
+{
+	size_t count;
+	LogBuffer buf;
+
+	Logger_Init();
+	LCUIMutex_Lock(&logger.mutex);
+	count = logger.dropped;
+	for (buf = logger.buffers; buf; buf = buf->next) {
+		count += LoadAcquire(&buf->dropped);
+	}
+	LCUIMutex_Unlock(&logger.mutex);
+	return count;
+}
+
 int Logger_Log(LoggerLevel level, const char* fmt, ...)
 {
 	int len;
 	va_list args;
+	LogBuffer buf;
 
 	if (level < logger.level) {
 		return 0;
 	}
-	if (!logger.inited) {
-		LCUIMutex_Init(&logger.mutex);
-		logger.inited = 1;
-	}
+	Logger_Init();
 	va_start(args, fmt);
+	if (LoadAcquire(&logger.async) && (buf = Logger_GetBuffer())) {
+		len = vsnprintf(buf->text, BUFFER_SIZE, fmt, args);
+		va_end(args);
+		if (len < 0) {
+			return len;
+		}
+		len = min(len, BUFFER_SIZE - 1);
+		buf->text[len] = 0;
+		if (Logger_Push(buf, 0, buf->text, len + 1) != 0) {
+			return -1;
+		}
+		return len;
+	}
 	LCUIMutex_Lock(&logger.mutex);
 	if (logger.handler) {
 		len = vsnprintf(logger.buffer, BUFFER_SIZE, fmt, args);
@@ -81,15 +552,27 @@ int Logger_LogW(LoggerLevel level, const wchar_t* fmt, ...)
 {
 	int len;
 	va_list args;
+	LogBuffer buf;
 
 	if (level < logger.level) {
 		return 0;
 	}
-	if (!logger.inited) {
-		LCUIMutex_Init(&logger.mutex);
-		logger.inited = 1;
-	}
+	Logger_Init();
 	va_start(args, fmt);
+	if (LoadAcquire(&logger.async) && (buf = Logger_GetBuffer())) {
+		len = vswprintf(buf->textw, BUFFER_SIZE, fmt, args);
+		va_end(args);
+		/* vswprintf() fails if the output is truncated */
+		if (len < 0) {
+			len = BUFFER_SIZE - 1;
+		}
+		buf->textw[len] = 0;
+		if (Logger_Push(buf, 1, buf->textw,
+				(len + 1) * sizeof(wchar_t)) != 0) {
+			return -1;
+		}
+		return len;
+	}
 	LCUIMutex_Lock(&logger.mutex);
 	if (logger.handlerw) {
 		len = vswprintf(logger.bufferw, BUFFER_SIZE, fmt, args);
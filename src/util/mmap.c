@@ -0,0 +1,256 @@
+/*
+ * mmap.c -- Read-only file mapping
+ *
+ * Copyright (c) 2020, Liu chao <lc-soft@live.cn> All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of LCUI nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <LCUI_Build.h>
+#include <LCUI/types.h>
+#include <LCUI/thread.h>
+#include <LCUI/util/dict.h>
+#include <LCUI/util/string.h>
+#include <LCUI/util/mmap.h>
+
+#if defined(LCUI_BUILD_IN_WIN32) || (_WIN32)
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+static struct LCUI_MappedFileModule {
+	LCUI_BOOL inited;
+	DictType dtype;
+	Dict *files;
+	LCUI_Mutex mutex;
+} self;
+
+/** Read the whole file into the heap, used when the file cannot be mapped */
+static int MappedFile_ReadCopy(LCUI_MappedFile file)
+{
+	FILE *fp;
+	long size;
+	unsigned char *data;
+
+	fp = fopen(file->path, "rb");
+	if (!fp) {
+		return -ENOENT;
+	}
+	if (fseek(fp, 0, SEEK_END) != 0 || (size = ftell(fp)) < 0) {
+		fclose(fp);
+		return -1;
+	}
+	rewind(fp);
+	data = malloc(size > 0 ? size : 1);
+	if (!data) {
+		fclose(fp);
+		return -ENOMEM;
+	}
+	if (fread(data, 1, size, fp) != (size_t)size) {
+		free(data);
+		fclose(fp);
+		return -1;
+	}
+	fclose(fp);
+	file->data = data;
+	file->size = size;
+	file->is_copy = TRUE;
+	return 0;
+}
+
+#if defined(LCUI_BUILD_IN_WIN32) || (_WIN32)
+
+static int MappedFile_Open(LCUI_MappedFile file)
+{
+	HANDLE fh, mh;
+	LARGE_INTEGER size;
+	void *data;
+
+	fh = CreateFileA(file->path, GENERIC_READ, FILE_SHARE_READ, NULL,
+			 OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (fh == INVALID_HANDLE_VALUE) {
+		return -ENOENT;
+	}
+	if (!GetFileSizeEx(fh, &size) || size.QuadPart < 1) {
+		CloseHandle(fh);
+		return MappedFile_ReadCopy(file);
+	}
+	mh = CreateFileMappingA(fh, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mh) {
+		CloseHandle(fh);
+		return MappedFile_ReadCopy(file);
+	}
+	data = MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0);
+	if (!data) {
+		CloseHandle(mh);
+		CloseHandle(fh);
+		return MappedFile_ReadCopy(file);
+	}
+	file->data = data;
+	file->size = (size_t)size.QuadPart;
+	file->file_handle = fh;
+	file->mapping_handle = mh;
+	return 0;
+}
+
+static void MappedFile_Close(LCUI_MappedFile file)
+{
+	if (file->is_copy) {
+		free((void *)file->data);
+		return;
+	}
+	UnmapViewOfFile(file->data);
+	CloseHandle(file->mapping_handle);
+	CloseHandle(file->file_handle);
+}
+
+#else
+
+static int MappedFile_Open(LCUI_MappedFile file)
+{
+	int fd;
+	void *data;
+	struct stat st;
+
+	fd = open(file->path, O_RDONLY);
+	if (fd < 0) {
+		return -ENOENT;
+	}
+	if (fstat(fd, &st) != 0 || st.st_size < 1) {
+		close(fd);
+		return MappedFile_ReadCopy(file);
+	}
+	data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	/* The mapping keeps its own reference to the file */
+	close(fd);
+	if (data == MAP_FAILED) {
+		return MappedFile_ReadCopy(file);
+	}
+	file->data = data;
+	file->size = st.st_size;
+	return 0;
+}
+
+static void MappedFile_Close(LCUI_MappedFile file)
+{
+	if (file->is_copy) {
+		free((void *)file->data);
+		return;
+	}
+	munmap((void *)file->data, file->size);
+}
+
+#endif
+
+static LCUI_MappedFile MappedFile_New(const char *path)
+{
+	LCUI_MappedFile file;
+
+	file = NEW(LCUI_MappedFileRec, 1);
+	if (!file) {
+		return NULL;
+	}
+	file->path = strdup2(path);
+	if (!file->path || MappedFile_Open(file) != 0) {
+		free(file->path);
+		free(file);
+		return NULL;
+	}
+	file->refs = 1;
+	return file;
+}
+
+LCUI_MappedFile LCUI_MapFile(const char *path)
+{
+	LCUI_MappedFile file;
+
+	/* Before LCUI_InitMappedFiles() the mapping is not shared */
+	if (!self.inited) {
+		return MappedFile_New(path);
+	}
+	LCUIMutex_Lock(&self.mutex);
+	file = Dict_FetchValue(self.files, path);
+	if (file) {
+		file->refs++;
+		LCUIMutex_Unlock(&self.mutex);
+		return file;
+	}
+	file = MappedFile_New(path);
+	if (file) {
+		Dict_Add(self.files, file->path, file);
+	}
+	LCUIMutex_Unlock(&self.mutex);
+	return file;
+}
+
+void LCUI_UnmapFile(LCUI_MappedFile file)
+{
+	if (self.inited) {
+		LCUIMutex_Lock(&self.mutex);
+		if (file->refs > 1) {
+			file->refs--;
+			LCUIMutex_Unlock(&self.mutex);
+			return;
+		}
+		/* The file may be mapped before the module is initialized */
+		if (Dict_FetchValue(self.files, file->path) == file) {
+			Dict_Delete(self.files, file->path);
+		}
+		LCUIMutex_Unlock(&self.mutex);
+	}
+	MappedFile_Close(file);
+	free(file->path);
+	free(file);
+}
+
+void LCUI_InitMappedFiles(void)
+{
+	if (self.inited) {
+		return;
+	}
+	Dict_InitStringKeyType(&self.dtype);
+	self.files = Dict_Create(&self.dtype, NULL);
+	LCUIMutex_Init(&self.mutex);
+	self.inited = TRUE;
+}
+
+void LCUI_FreeMappedFiles(void)
+{
+	if (!self.inited) {
+		return;
+	}
+	self.inited = FALSE;
+	Dict_Release(self.files);
+	LCUIMutex_Destroy(&self.mutex);
+	self.files = NULL;
+}
@@ -33,6 +33,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <LCUI_Build.h>
+#include <LCUI/types.h>
 #include <LCUI/util/object.h>
 #include <LCUI/util/string.h>
 #include <LCUI/util/charset.h>
@@ -44,6 +45,9 @@ typedef struct LCUI_ObjectWatcherRec_ {
 	LinkedListNode node;
 } LCUI_ObjectWatcherRec;
 
+/** Objects waiting to notify their watchers in deferred mode */
+static LinkedList notify_queue;
+
 LCUI_ObjectType ObjectType_New(const char *name)
 {
 	LCUI_ObjectType type;
@@ -71,6 +75,10 @@ void Object_Init(LCUI_Object object, const LCUI_ObjectTypeRec *type)
 	object->type = type;
 	object->watchers = NULL;
 	object->value.data = NULL;
+	object->deferred_notify = FALSE;
+	object->notify_node.data = object;
+	object->notify_node.prev = NULL;
+	object->notify_node.next = NULL;
 	if (type && type->init) {
 		type->init(object);
 	}
@@ -81,6 +89,9 @@ void Object_Destroy(LCUI_Object object)
 	if (object->type && object->type->destroy) {
 		object->type->destroy(object);
 	}
+	if (object->notify_node.prev) {
+		LinkedList_Unlink(&notify_queue, &object->notify_node);
+	}
 	if (object->watchers) {
 		LinkedList_ClearData(object->watchers, free);
 		free(object->watchers);
@@ -172,7 +183,7 @@ LCUI_ObjectWatcher Object_Watch(LCUI_Object object, LCUI_ObjectWatcherFunc func,
 	return watcher;
 }
 
-size_t Object_Notify(LCUI_Object object)
+static size_t Object_CallWatchers(LCUI_Object object)
 {
 	size_t count = 0;
 	LinkedListNode *node;
@@ -189,6 +200,50 @@ size_t Object_Notify(LCUI_Object object)
 	return count;
 }
 
+size_t Object_Notify(LCUI_Object object)
+{
+	if (!object->deferred_notify) {
+		return Object_CallWatchers(object);
+	}
+	if (!object->watchers || object->watchers->length < 1) {
+		return 0;
+	}
+	/* The object will be notified only once no matter how many times
+	 * it changes before the next flush */
+	if (!object->notify_node.prev) {
+		LinkedList_AppendNode(&notify_queue, &object->notify_node);
+	}
+	return 0;
+}
+
+void Object_SetDeferredNotify(LCUI_Object object, LCUI_BOOL deferred)
+{
+	object->deferred_notify = deferred;
+	if (!deferred && object->notify_node.prev) {
+		LinkedList_Unlink(&notify_queue, &object->notify_node);
+		Object_CallWatchers(object);
+	}
+}
+
+size_t Object_FlushNotifications(void)
+{
+	size_t n;
+	size_t count = 0;
+	LinkedListNode *node;
+
+	/* Only flush the objects queued before this call, so that watchers
+	 * that change the value again cannot keep this loop running */
+	for (n = notify_queue.length; n > 0; --n) {
+		node = notify_queue.head.next;
+		if (!node) {
+			break;
+		}
+		LinkedList_Unlink(&notify_queue, node);
+		count += Object_CallWatchers(node->data);
+	}
+	return count;
+}
+
 void ObjectWatcher_Delete(LCUI_ObjectWatcher watcher)
 {
 	LinkedList_Unlink(watcher->target->watchers, &watcher->node);
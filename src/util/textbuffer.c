@@ -0,0 +1,909 @@
+/*
+ * textbuffer.c -- Piece table text buffer
+ *
+ * Copyright (c) 2020, Liu chao <lc-soft@live.cn> All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of LCUI nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <wctype.h>
+#include <LCUI_Build.h>
+#include <LCUI/types.h>
+#include <LCUI/util/math.h>
+#include <LCUI/util/textbuffer.h>
+
+/** the default capacity of the chunks for inserted text */
+#define CHUNK_SIZE 4096
+
+/**
+ * the maximum number of versions kept for undo and redo, it is documented
+ * in TextBuffer_Undo()
+ */
+#define HISTORY_SIZE 256
+
+/**
+ * Read-only characters referenced by pieces
+ * The inserted text is appended to the current chunk and never changed
+ * after that, so the pieces of old versions stay valid.
+ */
+typedef struct TextChunkRec_ {
+	unsigned refs;
+	const wchar_t *text;
+	size_t length;
+	size_t capacity;
+
+	/** offsets of '\n' in ascending order, for line lookup */
+	size_t *newlines;
+	size_t n_newlines;
+	size_t newlines_capacity;
+
+	/** release the external text, NULL if the text is owned */
+	void (*destroy)(void *);
+	void *arg;
+} TextChunkRec, *TextChunk;
+
+/**
+ * Node of the persistent treap of pieces
+ * Nodes are immutable once created and are shared between versions, an
+ * edit copies only the nodes on the paths it changes.
+ */
+typedef struct TextNodeRec_ {
+	unsigned refs;
+	unsigned priority;
+	TextChunk chunk;
+	size_t offset;
+	size_t length;
+	size_t lines;
+	size_t total_length;
+	size_t total_lines;
+	struct TextNodeRec_ *left;
+	struct TextNodeRec_ *right;
+} TextNodeRec, *TextNode;
+
+typedef enum TextEditType {
+	TEXT_EDIT_NONE,
+	TEXT_EDIT_INSERT,
+	TEXT_EDIT_DELETE,
+	TEXT_EDIT_REPLACE
+} TextEditType;
+
+typedef struct TextVersionRec_ {
+	TextNode root;
+	/** the edit which made this version from the previous one */
+	TextEditType type;
+	/**
+	 * the range of the edit, it is the inserted range in this version, or
+	 * the deleted range in the previous version
+	 */
+	size_t start, end;
+} TextVersionRec, *TextVersion;
+
+struct LCUI_TextSnapshotRec_ {
+	TextNode root;
+};
+
+struct LCUI_TextBufferRec_ {
+	unsigned seed;
+	TextChunk chunk;
+	size_t n_versions;
+	size_t current;
+	TextVersionRec versions[HISTORY_SIZE];
+};
+
+static TextChunk TextChunk_New(size_t capacity)
+{
+	TextChunk chunk = malloc(sizeof(TextChunkRec));
+	wchar_t *text = malloc(sizeof(wchar_t) * capacity);
+
+	if (!chunk || !text) {
+		free(chunk);
+		free(text);
+		return NULL;
+	}
+	chunk->refs = 1;
+	chunk->text = text;
+	chunk->length = 0;
+	chunk->capacity = capacity;
+	chunk->newlines = NULL;
+	chunk->n_newlines = 0;
+	chunk->newlines_capacity = 0;
+	chunk->destroy = NULL;
+	chunk->arg = NULL;
+	return chunk;
+}
+
+static void TextChunk_Release(TextChunk chunk)
+{
+	if (--chunk->refs > 0) {
+		return;
+	}
+	if (chunk->destroy) {
+		chunk->destroy(chunk->arg);
+	} else {
+		free((wchar_t *)chunk->text);
+	}
+	free(chunk->newlines);
+	free(chunk);
+}
+
+/** Record the newlines of the text in [start, end) */
+static int TextChunk_IndexNewlines(TextChunk chunk, size_t start, size_t end)
+{
+	size_t i, capacity;
+	size_t *newlines;
+
+	for (i = start; i < end; ++i) {
+		if (chunk->text[i] != '\n') {
+			continue;
+		}
+		if (chunk->n_newlines >= chunk->newlines_capacity) {
+			capacity = max(chunk->newlines_capacity * 2, 16);
+			newlines = realloc(chunk->newlines,
+					   sizeof(size_t) * capacity);
+			if (!newlines) {
+				return -ENOMEM;
+			}
+			chunk->newlines = newlines;
+			chunk->newlines_capacity = capacity;
+		}
+		chunk->newlines[chunk->n_newlines++] = i;
+	}
+	return 0;
+}
+
+static int TextChunk_Append(TextChunk chunk, const wchar_t *text, size_t len)
+{
+	size_t start = chunk->length;
+
+	memcpy((wchar_t *)chunk->text + start, text, sizeof(wchar_t) * len);
+	if (TextChunk_IndexNewlines(chunk, start, start + len) != 0) {
+		/* Drop the partially indexed newlines */
+		while (chunk->n_newlines > 0 &&
+		       chunk->newlines[chunk->n_newlines - 1] >= start) {
+			chunk->n_newlines--;
+		}
+		return -ENOMEM;
+	}
+	chunk->length += len;
+	return 0;
+}
+
+/** Get the index of the first newline at or after the offset */
+static size_t TextChunk_FindNewline(TextChunk chunk, size_t offset)
+{
+	size_t low = 0, high = chunk->n_newlines, mid;
+
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		if (chunk->newlines[mid] < offset) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return low;
+}
+
+INLINE size_t TextChunk_CountLines(TextChunk chunk, size_t offset, size_t len)
+{
+	return TextChunk_FindNewline(chunk, offset + len) -
+	       TextChunk_FindNewline(chunk, offset);
+}
+
+INLINE size_t TextNode_GetLength(TextNode node)
+{
+	return node ? node->total_length : 0;
+}
+
+INLINE size_t TextNode_GetLines(TextNode node)
+{
+	return node ? node->total_lines : 0;
+}
+
+INLINE TextNode TextNode_Ref(TextNode node)
+{
+	if (node) {
+		node->refs++;
+	}
+	return node;
+}
+
+static void TextNode_Release(TextNode node)
+{
+	TextNode right;
+
+	/* Walk down the right spine iteratively, a long chain of released
+	 * nodes should not overflow the stack */
+	while (node && --node->refs == 0) {
+		right = node->right;
+		TextNode_Release(node->left);
+		TextChunk_Release(node->chunk);
+		free(node);
+		node = right;
+	}
+}
+
+/**
+ * Create a node, it takes over the references of left and right
+ * @returns NULL if there is not enough memory, left and right are released
+ */
+static TextNode TextNode_New(TextChunk chunk, size_t offset, size_t length,
+			     size_t lines, unsigned priority, TextNode left,
+			     TextNode right)
+{
+	TextNode node = malloc(sizeof(TextNodeRec));
+
+	if (!node) {
+		TextNode_Release(left);
+		TextNode_Release(right);
+		return NULL;
+	}
+	chunk->refs++;
+	node->refs = 1;
+	node->priority = priority;
+	node->chunk = chunk;
+	node->offset = offset;
+	node->length = length;
+	node->lines = lines;
+	node->left = left;
+	node->right = right;
+	node->total_length =
+	    TextNode_GetLength(left) + length + TextNode_GetLength(right);
+	node->total_lines =
+	    TextNode_GetLines(left) + lines + TextNode_GetLines(right);
+	return node;
+}
+
+INLINE TextNode TextNode_Copy(TextNode node, TextNode left, TextNode right)
+{
+	return TextNode_New(node->chunk, node->offset, node->length,
+			    node->lines, node->priority, left, right);
+}
+
+/**
+ * Split a tree into the first pos characters and the rest
+ * The input tree is not changed, the output trees are new references.
+ * @returns 0 on success, -ENOMEM on failure and no tree is output
+ */
+static int TextNode_Split(TextNode node, size_t pos, TextNode *left,
+			  TextNode *right)
+{
+	size_t left_len, lines;
+	TextNode tmp;
+
+	if (!node) {
+		*left = *right = NULL;
+		return 0;
+	}
+	if (pos == 0) {
+		*left = NULL;
+		*right = TextNode_Ref(node);
+		return 0;
+	}
+	if (pos >= node->total_length) {
+		*left = TextNode_Ref(node);
+		*right = NULL;
+		return 0;
+	}
+	left_len = TextNode_GetLength(node->left);
+	if (pos <= left_len) {
+		if (TextNode_Split(node->left, pos, left, &tmp) != 0) {
+			return -ENOMEM;
+		}
+		*right = TextNode_Copy(node, tmp, TextNode_Ref(node->right));
+		if (!*right) {
+			TextNode_Release(*left);
+			return -ENOMEM;
+		}
+	} else if (pos >= left_len + node->length) {
+		if (TextNode_Split(node->right, pos - left_len - node->length,
+				   &tmp, right) != 0) {
+			return -ENOMEM;
+		}
+		*left = TextNode_Copy(node, TextNode_Ref(node->left), tmp);
+		if (!*left) {
+			TextNode_Release(*right);
+			return -ENOMEM;
+		}
+	} else {
+		pos -= left_len;
+		lines = TextChunk_CountLines(node->chunk, node->offset, pos);
+		*left = TextNode_New(node->chunk, node->offset, pos, lines,
+				     node->priority, TextNode_Ref(node->left),
+				     NULL);
+		if (!*left) {
+			return -ENOMEM;
+		}
+		*right = TextNode_New(node->chunk, node->offset + pos,
+				      node->length - pos, node->lines - lines,
+				      node->priority, NULL,
+				      TextNode_Ref(node->right));
+		if (!*right) {
+			TextNode_Release(*left);
+			return -ENOMEM;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Concatenate two trees, the result is a new reference
+ * @returns 0 on success, -ENOMEM on failure and no tree is output
+ */
+static int TextNode_Merge(TextNode a, TextNode b, TextNode *out)
+{
+	TextNode tmp;
+
+	if (!a) {
+		*out = TextNode_Ref(b);
+		return 0;
+	}
+	if (!b) {
+		*out = TextNode_Ref(a);
+		return 0;
+	}
+	if (a->priority > b->priority) {
+		if (TextNode_Merge(a->right, b, &tmp) != 0) {
+			return -ENOMEM;
+		}
+		*out = TextNode_Copy(a, TextNode_Ref(a->left), tmp);
+	} else {
+		if (TextNode_Merge(a, b->left, &tmp) != 0) {
+			return -ENOMEM;
+		}
+		*out = TextNode_Copy(b, tmp, TextNode_Ref(b->right));
+	}
+	return *out ? 0 : -ENOMEM;
+}
+
+static TextNode TextNode_GetLast(TextNode node)
+{
+	while (node && node->right) {
+		node = node->right;
+	}
+	return node;
+}
+
+/**
+ * Copy the tree with its last piece extended
+ * @returns NULL if there is not enough memory
+ */
+static TextNode TextNode_ExtendLast(TextNode node, size_t len, size_t lines)
+{
+	TextNode right;
+
+	if (node->right) {
+		right = TextNode_ExtendLast(node->right, len, lines);
+		if (!right) {
+			return NULL;
+		}
+		return TextNode_Copy(node, TextNode_Ref(node->left), right);
+	}
+	return TextNode_New(node->chunk, node->offset, node->length + len,
+			    node->lines + lines, node->priority,
+			    TextNode_Ref(node->left), NULL);
+}
+
+static size_t TextNode_CopyText(TextNode node, size_t pos, size_t len,
+				wchar_t *out)
+{
+	size_t n, count = 0;
+	size_t left_len;
+
+	if (!node || len == 0) {
+		return 0;
+	}
+	left_len = TextNode_GetLength(node->left);
+	if (pos < left_len) {
+		count = TextNode_CopyText(node->left, pos, len, out);
+		pos = 0;
+	} else {
+		pos -= left_len;
+	}
+	if (pos < node->length) {
+		n = min(node->length - pos, len - count);
+		memcpy(out + count, node->chunk->text + node->offset + pos,
+		       sizeof(wchar_t) * n);
+		count += n;
+		pos = 0;
+	} else {
+		pos -= node->length;
+	}
+	return count + TextNode_CopyText(node->right, pos, len - count,
+					 out + count);
+}
+
+static unsigned TextBuffer_Random(LCUI_TextBuffer buf)
+{
+	/* xorshift32 */
+	buf->seed ^= buf->seed << 13;
+	buf->seed ^= buf->seed >> 17;
+	buf->seed ^= buf->seed << 5;
+	return buf->seed;
+}
+
+INLINE TextNode TextBuffer_GetRoot(LCUI_TextBuffer buf)
+{
+	return buf->versions[buf->current].root;
+}
+
+/** Drop the versions which can be redone */
+static void TextBuffer_DropRedo(LCUI_TextBuffer buf)
+{
+	while (buf->n_versions > buf->current + 1) {
+		buf->n_versions--;
+		TextNode_Release(buf->versions[buf->n_versions].root);
+	}
+}
+
+/** Add a version, it takes over the reference of root */
+static void TextBuffer_Commit(LCUI_TextBuffer buf, TextNode root,
+			      TextEditType type, size_t start, size_t end)
+{
+	TextVersion ver;
+
+	TextBuffer_DropRedo(buf);
+	if (buf->n_versions >= HISTORY_SIZE) {
+		TextNode_Release(buf->versions[0].root);
+		memmove(buf->versions, buf->versions + 1,
+			sizeof(TextVersionRec) * (buf->n_versions - 1));
+		buf->n_versions--;
+	}
+	buf->current = buf->n_versions++;
+	ver = &buf->versions[buf->current];
+	ver->root = root;
+	ver->type = type;
+	ver->start = start;
+	ver->end = end;
+}
+
+/** Replace the current version, it is used to merge continuous typing */
+static void TextBuffer_Amend(LCUI_TextBuffer buf, TextNode root, size_t start,
+			     size_t end)
+{
+	TextVersion ver = &buf->versions[buf->current];
+
+	TextNode_Release(ver->root);
+	ver->root = root;
+	ver->start = start;
+	ver->end = end;
+}
+
+/**
+ * Check whether an edit can be merged into the current version
+ * Single characters typed or deleted one after another are undone as a
+ * whole, until a whitespace or a jump of the position.
+ */
+static LCUI_BOOL TextBuffer_CanMerge(LCUI_TextBuffer buf, TextEditType type,
+				     size_t pos, const wchar_t *text)
+{
+	TextVersion ver = &buf->versions[buf->current];
+
+	if (buf->current == 0 || buf->current + 1 != buf->n_versions ||
+	    ver->type != type) {
+		return FALSE;
+	}
+	if (type == TEXT_EDIT_INSERT) {
+		return pos == ver->end && !iswspace(text[0]);
+	}
+	return pos + 1 == ver->start || pos == ver->start;
+}
+
+static int TextBuffer_InsertPiece(LCUI_TextBuffer buf, size_t pos,
+				  TextChunk chunk, size_t offset, size_t len,
+				  LCUI_BOOL merge)
+{
+	int ret = 0;
+	size_t lines;
+	TextNode left, right, last, node, tmp, root;
+
+	root = TextBuffer_GetRoot(buf);
+	pos = min(pos, TextNode_GetLength(root));
+	lines = TextChunk_CountLines(chunk, offset, len);
+	if (TextNode_Split(root, pos, &left, &right) != 0) {
+		return -ENOMEM;
+	}
+	last = TextNode_GetLast(left);
+	/* Text typed at the same place is contiguous in the chunk, extend
+	 * the last piece instead of adding a new one */
+	if (last && last->chunk == chunk &&
+	    last->offset + last->length == offset) {
+		tmp = TextNode_ExtendLast(left, len, lines);
+		if (!tmp) {
+			ret = -ENOMEM;
+		}
+	} else {
+		node = TextNode_New(chunk, offset, len, lines,
+				    TextBuffer_Random(buf), NULL, NULL);
+		if (node) {
+			ret = TextNode_Merge(left, node, &tmp);
+			TextNode_Release(node);
+		} else {
+			ret = -ENOMEM;
+		}
+	}
+	if (ret == 0) {
+		ret = TextNode_Merge(tmp, right, &root);
+		TextNode_Release(tmp);
+	}
+	TextNode_Release(left);
+	TextNode_Release(right);
+	/* The current version is kept as is on failure */
+	if (ret != 0) {
+		return ret;
+	}
+	if (merge) {
+		TextBuffer_Amend(buf, root, buf->versions[buf->current].start,
+				 pos + len);
+	} else {
+		TextBuffer_Commit(buf, root, TEXT_EDIT_INSERT, pos, pos + len);
+	}
+	return 0;
+}
+
+LCUI_TextBuffer TextBuffer_New(void)
+{
+	LCUI_TextBuffer buf = malloc(sizeof(struct LCUI_TextBufferRec_));
+
+	if (!buf) {
+		return NULL;
+	}
+	buf->seed = 2463534242u;
+	buf->chunk = NULL;
+	buf->n_versions = 1;
+	buf->current = 0;
+	buf->versions[0].root = NULL;
+	buf->versions[0].type = TEXT_EDIT_NONE;
+	buf->versions[0].start = 0;
+	buf->versions[0].end = 0;
+	return buf;
+}
+
+void TextBuffer_Destroy(LCUI_TextBuffer buf)
+{
+	size_t i;
+
+	for (i = 0; i < buf->n_versions; ++i) {
+		TextNode_Release(buf->versions[i].root);
+	}
+	if (buf->chunk) {
+		TextChunk_Release(buf->chunk);
+	}
+	free(buf);
+}
+
+size_t TextBuffer_GetLength(LCUI_TextBuffer buf)
+{
+	return TextNode_GetLength(TextBuffer_GetRoot(buf));
+}
+
+size_t TextBuffer_GetLineCount(LCUI_TextBuffer buf)
+{
+	return TextNode_GetLines(TextBuffer_GetRoot(buf)) + 1;
+}
+
+size_t TextBuffer_GetLineStart(LCUI_TextBuffer buf, size_t line)
+{
+	size_t i, pos = 0, left_lines;
+	TextNode node = TextBuffer_GetRoot(buf);
+
+	if (line == 0 || !node) {
+		return 0;
+	}
+	if (line > node->total_lines) {
+		return node->total_length;
+	}
+	/* Find the line-th newline, the line starts after it */
+	while (node) {
+		left_lines = TextNode_GetLines(node->left);
+		if (line <= left_lines) {
+			node = node->left;
+			continue;
+		}
+		line -= left_lines;
+		pos += TextNode_GetLength(node->left);
+		if (line <= node->lines) {
+			i = TextChunk_FindNewline(node->chunk, node->offset);
+			i += line - 1;
+			return pos + node->chunk->newlines[i] - node->offset + 1;
+		}
+		line -= node->lines;
+		pos += node->length;
+		node = node->right;
+	}
+	return pos;
+}
+
+size_t TextBuffer_GetLineIndex(LCUI_TextBuffer buf, size_t pos)
+{
+	size_t line = 0, left_len;
+	TextNode node = TextBuffer_GetRoot(buf);
+
+	while (node) {
+		left_len = TextNode_GetLength(node->left);
+		if (pos < left_len) {
+			node = node->left;
+			continue;
+		}
+		line += TextNode_GetLines(node->left);
+		pos -= left_len;
+		if (pos <= node->length) {
+			line += TextChunk_CountLines(node->chunk, node->offset,
+						     pos);
+			break;
+		}
+		line += node->lines;
+		pos -= node->length;
+		node = node->right;
+	}
+	return line;
+}
+
+int TextBuffer_Insert(LCUI_TextBuffer buf, size_t pos, const wchar_t *text,
+		      size_t len)
+{
+	size_t offset;
+	LCUI_BOOL merge;
+	TextChunk chunk = buf->chunk;
+
+	if (len == 0) {
+		return 0;
+	}
+	if (!chunk || chunk->capacity - chunk->length < len) {
+		chunk = TextChunk_New(max(len, CHUNK_SIZE));
+		if (!chunk) {
+			return -ENOMEM;
+		}
+		if (buf->chunk) {
+			TextChunk_Release(buf->chunk);
+		}
+		buf->chunk = chunk;
+	}
+	offset = chunk->length;
+	if (TextChunk_Append(chunk, text, len) != 0) {
+		return -ENOMEM;
+	}
+	merge = len == 1 && TextBuffer_CanMerge(buf, TEXT_EDIT_INSERT, pos, text);
+	return TextBuffer_InsertPiece(buf, pos, chunk, offset, len, merge);
+}
+
+int TextBuffer_InsertExternal(LCUI_TextBuffer buf, size_t pos,
+			      const wchar_t *text, size_t len,
+			      void (*destroy)(void *), void *arg)
+{
+	int ret;
+	TextChunk chunk;
+
+	chunk = malloc(sizeof(TextChunkRec));
+	if (!chunk) {
+		return -ENOMEM;
+	}
+	chunk->refs = 1;
+	chunk->text = text;
+	chunk->length = len;
+	chunk->capacity = len;
+	chunk->newlines = NULL;
+	chunk->n_newlines = 0;
+	chunk->newlines_capacity = 0;
+	chunk->destroy = NULL;
+	chunk->arg = NULL;
+	if (TextChunk_IndexNewlines(chunk, 0, len) != 0) {
+		free(chunk->newlines);
+		free(chunk);
+		return -ENOMEM;
+	}
+	chunk->destroy = destroy;
+	chunk->arg = arg;
+	if (len > 0) {
+		ret = TextBuffer_InsertPiece(buf, pos, chunk, 0, len, FALSE);
+	} else {
+		ret = 0;
+	}
+	/* The text is still owned by the caller if it was not inserted */
+	if (ret != 0) {
+		chunk->destroy = NULL;
+		chunk->text = NULL;
+	}
+	/* The pieces keep their own references */
+	TextChunk_Release(chunk);
+	return ret;
+}
+
+int TextBuffer_Delete(LCUI_TextBuffer buf, size_t pos, size_t len)
+{
+	int ret;
+	size_t length;
+	TextVersion ver;
+	TextNode left, mid, right, rest, root;
+
+	root = TextBuffer_GetRoot(buf);
+	length = TextNode_GetLength(root);
+	if (pos >= length || len == 0) {
+		return 0;
+	}
+	len = min(len, length - pos);
+	if (TextNode_Split(root, pos, &left, &rest) != 0) {
+		return -ENOMEM;
+	}
+	ret = TextNode_Split(rest, len, &mid, &right);
+	TextNode_Release(rest);
+	if (ret == 0) {
+		ret = TextNode_Merge(left, right, &root);
+		TextNode_Release(mid);
+		TextNode_Release(right);
+	}
+	TextNode_Release(left);
+	if (ret != 0) {
+		return ret;
+	}
+	if (len == 1 && TextBuffer_CanMerge(buf, TEXT_EDIT_DELETE, pos, NULL)) {
+		ver = &buf->versions[buf->current];
+		if (pos + 1 == ver->start) {
+			TextBuffer_Amend(buf, root, pos, ver->end);
+		} else {
+			TextBuffer_Amend(buf, root, ver->start, ver->end + 1);
+		}
+		return 0;
+	}
+	TextBuffer_Commit(buf, root, TEXT_EDIT_DELETE, pos, pos + len);
+	return 0;
+}
+
+void TextBuffer_Clear(LCUI_TextBuffer buf)
+{
+	TextBuffer_Delete(buf, 0, TextBuffer_GetLength(buf));
+}
+
+size_t TextBuffer_GetText(LCUI_TextBuffer buf, size_t pos, size_t max_len,
+			  wchar_t *out)
+{
+	size_t len;
+
+	len = TextNode_CopyText(TextBuffer_GetRoot(buf), pos, max_len, out);
+	out[len] = 0;
+	return len;
+}
+
+size_t TextBuffer_GetChunk(LCUI_TextBuffer buf, size_t pos,
+			   const wchar_t **text)
+{
+	size_t left_len;
+	TextNode node = TextBuffer_GetRoot(buf);
+
+	while (node) {
+		left_len = TextNode_GetLength(node->left);
+		if (pos < left_len) {
+			node = node->left;
+			continue;
+		}
+		pos -= left_len;
+		if (pos < node->length) {
+			*text = node->chunk->text + node->offset + pos;
+			return node->length - pos;
+		}
+		pos -= node->length;
+		node = node->right;
+	}
+	*text = NULL;
+	return 0;
+}
+
+/** Get the change which made the i-th version from the previous one */
+static void TextBuffer_GetChange(LCUI_TextBuffer buf, size_t i,
+				 LCUI_TextChange change)
+{
+	TextVersion ver = &buf->versions[i];
+
+	change->start = ver->start;
+	change->deleted = 0;
+	change->inserted = 0;
+	switch (ver->type) {
+	case TEXT_EDIT_INSERT:
+		change->inserted = ver->end - ver->start;
+		break;
+	case TEXT_EDIT_DELETE:
+		change->deleted = ver->end - ver->start;
+		break;
+	case TEXT_EDIT_REPLACE:
+		change->start = 0;
+		change->deleted = TextNode_GetLength(buf->versions[i - 1].root);
+		change->inserted = TextNode_GetLength(ver->root);
+		break;
+	default:
+		break;
+	}
+}
+
+int TextBuffer_Undo(LCUI_TextBuffer buf, LCUI_TextChange change)
+{
+	size_t n;
+
+	if (buf->current == 0) {
+		return -1;
+	}
+	if (change) {
+		TextBuffer_GetChange(buf, buf->current, change);
+		n = change->deleted;
+		change->deleted = change->inserted;
+		change->inserted = n;
+	}
+	buf->current--;
+	return 0;
+}
+
+int TextBuffer_Redo(LCUI_TextBuffer buf, LCUI_TextChange change)
+{
+	if (buf->current + 1 >= buf->n_versions) {
+		return -1;
+	}
+	buf->current++;
+	if (change) {
+		TextBuffer_GetChange(buf, buf->current, change);
+	}
+	return 0;
+}
+
+void TextBuffer_ClearHistory(LCUI_TextBuffer buf)
+{
+	size_t i;
+	TextVersionRec ver = buf->versions[buf->current];
+
+	for (i = 0; i < buf->n_versions; ++i) {
+		if (i != buf->current) {
+			TextNode_Release(buf->versions[i].root);
+		}
+	}
+	ver.type = TEXT_EDIT_NONE;
+	buf->versions[0] = ver;
+	buf->n_versions = 1;
+	buf->current = 0;
+}
+
+LCUI_TextSnapshot TextBuffer_GetSnapshot(LCUI_TextBuffer buf)
+{
+	LCUI_TextSnapshot snapshot;
+
+	snapshot = malloc(sizeof(struct LCUI_TextSnapshotRec_));
+	if (!snapshot) {
+		return NULL;
+	}
+	snapshot->root = TextNode_Ref(TextBuffer_GetRoot(buf));
+	return snapshot;
+}
+
+void TextBuffer_SetSnapshot(LCUI_TextBuffer buf, LCUI_TextSnapshot snapshot)
+{
+	TextBuffer_Commit(buf, TextNode_Ref(snapshot->root), TEXT_EDIT_REPLACE,
+			  0, TextNode_GetLength(snapshot->root));
+}
+
+void TextSnapshot_Release(LCUI_TextSnapshot snapshot)
+{
+	TextNode_Release(snapshot->root);
+	free(snapshot);
+}
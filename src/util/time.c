@@ -78,7 +78,16 @@ int64_t LCUI_GetTime(void)
 {
 	int64_t t;
 	struct timeval tv;
-
+#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+
+	/* Use the monotonic clock so that timers and input timestamps are not
+	 * affected by the changes of the system time */
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {
+		t = (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+		return t;
+	}
+#endif
 	gettimeofday(&tv, NULL);
 	t = tv.tv_sec * 1000 + tv.tv_usec / 1000;
 	return t;